@@ -10,13 +10,20 @@ HEADERS += \
            ../common/include/fixedcamera.h \
            ../common/include/scene.h \
            ../common/include/trackballcamera.h \
-           src/texscene.h
+           src/texscene.h \
+           ../common/include/headlessrunner.h \
+           ../common/include/tracelog.h \
+           ../common/include/bufferhash.h \
+           ../common/include/fnv1a.h
 SOURCES += src/main.cpp \
            ../common/src/camera.cpp \
            ../common/src/fixedcamera.cpp \
            ../common/src/scene.cpp \
            ../common/src/trackballcamera.cpp \
-           src/texscene.cpp
+           src/texscene.cpp \
+           ../common/src/headlessrunner.cpp \
+           ../common/src/tracelog.cpp \
+           ../common/src/bufferhash.cpp
 
 OTHER_FILES += shaders/tex_frag.glsl \
 	       shaders/tex_vert.glsl 
@@ -1,5 +1,7 @@
 // Must include our scene first because of GL dependency order
 #include "texscene.h"
+#include "headlessrunner.h"
+#include "tracelog.h"
 
 // This will probably already be included by a scene file
 //#include "glinclude.h"
@@ -79,7 +81,23 @@ void resize_callback(GLFWwindow */*window*/, int width, int height) {
     g_scene.resizeGL(width,height);
 }
 
-int main() {
+int main(int argc, char **argv) {
+    // Without a window, draw a scripted orbit of the scene and report the frame times (see HeadlessRunner)
+    HeadlessRunner::Options options;
+    options.m_width = 1024; options.m_height = 1024;
+    options.m_glMinor = 3;
+    options.m_eye = glm::vec3(0.0f, 10.0f, 15.0f);
+    options.m_target = glm::vec3(0.0f, 1.0f, 0.0f);
+    int exitCode;
+    if (HeadlessRunner::runIfRequested(argc, argv, g_scene, options, exitCode, nullptr,
+                                       [](const glm::vec3 &eye, const glm::vec3 &target) {
+                                           g_scene.setEye(eye);
+                                           g_scene.setTarget(target);
+                                       })) return exitCode;
+
+    // With --trace file.json, record where start up and each frame spend their time (see TraceLog)
+    if (!options.m_traceFile.empty()) TraceLog::start();
+
     if (!glfwInit()) {
         // Initialisation failed
         glfwTerminate();
@@ -162,4 +180,5 @@ int main() {
     // Close up shop
     glfwDestroyWindow(window);
     glfwTerminate();
+    if (!options.m_traceFile.empty()) TraceLog::write(options.m_traceFile);
 }
@@ -1,4 +1,5 @@
 #include "texscene.h"
+#include "tracelog.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/ext.hpp>
@@ -22,6 +23,8 @@ TexScene::TexScene() : Scene() {
  * @brief ObjLoaderScene::initGL
  */
 void TexScene::initGL() noexcept {
+    TraceScope trace("TexScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -36,7 +39,9 @@ void TexScene::initGL() noexcept {
 
     // Create and compile all of our shaders
     ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+    TraceLog::begin("loadShader");
     shader->loadShader("TexProgram","shaders/tex_vert.glsl","shaders/tex_frag.glsl");
+    TraceLog::end("loadShader");
 
     // Create a screen oriented plane
     ngl::VAOPrimitives *prim=ngl::VAOPrimitives::instance();
@@ -46,6 +51,8 @@ void TexScene::initGL() noexcept {
 }
 
 void TexScene::load3DTex() {
+    TraceScope trace("TexScene::load3DTex");
+
     // Retrieve all the file names and sort them appropriately
     DIR *dir;
     struct dirent *ent;
@@ -122,6 +129,8 @@ void TexScene::load3DTex() {
 }
 
 void TexScene::paintGL() noexcept {
+    TraceScope trace("TexScene::paintGL");
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -144,8 +153,7 @@ void TexScene::paintGL() noexcept {
     MVP = m_P * MV;
 
     // Calculate the elapsed time since the programme started
-    auto now = std::chrono::high_resolution_clock::now();
-    double t = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_startTime).count()  * 0.001;
+    double t = elapsedTime(m_startTime);
 
     // Set the viewport resolution
     glUniform3fv(glGetUniformLocation(pid, "iResolution"), 1, glm::value_ptr(glm::vec3(float(m_width), float(m_height), 0.0f)));
@@ -0,0 +1,14 @@
+# The benchmark suite starts each demo with --headless, so it doesn't need OpenGL or common.pri itself
+TEMPLATE = app
+TARGET = benchmark
+
+CONFIG += console c++11 debug
+CONFIG -= qt app_bundle
+
+OBJECTS_DIR = obj
+
+# Input
+SOURCES += src/main.cpp \
+           src/benchmarksuite.cpp
+
+HEADERS += src/benchmarksuite.h
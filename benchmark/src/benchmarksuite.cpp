@@ -0,0 +1,381 @@
+#include "benchmarksuite.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include <unistd.h>
+
+/**
+ * @brief BenchmarkSuite::BenchmarkSuite
+ */
+BenchmarkSuite::BenchmarkSuite() {
+    m_scenes = {"phong", "dof", "shadows", "sdf", "fractal", "fins", "morph", "curv", "noise", "wood",
+                "environment", "shadermaps", "bump", "3dtex", "objviewer"};
+    m_sizes = {{640, 480}, {1280, 720}, {1920, 1080}};
+    m_objectCounts = {5, 500, 5000};
+}
+
+/**
+ * @brief BenchmarkSuite::usage
+ * @param program The name of the executable
+ */
+void BenchmarkSuite::usage(const char *program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --root DIR              The directory holding the built demos (default ..)\n"
+              << "  --out FILE              The results file (default benchmark.json)\n"
+              << "  --frames N              Timed frames per run (default 200)\n"
+              << "  --warmup N              Untimed frames before each run (default 10)\n"
+              << "  --scenes a,b,...        The demos to run (default all of them)\n"
+              << "  --sizes WxH,...         The framebuffer sizes (default 640x480,1280x720,1920x1080)\n"
+              << "  --objects N,...         The object counts for dof and shadows (default 5,500,5000)\n"
+              << "  --compare OLD NEW       Compare two results files instead of running\n"
+              << "  --threshold PCT         The slow down in a median counted as a regression (default 5)\n";
+}
+
+/**
+ * @brief BenchmarkSuite::parseArgs
+ * @param argc The argument count from main()
+ * @param argv The arguments from main()
+ * @return false if an option was unknown or malformed
+ */
+bool BenchmarkSuite::parseArgs(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        const bool hasValue = (i + 1 < argc);
+        if ((arg == "--root") && hasValue) {
+            m_rootDir = argv[++i];
+        } else if ((arg == "--out") && hasValue) {
+            m_outFile = argv[++i];
+        } else if ((arg == "--frames") && hasValue) {
+            m_frames = std::max(1, atoi(argv[++i]));
+        } else if ((arg == "--warmup") && hasValue) {
+            m_warmupFrames = std::max(0, atoi(argv[++i]));
+        } else if ((arg == "--scenes") && hasValue) {
+            m_scenes = split(argv[++i]);
+        } else if ((arg == "--sizes") && hasValue) {
+            m_sizes.clear();
+            for (const std::string &size : split(argv[++i])) {
+                int width, height;
+                if ((sscanf(size.c_str(), "%dx%d", &width, &height) != 2) || (width <= 0) || (height <= 0)) {
+                    std::cerr << "BenchmarkSuite::parseArgs() - expected WxH, not " << size << "\n";
+                    return false;
+                }
+                m_sizes.push_back(std::make_pair(width, height));
+            }
+        } else if ((arg == "--objects") && hasValue) {
+            m_objectCounts.clear();
+            for (const std::string &count : split(argv[++i])) {
+                m_objectCounts.push_back(std::max(1, atoi(count.c_str())));
+            }
+        } else if ((arg == "--compare") && (i + 2 < argc)) {
+            m_compareOld = argv[++i];
+            m_compareNew = argv[++i];
+        } else if ((arg == "--threshold") && hasValue) {
+            m_threshold = atof(argv[++i]);
+        } else {
+            std::cerr << "BenchmarkSuite::parseArgs() - unknown option " << arg << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief BenchmarkSuite::exec
+ * @return The exit code for main()
+ */
+int BenchmarkSuite::exec() {
+    if (!m_compareOld.empty()) return compare(m_compareOld, m_compareNew);
+    return runAll();
+}
+
+/**
+ * @brief BenchmarkSuite::runAll
+ * The reports are written one run to a line so that readResults() can find them again without a JSON parser. The
+ * output of the demos goes to a log file next to the results, to keep the console readable.
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if any run failed or the results couldn't be written
+ */
+int BenchmarkSuite::runAll() {
+    // The demos run in their own directories, so the files they write need absolute paths
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) == nullptr) {
+        std::cerr << "BenchmarkSuite::runAll() - could not find the working directory\n";
+        return EXIT_FAILURE;
+    }
+    const std::string outFile = (m_outFile[0] == '/') ? m_outFile : std::string(cwd) + "/" + m_outFile;
+    const std::string jsonFile = outFile + ".run";
+    const std::string logFile = outFile + ".log";
+    std::ofstream(logFile.c_str(), std::ios::trunc);
+
+    std::vector<Run> runs;
+    for (const std::string &scene : m_scenes) {
+        for (const std::pair<int, int> &size : m_sizes) {
+            for (const std::string &variant : variants(scene)) {
+                if (hasObjects(scene)) {
+                    for (int count : m_objectCounts) runs.push_back({scene, size.first, size.second, count, variant});
+                } else {
+                    runs.push_back({scene, size.first, size.second, 0, variant});
+                }
+            }
+        }
+    }
+
+    std::vector<std::string> results;
+    int numFailed = 0;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const Run &run = runs[i];
+        std::cout << "[" << (i + 1) << "/" << runs.size() << "] " << run.m_scene << " " << run.m_width << "x"
+                  << run.m_height;
+        if (run.m_numObjects > 0) std::cout << " " << run.m_numObjects << " objects";
+        if (!run.m_variant.empty()) std::cout << " " << run.m_variant;
+        std::cout << std::flush;
+
+        std::string result = execute(run, jsonFile, logFile);
+        double median = 0.0;
+        if (result.empty() || !findNumber(result, "frame_ms", "p50", median)) {
+            std::cout << ": failed (see " << logFile << ")\n";
+            ++numFailed;
+            continue;
+        }
+        std::cout << ": median frame " << median << " ms\n";
+        results.push_back(result);
+    }
+    remove(jsonFile.c_str());
+
+    char date[32] = "";
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    std::string commit = commandOutput("cd '" + m_rootDir + "' && git rev-parse --short HEAD 2>/dev/null");
+    if (commit.empty()) commit = "unknown";
+
+    std::ofstream file(outFile.c_str(), std::ios::trunc);
+    file << "{\n\"commit\": \"" << commit << "\",\n\"date\": \"" << date << "\",\n\"frames\": " << m_frames
+         << ",\n\"warmup\": " << m_warmupFrames << ",\n\"runs\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        file << results[i] << ((i + 1 < results.size()) ? ",\n" : "\n");
+    }
+    file << "]\n}\n";
+    file.close();
+    if (!file.good()) {
+        std::cerr << "BenchmarkSuite::runAll() - could not write " << outFile << "\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << results.size() << " runs written to " << outFile;
+    if (numFailed > 0) std::cout << ", " << numFailed << " failed";
+    std::cout << "\n";
+    return (numFailed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * @brief BenchmarkSuite::execute
+ * @param run The demo and its settings
+ * @param jsonFile Where the demo writes its report
+ * @param logFile The file collecting the output of the demos
+ * @return The one line JSON report, or an empty string if the demo failed
+ */
+std::string BenchmarkSuite::execute(const Run &run, const std::string &jsonFile, const std::string &logFile) const {
+    remove(jsonFile.c_str());
+    std::ostringstream command;
+    command << "(cd '" << m_rootDir << "/" << run.m_scene << "' && './" << run.m_scene << "' --headless"
+            << " --frames " << m_frames << " --warmup " << m_warmupFrames
+            << " --size " << run.m_width << "x" << run.m_height;
+    if (run.m_numObjects > 0) command << " --objects " << run.m_numObjects;
+    if (!run.m_variant.empty()) command << " --variant " << run.m_variant;
+    command << " --json '" << jsonFile << "') >> '" << logFile << "' 2>&1";
+    if (std::system(command.str().c_str()) != 0) return std::string();
+
+    std::ifstream file(jsonFile.c_str());
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+/**
+ * @brief BenchmarkSuite::compare
+ * @param oldFile The results to compare against, e.g. from the previous commit
+ * @param newFile The latest results
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if a file couldn't be read or a median frame or GPU time went up by more than
+ * the threshold
+ */
+int BenchmarkSuite::compare(const std::string &oldFile, const std::string &newFile) const {
+    std::vector<std::string> oldKeys, oldLines, newKeys, newLines;
+    if (!readResults(oldFile, oldKeys, oldLines) || !readResults(newFile, newKeys, newLines)) return EXIT_FAILURE;
+
+    // Format a change in a median as old -> new (percent)
+    auto change = [](double before, double after, double &percent) {
+        percent = (before > 0.0) ? 100.0 * (after - before) / before : 0.0;
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3) << before << " -> " << after
+            << std::showpos << std::setprecision(1) << " (" << percent << "%)";
+        return out.str();
+    };
+
+    int numRegressions = 0;
+    std::cout << std::left << std::setw(32) << "run" << std::setw(36) << "median frame ms"
+              << std::setw(36) << "median GPU ms" << "median paintGL ms\n";
+    for (size_t i = 0; i < newKeys.size(); ++i) {
+        auto it = std::find(oldKeys.begin(), oldKeys.end(), newKeys[i]);
+        if (it == oldKeys.end()) continue;
+        const std::string &before = oldLines[size_t(it - oldKeys.begin())];
+        const std::string &after = newLines[i];
+
+        double oldFrame = 0.0, newFrame = 0.0, oldGPU = 0.0, newGPU = 0.0, oldCPU = 0.0, newCPU = 0.0;
+        double framePercent = 0.0, gpuPercent = 0.0, cpuPercent = 0.0;
+        findNumber(before, "frame_ms", "p50", oldFrame);
+        findNumber(after, "frame_ms", "p50", newFrame);
+        findNumber(before, "cpu_ms", "p50", oldCPU);
+        findNumber(after, "cpu_ms", "p50", newCPU);
+        const bool hasGPU = findNumber(before, "gpu_ms", "p50", oldGPU) && findNumber(after, "gpu_ms", "p50", newGPU);
+
+        std::cout << std::left << std::setw(32) << newKeys[i]
+                  << std::setw(36) << change(oldFrame, newFrame, framePercent)
+                  << std::setw(36) << (hasGPU ? change(oldGPU, newGPU, gpuPercent) : std::string("-"))
+                  << change(oldCPU, newCPU, cpuPercent);
+        if ((framePercent > m_threshold) || (gpuPercent > m_threshold)) {
+            std::cout << "  REGRESSION";
+            ++numRegressions;
+        }
+        std::cout << "\n";
+    }
+    std::cout << numRegressions << " regressions over " << m_threshold << "%\n";
+    return (numRegressions > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * @brief BenchmarkSuite::readResults
+ * @param fileName A results file written by runAll()
+ * @param keys The scene, size, object count and variant of each run
+ * @param lines The report of each run
+ * @return false if the file couldn't be read
+ */
+bool BenchmarkSuite::readResults(const std::string &fileName,
+                                 std::vector<std::string> &keys,
+                                 std::vector<std::string> &lines) {
+    std::ifstream file(fileName.c_str());
+    if (!file.good()) {
+        std::cerr << "BenchmarkSuite::readResults() - could not read " << fileName << "\n";
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        std::string scene, variant;
+        double width = 0.0, height = 0.0, objects = 0.0;
+        if (!findString(line, "scene", scene) ||
+            !findNumber(line, "", "width", width) ||
+            !findNumber(line, "", "height", height)) {
+            continue;
+        }
+        findNumber(line, "", "objects", objects);
+        std::ostringstream key;
+        key << scene << " " << int(width) << "x" << int(height);
+        if (objects > 0.0) key << " " << int(objects) << " objects";
+        if (findString(line, "variant", variant) && !variant.empty()) key << " " << variant;
+        keys.push_back(key.str());
+        lines.push_back(line);
+    }
+    return true;
+}
+
+/**
+ * @brief BenchmarkSuite::findNumber
+ * This only understands the flat reports written by HeadlessRunner, where each object holds numbers.
+ * @param line The report
+ * @param object The object holding the number, or empty for the top level
+ * @param key The name of the number
+ * @param value The number if it was found
+ * @return true if the number was found
+ */
+bool BenchmarkSuite::findNumber(const std::string &line,
+                                const std::string &object,
+                                const std::string &key,
+                                double &value) {
+    size_t start = 0, end = line.size();
+    if (!object.empty()) {
+        start = line.find("\"" + object + "\": {");
+        if (start == std::string::npos) return false;
+        end = line.find('}', start);
+    }
+    const std::string name = "\"" + key + "\": ";
+    size_t pos = line.find(name, start);
+    if ((pos == std::string::npos) || (pos > end)) return false;
+    const char *number = line.c_str() + pos + name.size();
+    char *numberEnd = nullptr;
+    value = strtod(number, &numberEnd);
+    return numberEnd != number;
+}
+
+/**
+ * @brief BenchmarkSuite::findString
+ * @param line The report
+ * @param key The name of the string
+ * @param value The string if it was found (escapes are left as they are)
+ * @return true if the string was found
+ */
+bool BenchmarkSuite::findString(const std::string &line, const std::string &key, std::string &value) {
+    const std::string name = "\"" + key + "\": \"";
+    size_t pos = line.find(name);
+    if (pos == std::string::npos) return false;
+    pos += name.size();
+    size_t end = pos;
+    while ((end < line.size()) && (line[end] != '"')) end += (line[end] == '\\') ? 2 : 1;
+    if (end >= line.size()) return false;
+    value = line.substr(pos, end - pos);
+    return true;
+}
+
+/**
+ * @brief BenchmarkSuite::commandOutput
+ * @param command The shell command
+ * @return The first line of its output, or an empty string if it failed
+ */
+std::string BenchmarkSuite::commandOutput(const std::string &command) {
+    FILE *pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) return std::string();
+    char buffer[256] = "";
+    std::string output;
+    if (fgets(buffer, sizeof(buffer), pipe) != nullptr) output = buffer;
+    pclose(pipe);
+    output.erase(output.find_last_not_of(" \r\n") + 1);
+    return output;
+}
+
+/**
+ * @brief BenchmarkSuite::split
+ * @param list A comma separated list
+ * @return The items, skipping empty ones
+ */
+std::vector<std::string> BenchmarkSuite::split(const std::string &list) {
+    std::vector<std::string> items;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+/**
+ * @brief BenchmarkSuite::hasObjects
+ * @param scene The demo
+ * @return true if the demo draws a variable number of teapots
+ */
+bool BenchmarkSuite::hasObjects(const std::string &scene) {
+    return (scene == "dof") || (scene == "shadows");
+}
+
+/**
+ * @brief BenchmarkSuite::variants
+ * @param scene The demo
+ * @return The variants its main() understands
+ */
+std::vector<std::string> BenchmarkSuite::variants(const std::string &scene) {
+    if (scene == "dof") return {"gaussian", "poisson", "separable", "separable-quarter"};
+    if (scene == "sdf") return {"sphere", "relaxed", "cone"};
+    if (scene == "curv") return {"meshlets", "strips", "sculpt"};
+    return {std::string()};
+}
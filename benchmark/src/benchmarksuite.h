@@ -0,0 +1,88 @@
+#ifndef BENCHMARKSUITE_H
+#define BENCHMARKSUITE_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief The BenchmarkSuite class
+ * Measures the frame times of every demo so that performance regressions show up between commits. Each demo is built as
+ * usual and then started with --headless (see HeadlessRunner) from its own directory, so that it finds its shaders,
+ * once for every resolution and, for the scenes which can vary them, every number of objects and every variant (such as
+ * the blur filters of dof or the ray marching of sdf, which puts them side by side). Each run writes a one line JSON
+ * report of the percentiles of its paintGL() CPU time, GPU time and whole frame time along with its initGL() time, and
+ * the suite gathers them into one JSON file tagged with the commit. Two of these files can then be compared, listing
+ * the change in the median times of every run they share.
+ */
+class BenchmarkSuite
+{
+public:
+    /// A single run of a demo
+    struct Run {
+        std::string m_scene;        //< The demo, which is also its directory and executable name
+        int m_width, m_height;      //< The framebuffer size
+        int m_numObjects;           //< The number of objects, or 0 for the scene's default
+        std::string m_variant;      //< The way of drawing the scene, or empty for its only one
+    };
+
+    /// Set up the default runs: every scene at every default size, and several object counts where supported
+    BenchmarkSuite();
+
+    /// Read the command line. Returns false if it couldn't be understood.
+    bool parseArgs(int /*argc*/, char **/*argv*/);
+
+    /// Run the suite (or the comparison if --compare was given), returning the exit code for main()
+    int exec();
+
+    /// Print the command line options
+    static void usage(const char */*program*/);
+
+private:
+    /// Run every combination and write the results file
+    int runAll();
+
+    /// Start one demo and read back its report, which is empty if the run failed
+    std::string execute(const Run &/*run*/, const std::string &/*jsonFile*/, const std::string &/*logFile*/) const;
+
+    /// List the change in the median times between two results files. Returns EXIT_FAILURE if any run is slower by
+    /// more than the threshold.
+    int compare(const std::string &/*oldFile*/, const std::string &/*newFile*/) const;
+
+    /// Read the runs of a results file, one per line, keyed by scene, size, objects and variant
+    static bool readResults(const std::string &/*fileName*/,
+                            std::vector<std::string> &/*keys*/,
+                            std::vector<std::string> &/*lines*/);
+
+    /// Find a number in a one line JSON report, either at the top level or inside the named object
+    static bool findNumber(const std::string &/*line*/,
+                           const std::string &/*object*/,
+                           const std::string &/*key*/,
+                           double &/*value*/);
+
+    /// Find a string at the top level of a one line JSON report
+    static bool findString(const std::string &/*line*/, const std::string &/*key*/, std::string &/*value*/);
+
+    /// Run a shell command and return the first line it prints
+    static std::string commandOutput(const std::string &/*command*/);
+
+    /// Split a comma separated list
+    static std::vector<std::string> split(const std::string &/*list*/);
+
+    /// The scenes which take --objects
+    static bool hasObjects(const std::string &/*scene*/);
+
+    /// The values a scene takes for --variant, which is just an empty string for most of them
+    static std::vector<std::string> variants(const std::string &/*scene*/);
+
+    std::vector<std::string> m_scenes;
+    std::vector<std::pair<int, int>> m_sizes;
+    std::vector<int> m_objectCounts;
+    std::string m_rootDir = "..";
+    std::string m_outFile = "benchmark.json";
+    int m_frames = 200;
+    int m_warmupFrames = 10;
+    std::string m_compareOld, m_compareNew;
+    double m_threshold = 5.0;   //< The percentage change in a median which counts as a regression
+};
+
+#endif // BENCHMARKSUITE_H
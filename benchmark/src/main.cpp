@@ -0,0 +1,19 @@
+#include "benchmarksuite.h"
+
+#include <cstdlib>
+
+/**
+ * Runs every demo headlessly and writes their frame times to a JSON file, or compares two of these files:
+ *
+ *     cd benchmark && ./benchmark --out before.json
+ *     ... change something and rebuild ...
+ *     ./benchmark --out after.json && ./benchmark --compare before.json after.json
+ */
+int main(int argc, char **argv) {
+    BenchmarkSuite suite;
+    if (!suite.parseArgs(argc, argv)) {
+        BenchmarkSuite::usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    return suite.exec();
+}
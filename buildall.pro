@@ -1,2 +1,2 @@
 TEMPLATE = subdirs
-SUBDIRS = 3dtex bump curv dof environment fins fractal morph objviewer phong sdf shadermaps wood noise
+SUBDIRS = 3dtex bump curv dof environment fins fractal morph objviewer phong sdf shadermaps shadows wood noise benchmark golden tests
@@ -10,12 +10,19 @@ HEADERS += src/bumpscene.h \
            ../common/include/camera.h \
            ../common/include/fixedcamera.h \
            ../common/include/scene.h \
-           ../common/include/trackballcamera.h
+           ../common/include/trackballcamera.h \
+           ../common/include/headlessrunner.h \
+           ../common/include/tracelog.h \
+           ../common/include/bufferhash.h \
+           ../common/include/fnv1a.h
 SOURCES += src/main.cpp src/bumpscene.cpp \
            ../common/src/camera.cpp \
            ../common/src/fixedcamera.cpp \
            ../common/src/scene.cpp \
-           ../common/src/trackballcamera.cpp
+           ../common/src/trackballcamera.cpp \
+           ../common/src/headlessrunner.cpp \
+           ../common/src/tracelog.cpp \
+           ../common/src/bufferhash.cpp
 
 OTHER_FILES += shaders/bump_vert.glsl \
                shaders/bump_frag.glsl \
@@ -1,4 +1,5 @@
 #include "bumpscene.h"
+#include "tracelog.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <ngl/Obj.h>
@@ -11,6 +12,8 @@ BumpScene::BumpScene() : Scene() {}
 
 
 void BumpScene::initGL() noexcept {
+    TraceScope trace("BumpScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -25,9 +28,11 @@ void BumpScene::initGL() noexcept {
 
     // Create and compile the vertex and fragment shader
     ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+    TraceLog::begin("loadShader");
     shader->loadShader("BumpProgram",
                        "shaders/bump_vert.glsl",
                        "shaders/bump_frag.glsl");
+    TraceLog::end("loadShader");
     (*shader)["BumpProgram"]->use();
 
     // Load up our textures
@@ -79,6 +84,8 @@ void BumpScene::initTexture(const GLuint& texUnit, GLuint &texId, const char *fi
 }
 
 void BumpScene::paintGL() noexcept {
+    TraceScope trace("BumpScene::paintGL");
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -41,6 +41,9 @@ INCLUDEPATH += $$NGLPATH/include ../common/include $$IGLPATH/include $$EIGENPATH
 # The config includes C++11 features. I'll assume you want debug mode!
 CONFIG += c++11 debug
 
+# Some of the geometry processing in common is multithreaded (see parallelfor.h)
+CONFIG += thread
+
 # These options are to include the openGL headers etc for NGL
 QT += core opengl gui
 
@@ -56,7 +59,7 @@ if ($$LAB_BUILD) {
 } else {
   LIBS += -lglfw
 }
-LIBS += -lGL -lGLEW -lGLU $$NOISELIBPATH/libnoise.a
+LIBS += -lGL -lEGL -lGLEW -lGLU $$NOISELIBPATH/libnoise.a
 
 # The RPATH tells the executable where to find the shared libraries that are not in LD_LIBRARY_PATH
 QMAKE_RPATHDIR += $$NGLPATH/lib 
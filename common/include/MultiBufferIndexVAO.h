@@ -0,0 +1,208 @@
+#ifndef MULTIBUFFERINDEXVAO_H_
+#define MULTIBUFFERINDEXVAO_H_
+
+#include <ngl/AbstractVAO.h>
+#include <vector>
+
+
+class  MultiBufferIndexVAO : public ngl::AbstractVAO
+{
+  public :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief creator method for the factory
+    /// @param _mode the mode to draw with.
+    /// @returns a new AbstractVAO * object
+    //----------------------------------------------------------------------------------------------------------------------
+    static std::unique_ptr<ngl::AbstractVAO>create(GLenum _mode=GL_TRIANGLES) { return std::unique_ptr<AbstractVAO>(new MultiBufferIndexVAO(_mode)); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw the VAO using glDrawArrays
+    //----------------------------------------------------------------------------------------------------------------------
+    virtual void draw() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw a span of the indices set with setIndices. Indices set as ranges (by setCompactIndices or
+    /// setClusterIndices) have a type and base vertex per range, so they are refused here.
+    //----------------------------------------------------------------------------------------------------------------------
+    virtual void draw(int _startIndex, int _amount) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief dtor don't do anything as the remove clears things
+    //----------------------------------------------------------------------------------------------------------------------
+    virtual ~MultiBufferIndexVAO()=default;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief remove the VAO and buffers created
+    //----------------------------------------------------------------------------------------------------------------------
+    virtual void removeVAO();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief, this method sets the data for the VAO if data has already been set it will remove the existing data
+    /// and then re-set with the new data.
+    /// @param _size the size of the raw data passed
+    /// @param _data the actual data to set for the VOA
+    /// @param _indexSize the size of the index array passed
+    /// @param _indexData the actual data to set for the VOA indexes (only GLubyte data at present need to write more methods
+    /// but usually only use this
+    /// @param _indexType the type of the values in the indices buffer. Must be one of GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, or GL_UNSIGNED_INT.
+    /// @param _mode the draw mode hint used by GL
+    //----------------------------------------------------------------------------------------------------------------------
+    virtual void setData(const VertexData &_data);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set the vertex data from a raw pointer, for example straight out of a memory mapped MeshCache
+    /// @param _size the size of the raw data in bytes
+    /// @param _data pointer to the interleaved vertex data (not copied on the CPU side)
+    /// @param _mode the draw mode hint used by GL
+    //----------------------------------------------------------------------------------------------------------------------
+    void setData(size_t _size, const GLvoid *_data, GLenum _mode=GL_STATIC_DRAW);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief overwrite part of the existing vertex data with glBufferSubData
+    /// @param _offset the offset into the buffer in bytes
+    /// @param _size the number of bytes to write
+    /// @param _data pointer to the new data
+    //----------------------------------------------------------------------------------------------------------------------
+    void setSubData(size_t _offset, size_t _size, const GLvoid *_data);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief upload only the listed vertex records. Records which are close together are merged into a single write,
+    /// as a few larger writes are cheaper than many tiny ones.
+    /// @param _records the sorted indices of the records to upload
+    /// @param _recordSize the size of each record in bytes
+    /// @param _data pointer to the first record of the complete CPU side copy of the vertex data
+    /// @param _maxGap the largest run of unchanged records that will be uploaded to join two writes
+    //----------------------------------------------------------------------------------------------------------------------
+    void updateRecords(const std::vector<GLuint> &_records, size_t _recordSize, const GLvoid *_data, GLuint _maxGap=8);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set a vertex attribute at a byte offset within the record. setVertexAttributePointer takes its offset
+    /// in floats, which can't describe packed records (e.g. 16 bit or 10:10:10:2 fields)
+    /// @param _id the attribute location
+    /// @param _size the number of components (must be 4 for GL_INT_2_10_10_10_REV)
+    /// @param _type the component type, e.g. GL_SHORT or GL_HALF_FLOAT
+    /// @param _stride the size of a vertex record in bytes
+    /// @param _byteOffset the offset of the attribute within the record in bytes
+    /// @param _normalise whether integer types are mapped to [0,1] or [-1,1]
+    //----------------------------------------------------------------------------------------------------------------------
+    void setVertexAttribute(GLuint _id, GLint _size, GLenum _type, GLsizei _stride, size_t _byteOffset, bool _normalise=false);
+    void setIndices(unsigned int _indexSize,const GLvoid *_indexData,GLenum _indexType,GLenum _mode=GL_STATIC_DRAW);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set a 32 bit triangle list, stored with 16 bit indices wherever possible (see MeshOptimiser::compactIndices).
+    /// Meshes with more than 64K vertices are drawn as several ranges with a base vertex. This also sets the number of
+    /// indices, and with _strips the draw mode becomes GL_TRIANGLE_STRIP using fixed index primitive restart.
+    /// @param _indexCount the number of indices (3 per triangle)
+    /// @param _indexData the triangle list
+    /// @param _numVertices the number of vertices the indices refer to
+    /// @param _strips whether to join the triangles into strips
+    /// @param _mode the draw mode hint used by GL
+    //----------------------------------------------------------------------------------------------------------------------
+    void setCompactIndices(size_t _indexCount, const GLuint *_indexData, GLuint _numVertices, bool _strips=false, GLenum _mode=GL_STATIC_DRAW);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief as above, but the triangle list is made of consecutive parts (for example levels of detail) which are
+    /// compacted separately so that each can be drawn on its own with setPart()
+    /// @param _partSizes the number of indices in each part
+    //----------------------------------------------------------------------------------------------------------------------
+    void setCompactIndices(const std::vector<GLuint> &_partSizes, const GLuint *_indexData, GLuint _numVertices, bool _strips=false, GLenum _mode=GL_STATIC_DRAW);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set a triangle list made of clusters (see Meshlets) which can be drawn selectively with drawClusters().
+    /// Each cluster is stored with 16 bit indices relative to its lowest vertex wherever it spans less than 64K vertices.
+    /// @param _partClusters the number of clusters in each part (for example each level of detail)
+    /// @param _clusterSizes the number of indices in each cluster, in the order they appear in _indexData
+    /// @param _indexData the triangle list
+    /// @param _numVertices the number of vertices the indices refer to
+    /// @param _mode the draw mode hint used by GL
+    //----------------------------------------------------------------------------------------------------------------------
+    void setClusterIndices(const std::vector<GLuint> &_partClusters, const std::vector<GLuint> &_clusterSizes, const GLuint *_indexData, GLuint _numVertices, GLenum _mode=GL_STATIC_DRAW);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw some of the clusters of the current part with (at most) one multi-draw for each index type
+    /// @param _clusters the clusters to draw, numbered from the first cluster of the part
+    /// @param _count the number of clusters to draw
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawClusters(const GLuint *_clusters, size_t _count) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief choose which part of the compact indices draw() uses
+    //----------------------------------------------------------------------------------------------------------------------
+    void setPart(size_t _part);
+    size_t getPart() const {return m_part;}
+    size_t numParts() const {return m_parts.size();}
+
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief return the id of the buffer, if there is only 1 buffer just return this
+    /// if we have the more than one buffer the sub class manages the id's
+    /// @param _buffer index (default to 0 for single buffer VAO's)
+    //----------------------------------------------------------------------------------------------------------------------
+     GLuint getBufferID(unsigned int ){return m_buffer;}
+
+     //----------------------------------------------------------------------------------------------------------------------
+     /// @brief grab a raw pointer to the data
+     /// @param _index the index to the buffer (0) default for simple
+     /// @param _mode the access more
+     //----------------------------------------------------------------------------------------------------------------------
+     ngl::Real * mapBuffer(unsigned int _index=0, GLenum _accessMode=GL_READ_WRITE);
+  protected :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor calles parent ctor to allocate vao;
+    //----------------------------------------------------------------------------------------------------------------------
+    MultiBufferIndexVAO(GLenum _mode)  : ngl::AbstractVAO(_mode)
+    {
+
+    }
+
+  private :
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the id of the buffer for the VAO
+    //----------------------------------------------------------------------------------------------------------------------
+    GLuint m_buffer=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the id of the element buffer, shared by setIndices and the ranges and reused each time they are set
+    //----------------------------------------------------------------------------------------------------------------------
+    GLuint m_indexBuffer=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief data type of the index data set with setIndices (e.g. GL_UNSIGNED_INT), the ranges keep their own
+    //----------------------------------------------------------------------------------------------------------------------
+    GLenum m_indexType=GL_UNSIGNED_INT;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the ranges set by setCompactIndices or setClusterIndices, each drawn with its own base vertex. The 16 bit
+    /// indices come first in the buffer, followed by the 32 bit ones for triangles which don't fit in 16 bits.
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<GLsizei> m_rangeCounts;
+    std::vector<const GLvoid *> m_rangeOffsets;
+    std::vector<GLint> m_rangeBaseVertices;
+    std::vector<GLenum> m_rangeTypes;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a part of the compact indices: a run of the ranges which can be drawn on its own
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Part
+    {
+      size_t m_firstRange=0;
+      size_t m_numRanges=0;
+      size_t m_numIndices=0;
+    };
+    std::vector<Part> m_parts;
+    size_t m_part=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the arguments of the multi-draw for each index type, gathered every draw (16 bit then 32 bit)
+    //----------------------------------------------------------------------------------------------------------------------
+    struct DrawList
+    {
+      std::vector<GLsizei> m_counts;
+      std::vector<const GLvoid *> m_offsets;
+      std::vector<GLint> m_baseVertices;
+    };
+    mutable DrawList m_drawLists[2];
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add a range of 16 or 32 bit indices (offsets are in indices from the start of the indices of that type)
+    //----------------------------------------------------------------------------------------------------------------------
+    void addRange(GLenum _type, size_t _first, size_t _count, GLuint _baseVertex);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief upload the 16 and 32 bit indices one after the other and fix up the offsets of the 32 bit ranges
+    //----------------------------------------------------------------------------------------------------------------------
+    void uploadRanges(const std::vector<GLushort> &_shortIndices, const std::vector<GLuint> &_wideIndices, GLenum _mode);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief bind the element buffer, creating it the first time
+    //----------------------------------------------------------------------------------------------------------------------
+    void bindIndexBuffer();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw ranges of the current part (all of them if _ranges is nullptr)
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawRanges(const GLuint *_ranges, size_t _count) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief whether the indices are strips separated by the maximum value of the index type
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_primitiveRestart=false;
+
+};
+
+#endif
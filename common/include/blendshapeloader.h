@@ -0,0 +1,60 @@
+#ifndef BLENDSHAPELOADER_H
+#define BLENDSHAPELOADER_H
+
+#include <Eigen/Core>
+#include <string>
+#include <vector>
+#include <utility>
+
+/**
+ * @brief The BlendshapeLoader class
+ * Loads a set of morph targets which share the same connectivity. All of the target files are read
+ * and their vertex normals computed concurrently, and each is written into a single interleaved
+ * vertex buffer and released as soon as it is ready. Each vertex record is laid out as
+ *   V0, V1-V0, ..., Vn-V0, N0, N1, ..., Nn
+ * where V0 is the base target, and the positions of every target are normalised using the bounding box
+ * of the base target.
+ */
+class BlendshapeLoader
+{
+public:
+    typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixXfr;
+    typedef Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixXir;
+
+    /// Construct an empty loader
+    BlendshapeLoader() {}
+
+    /// Load all the targets. The first file is the base shape. Returns false if any file fails or the faces differ.
+    bool load(const std::vector<std::string> &/*fileNames*/);
+
+    /// The interleaved vertex data ready for upload to the GPU
+    const std::vector<float> &vertexData() const {return m_vertexData;}
+
+    /// Move the interleaved vertex data out of the loader (leaving it empty), to keep it without a copy
+    std::vector<float> takeVertexData() {return std::move(m_vertexData);}
+
+    /// The faces shared by all the targets
+    const MatrixXir &faces() const {return m_faces;}
+
+    /// The number of targets that were loaded (including the base)
+    size_t numTargets() const {return m_numTargets;}
+
+    /// The number of vertices in each target
+    size_t numVertices() const {return m_numVertices;}
+
+    /// The number of floats in each interleaved vertex record
+    size_t floatsPerVertex() const {return m_numTargets * 6;}
+
+private:
+    /// The interleaved result
+    std::vector<float> m_vertexData;
+
+    /// The shared connectivity
+    MatrixXir m_faces;
+
+    /// Dimensions of the loaded data
+    size_t m_numTargets = 0;
+    size_t m_numVertices = 0;
+};
+
+#endif // BLENDSHAPELOADER_H
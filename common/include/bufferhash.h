@@ -0,0 +1,28 @@
+#ifndef BUFFERHASH_H
+#define BUFFERHASH_H
+
+#include <string>
+#include <cstddef>
+
+/**
+ * @brief The BufferHash class
+ * Records a hash of the buffers made on the CPU before they go to the GPU, such as the baked noise textures, the
+ * curvature attributes and the morph targets, so that a faster way of making them can be checked to give exactly the
+ * same bytes. Once started, each record() appends a line holding the name, size and hash of a buffer to a text file,
+ * which the golden image tests compare with a stored copy. When it hasn't been started record() does nothing, so the
+ * calls can be left in place.
+ */
+class BufferHash
+{
+public:
+    /// Start writing the hashes to a file, replacing anything in it
+    static bool start(const std::string &/*fileName*/);
+
+    /// Whether hashes are being written
+    static bool isEnabled();
+
+    /// Write the hash of a buffer, if started
+    static void record(const char */*name*/, const void */*data*/, std::size_t /*size*/);
+};
+
+#endif // BUFFERHASH_H
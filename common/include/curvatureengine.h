@@ -0,0 +1,153 @@
+#ifndef CURVATUREENGINE_H
+#define CURVATUREENGINE_H
+
+#include "meshtopology.h"
+
+#include <Eigen/Core>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief The CurvatureEngine class
+ * Computes smooth vertex normals and the principal curvature of a triangle mesh by fitting a quadric
+ * to the k-ring of every vertex. This follows the same method (and gives the same result) as
+ * igl::principal_curvature, but the vertex adjacency is built once in compressed sparse row (CSR) form
+ * (see MeshTopology), and the per-vertex fits are run in parallel with scratch storage that is reused by each thread.
+ * The results can be written straight into the interleaved position, normal, K1, K2 layout used by
+ * the curv demo (see MeshCache::ATTRIB_CURVATURE).
+ *
+ * For deforming meshes update() only recomputes what a set of moved vertices can affect: the normals of
+ * their one-ring, and the curvature of every vertex whose k-ring reaches one of those normals. The vertices
+ * that changed are listed in dirtyVertices() so that only those records need to be sent to the GPU. This pays off
+ * for localised deformations such as the sculpt in the curv demo, where the work grows with the size of the edit
+ * rather than the mesh. A deformation which moves most of the mesh (like the morph targets) is better computed.
+ */
+class CurvatureEngine
+{
+public:
+    typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixXfr;
+    typedef Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixXir;
+
+    /// The number of floats in each record written by writeInterleaved()
+    static const size_t FLOATS_PER_VERTEX = 12;
+
+    /// Construct an engine which fits quadrics over the _kRing neighbourhood (igl uses 5 by default)
+    explicit CurvatureEngine(unsigned int _kRing = 5) : m_kRing(_kRing) {}
+
+    /// Build the vertex-to-face and vertex-to-vertex adjacency for the faces F. Only needed once per mesh.
+    void build(const MatrixXir &/*F*/, size_t /*numVertices*/);
+
+    /// As above, for a triangle list such as the indices of a MeshCache
+    void build(const std::uint32_t */*faces*/, size_t /*numFaces*/, size_t /*numVertices*/);
+
+    /// The connectivity of the mesh, which can be shared with anything else that needs it
+    const MeshTopology &topology() const {return m_topology;}
+
+    /// Compute the normals and curvature for the vertex positions V (must match the faces passed to build)
+    void compute(const MatrixXfr &/*V*/);
+
+    /// As above, for positions stored with an arbitrary stride (in floats) e.g. within an interleaved buffer.
+    /// The positions must stay valid until the next call to compute() or update().
+    void compute(const float */*positions*/, size_t /*stride*/, bool /*withCurvature*/ = true);
+
+    /// Find the vertices which moved since the last compute() or update() and recompute what they affect
+    void update(const float */*positions*/, size_t /*stride*/, bool /*withCurvature*/ = true);
+
+    /// As above, when the caller already knows which vertices moved
+    void update(const float */*positions*/, size_t /*stride*/, const std::vector<std::uint32_t> &/*moved*/, bool /*withCurvature*/ = true);
+
+    /// The sorted list of vertices whose normal or curvature was recomputed by the last compute() or update()
+    const std::vector<std::uint32_t> &dirtyVertices() const {return m_dirty;}
+
+    /// Write position, normal, K1 * kappa1 and K2 * kappa2 (FLOATS_PER_VERTEX floats) for every vertex
+    void writeInterleaved(float */*data*/) const;
+
+    /// As above, but only for the listed vertices (e.g. dirtyVertices())
+    void writeInterleaved(float */*data*/, const std::vector<std::uint32_t> &/*vertices*/) const;
+
+    /// Write the normals of the listed vertices into records of stride floats, starting at data
+    void writeNormals(float */*data*/, size_t /*stride*/, const std::vector<std::uint32_t> &/*vertices*/) const;
+
+    /// Retrieve the results (the directions are unit length, as returned by igl::principal_curvature)
+    const std::vector<Eigen::Vector3d> &normals() const {return m_normals;}
+    const std::vector<Eigen::Vector3d> &minDirections() const {return m_pd1;}
+    const std::vector<Eigen::Vector3d> &maxDirections() const {return m_pd2;}
+    const std::vector<double> &minCurvatures() const {return m_pv1;}
+    const std::vector<double> &maxCurvatures() const {return m_pv2;}
+
+    /// The number of vertices the engine was built for
+    size_t numVertices() const {return m_topology.numVertices();}
+
+protected:
+    /// Scratch storage reused by each thread between vertices
+    struct Scratch {
+        std::vector<std::uint32_t> m_stamp;     //< Visit stamp per vertex, so the k-ring search needs no clearing
+        std::uint32_t m_currentStamp = 0;       //< The stamp of the current search
+        std::vector<std::pair<std::uint32_t, std::uint32_t> > m_queue; //< Breadth first queue of (vertex, ring)
+        std::vector<std::uint32_t> m_ring;      //< The k-ring of the current vertex
+        std::vector<std::uint32_t> m_filtered;  //< The k-ring after removing back facing vertices
+        Eigen::MatrixXd m_A;                    //< The least squares system for the quadric
+        Eigen::VectorXd m_b;
+        std::vector<std::uint32_t> m_moved;     //< Moved vertices found by this thread in update()
+    };
+
+    /// Make sure there is one scratch entry per thread
+    void allocateScratch();
+
+    /// Calculate the (unnormalised) normal of face f
+    void faceNormal(size_t /*f*/);
+
+    /// Calculate the normal of vertex v from the normals of its faces
+    void vertexNormal(size_t /*v*/);
+
+    /// Fit the quadric and compute the principal curvature of vertex v
+    void curvatureAt(size_t /*v*/, Scratch &/*scratch*/);
+
+    /// Gather the k-ring of v (including v itself) in breadth first order
+    void kRing(size_t /*v*/, Scratch &/*scratch*/) const;
+
+    /// Write a single FLOATS_PER_VERTEX record
+    void writeRecord(size_t /*v*/, float */*record*/) const;
+
+    /// Remember the positions of the listed vertices, so that update() can tell which have moved
+    void storePositions(const std::vector<std::uint32_t> &/*vertices*/);
+
+    /// Fetch the position of vertex v as a double precision vector
+    Eigen::Vector3d position(size_t v) const {
+        const float *p = m_positions + v * m_stride;
+        return Eigen::Vector3d(p[0], p[1], p[2]);
+    }
+
+    /// The size of the k-ring used for the quadric fit
+    unsigned int m_kRing;
+
+    /// The connectivity of the mesh
+    MeshTopology m_topology;
+
+    /// The positions currently being processed (not owned)
+    const float *m_positions = nullptr;
+    size_t m_stride = 3;
+
+    /// Per face and per vertex results
+    std::vector<Eigen::Vector3d> m_faceNormals;
+    std::vector<Eigen::Vector3d> m_normals;
+    std::vector<Eigen::Vector3d> m_pd1, m_pd2;
+    std::vector<double> m_pv1, m_pv2;
+
+    /// The positions at the last compute() or update()
+    std::vector<float> m_previous;
+
+    /// Set if an update() skipped the curvature, in which case it all needs recomputing next time
+    bool m_curvatureStale = true;
+
+    /// Per vertex and per face flags used to build the dirty lists without duplicates
+    std::vector<std::uint8_t> m_vertexMark, m_faceMark;
+
+    /// The faces and vertices touched by the last update
+    std::vector<std::uint32_t> m_dirtyFaces, m_dirtyNormals, m_dirty;
+
+    /// Per thread scratch storage
+    std::vector<Scratch> m_scratch;
+};
+
+#endif // CURVATUREENGINE_H
@@ -0,0 +1,27 @@
+#ifndef FNV1A_H
+#define FNV1A_H
+
+#include <cstddef>
+#include <cstdint>
+
+/// The FNV-1a offset basis, which starts a new hash
+const std::uint64_t FNV1A_OFFSET_BASIS = 14695981039346656037ULL;
+
+/**
+ * @brief fnv1a A 64 bit FNV-1a hash of a block of memory. This is the one hash used by the program and mesh caches
+ * and by BufferHash, so a hash stored by one can be compared with another.
+ * @param data The memory to hash
+ * @param size The number of bytes
+ * @param hash The hash so far, to continue a hash over several blocks
+ * @return The hash including this block
+ */
+inline std::uint64_t fnv1a(const void *data, std::size_t size, std::uint64_t hash = FNV1A_OFFSET_BASIS) {
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= std::uint64_t(bytes[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+#endif // FNV1A_H
@@ -0,0 +1,130 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+#include "scene.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+
+/**
+ * @brief The HeadlessRunner class
+ * Runs a Scene without a window, so that the demos can be timed on machines without a display or a GPU (it works
+ * on Mesa's llvmpipe). An offscreen context is created through EGL on the surfaceless platform, rendering into a
+ * pbuffer, so the scene draws to a default framebuffer exactly as it would in a window. The camera orbits the target
+ * once over the timed frames, every frame is finished with glFinish() so that its time includes the rendering, and
+ * the last frame is read back and can be written as a binary PPM image. For the golden image tests the clock of
+ * animated scenes can be stopped with --time, and the hashes of the buffers made on the CPU written with --hashes
+ * (see BufferHash). Three times are kept for each frame: the CPU
+ * time spent in paintGL(), the GPU time between timestamp queries either side of it, and the whole frame including
+ * glFinish(). Each demo's main() hands its scene to runIfRequested(), which runs it when started with --headless:
+ *
+ *     dof --headless [--frames N] [--warmup N] [--size WxH] [--objects N] [--image file.ppm] [--report file.txt]
+ *                    [--json file.json] [--trace file.json] [--time S] [--hashes file.txt]
+ *                    [--variant NAME]
+ *
+ * The JSON report is a single line holding the percentiles of each time, which is what the benchmark suite collects.
+ * A variant names a way of drawing the scene which its main() chooses before the run, such as the blur of dof, so
+ * that the variants can be timed against each other.
+ */
+class HeadlessRunner
+{
+public:
+    /// The settings of a run, filled in by the demo and then parseArgs()
+    struct Options {
+        int m_width = 640;                          //< The size of the framebuffer
+        int m_height = 480;
+        int m_frames = 200;                         //< The number of timed frames
+        int m_warmupFrames = 10;                    //< Frames drawn at the start pose before timing
+        int m_glMajor = 4;                          //< The core profile version requested
+        int m_glMinor = 5;
+        glm::vec3 m_eye = glm::vec3(0.0f, 0.0f, -2.0f);    //< Where the orbit starts
+        glm::vec3 m_target = glm::vec3(0.0f);               //< The centre of the orbit
+        int m_numObjects = 0;                       //< The number of objects, for scenes which can vary it (0 is the default)
+        std::string m_variant;                      //< How to draw the scene, for scenes which have more than one way
+        std::string m_name;                         //< The name of the demo, which parseArgs() takes from argv[0]
+        std::string m_imageFile;                    //< Write the last frame here if not empty
+        std::string m_reportFile;                   //< Write the timing report here if not empty
+        std::string m_jsonFile;                     //< Write the timing report as JSON here if not empty
+        std::string m_traceFile;                    //< Record a Chrome trace of the run with TraceLog if not empty
+        std::string m_hashFile;                     //< Write the BufferHash of the CPU buffers here if not empty
+        double m_time = -1.0;                       //< The time in seconds animated scenes are stopped at, if not negative
+    };
+
+    /// A summary of a set of times in ms
+    struct Stats {
+        double m_mean = 0.0, m_min = 0.0, m_p50 = 0.0, m_p90 = 0.0, m_p95 = 0.0, m_p99 = 0.0, m_max = 0.0;
+    };
+
+    /// Called each frame with the camera position, for scenes which take the eye rather than a view matrix
+    typedef std::function<void(const glm::vec3 &/*eye*/, const glm::vec3 &/*target*/)> EyeCallback;
+
+    /// Called with the options read from the command line before a headless run, to choose a variant for example
+    typedef std::function<void(const Options &/*options*/)> SetupCallback;
+
+    /// Read the command line into the options. Returns true if --headless was given.
+    static bool parseArgs(int /*argc*/, char **/*argv*/, Options &/*options*/);
+
+    /// Read the command line into the options and, if --headless was given, set up and run the scene. Returns true
+    /// with the exit code for main() if it ran, or false if the demo should open its window as usual.
+    static bool runIfRequested(int /*argc*/, char **/*argv*/, Scene &/*scene*/, Options &/*options*/, int &/*exitCode*/,
+                               SetupCallback /*setupCallback*/ = nullptr, EyeCallback /*eyeCallback*/ = nullptr);
+
+    /// Construct a runner (the context isn't created until run())
+    explicit HeadlessRunner(const Options &/*options*/);
+
+    /// Destroys the context
+    ~HeadlessRunner();
+
+    /// Create the context, initialise the scene, draw and time the frames and write the image and report. Returns
+    /// the exit code for main().
+    int run(Scene &/*scene*/, EyeCallback /*eyeCallback*/ = nullptr);
+
+    /// The time of each timed frame, of paintGL() on the CPU and on the GPU, and of initGL() in ms. The GPU times are
+    /// empty if the driver has no timestamp queries.
+    const std::vector<double> &frameTimes() const {return m_frameTimes;}
+    const std::vector<double> &cpuTimes() const {return m_cpuTimes;}
+    const std::vector<double> &gpuTimes() const {return m_gpuTimes;}
+    double initTime() const {return m_initTime;}
+
+    /// The RGBA pixels of the last frame, bottom row first
+    const std::vector<unsigned char> &pixels() const {return m_pixels;}
+
+    /// The renderer string of the context
+    const std::string &renderer() const {return m_renderer;}
+
+    /// Write RGBA pixels (bottom row first) as a binary PPM
+    static bool writePPM(const std::string &/*fileName*/, int /*width*/, int /*height*/, const unsigned char */*rgba*/);
+
+    /// The value below which a fraction p of the sorted times fall (nearest rank)
+    static double percentile(const std::vector<double> &/*sorted*/, double /*p*/);
+
+    /// The mean, extremes and percentiles of some times
+    static Stats summarise(const std::vector<double> &/*times*/);
+
+private:
+    /// Create the EGL display, pbuffer and context and make them current
+    bool createContext();
+
+    /// Release everything made by createContext()
+    void destroyContext();
+
+    /// Print the report, and write it to m_reportFile and m_jsonFile if set
+    void report() const;
+
+    /// Write the report as a single line of JSON
+    bool writeJSON(const std::string &/*fileName*/) const;
+
+    Options m_options;
+    std::vector<double> m_frameTimes, m_cpuTimes, m_gpuTimes;
+    double m_initTime = 0.0;
+    std::vector<unsigned char> m_pixels;
+    std::string m_renderer;
+
+    /// The EGL handles, kept opaque so that the EGL headers (which can drag in X11) stay out of the scenes
+    void *m_display = nullptr;
+    void *m_surface = nullptr;
+    void *m_context = nullptr;
+};
+
+#endif // HEADLESSRUNNER_H
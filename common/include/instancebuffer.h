@@ -0,0 +1,79 @@
+#ifndef INSTANCEBUFFER_H
+#define INSTANCEBUFFER_H
+
+// Includes the GL headers in platform independent and order specific way
+#include <ngl/Types.h>
+#include <ngl/AbstractVAO.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstddef>
+
+#include "parallelfor.h"
+
+/**
+ * @brief The InstanceBuffer class
+ * Holds the model matrix, normal matrix and colour of many copies of the same primitive in a shader storage buffer,
+ * so that they can all be drawn with a single instanced draw call. The vertex shader looks up its instance with
+ * gl_InstanceID and combines it with the view and projection of the pass, which is set once per draw.
+ */
+class InstanceBuffer
+{
+public:
+    /// One instance, in std430 layout. N is stored as a mat4 so that its columns line up.
+    struct Instance {
+        glm::mat4 m_M, m_N;
+        glm::vec4 m_colour;
+    };
+
+    /// The binding point of the buffer, which must match the layout(binding=) in the shaders
+    static constexpr GLuint BINDING = 2;
+
+    /// Construct an empty buffer (the GL buffer is created on the first upload)
+    InstanceBuffer() {}
+
+    /// Fill count instances from func(i, M, colour), working out their normal matrices, and upload them. Large
+    /// counts are split between threads, so func must be safe to call concurrently.
+    template<typename Func>
+    void build(size_t /*count*/, Func /*func*/);
+
+    /// The number of instances
+    size_t size() const {return m_instances.size();}
+
+    /// Bind the buffer for the shaders to read
+    void bind() const;
+
+    /// Draw every instance of a primitive built by ngl::VAOPrimitives (these are not indexed)
+    void draw(ngl::AbstractVAO */*vao*/) const;
+
+private:
+    /// Copy the instances to the GPU
+    void upload();
+
+    /// The CPU copy of the instances and the GL buffer
+    std::vector<Instance> m_instances;
+    GLuint m_buffer = 0;
+};
+
+/**
+ * @brief InstanceBuffer::build
+ * @param count The number of instances
+ * @param func Called as func(i, M, colour) to fill in the model matrix and the colour of each instance
+ */
+template<typename Func>
+void InstanceBuffer::build(size_t count, Func func) {
+    m_instances.resize(count);
+    Instance *instances = m_instances.data();
+    parallelFor(0, count, [instances, &func](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            Instance &instance = instances[i];
+            glm::vec3 colour;
+            func(i, instance.m_M, colour);
+            instance.m_N = glm::mat4(glm::transpose(glm::inverse(glm::mat3(instance.m_M))));
+            instance.m_colour = glm::vec4(colour, 1.0f);
+        }
+    });
+    upload();
+}
+
+#endif // INSTANCEBUFFER_H
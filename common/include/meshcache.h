@@ -0,0 +1,140 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include "meshlod.h"
+#include "meshlets.h"
+
+/**
+ * @brief The MeshCache class
+ * A compact binary container for a mesh which has already been loaded, processed and interleaved
+ * into the layout expected by the GPU. When a cache is opened the file is memory mapped, so the
+ * vertex and index data can be handed straight to MultiBufferIndexVAO::setData() without parsing
+ * or copying anything on the CPU. Each cache stores the size, modification time and a hash of the
+ * source file it was built from, so it is discarded automatically when the source changes.
+ * The indices can hold a chain of levels of detail (see MeshLOD), which all share the same vertices, and each level
+ * can be split into meshlets for culling (see Meshlets).
+ * A cache can also hold a quantised copy of every vertex record (see VertexPacker) along with the box its positions
+ * are stored relative to, so that a scene drawing the packed records can map those straight from the file too.
+ */
+class MeshCache
+{
+public:
+    /// Flags describing which attributes are interleaved in each vertex record (in this order)
+    typedef enum {
+        ATTRIB_POSITION  = 1 << 0,  //< 3 floats
+        ATTRIB_NORMAL    = 1 << 1,  //< 3 floats
+        ATTRIB_CURVATURE = 1 << 2   //< 6 floats: K1 and K2 scaled by the principal curvature values
+    } Attribute;
+
+    /// Construct an empty (unmapped) cache
+    MeshCache();
+
+    /// Unmaps the file if it is still open
+    ~MeshCache();
+
+    /// Map the cache built for _source. Returns false if it is missing, stale or has a different layout.
+    bool open(const std::string &/*source*/, unsigned int /*attributes*/);
+
+    /// Unmap the file
+    void close();
+
+    /// Write a new cache for _source from interleaved vertex data and triangle indices. If levels are given the
+    /// indices hold every level one after the other, otherwise they are stored as a single level. The meshlets (if
+    /// any) are those referred to by the levels. The packed records (if any) are one of packedStride bytes for each
+    /// vertex, with positions relative to packedBox (the minimum corner then the extent).
+    static bool write(const std::string &/*source*/,
+                      unsigned int /*attributes*/,
+                      const float */*vertices*/,
+                      std::uint32_t /*numVertices*/,
+                      const std::uint32_t */*indices*/,
+                      std::uint32_t /*numIndices*/,
+                      const MeshLOD::Level */*levels*/ = nullptr,
+                      std::uint32_t /*numLevels*/ = 0,
+                      const Meshlets::Meshlet */*meshlets*/ = nullptr,
+                      std::uint32_t /*numMeshlets*/ = 0,
+                      const void */*packed*/ = nullptr,
+                      std::uint32_t /*packedStride*/ = 0,
+                      const float */*packedBox*/ = nullptr);
+
+    /// Returns true if a valid cache is currently mapped
+    bool isOpen() const {return m_header != nullptr;}
+
+    /// Raw pointers into the mapped file (only valid while the cache is open)
+    const float *vertices() const;
+    const std::uint32_t *indices() const;
+
+    /// The dimensions of the mapped data. numIndices() covers all of the levels.
+    std::uint32_t numVertices() const;
+    std::uint32_t numIndices() const;
+    std::uint32_t floatsPerVertex() const;
+
+    /// The levels of detail within the indices (there is always at least one)
+    std::uint32_t numLevels() const;
+    const MeshLOD::Level *levels() const;
+
+    /// The meshlets of all of the levels (there may be none)
+    std::uint32_t numMeshlets() const;
+    const Meshlets::Meshlet *meshlets() const;
+
+    /// The packed vertex records, their size in bytes (0 if there are none) and the 6 floats of their position box
+    const void *packedVertices() const;
+    std::uint32_t packedStride() const;
+    const float *packedBox() const;
+
+    /// The size of the vertex and index data in bytes
+    std::size_t vertexBytes() const {return std::size_t(numVertices()) * floatsPerVertex() * sizeof(float);}
+    std::size_t indexBytes() const {return std::size_t(numIndices()) * sizeof(std::uint32_t);}
+
+    /// The number of floats in each interleaved vertex record for a set of attribute flags
+    static std::uint32_t floatsPerVertex(unsigned int /*attributes*/);
+
+    /// The offset in floats of one of the attributes within a vertex record holding the given attributes
+    static std::uint32_t attributeOffset(unsigned int _attributes, Attribute _attribute) {
+        return floatsPerVertex(_attributes & (static_cast<unsigned int>(_attribute) - 1));
+    }
+
+    /// The file name of the cache associated with a source mesh
+    static std::string cacheFileName(const std::string &_source) {return _source + ".meshcache";}
+
+    /// A 64 bit FNV-1a hash of the contents of a file (returns 0 if the file can't be read)
+    static std::uint64_t hashFile(const std::string &/*fileName*/);
+
+private:
+    /// The fixed size header at the start of every cache file
+    struct Header {
+        char m_magic[4];                //< Always "NCMC"
+        std::uint32_t m_version;        //< Bumped whenever the layout of the file changes
+        std::uint32_t m_attributes;     //< The Attribute flags used to build the vertex records
+        std::uint32_t m_floatsPerVertex;//< The stride of a vertex record in floats
+        std::uint32_t m_numVertices;    //< The number of vertex records
+        std::uint32_t m_numIndices;     //< The number of triangle indices
+        std::uint64_t m_sourceSize;     //< The size of the source file in bytes
+        std::int64_t m_sourceTime;      //< The modification time of the source file
+        std::uint64_t m_sourceHash;     //< hashFile() of the source file
+        std::uint64_t m_vertexOffset;   //< Byte offset of the vertex data from the start of the file
+        std::uint64_t m_indexOffset;    //< Byte offset of the index data from the start of the file
+        std::uint32_t m_numLevels;      //< The number of MeshLOD::Level records
+        std::uint32_t m_numMeshlets;    //< The number of Meshlets::Meshlet records
+        std::uint64_t m_levelOffset;    //< Byte offset of the level records from the start of the file
+        std::uint64_t m_meshletOffset;  //< Byte offset of the meshlet records from the start of the file
+        std::uint32_t m_packedStride;   //< The size of a packed vertex record in bytes, or 0 if there are none
+        float m_packedBox[6];           //< The minimum corner and extent the packed positions are relative to
+        std::uint64_t m_packedOffset;   //< Byte offset of the packed vertex records from the start of the file
+    };
+
+    /// Retrieve the size and modification time of a file
+    static bool fileStats(const std::string &/*fileName*/, std::uint64_t &/*size*/, std::int64_t &/*time*/);
+
+    /// The mapped region and its size
+    void *m_map;
+    std::size_t m_mapSize;
+
+    /// Points to the start of the mapped region once it has been validated
+    const Header *m_header;
+};
+
+#endif // MESHCACHE_H
@@ -0,0 +1,59 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "meshlod.h"
+
+/**
+ * @brief The Meshlets class
+ * Splits the triangles of a mesh into small clusters (meshlets) of up to 128 connected triangles, each with a
+ * bounding sphere and a cone which contains all of its face normals. Every frame the clusters are tested on the CPU
+ * against the view frustum and the cone, and only the survivors are submitted with a single multi-draw (see
+ * MultiBufferIndexVAO::setClusterIndices()). The cone test follows the "normal cone" of Shirman and Abi-Ezzi, and
+ * removes clusters whose triangles all face away from the eye.
+ */
+class Meshlets
+{
+public:
+    /// A cluster of triangles within the index buffer
+    struct Meshlet {
+        std::uint32_t m_firstIndex = 0;  //< The first index of the meshlet
+        std::uint32_t m_numIndices = 0;  //< The number of indices (3 per triangle)
+        float m_centre[3];               //< The bounding sphere
+        float m_radius = 0.0f;
+        float m_coneAxis[3];             //< The average direction of the face normals
+        float m_coneCutoff = 1.0f;       //< The sine of the widest angle between a normal and the axis (1 never culls)
+    };
+
+    /// The largest number of triangles in a meshlet
+    static const size_t MAX_TRIANGLES = 128;
+
+    /// The number of triangles submitted and culled, summed over some number of frames
+    struct CullStats {
+        size_t m_frames = 0;
+        size_t m_meshlets = 0;           //< Meshlets submitted
+        size_t m_submitted = 0;          //< Triangles submitted
+        size_t m_frustumCulled = 0;      //< Triangles in meshlets outside of the frustum
+        size_t m_coneCulled = 0;         //< Triangles in meshlets facing away from the eye
+    };
+
+    /// Split each level of detail into meshlets. The triangles of each level are reordered in place so that every
+    /// meshlet is contiguous, and the meshlet range of each level is filled in. The levels are built in parallel.
+    static std::vector<Meshlet> build(std::uint32_t */*indices*/, MeshLOD::Level */*levels*/, size_t /*numLevels*/,
+                                      const float */*vertices*/, size_t /*numVertices*/, size_t /*floatsPerVertex*/,
+                                      size_t /*maxTriangles*/ = MAX_TRIANGLES);
+
+    /// Find the meshlets which may be visible. mvp is the column major model-view-projection matrix, and eye is the
+    /// position of the eye in model space (or nullptr to skip the cone test). The index of each visible meshlet,
+    /// relative to the first one passed in, is written to visible, and the triangle counts are added to stats.
+    static void cull(const Meshlet */*meshlets*/, size_t /*numMeshlets*/, const float */*mvp*/, const float */*eye*/,
+                     std::vector<std::uint32_t> &/*visible*/, CullStats &/*stats*/);
+
+    /// Print the average number of triangles submitted and culled per frame to std::cout, then reset the stats
+    static void report(const char */*name*/, CullStats &/*stats*/);
+};
+
+#endif // MESHLETS_H
@@ -0,0 +1,57 @@
+#ifndef MESHLOD_H
+#define MESHLOD_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief The MeshLOD class
+ * Builds a chain of simplified index buffers for a mesh using half-edge collapses ordered by quadric error metrics
+ * (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics", 1997). A half-edge collapse moves a
+ * vertex onto one of its neighbours rather than creating a new one, so every level indexes the original vertex
+ * buffer and any per-vertex attributes (normals, curvature) stay valid. Only the indices of each level are stored.
+ *
+ * Each pass splits the triangles into a grid of spatial clusters which are simplified in parallel. Vertices on the
+ * boundary between clusters are locked so that the threads never touch the same triangles, and the grid is shifted
+ * by half a cell on alternate passes so that the seams are simplified as well.
+ */
+class MeshLOD
+{
+public:
+    /// A level of detail within the concatenated index buffer
+    struct Level {
+        std::uint32_t m_firstIndex = 0;  //< The first index of the level
+        std::uint32_t m_numIndices = 0;  //< The number of indices (3 per triangle)
+        float m_error = 0.0f;            //< An error estimate (not a bound) of the distance from the full mesh
+        std::uint32_t m_firstMeshlet = 0;//< The first meshlet of the level (filled in by Meshlets::build)
+        std::uint32_t m_numMeshlets = 0; //< The number of meshlets, or 0 if none have been built
+        std::uint32_t m_padding = 0;     //< Keeps the record a multiple of 8 bytes in the MeshCache
+    };
+
+    /// The most levels that will be built (including the full resolution mesh)
+    static const size_t MAX_LEVELS = 8;
+
+    /// Build the chain. Level 0 is the input triangle list, and each level has about reduction times the triangles
+    /// of the one before, until there are fewer than minTriangles or the mesh can't be simplified any further.
+    /// The indices of all the levels are written one after the other to out, each in vertex cache order.
+    static std::vector<Level> build(const std::uint32_t */*indices*/, size_t /*numIndices*/,
+                                    const float */*vertices*/, size_t /*numVertices*/, size_t /*floatsPerVertex*/,
+                                    std::vector<std::uint32_t> &/*out*/,
+                                    float /*reduction*/ = 0.5f, size_t /*minTriangles*/ = 1000);
+
+    /// Choose the coarsest level whose error, seen from distance, projects to no more than maxPixels. pixelsPerUnit
+    /// is the size in pixels of one unit at a distance of one (the height of the viewport * P[1][1] / 2, times
+    /// any scale in the model matrix).
+    static size_t selectLevel(const Level */*levels*/, size_t /*numLevels*/, float /*distance*/,
+                              float /*pixelsPerUnit*/, float /*maxPixels*/ = 1.0f);
+
+    /// The sphere around the bounding box of the positions at the start of each record
+    static void boundingSphere(const float */*vertices*/, size_t /*numVertices*/, size_t /*floatsPerVertex*/,
+                               float */*centre*/, float &/*radius*/);
+
+    /// Print the triangle count and error of each level to std::cout
+    static void report(const char */*name*/, const Level */*levels*/, size_t /*numLevels*/);
+};
+
+#endif // MESHLOD_H
@@ -0,0 +1,69 @@
+#ifndef MESHOPTIMISER_H
+#define MESHOPTIMISER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief The MeshOptimiser class
+ * Reorders indexed triangle meshes for the GPU. The triangles are sorted with Tipsify (Sander, Nehab and Barczak,
+ * "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007) so that the post-transform vertex
+ * cache is reused as much as possible, and then the vertices are sorted into the order they are first used so that
+ * vertex fetches walk through memory. Both passes run in linear time, so they can be used when building a MeshCache.
+ */
+class MeshOptimiser
+{
+public:
+    /// The cache statistics of an index buffer
+    struct Stats {
+        float m_acmr = 0.0f;   //< Average cache miss ratio: vertex shader invocations per triangle (0.5 is ideal)
+        float m_atvr = 0.0f;   //< Average transformed vertex ratio: invocations per referenced vertex (1 is ideal)
+    };
+
+    /// The FIFO cache size used to report the statistics, typical of current hardware
+    static const unsigned int DEFAULT_CACHE_SIZE = 16;
+
+    /// A run of indices drawn with a single base vertex
+    struct IndexRange {
+        std::uint32_t m_first = 0;       //< The first index of the run
+        std::uint32_t m_count = 0;       //< The number of indices (including any restart markers)
+        std::uint32_t m_baseVertex = 0;  //< Added to every index in the run
+    };
+
+    /// An index buffer rewritten by compactIndices(): 16 bit runs drawn with a base vertex, followed by at most one
+    /// 32 bit run for the triangles which didn't fit
+    struct CompactIndices {
+        bool m_strips = false;                  //< Triangle strips separated by the maximum value of the index type
+        std::vector<std::uint16_t> m_indices16;
+        std::vector<std::uint32_t> m_indices32;
+        std::vector<IndexRange> m_ranges16;
+        std::vector<IndexRange> m_ranges32;
+    };
+
+    /// Simulate a FIFO post-transform cache of cacheSize entries over the triangle list
+    static Stats analyse(const std::uint32_t */*indices*/, size_t /*numIndices*/, size_t /*numVertices*/,
+                         unsigned int /*cacheSize*/ = DEFAULT_CACHE_SIZE);
+
+    /// Reorder the triangles in place using Tipsify with the given cache size
+    static void optimiseTriangles(std::uint32_t */*indices*/, size_t /*numIndices*/, size_t /*numVertices*/,
+                                  unsigned int /*cacheSize*/ = DEFAULT_CACHE_SIZE);
+
+    /// Reorder the interleaved vertex records by first use in the index buffer, and remap the indices to match.
+    /// Unreferenced vertices are moved to the end. Returns the new index of each old vertex.
+    static std::vector<std::uint32_t> optimiseVertices(std::uint32_t */*indices*/, size_t /*numIndices*/,
+                                                       float */*vertices*/, size_t /*numVertices*/,
+                                                       size_t /*floatsPerVertex*/);
+
+    /// Rewrite a triangle list with the smallest index type. Meshes with too many vertices for 16 bits are split into
+    /// windows drawn with a base vertex, which covers nearly every triangle once the vertices are in first use order.
+    /// Optionally the triangles are joined into strips within each window, separated by the primitive restart index.
+    static CompactIndices compactIndices(const std::uint32_t */*indices*/, size_t /*numIndices*/, size_t /*numVertices*/,
+                                         bool /*allow16bit*/ = true, bool /*stripify*/ = false);
+
+    /// Run both passes and print the cache statistics before and after to std::cout
+    static void optimise(const char */*name*/, std::uint32_t */*indices*/, size_t /*numIndices*/,
+                         float */*vertices*/, size_t /*numVertices*/, size_t /*floatsPerVertex*/);
+};
+
+#endif // MESHOPTIMISER_H
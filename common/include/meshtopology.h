@@ -0,0 +1,103 @@
+#ifndef MESHTOPOLOGY_H
+#define MESHTOPOLOGY_H
+
+#include <Eigen/Core>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief The MeshTopology class
+ * The connectivity of a triangle mesh in a compact, flat form which can be shared by anything that needs to walk
+ * over the mesh (normals, curvature, silhouettes, simplification). It stores
+ *  - compressed sparse row (CSR) vertex-to-face adjacency, with the faces of each vertex in ascending order
+ *  - CSR vertex-to-vertex adjacency, with the neighbours of each vertex sorted and unique
+ *  - a flat half-edge array. Half-edge h belongs to face h/3 and runs from corner h%3 to the next corner, so
+ *    next, previous, face and source need no storage and only the twin is kept.
+ * All indices are 32 bits, and every stage of the build runs in parallel in time linear in the size of the mesh
+ * (assuming the valence of the vertices is bounded, as it is for any reasonable mesh).
+ */
+class MeshTopology
+{
+public:
+    typedef Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixXir;
+
+    /// Marks a half-edge without a twin (on the boundary, or on a non-manifold edge)
+    static const std::uint32_t INVALID = 0xffffffff;
+
+    /// A range of indices within one of the CSR arrays, usable in a range based for loop
+    struct Range {
+        const std::uint32_t *m_begin, *m_end;
+        const std::uint32_t *begin() const {return m_begin;}
+        const std::uint32_t *end() const {return m_end;}
+        size_t size() const {return size_t(m_end - m_begin);}
+        bool empty() const {return m_begin == m_end;}
+    };
+
+    /// Construct an empty topology
+    MeshTopology() {}
+
+    /// Build the topology from numFaces triangles (3 indices each) over numVertices vertices
+    void build(const std::uint32_t */*faces*/, size_t /*numFaces*/, size_t /*numVertices*/);
+
+    /// As above, from a row major matrix of faces
+    void build(const MatrixXir &/*F*/, size_t /*numVertices*/);
+
+    /// Mesh dimensions
+    size_t numVertices() const {return m_numVertices;}
+    size_t numFaces() const {return m_numFaces;}
+    size_t numHalfEdges() const {return m_faces.size();}
+
+    /// The face indices (3 per face)
+    const std::vector<std::uint32_t> &faces() const {return m_faces;}
+    const std::uint32_t *face(size_t f) const {return m_faces.data() + 3 * f;}
+
+    /// The faces around vertex v, in ascending order
+    Range vertexFaces(size_t v) const {return Range{m_vfAdj.data() + m_vfOffset[v], m_vfAdj.data() + m_vfOffset[v + 1]};}
+
+    /// The vertices sharing an edge with vertex v, in ascending order
+    Range vertexNeighbours(size_t v) const {return Range{m_vvAdj.data() + m_vvOffset[v], m_vvAdj.data() + m_vvOffset[v + 1]};}
+
+    /// Half-edge navigation
+    static std::uint32_t halfEdgeFace(std::uint32_t h) {return h / 3;}
+    static std::uint32_t next(std::uint32_t h) {return (h % 3 == 2) ? h - 2 : h + 1;}
+    static std::uint32_t prev(std::uint32_t h) {return (h % 3 == 0) ? h + 2 : h - 1;}
+    std::uint32_t source(std::uint32_t h) const {return m_faces[h];}
+    std::uint32_t target(std::uint32_t h) const {return m_faces[next(h)];}
+    std::uint32_t twin(std::uint32_t h) const {return m_twin[h];}
+    bool isBoundary(std::uint32_t h) const {return m_twin[h] == INVALID;}
+
+    /// Direct access to the raw arrays, e.g. for upload to the GPU
+    const std::vector<std::uint32_t> &vertexFaceOffsets() const {return m_vfOffset;}
+    const std::vector<std::uint32_t> &vertexFaceIndices() const {return m_vfAdj;}
+    const std::vector<std::uint32_t> &vertexNeighbourOffsets() const {return m_vvOffset;}
+    const std::vector<std::uint32_t> &vertexNeighbourIndices() const {return m_vvAdj;}
+    const std::vector<std::uint32_t> &twins() const {return m_twin;}
+
+private:
+    /// Build the vertex-to-face adjacency
+    void buildVertexFaces();
+
+    /// Build the vertex-to-vertex adjacency from the vertex-to-face adjacency
+    void buildVertexNeighbours();
+
+    /// Match up the half-edges using the vertex-to-face adjacency
+    void buildTwins();
+
+    /// Mesh dimensions
+    size_t m_numVertices = 0;
+    size_t m_numFaces = 0;
+
+    /// The face indices, which double as the source vertex of each half-edge
+    std::vector<std::uint32_t> m_faces;
+
+    /// CSR vertex-to-face adjacency: the faces of vertex v are m_vfAdj[m_vfOffset[v]..m_vfOffset[v+1]]
+    std::vector<std::uint32_t> m_vfOffset, m_vfAdj;
+
+    /// CSR vertex-to-vertex adjacency
+    std::vector<std::uint32_t> m_vvOffset, m_vvAdj;
+
+    /// The opposite half-edge of each half-edge
+    std::vector<std::uint32_t> m_twin;
+};
+
+#endif // MESHTOPOLOGY_H
@@ -26,6 +26,9 @@
 #include <iostream>
 #include <array>
 
+#include "tracelog.h"
+#include "bufferhash.h"
+
 /**
  * @brief The NoiseTexture class
  */
@@ -250,16 +253,22 @@ void NoiseTexture<DIM>::generate_recurse(const size_t &d,
 template <size_t DIM>
 void NoiseTexture<DIM>::generate() {
     if (m_isInit) return;
+    TraceScope trace("NoiseTexture::generate");
 
     // Allocate a slab of data for the stuffing
     GLfloat *data = (GLfloat*) malloc(sizeof(GLfloat) * pow(m_res,DIM) * 3);
 
     // Use the recursive function to generate the data recursively
     CoordinateArray coord;
+    TraceLog::begin("noise");
     generate_recurse(DIM, coord, data);
+    TraceLog::end("noise");
+    BufferHash::record("noise texture", data, sizeof(GLfloat) * pow(m_res,DIM) * 3);
 
     // Copy our data over to the GPU
+    TraceLog::begin("upload");
     copyTextureDataToGPU(data);
+    TraceLog::end("upload");
 
     // Delete our data - it's been copied onto the GPU right?
     free(data);
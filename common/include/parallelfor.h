@@ -0,0 +1,50 @@
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+/// The number of worker threads used by parallelFor (always at least 1)
+inline size_t parallelThreadCount() {
+    size_t cnt = std::thread::hardware_concurrency();
+    return (cnt == 0)?1:cnt;
+}
+
+/**
+ * @brief parallelFor Split the range [begin,end) into contiguous blocks and process each block on its
+ * own thread. The function is called as func(blockBegin, blockEnd, threadIdx), where threadIdx is
+ * less than parallelThreadCount() and can be used to index per-thread scratch storage.
+ * @param begin The first index
+ * @param end One past the last index
+ * @param func The function to execute on each block
+ * @param minBlock Ranges smaller than this are not worth spawning threads for
+ */
+template<typename Func>
+void parallelFor(size_t begin, size_t end, Func func, size_t minBlock = 1024) {
+    if (end <= begin) return;
+    size_t range = end - begin;
+    size_t numThreads = std::min(parallelThreadCount(), (range + minBlock - 1) / minBlock);
+
+    // Not enough work to be worth the overhead of the threads
+    if (numThreads <= 1) {
+        func(begin, end, size_t(0));
+        return;
+    }
+
+    // The calling thread processes the last block while the others are running
+    size_t blockSize = (range + numThreads - 1) / numThreads;
+    numThreads = (range + blockSize - 1) / blockSize;
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (size_t t = 0; t < numThreads - 1; ++t) {
+        size_t b = begin + t * blockSize;
+        size_t e = std::min(end, b + blockSize);
+        threads.push_back(std::thread(func, b, e, t));
+    }
+    func(begin + (numThreads - 1) * blockSize, end, numThreads - 1);
+    for (std::thread &t : threads) t.join();
+}
+
+#endif // PARALLELFOR_H
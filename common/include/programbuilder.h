@@ -0,0 +1,78 @@
+#ifndef PROGRAMBUILDER_H
+#define PROGRAMBUILDER_H
+
+#include "programcache.h"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <initializer_list>
+
+// The tokens of GL_KHR_parallel_shader_compile, in case the GL headers are older than the extension
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+/**
+ * @brief The ProgramBuilder class
+ * Builds all of the programs of a scene at once. Every program is queued with add(), which loads it from its
+ * ProgramCache or otherwise starts compiling and linking it without waiting. Where the driver supports
+ * GL_KHR_parallel_shader_compile the compiles run on the driver's own threads, poll() checks which programs have
+ * finished with GL_COMPLETION_STATUS_KHR without blocking, and the scene can carry on initialising in the meantime.
+ * Without the extension GL still queues the work, but poll() blocks on each program in turn. Once a program is ready
+ * its handle is returned by program(), and report() lists how long each one took from being queued.
+ */
+class ProgramBuilder
+{
+public:
+    /// Enable parallel compilation if the driver supports it
+    ProgramBuilder();
+
+    /// Queue a program, returning its index. Cached programs are ready straight away.
+    size_t add(const std::string &/*name*/, std::initializer_list<ProgramCache::Stage> /*stages*/);
+
+    /// Finish any programs which are ready without blocking. Returns true once every program is finished.
+    bool poll();
+
+    /// Wait for every program to finish and print the timing report
+    void finish();
+
+    /// Whether the driver is compiling in the background
+    bool isParallel() const {return m_isParallel;}
+
+    /// The program, or 0 if it isn't ready yet or failed to build
+    GLuint program(size_t /*index*/) const;
+    GLuint program(const std::string &/*name*/) const;
+
+    /// Print how long each program took to build, and whether it came from the cache
+    void report() const;
+
+private:
+    /// A queued program
+    struct Job {
+        std::string m_name;
+        std::vector<ProgramCache::Stage> m_stages;
+        std::vector<GLuint> m_shaders;       //< The shaders being compiled (empty if it came from the cache)
+        std::uint64_t m_sourceHash = 0;
+        std::string m_cacheName;
+        GLuint m_program = 0;
+        bool m_isDone = false;
+        bool m_isCached = false;
+        double m_queuedTime = 0.0;          //< When the program was queued, in ms since the builder was created
+        double m_readyTime = 0.0;           //< When the program was found to be finished
+    };
+
+    /// The time in ms since the builder was created
+    double elapsed() const;
+
+    std::vector<Job> m_jobs;
+    bool m_isParallel = false;
+    GLint m_numFormats = 0;
+    std::string m_driver;
+    std::chrono::high_resolution_clock::time_point m_start;
+};
+
+#endif // PROGRAMBUILDER_H
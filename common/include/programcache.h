@@ -0,0 +1,79 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+// Includes the GL headers in platform independent and order specific way
+#include <ngl/Types.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <initializer_list>
+
+/**
+ * @brief The ProgramCache class
+ * Builds GLSL programs from their source files, and keeps the linked binary (from glGetProgramBinary()) in a file
+ * next to the shaders so that the next run can hand it straight back to the driver with glProgramBinary() instead of
+ * compiling and linking again. Each cache stores a hash of the stage sources and the vendor, renderer and version
+ * strings of the driver which produced it. If any of these differ, or the driver refuses the binary (which it is
+ * allowed to do at any time, for example after an update), the program is compiled from source and the cache is
+ * rewritten.
+ */
+class ProgramCache
+{
+public:
+    /// A shader stage of a program and the file holding its source
+    struct Stage {
+        GLenum m_type;          //< e.g. GL_VERTEX_SHADER
+        std::string m_fileName; //< The GLSL source file
+    };
+
+    /// Load the program called _name from its cache, or compile and link it from the stage sources and write a new
+    /// cache. Returns the program, or 0 if it failed to build (the reasons are written to std::cerr).
+    static GLuint build(const std::string &/*name*/, std::initializer_list<Stage> /*stages*/);
+
+    /// The file name of the cache of a program, which lives alongside the source of its first stage
+    static std::string cacheFileName(const std::string &/*name*/, const std::string &/*firstStage*/);
+
+    /// The vendor, renderer and version strings of the current context, which identify the driver
+    static std::string driverString();
+
+    /// Read the source of every stage and hash them. Returns false if a file can't be read.
+    static bool readSources(const std::vector<Stage> &/*stages*/,
+                            std::vector<std::string> &/*sources*/,
+                            std::uint64_t &/*sourceHash*/);
+
+    /// Try to create a program from a cache file, returning 0 if it is missing, stale or rejected by the driver
+    static GLuint load(const std::string &/*cacheName*/, std::uint64_t /*sourceHash*/, const std::string &/*driver*/);
+
+    /// Start compiling the stages and linking the program, without waiting for the result. The shaders are returned
+    /// so that endCompile() can report their errors and delete them.
+    static GLuint beginCompile(const std::vector<Stage> &/*stages*/,
+                               const std::vector<std::string> &/*sources*/,
+                               std::vector<GLuint> &/*shaders*/);
+
+    /// Check the result of beginCompile() (which waits for it to finish) and delete the shaders. Returns false, and
+    /// deletes the program, if it failed to compile or link.
+    static bool endCompile(const std::string &/*name*/,
+                           GLuint /*program*/,
+                           const std::vector<Stage> &/*stages*/,
+                           const std::vector<GLuint> &/*shaders*/);
+
+    /// Retrieve the binary of a linked program and write it to a cache file
+    static bool write(GLuint /*program*/,
+                      const std::string &/*cacheName*/,
+                      std::uint64_t /*sourceHash*/,
+                      const std::string &/*driver*/);
+
+private:
+    /// The fixed size header at the start of every cache file. It is followed by the driver string and the binary.
+    struct Header {
+        char m_magic[4];                //< Always "NCPB"
+        std::uint32_t m_version;        //< Bumped whenever the layout of the file changes
+        std::uint64_t m_sourceHash;     //< fnv1a() of the stage types and sources
+        std::uint32_t m_binaryFormat;   //< The format returned by glGetProgramBinary()
+        std::uint32_t m_driverLength;   //< The number of characters in the driver string
+        std::uint64_t m_binaryLength;   //< The size of the binary in bytes
+    };
+};
+
+#endif // PROGRAMCACHE_H
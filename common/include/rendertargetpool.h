@@ -0,0 +1,109 @@
+#ifndef RENDERTARGETPOOL_H
+#define RENDERTARGETPOOL_H
+
+// Includes the GL headers in platform independent and order specific way
+#include <ngl/Types.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+/**
+ * @brief The RenderTargetPool class
+ * Hands out framebuffers with colour and depth textures for the passes of a frame, and takes them back afterwards so
+ * that they can be used again. Textures are allocated with their sizes rounded up to a bucket of BUCKET_SIZE pixels,
+ * so a window being dragged to a new size keeps drawing into the same textures until it crosses a bucket, and a pass
+ * just renders into the part of the target it asked for. Targets which haven't been acquired for MAX_IDLE_FRAMES
+ * frames are deleted in beginFrame(), so the old sizes are recycled lazily rather than on every resize.
+ *
+ * A format with more than one layer makes array textures, attached as layered so that a geometry shader can draw
+ * into every layer in one pass by writing gl_Layer (as the cascades of a shadow map are).
+ *
+ * Passes acquire a target each frame and release it when the next pass has read it:
+ *
+ *     m_renderTargets.beginFrame();
+ *     RenderTargetPool::Target *target = m_renderTargets.acquire(m_width, m_height, format);
+ *     target->bind();
+ *     ... draw, then read target->m_colour, scaling the texture coordinates by target->uvScale() ...
+ *     m_renderTargets.release(target);
+ */
+class RenderTargetPool
+{
+public:
+    /// Sizes are rounded up to a multiple of this
+    static constexpr GLsizei BUCKET_SIZE = 128;
+
+    /// The number of frames a target can go unused before it is deleted
+    static constexpr int MAX_IDLE_FRAMES = 120;
+
+    /// The attachments of a target. A format of GL_NONE leaves that attachment out.
+    struct Format {
+        GLenum m_colour = GL_RGBA8;
+        GLenum m_depth = GL_DEPTH_COMPONENT24;
+        GLenum m_filter = GL_LINEAR;
+        GLsizei m_layers = 1;   //< More than one makes GL_TEXTURE_2D_ARRAY textures
+
+        bool operator==(const Format &other) const {
+            return (m_colour == other.m_colour) && (m_depth == other.m_depth) && (m_filter == other.m_filter) &&
+                   (m_layers == other.m_layers);
+        }
+
+        /// The texture target of the attachments
+        GLenum textureTarget() const {return (m_layers > 1) ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;}
+    };
+
+    /// A framebuffer and the textures attached to it
+    struct Target {
+        GLuint m_fbo = 0, m_colour = 0, m_depth = 0;
+        GLsizei m_width = 0, m_height = 0;                  //< The size asked for by acquire()
+        GLsizei m_textureWidth = 0, m_textureHeight = 0;    //< The size of the textures, rounded up to the bucket
+        Format m_format;
+        int m_lastUsed = 0;                                 //< The frame it was last acquired in
+        bool m_isInUse = false;
+
+        /// Bind the framebuffer and set the viewport to the size asked for
+        void bind() const;
+
+        /// What texture coordinates over the part drawn to must be multiplied by to read the textures
+        glm::vec2 uvScale() const {
+            return glm::vec2(float(m_width) / float(m_textureWidth), float(m_height) / float(m_textureHeight));
+        }
+    };
+
+    /// Construct an empty pool (nothing is allocated until a target is acquired)
+    RenderTargetPool() {}
+
+    /// Call at the start of every frame, to delete the targets which have been idle for too long
+    void beginFrame();
+
+    /// Find a free target of the same format in the same size bucket, or make one
+    Target *acquire(GLsizei /*width*/, GLsizei /*height*/, const Format &/*format*/);
+
+    /// Hand a target back to the pool, once the frame has finished with it
+    void release(Target */*target*/);
+
+    /// Delete every target, which needs the context to still be current
+    void clear();
+
+    /// The number of targets allocated
+    size_t size() const {return m_targets.size();}
+
+private:
+    /// Allocate the textures and framebuffer of a target
+    static void create(Target &/*target*/);
+
+    /// Delete the textures and framebuffer of a target
+    static void destroy(Target &/*target*/);
+
+    /// Round a size up to the bucket
+    static GLsizei bucket(GLsizei size) {
+        return ((std::max(size, GLsizei(1)) + BUCKET_SIZE - 1) / BUCKET_SIZE) * BUCKET_SIZE;
+    }
+
+    /// Every target, so that the pointers handed out stay valid as the list changes
+    std::vector<std::unique_ptr<Target>> m_targets;
+    int m_frame = 0;
+};
+
+#endif // RENDERTARGETPOOL_H
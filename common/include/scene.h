@@ -18,6 +18,10 @@
 #include <fstream>
 #include <streambuf>
 
+// Needed for the frame timer and the pass profiler
+#include <chrono>
+#include <vector>
+
 /**
  * @brief The Scene class
  */
@@ -42,7 +46,86 @@ public:
     /// Set the projection matrix from somewhere else
     void setProjMatrix(glm::mat4 _P) {m_P = _P;}
 
+    /// Stop the clock of animated scenes at a time in seconds, so that a frame can be drawn again exactly (a negative
+    /// time starts the clock again)
+    void setFixedTime(double _t) {m_fixedTime = _t;}
+
 protected:
+    /// The per-frame uniform block, in std140 layout. The light position is in eye space.
+    struct FrameBlock {
+        glm::mat4 m_V, m_P;
+        glm::vec4 m_lightPosition;
+    };
+
+    /// The per-object uniform block, in std140 layout. N is stored as a mat4 so that its columns line up.
+    struct ObjectBlock {
+        glm::mat4 m_MVP, m_MV, m_N, m_depthBiasMVP;
+        glm::vec4 m_colour;
+    };
+
+    /// The binding points of the blocks, which must match the layout(binding=) in the shaders
+    static constexpr GLuint FRAME_BLOCK_BINDING = 0;
+    static constexpr GLuint OBJECT_BLOCK_BINDING = 1;
+
+    /// The number of frames the ring holds, so the CPU can write one while the GPU reads the others
+    static constexpr size_t UNIFORM_RING_FRAMES = 3;
+
+    /// Create the persistently mapped ring of uniform blocks, with room for maxObjects objects per frame (before GL 4.4
+    /// the blocks are written with glBufferSubData instead). Calling it again replaces the ring once the GPU has
+    /// finished with it.
+    void initUniformBlocks(size_t /*maxObjects*/);
+
+    /// Wait until the GPU is finished with the next frame of the ring, then write and bind its frame block
+    void beginUniformBlocks(const FrameBlock &/*frame*/);
+
+    /// Write an object block into the current frame, returning the slot to bind when it is drawn. The ring grows if
+    /// the frame is full.
+    GLuint pushObjectBlock(const ObjectBlock &/*object*/);
+
+    /// Bind the slice of the ring holding an object block
+    void bindObjectBlock(GLuint /*slot*/) const;
+
+    /// Fence the current frame of the ring once all of its draws have been submitted
+    void endUniformBlocks();
+
+    /// The number of frames averaged by timeFrame()
+    static constexpr int FRAME_REPORT_INTERVAL = 200;
+
+    /// Call once a frame to time the interval since the last call, printing the average every FRAME_REPORT_INTERVAL
+    /// frames along with a description of the workload
+    void timeFrame(const char */*name*/, const std::string &/*description*/);
+
+    /// Start the average again, for example when the workload changes
+    void resetFrameTimer() {m_numTimedFrames = -1; m_totalFrameTime = 0.0;}
+
+    /// The number of frames of timer queries in flight, so that a result is only read once the GPU has long finished
+    static constexpr size_t PROFILE_RING_FRAMES = 4;
+
+    /// The most passes timed in one frame
+    static constexpr size_t PROFILE_MAX_PASSES = 8;
+
+    /// Times a pass of the frame on the CPU and the GPU for as long as it is in scope. Passes mustn't nest, as only
+    /// one GL_TIME_ELAPSED query can be active at a time.
+    class ProfileScope {
+    public:
+        ProfileScope(Scene &scene, const char *name) : m_scene(scene) {m_scene.beginPass(name);}
+        ~ProfileScope() {m_scene.endPass();}
+    private:
+        Scene &m_scene;
+    };
+
+    /// Call at the start of paintGL() to collect the pass times of an old frame, if the GPU has finished it, and
+    /// start timing a new one. The average time of each pass is printed every FRAME_REPORT_INTERVAL frames, and while
+    /// the TraceLog is recording each pass appears on the CPU track of its thread and on the GPU track.
+    void beginProfileFrame(const char */*name*/);
+
+    /// Start and end timing a pass, which ProfileScope does for a block
+    void beginPass(const char */*name*/);
+    void endPass();
+
+    /// The seconds since start to the nearest ms, or the fixed time if one has been set
+    double elapsedTime(const std::chrono::high_resolution_clock::time_point &/*start*/) const;
+
     /// Check for generic OpenGL errors
     static GLvoid CheckError( const char* label ) noexcept;
 
@@ -64,6 +147,57 @@ protected:
     /// Keep a view and projection matrix here to render our scene
     glm::mat4 m_V, m_P;
 
+    /// The uniform block ring: the buffer, its mapping (or nullptr if it isn't persistently mapped), the size of a
+    /// block rounded up to the offset alignment, and the fence of each frame
+    GLuint m_uniformBuffer = 0;
+    GLubyte *m_uniformData = nullptr;
+    bool m_isUniformPersistent = false;
+    GLsizeiptr m_frameBlockStride = 0, m_objectBlockStride = 0, m_uniformFrameSize = 0;
+    size_t m_maxObjects = 0, m_numObjectBlocks = 0, m_uniformFrame = 0;
+    GLsync m_uniformFences[UNIFORM_RING_FRAMES] = {};
+
+    /// Create the buffer of a ring with room for maxObjects objects per frame, replacing m_uniformBuffer
+    void allocateUniformBlocks(size_t /*maxObjects*/);
+
+    /// Double the size of the ring, keeping the blocks already written this frame
+    void growUniformBlocks();
+
+    /// Copy a block into the ring at a byte offset
+    void writeUniformBlock(GLintptr /*offset*/, const void */*block*/, GLsizeiptr /*size*/);
+
+    /// The time given to setFixedTime(), or negative to follow the clock
+    double m_fixedTime = -1.0;
+
+    /// The frame timer (the first frame after a reset only sets the start time)
+    std::chrono::steady_clock::time_point m_lastFrameTime;
+    double m_totalFrameTime = 0.0;
+    int m_numTimedFrames = -1;
+
+    /// The passes of a frame of the profiler ring. The CPU start times are from TraceLog::now() in us, and the CPU
+    /// times are in ms.
+    struct ProfileFrame {
+        const char *m_names[PROFILE_MAX_PASSES];
+        double m_cpuStart[PROFILE_MAX_PASSES];
+        double m_cpuTime[PROFILE_MAX_PASSES];
+        size_t m_numPasses = 0;
+    };
+
+    /// The running total of a pass, for the report
+    struct PassTotal {
+        std::string m_name;
+        double m_cpuTime = 0.0, m_gpuTime = 0.0;
+        int m_count = 0;
+    };
+
+    /// The pass profiler: a ring of GL_TIME_ELAPSED queries and the CPU times which go with them, and the totals since
+    /// the last report
+    GLuint m_profileQueries[PROFILE_RING_FRAMES][PROFILE_MAX_PASSES] = {};
+    ProfileFrame m_profileFrames[PROFILE_RING_FRAMES];
+    size_t m_profileFrame = 0;
+    bool m_isProfiling = false, m_isPassOpen = false;
+    std::vector<PassTotal> m_passTotals;
+    int m_numProfiledFrames = 0;
+
     /// Function to convert HSV to RGB
     static void hsv2rgb(glm::vec3& rgb, const glm::vec3& hsv);
 
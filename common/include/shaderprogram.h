@@ -0,0 +1,104 @@
+#ifndef SHADERPROGRAM_H
+#define SHADERPROGRAM_H
+
+// Includes the GL headers in platform independent and order specific way
+#include <ngl/Types.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/**
+ * @brief The ShaderProgram class
+ * Wraps a linked GLSL program (for example one built by ngl::ShaderLib) and reads all of its active uniforms and
+ * subroutines once, straight after linking. Scenes ask for typed Uniform handles in initGL() and keep them, so that
+ * paintGL() sets values through a cached location without any string lookups or glGetUniformLocation() calls.
+ * Handles of uniforms which aren't active (for example optimised out by the compiler) have a location of -1, which
+ * GL silently ignores, and isActive() can be used to skip work for them.
+ */
+class ShaderProgram
+{
+public:
+    /// A cached uniform location of a known type. set() applies to the program currently in use.
+    template<typename T>
+    class Uniform {
+    public:
+        Uniform() {}
+
+        /// Whether the uniform is used by the program
+        bool isActive() const {return m_location != -1;}
+        GLint location() const {return m_location;}
+
+        /// Set the value
+        void set(const T &/*value*/) const;
+
+        /// Set the transpose of a matrix
+        void setTransposed(const T &/*value*/) const;
+
+    private:
+        friend class ShaderProgram;
+        explicit Uniform(GLint _location) : m_location(_location) {}
+        GLint m_location = -1;
+    };
+
+    /// Construct an empty wrapper
+    ShaderProgram() {}
+
+    /// Wrap a linked program and read its uniforms and subroutines
+    void init(GLuint /*programId*/);
+
+    /// Wrap a program which has been loaded and linked by ngl::ShaderLib
+    void init(const std::string &/*name*/);
+
+    /// The GL name of the program
+    GLuint id() const {return m_id;}
+
+    /// Make this the current program
+    void use() const {glUseProgram(m_id);}
+
+    /// The location of a uniform, or -1 if it isn't active. Elements of an array are found as "name[i]".
+    GLint location(const std::string &/*name*/) const;
+
+    /// A typed handle on a uniform (only call this while initialising, not every frame)
+    template<typename T>
+    Uniform<T> uniform(const std::string &_name) const {return Uniform<T>(location(_name));}
+
+    /// The index of a subroutine function in a shader stage, or GL_INVALID_INDEX if there isn't one
+    GLuint subroutineIndex(GLenum /*stage*/, const std::string &/*name*/) const;
+
+    /// Select the subroutine functions of a stage, one for each subroutine uniform location. GL forgets these
+    /// whenever a program is made current, so call it after use().
+    void setSubroutines(GLenum /*stage*/, const GLuint */*indices*/) const;
+
+    /// As above, for a stage with a single subroutine uniform
+    void setSubroutine(GLenum _stage, GLuint _index) const {setSubroutines(_stage, &_index);}
+
+private:
+    /// The subroutines of a shader stage
+    struct Stage {
+        GLenum m_stage;
+        GLint m_numUniformLocations;
+        std::unordered_map<std::string, GLuint> m_subroutines;
+    };
+
+    /// The program and what was found in it at link time
+    GLuint m_id = 0;
+    std::unordered_map<std::string, GLint> m_locations;
+    std::vector<Stage> m_stages;
+};
+
+/// The typed setters, which are defined in shaderprogram.cpp
+template<> void ShaderProgram::Uniform<bool>::set(const bool &) const;
+template<> void ShaderProgram::Uniform<GLint>::set(const GLint &) const;
+template<> void ShaderProgram::Uniform<GLuint>::set(const GLuint &) const;
+template<> void ShaderProgram::Uniform<GLfloat>::set(const GLfloat &) const;
+template<> void ShaderProgram::Uniform<glm::vec2>::set(const glm::vec2 &) const;
+template<> void ShaderProgram::Uniform<glm::vec3>::set(const glm::vec3 &) const;
+template<> void ShaderProgram::Uniform<glm::vec4>::set(const glm::vec4 &) const;
+template<> void ShaderProgram::Uniform<glm::mat3>::set(const glm::mat3 &) const;
+template<> void ShaderProgram::Uniform<glm::mat4>::set(const glm::mat4 &) const;
+template<> void ShaderProgram::Uniform<glm::mat3>::setTransposed(const glm::mat3 &) const;
+template<> void ShaderProgram::Uniform<glm::mat4>::setTransposed(const glm::mat4 &) const;
+
+#endif // SHADERPROGRAM_H
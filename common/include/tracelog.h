@@ -0,0 +1,64 @@
+#ifndef TRACELOG_H
+#define TRACELOG_H
+
+#include <string>
+
+/**
+ * @brief The TraceLog class
+ * Records where the time goes, for instance during start up where file I/O, geometry processing, noise generation,
+ * shader compilation and texture uploads all happen one after another. Code is marked up with begin() and end(), or a
+ * TraceScope for a block, and once recording has been started each event is appended to a buffer belonging to the
+ * thread which made it. The buffers are only ever written by their own thread and publish each event with an atomic
+ * count, so recording takes no locks and threads never wait for each other. write() saves everything recorded so far
+ * in the Chrome trace event format, which can be opened with chrome://tracing or ui.perfetto.dev. Passes timed on the
+ * GPU by the Scene profiler appear on a track of their own.
+ *
+ * Event names are kept as pointers rather than copied, so they must be string literals.
+ */
+class TraceLog
+{
+public:
+    /// Start recording, naming the calling thread "main"
+    static void start();
+
+    /// Stop recording (anything recorded is kept until the program exits)
+    static void stop();
+
+    /// Whether events are being recorded
+    static bool isEnabled();
+
+    /// Record the start and end of a span of work on the calling thread. Spans on a thread must nest.
+    static void begin(const char */*name*/);
+    static void end(const char */*name*/);
+
+    /// Record a span of work on the GPU, given when it was submitted and how long it took in us. It is placed when it
+    /// was submitted or when the previous GPU span ended, whichever is later. Only call this from the GL thread.
+    static void gpu(const char */*name*/, double /*submitted*/, double /*duration*/);
+
+    /// The time in us since the program started, which is the clock of the trace
+    static double now();
+
+    /// Write every event recorded so far to a Chrome trace JSON file
+    static bool write(const std::string &/*fileName*/);
+};
+
+/**
+ * @brief The TraceScope class
+ * Records a span of work on the calling thread for as long as it is in scope.
+ */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name) : m_name(name), m_isEnabled(TraceLog::isEnabled()) {
+        if (m_isEnabled) TraceLog::begin(m_name);
+    }
+    ~TraceScope() {
+        if (m_isEnabled) TraceLog::end(m_name);
+    }
+
+private:
+    const char *m_name;
+    bool m_isEnabled;   //< So that a span started before recording stopped is still ended
+};
+
+#endif // TRACELOG_H
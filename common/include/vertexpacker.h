@@ -0,0 +1,66 @@
+#ifndef VERTEXPACKER_H
+#define VERTEXPACKER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief The VertexPacker class
+ * Quantises interleaved float vertex records into compact GPU formats:
+ *  - unit vectors are octahedral encoded into 2 x 16 bit snorm, or packed as GL_INT_2_10_10_10_REV
+ *  - positions can be stored as 16 bit unorm within the bounding box of the mesh
+ *  - morph target deltas are 16 bit snorm with a scale per target
+ *  - unbounded scalars (curvature) are stored as half floats
+ * The matching decode is done in the vertex shaders, driven by uniforms whose defaults leave the float path alone.
+ */
+class VertexPacker
+{
+public:
+    /// The packed version of the 12 float position, normal, K1, K2 record used by the curv demo (24 bytes)
+    struct CurvatureVertex {
+        std::uint16_t m_position[4];  //< unorm16 within the bounding box (the 4th component is padding)
+        std::uint32_t m_normal;       //< GL_INT_2_10_10_10_REV
+        std::int16_t m_k1[2];         //< Octahedral encoded direction of K1
+        std::int16_t m_k2[2];         //< Octahedral encoded direction of K2
+        std::uint16_t m_kappa[2];     //< Half float magnitude of K1 and K2
+    };
+
+    /// Scalar conversions
+    static std::uint16_t floatToHalf(float /*f*/);
+    static std::uint16_t packUnorm16(float /*f*/);
+    static std::int16_t packSnorm16(float /*f*/);
+
+    /// Pack a vector with components in [-1,1] (plus a 2 bit w) as GL_INT_2_10_10_10_REV
+    static std::uint32_t packSnorm1010102(float /*x*/, float /*y*/, float /*z*/, float /*w*/ = 0.0f);
+
+    /// Octahedral encode a direction into two snorm16 values (the length of the input is ignored)
+    static void octEncode(const float */*v*/, std::int16_t */*out*/);
+
+    /// Find the bounding box of the positions at the start of each record
+    static void bounds(const float */*records*/, size_t /*numVertices*/, size_t /*floatsPerVertex*/,
+                       float */*minCorner*/, float */*extent*/);
+
+    /// Pack the curv demo records. Positions are stored relative to the box given by minCorner and extent.
+    /// If vertices is given only those records are packed.
+    static void packCurvature(const float */*records*/, size_t /*numVertices*/,
+                              const float */*minCorner*/, const float */*extent*/, CurvatureVertex */*out*/,
+                              const std::vector<std::uint32_t> */*vertices*/ = nullptr);
+
+    /// Layout of a packed morph record with numTargets targets: the base position stays as 3 floats so that
+    /// it can be rewritten freely, the deltas are 4 x snorm16 (the 4th is padding) and the normals 10:10:10:2
+    static size_t morphStride(size_t numTargets) {return 12 + 8 * (numTargets - 1) + 4 * numTargets;}
+    static size_t morphDeltaOffset(size_t t) {return 12 + 8 * (t - 1);}
+    static size_t morphNormalOffset(size_t numTargets, size_t t) {return 12 + 8 * (numTargets - 1) + 4 * t;}
+
+    /// The largest absolute delta component of each target from 1 to numTargets-1, used as the snorm16 scale
+    static std::vector<float> morphDeltaScales(const float */*records*/, size_t /*numVertices*/, size_t /*numTargets*/);
+
+    /// Pack BlendshapeLoader records (V0, V1-V0, ..., N0, N1, ...) into morphStride(numTargets) bytes each.
+    /// If vertices is given only those records are packed.
+    static void packMorph(const float */*records*/, size_t /*numVertices*/, size_t /*numTargets*/,
+                          const std::vector<float> &/*scales*/, std::uint8_t */*out*/,
+                          const std::vector<std::uint32_t> */*vertices*/ = nullptr);
+};
+
+#endif // VERTEXPACKER_H
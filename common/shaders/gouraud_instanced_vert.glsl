@@ -0,0 +1,93 @@
+#version 430
+
+// The matrices and light shared by every object this frame (see Scene::FrameBlock)
+layout (std140, binding=0) uniform FrameBlock {
+    mat4 V;
+    mat4 P;
+    vec4 LightPosition; // Light position in eye coords.
+} Frame;
+
+// The matrices of the pass, which are combined with the model matrix of each instance (see Scene::ObjectBlock)
+layout (std140, binding=1) uniform ObjectBlock {
+    mat4 MVP;
+    mat4 MV;
+    mat4 N; // This is the inverse transpose of the MV matrix (only the top left 3x3 is used)
+    mat4 depthBiasMVP;
+    vec4 Colour;
+} Object;
+
+// The model matrices and colours of every copy being drawn (see InstanceBuffer::Instance)
+struct InstanceInfo {
+    mat4 M;
+    mat4 N; // This is the inverse transpose of M (only the top left 3x3 is used)
+    vec4 Colour;
+};
+layout (std430, binding=2) readonly buffer InstanceBuffer {
+    InstanceInfo Instances[];
+};
+
+// The vertex position attribute
+layout (location=0) in vec3 VertexPosition;
+
+// The vertex normal attribute
+layout (location=1) in vec3 VertexNormal;
+
+// The texture coordinate attribute
+layout (location=2) in vec2 TexCoord;
+
+// Passed onto the fragment shader
+out vec3 LightIntensity;
+
+// Structure for holding light parameters
+struct LightInfo {
+    vec3 La; // Ambient light intensity
+    vec3 Ld; // Diffuse light intensity
+    vec3 Ls; // Specular light intensity
+};
+
+// We'll have a single light in the scene with some default values (its position comes from the frame block)
+uniform LightInfo Light = LightInfo(
+            vec3(0.2, 0.2, 0.2),        // La
+            vec3(1.0, 1.0, 1.0),        // Ld
+            vec3(1.0, 1.0, 1.0)         // Ls
+            );
+
+// The material properties of our object
+struct MaterialInfo {
+    vec3 Ka; // Ambient reflectivity
+    vec3 Ks; // Specular reflectivity
+    float Shininess; // Specular shininess factor
+};
+
+// The object has a material (its diffuse reflectivity comes from the instance)
+uniform MaterialInfo Material = MaterialInfo(
+            vec3(0.1, 0.1, 0.1),    // Ka
+            vec3(1.0, 1.0, 1.0),    // Ks
+            10.0                    // Shininess
+            );
+
+/************************************************************************************/
+void main() {
+    InstanceInfo instance = Instances[gl_InstanceID];
+
+    // Set the position of the current vertex
+    gl_Position = Object.MVP * instance.M * vec4(VertexPosition, 1.0);
+
+    // Transform your input normal
+    vec3 n = normalize( mat3(Object.N) * mat3(instance.N) * VertexNormal );
+
+    // Calculate the light vector
+    vec3 s = normalize( vec3(Frame.LightPosition) - gl_Position.xyz );
+
+    // Calculate the vertex position
+    vec3 v = normalize(vec3(-gl_Position.xyz));
+
+    // Reflect the light about the surface normal
+    vec3 r = reflect( -s, n );
+
+    // Compute the light from the ambient, diffuse and specular components
+    LightIntensity = (
+            Light.La * Material.Ka +
+            Light.Ld * instance.Colour.rgb * max( dot(s, n), 0.0 ) +
+            Light.Ls * Material.Ks * pow( max( dot(r,v), 0.0 ), Material.Shininess ));
+}
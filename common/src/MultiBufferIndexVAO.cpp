@@ -0,0 +1,381 @@
+#include "MultiBufferIndexVAO.h"
+#include "meshoptimiser.h"
+#include <iostream>
+#include <algorithm>
+
+void MultiBufferIndexVAO::draw() const
+{
+  if(m_allocated == false)
+  {
+    std::cerr<<"Warning trying to draw an unallocated VOA\n";
+  }
+  if(m_bound == false)
+  {
+    std::cerr<<"Warning trying to draw an unbound VOA\n";
+  }
+  if(m_parts.empty())
+  {
+    glDrawElements(m_mode,static_cast<GLsizei>(m_indicesCount),m_indexType,static_cast<ngl::Real *>(nullptr));
+    return;
+  }
+
+  drawRanges(nullptr,0);
+}
+
+void MultiBufferIndexVAO::drawClusters(const GLuint *_clusters, size_t _count) const
+{
+  if(m_parts.empty())
+  {
+    std::cerr<<"trying to draw clusters without setting cluster indices\n";
+    return;
+  }
+  drawRanges(_clusters,_count);
+}
+
+void MultiBufferIndexVAO::drawRanges(const GLuint *_ranges, size_t _count) const
+{
+  // gather the ranges of each index type so that each needs only one multi-draw
+  const Part &part=m_parts[m_part];
+  for(DrawList &list : m_drawLists)
+  {
+    list.m_counts.clear();
+    list.m_offsets.clear();
+    list.m_baseVertices.clear();
+  }
+  const size_t count=(_ranges==nullptr) ? part.m_numRanges : _count;
+  for(size_t i=0; i<count; ++i)
+  {
+    size_t range=part.m_firstRange+((_ranges==nullptr) ? i : _ranges[i]);
+    DrawList &list=m_drawLists[(m_rangeTypes[range]==GL_UNSIGNED_SHORT) ? 0 : 1];
+    list.m_counts.push_back(m_rangeCounts[range]);
+    list.m_offsets.push_back(m_rangeOffsets[range]);
+    list.m_baseVertices.push_back(m_rangeBaseVertices[range]);
+  }
+
+  if(m_primitiveRestart)
+  {
+    glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+  }
+  const GLenum types[2]={GL_UNSIGNED_SHORT,GL_UNSIGNED_INT};
+  for(size_t t=0; t<2; ++t)
+  {
+    const DrawList &list=m_drawLists[t];
+    if(list.m_counts.empty())
+    {
+      continue;
+    }
+    glMultiDrawElementsBaseVertex(m_mode,list.m_counts.data(),types[t],
+                                  const_cast<const GLvoid **>(list.m_offsets.data()),
+                                  static_cast<GLsizei>(list.m_counts.size()),
+                                  const_cast<GLint *>(list.m_baseVertices.data()));
+  }
+  if(m_primitiveRestart)
+  {
+    glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+  }
+}
+
+
+void MultiBufferIndexVAO::draw(int _startIndex, int _amount) const
+{
+  if(m_allocated == false)
+  {
+    std::cerr<<"Warning trying to draw an unallocated VOA\n";
+  }
+  if(m_bound == false)
+  {
+    std::cerr<<"Warning trying to draw an unbound VOA\n";
+  }
+  // the ranges mix 16 and 32 bit indices with their own base vertices, so a start index doesn't mean anything
+  if(!m_parts.empty())
+  {
+    std::cerr<<"trying to draw a span of indices which were set as ranges, use setPart() and draw() instead\n";
+    return;
+  }
+
+  switch(m_indexType)
+  {
+    case GL_UNSIGNED_INT   :
+     glDrawElements(m_mode,static_cast<GLsizei>(_amount),m_indexType,static_cast<GLuint *>(nullptr)+_startIndex);
+    break;
+    case GL_UNSIGNED_SHORT :
+      glDrawElements(m_mode,static_cast<GLsizei>(_amount),m_indexType,static_cast<GLushort *>(nullptr)+_startIndex);
+    break;
+    case GL_UNSIGNED_BYTE :
+      glDrawElements(m_mode,static_cast<GLsizei>(_amount),m_indexType,static_cast<GLubyte *>(nullptr)+_startIndex);
+    break;
+    default : std::cerr<<"wrong data type send for index value\n"; break;
+  }
+}
+
+ngl::Real * MultiBufferIndexVAO::mapBuffer(unsigned int _index, GLenum _accessMode)
+{
+    ngl::Real *ptr=nullptr;
+    bind();
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    ptr = static_cast<ngl::Real *>(glMapBuffer(GL_ARRAY_BUFFER, _accessMode));
+    return ptr;
+  }
+
+void MultiBufferIndexVAO::removeVAO()
+{
+  if(m_bound == true)
+  {
+    unbind();
+  }
+  if( m_allocated ==true)
+  {
+      glDeleteBuffers(1,&m_buffer);
+  }
+  if(m_indexBuffer != 0)
+  {
+    glDeleteBuffers(1,&m_indexBuffer);
+    m_indexBuffer=0;
+  }
+  glDeleteVertexArrays(1,&m_id);
+  m_allocated=false;
+}
+
+
+//void MultiBufferIndexVAO::setData(size_t _size, const GLfloat &_data, GLenum _mode)
+void MultiBufferIndexVAO::setData(const VertexData &_data)
+{
+  setData(_data.m_size, &_data.m_data, _data.m_mode);
+}
+
+void MultiBufferIndexVAO::setData(size_t _size, const GLvoid *_data, GLenum _mode)
+{
+
+  if(m_bound == false)
+  {
+  std::cerr<<"trying to set VOA data when unbound\n";
+  }
+  // remove any previous buffer so that we don't leak it when the data is re-set
+  if(m_allocated == true)
+  {
+    glDeleteBuffers(1,&m_buffer);
+  }
+  glGenBuffers(1, &m_buffer);
+
+  // now we will bind an array buffer to the first one and load the data for the verts
+  glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+  glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_size), _data, _mode);
+
+  m_allocated=true;
+}
+
+void MultiBufferIndexVAO::setSubData(size_t _offset, size_t _size, const GLvoid *_data)
+{
+  if(m_allocated == false)
+  {
+    std::cerr<<"trying to update VOA data before it has been set\n";
+    return;
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(_offset), static_cast<GLsizeiptr>(_size), _data);
+}
+
+void MultiBufferIndexVAO::updateRecords(const std::vector<GLuint> &_records, size_t _recordSize, const GLvoid *_data, GLuint _maxGap)
+{
+  const char *data = static_cast<const char *>(_data);
+  size_t i = 0;
+  while(i < _records.size())
+  {
+    // extend the run while the next record is near enough to the end of it
+    GLuint first = _records[i];
+    GLuint last = first;
+    for(++i; i < _records.size() && _records[i] - last <= _maxGap + 1; ++i)
+    {
+      last = _records[i];
+    }
+    size_t offset = first * _recordSize;
+    setSubData(offset, (last - first + 1) * _recordSize, data + offset);
+  }
+}
+
+void MultiBufferIndexVAO::setVertexAttribute(GLuint _id, GLint _size, GLenum _type, GLsizei _stride, size_t _byteOffset, bool _normalise)
+{
+  if(m_bound == false)
+  {
+    std::cerr<<"trying to set VOA attributes when unbound\n";
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+  glVertexAttribPointer(_id, _size, _type, _normalise ? GL_TRUE : GL_FALSE, _stride, static_cast<char *>(nullptr) + _byteOffset);
+  glEnableVertexAttribArray(_id);
+}
+
+void MultiBufferIndexVAO::setIndices(unsigned int _indexSize,const GLvoid *_indexData,GLenum _indexType,GLenum _mode)
+{
+  // we need to determine the size of the data type before we set it
+  // in default to a ushort
+  int size=sizeof(GLushort);
+  switch(_indexType)
+  {
+    case GL_UNSIGNED_INT   : size=sizeof(GLuint);   break;
+    case GL_UNSIGNED_SHORT : size=sizeof(GLushort); break;
+    case GL_UNSIGNED_BYTE  : size=sizeof(GLubyte);  break;
+    default : std::cerr<<"wrong data type send for index value\n"; break;
+  }
+  // now for the indices
+  bindIndexBuffer();
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indexSize * static_cast<GLsizeiptr>(size), const_cast<GLvoid *>(_indexData), _mode);
+  m_indexType=_indexType;
+  // plain indices replace any ranges set before
+  m_rangeCounts.clear();
+  m_rangeOffsets.clear();
+  m_rangeBaseVertices.clear();
+  m_rangeTypes.clear();
+  m_parts.clear();
+  m_primitiveRestart=false;
+}
+
+void MultiBufferIndexVAO::setCompactIndices(size_t _indexCount, const GLuint *_indexData, GLuint _numVertices, bool _strips, GLenum _mode)
+{
+  setCompactIndices(std::vector<GLuint>(1,static_cast<GLuint>(_indexCount)),_indexData,_numVertices,_strips,_mode);
+}
+
+void MultiBufferIndexVAO::setCompactIndices(const std::vector<GLuint> &_partSizes, const GLuint *_indexData, GLuint _numVertices, bool _strips, GLenum _mode)
+{
+  // compact each part on its own, and gather the 16 and 32 bit indices of all of them
+  std::vector<GLushort> shortIndices;
+  std::vector<GLuint> wideIndices;
+  m_rangeCounts.clear();
+  m_rangeOffsets.clear();
+  m_rangeBaseVertices.clear();
+  m_rangeTypes.clear();
+  m_parts.clear();
+  size_t first=0;
+  for(GLuint size : _partSizes)
+  {
+    MeshOptimiser::CompactIndices compact=MeshOptimiser::compactIndices(_indexData+first,size,_numVertices,true,_strips);
+    first+=size;
+
+    Part part;
+    part.m_firstRange=m_rangeCounts.size();
+    for(const MeshOptimiser::IndexRange &range : compact.m_ranges16)
+    {
+      addRange(GL_UNSIGNED_SHORT,shortIndices.size()+range.m_first,range.m_count,range.m_baseVertex);
+    }
+    if(!compact.m_indices32.empty())
+    {
+      addRange(GL_UNSIGNED_INT,wideIndices.size(),compact.m_indices32.size(),0);
+    }
+    part.m_numRanges=m_rangeCounts.size()-part.m_firstRange;
+    part.m_numIndices=compact.m_indices16.size()+compact.m_indices32.size();
+    shortIndices.insert(shortIndices.end(),compact.m_indices16.begin(),compact.m_indices16.end());
+    wideIndices.insert(wideIndices.end(),compact.m_indices32.begin(),compact.m_indices32.end());
+    m_parts.push_back(part);
+  }
+  uploadRanges(shortIndices,wideIndices,_mode);
+
+  m_primitiveRestart=_strips;
+  m_mode=_strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+  setPart(0);
+}
+
+void MultiBufferIndexVAO::setClusterIndices(const std::vector<GLuint> &_partClusters, const std::vector<GLuint> &_clusterSizes, const GLuint *_indexData, GLuint _numVertices, GLenum _mode)
+{
+  // every cluster is a range of its own, in 16 bits relative to its lowest vertex if the span allows it
+  std::vector<GLushort> shortIndices;
+  std::vector<GLuint> wideIndices;
+  m_rangeCounts.clear();
+  m_rangeOffsets.clear();
+  m_rangeBaseVertices.clear();
+  m_rangeTypes.clear();
+  m_parts.clear();
+  size_t first=0, cluster=0;
+  for(GLuint numClusters : _partClusters)
+  {
+    Part part;
+    part.m_firstRange=m_rangeCounts.size();
+    part.m_numRanges=numClusters;
+    for(GLuint c=0; c<numClusters && cluster<_clusterSizes.size(); ++c, ++cluster)
+    {
+      const GLuint *indices=_indexData+first;
+      const GLuint size=_clusterSizes[cluster];
+      GLuint minIndex=_numVertices, maxIndex=0;
+      for(GLuint i=0; i<size; ++i)
+      {
+        minIndex=std::min(minIndex,indices[i]);
+        maxIndex=std::max(maxIndex,indices[i]);
+      }
+      if(size!=0 && maxIndex-minIndex<0xffff)
+      {
+        addRange(GL_UNSIGNED_SHORT,shortIndices.size(),size,minIndex);
+        for(GLuint i=0; i<size; ++i)
+        {
+          shortIndices.push_back(static_cast<GLushort>(indices[i]-minIndex));
+        }
+      }
+      else
+      {
+        addRange(GL_UNSIGNED_INT,wideIndices.size(),size,0);
+        wideIndices.insert(wideIndices.end(),indices,indices+size);
+      }
+      part.m_numIndices+=size;
+      first+=size;
+    }
+    m_parts.push_back(part);
+  }
+  uploadRanges(shortIndices,wideIndices,_mode);
+
+  m_primitiveRestart=false;
+  m_mode=GL_TRIANGLES;
+  setPart(0);
+}
+
+void MultiBufferIndexVAO::addRange(GLenum _type, size_t _first, size_t _count, GLuint _baseVertex)
+{
+  m_rangeCounts.push_back(static_cast<GLsizei>(_count));
+  if(_type==GL_UNSIGNED_SHORT)
+  {
+    m_rangeOffsets.push_back(static_cast<GLushort *>(nullptr)+_first);
+  }
+  else
+  {
+    m_rangeOffsets.push_back(static_cast<GLuint *>(nullptr)+_first);
+  }
+  m_rangeBaseVertices.push_back(static_cast<GLint>(_baseVertex));
+  m_rangeTypes.push_back(_type);
+}
+
+void MultiBufferIndexVAO::uploadRanges(const std::vector<GLushort> &_shortIndices, const std::vector<GLuint> &_wideIndices, GLenum _mode)
+{
+  // the 32 bit indices follow the 16 bit ones, aligned to their size
+  size_t shortBytes=_shortIndices.size()*sizeof(GLushort);
+  size_t wideStart=(shortBytes+sizeof(GLuint)-1)/sizeof(GLuint)*sizeof(GLuint);
+  size_t wideBytes=_wideIndices.size()*sizeof(GLuint);
+  for(size_t i=0; i<m_rangeOffsets.size(); ++i)
+  {
+    if(m_rangeTypes[i]==GL_UNSIGNED_INT)
+    {
+      m_rangeOffsets[i]=static_cast<const char *>(m_rangeOffsets[i])+wideStart;
+    }
+  }
+
+  bindIndexBuffer();
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(wideStart+wideBytes), nullptr, _mode);
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(shortBytes), _shortIndices.data());
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLintptr>(wideStart), static_cast<GLsizeiptr>(wideBytes), _wideIndices.data());
+}
+
+void MultiBufferIndexVAO::bindIndexBuffer()
+{
+  // the buffer is kept and its storage respecified, so that setting the indices again doesn't leak the old one
+  if(m_indexBuffer == 0)
+  {
+    glGenBuffers(1, &m_indexBuffer);
+  }
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+}
+
+void MultiBufferIndexVAO::setPart(size_t _part)
+{
+  if(_part >= m_parts.size())
+  {
+    std::cerr<<"trying to select index part "<<_part<<" of "<<m_parts.size()<<"\n";
+    return;
+  }
+  m_part=_part;
+  m_indicesCount=m_parts[_part].m_numIndices;
+}
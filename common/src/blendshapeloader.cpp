@@ -0,0 +1,122 @@
+#include "blendshapeloader.h"
+#include "parallelfor.h"
+
+#include <future>
+#include <iostream>
+
+// The headers below are required to read the meshes and calculate the normals
+#include <igl/per_vertex_normals.h>
+#include <igl/read_triangle_mesh.h>
+
+/// Everything we need to keep from a single target while the others are still loading
+struct BlendshapeTarget {
+    BlendshapeLoader::MatrixXfr V, N;
+    BlendshapeLoader::MatrixXir F;
+    bool ok = false;
+};
+
+/**
+ * @brief loadTarget Read a single target and compute its vertex normals. The normals are invariant to the
+ * uniform scale and translation used to normalise the targets, so they can be computed straight away.
+ * @param fileName The mesh file to read
+ * @return The loaded target
+ */
+static BlendshapeTarget loadTarget(const std::string &fileName) {
+    BlendshapeTarget target;
+    target.ok = igl::read_triangle_mesh(fileName, target.V, target.F) && (target.V.rows() > 0);
+    if (target.ok) {
+        igl::per_vertex_normals(target.V, target.F, target.N);
+    } else {
+        std::cerr << "BlendshapeLoader::load() - could not read " << fileName << "\n";
+    }
+    return target;
+}
+
+/**
+ * @brief BlendshapeLoader::load
+ * The targets are read concurrently, but they are folded into the records one at a time in order and each is
+ * released as soon as it has been written. Besides the records, only the base and the targets being read (at most
+ * one per thread) are held at once, rather than every target.
+ * @param fileNames The morph target files, the first of which is the base shape
+ * @return true if all of the targets were loaded and share the same faces
+ */
+bool BlendshapeLoader::load(const std::vector<std::string> &fileNames) {
+    m_vertexData.clear();
+    m_faces.resize(0,0);
+    m_numTargets = m_numVertices = 0;
+    if (fileNames.empty()) return false;
+
+    // Read and process the targets concurrently, with no more in flight than there are threads to work on them.
+    // Each is started as an earlier one is taken.
+    std::vector<std::future<BlendshapeTarget> > futures(fileNames.size());
+    size_t numStarted = 0;
+    auto startNext = [&]() {
+        if (numStarted < fileNames.size()) {
+            futures[numStarted] = std::async(std::launch::async, loadTarget, fileNames[numStarted]);
+            ++numStarted;
+        }
+    };
+    auto take = [&](size_t t) {
+        BlendshapeTarget target = futures[t].get();
+        startNext();
+        return target;
+    };
+    for (size_t t = 0; t < parallelThreadCount(); ++t) startNext();
+
+    // The base sets the layout of the records and the box every target is normalised by
+    BlendshapeTarget base = take(0);
+    if (!base.ok) return false;
+    m_faces.swap(base.F);
+    m_numTargets = fileNames.size();
+    m_numVertices = size_t(base.V.rows());
+
+    // Determine our bounding box by finding the min and max corner of the base target
+    const MatrixXfr &V0 = base.V;
+    Eigen::RowVector3f minCorner = V0.colwise().minCoeff();
+    Eigen::RowVector3f maxCorner = V0.colwise().maxCoeff();
+
+    // The same scale and offset used to fit the base shape between 0 and 1 is applied to every target
+    float maxScale = (maxCorner - minCorner).cwiseInverse().maxCoeff();
+    Eigen::RowVector3f cntr = (maxCorner - minCorner) * (-0.5f * maxScale);
+
+    // Write the base position and normal of each record
+    const size_t stride = floatsPerVertex();
+    const size_t numTargets = m_numTargets;
+    m_vertexData.resize(m_numVertices * stride);
+    float *data = m_vertexData.data();
+    parallelFor(0, m_numVertices, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            float *record = data + i * stride;
+            Eigen::Map<Eigen::RowVector3f> pos(record);
+            pos = (V0.row(i) - minCorner) * maxScale + cntr;
+            Eigen::Map<Eigen::RowVector3f> normal(record + 3 * numTargets);
+            normal = base.N.row(i);
+        }
+    });
+    base.N.resize(0,0);
+
+    // Then fold in each of the other targets as it arrives, once it is known to share the faces of the base
+    for (size_t t = 1; t < numTargets; ++t) {
+        BlendshapeTarget target = take(t);
+        if (!target.ok || (target.V.rows() != V0.rows()) || (target.F != m_faces)) {
+            if (target.ok) {
+                std::cerr << "BlendshapeLoader::load() - " << fileNames[t] << " does not match the topology of "
+                          << fileNames[0] << "\n";
+            }
+            m_vertexData.clear();
+            m_faces.resize(0,0);
+            m_numTargets = m_numVertices = 0;
+            return false;
+        }
+        parallelFor(0, m_numVertices, [&](size_t begin, size_t end, size_t) {
+            for (size_t i = begin; i < end; ++i) {
+                float *record = data + i * stride;
+                Eigen::Map<Eigen::RowVector3f> delta(record + 3 * t);
+                delta = (target.V.row(i) - V0.row(i)) * maxScale;
+                Eigen::Map<Eigen::RowVector3f> normal(record + 3 * (numTargets + t));
+                normal = target.N.row(i);
+            }
+        });
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+#include "bufferhash.h"
+#include "fnv1a.h"
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <atomic>
+
+namespace {
+/// The file being written, and a lock so that buffers made on worker threads keep whole lines. The flag is checked
+/// without the lock, so the calls left in per frame code cost nothing when the hashes aren't being written.
+std::ofstream g_file;
+std::mutex g_mutex;
+std::atomic<bool> g_isEnabled(false);
+}
+
+/**
+ * @brief BufferHash::start
+ * @param fileName The text file to write
+ * @return false if the file couldn't be opened
+ */
+bool BufferHash::start(const std::string &fileName) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_file.is_open()) g_file.close();
+    g_file.open(fileName.c_str(), std::ios::trunc);
+    g_isEnabled = g_file.good();
+    if (!g_isEnabled) std::cerr << "BufferHash::start() - could not write " << fileName << "\n";
+    return g_isEnabled;
+}
+
+/**
+ * @brief BufferHash::isEnabled
+ * @return true if hashes are being written
+ */
+bool BufferHash::isEnabled() {
+    return g_isEnabled;
+}
+
+/**
+ * @brief BufferHash::record
+ * The line is flushed straight away, so the hashes made before a crash are kept.
+ * @param name What the buffer holds, which names the line in the file
+ * @param data The buffer
+ * @param size The size of the buffer in bytes
+ */
+void BufferHash::record(const char *name, const void *data, std::size_t size) {
+    if (!g_isEnabled) return;
+
+    // Hash outside the lock, so that large buffers from several threads don't wait for each other
+    const std::uint64_t hash = fnv1a(data, size);
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_file << name << " " << size << " " << std::hex << std::setw(16) << std::setfill('0') << hash
+           << std::dec << std::setfill(' ') << std::endl;
+}
@@ -0,0 +1,416 @@
+#include "curvatureengine.h"
+#include "parallelfor.h"
+
+#include <Eigen/Dense>
+#include <algorithm>
+
+/// The quadric fit needs at least this many vertices in the neighbourhood (igl uses the same limit)
+static const size_t MIN_NEIGHBOURHOOD = 6;
+
+/**
+ * @brief CurvatureEngine::build
+ * @param F The triangle indices of the mesh
+ * @param numVertices The number of vertices in the mesh
+ */
+void CurvatureEngine::build(const MatrixXir &F, size_t numVertices) {
+    m_topology.build(F, numVertices);
+}
+
+/**
+ * @brief CurvatureEngine::build
+ * @param faces Three vertex indices per face
+ * @param numFaces The number of faces
+ * @param numVertices The number of vertices in the mesh
+ */
+void CurvatureEngine::build(const std::uint32_t *faces, size_t numFaces, size_t numVertices) {
+    m_topology.build(faces, numFaces, numVertices);
+}
+
+/**
+ * @brief CurvatureEngine::allocateScratch
+ */
+void CurvatureEngine::allocateScratch() {
+    const size_t numVertices = m_topology.numVertices();
+    m_scratch.resize(parallelThreadCount());
+    for (Scratch &s : m_scratch) {
+        if (s.m_stamp.size() != numVertices) {
+            s.m_stamp.assign(numVertices, 0);
+            s.m_currentStamp = 0;
+        }
+    }
+}
+
+/**
+ * @brief CurvatureEngine::compute
+ * @param V The vertex positions
+ */
+void CurvatureEngine::compute(const MatrixXfr &V) {
+    compute(V.data(), size_t(V.cols()));
+}
+
+/**
+ * @brief CurvatureEngine::compute
+ * @param positions The vertex positions
+ * @param stride The number of floats between the start of consecutive positions
+ * @param withCurvature If false only the normals are computed
+ */
+void CurvatureEngine::compute(const float *positions, size_t stride, bool withCurvature) {
+    const size_t numVertices = m_topology.numVertices();
+    const size_t numFaces = m_topology.numFaces();
+    m_positions = positions;
+    m_stride = stride;
+    m_faceNormals.resize(numFaces);
+    m_normals.resize(numVertices);
+    m_pd1.resize(numVertices);
+    m_pd2.resize(numVertices);
+    m_pv1.resize(numVertices);
+    m_pv2.resize(numVertices);
+
+    // The normals are needed for the whole neighbourhood before any quadric can be fitted
+    parallelFor(0, numFaces, [this](size_t begin, size_t end, size_t) {
+        for (size_t f = begin; f < end; ++f) faceNormal(f);
+    });
+    parallelFor(0, numVertices, [this](size_t begin, size_t end, size_t) {
+        for (size_t v = begin; v < end; ++v) vertexNormal(v);
+    });
+
+    // Each fit is fairly expensive, so smaller blocks are still worth a thread
+    if (withCurvature) {
+        allocateScratch();
+        parallelFor(0, numVertices, [this](size_t begin, size_t end, size_t threadIdx) {
+            Scratch &scratch = m_scratch[threadIdx];
+            for (size_t v = begin; v < end; ++v) curvatureAt(v, scratch);
+        }, 64);
+    }
+    m_curvatureStale = !withCurvature;
+
+    // Everything has changed
+    m_dirty.resize(numVertices);
+    for (size_t v = 0; v < numVertices; ++v) m_dirty[v] = std::uint32_t(v);
+    m_previous.resize(numVertices * 3);
+    storePositions(m_dirty);
+}
+
+/**
+ * @brief CurvatureEngine::update
+ * @param positions The new vertex positions
+ * @param stride The number of floats between the start of consecutive positions
+ * @param withCurvature If false only the normals are updated
+ */
+void CurvatureEngine::update(const float *positions, size_t stride, bool withCurvature) {
+    const size_t numVertices = m_topology.numVertices();
+    if (m_previous.size() != numVertices * 3) {
+        compute(positions, stride, withCurvature);
+        return;
+    }
+
+    // Compare against the last positions, each thread collecting its own (sorted) block of moved vertices
+    allocateScratch();
+    for (Scratch &s : m_scratch) s.m_moved.clear();
+    parallelFor(0, numVertices, [&](size_t begin, size_t end, size_t threadIdx) {
+        std::vector<std::uint32_t> &moved = m_scratch[threadIdx].m_moved;
+        for (size_t v = begin; v < end; ++v) {
+            const float *p = positions + v * stride;
+            const float *q = m_previous.data() + v * 3;
+            if ((p[0] != q[0]) || (p[1] != q[1]) || (p[2] != q[2])) moved.push_back(std::uint32_t(v));
+        }
+    });
+    std::vector<std::uint32_t> moved;
+    for (Scratch &s : m_scratch) moved.insert(moved.end(), s.m_moved.begin(), s.m_moved.end());
+    update(positions, stride, moved, withCurvature);
+}
+
+/**
+ * @brief CurvatureEngine::update
+ * @param positions The new vertex positions
+ * @param stride The number of floats between the start of consecutive positions
+ * @param moved The vertices which have moved
+ * @param withCurvature If false only the normals are updated
+ */
+void CurvatureEngine::update(const float *positions, size_t stride, const std::vector<std::uint32_t> &moved, bool withCurvature) {
+    const size_t numVertices = m_topology.numVertices();
+    // Once a large part of the mesh has moved the bookkeeping costs more than it saves
+    if ((m_previous.size() != numVertices * 3) || (moved.size() * 4 > numVertices)) {
+        compute(positions, stride, withCurvature);
+        return;
+    }
+    m_positions = positions;
+    m_stride = stride;
+    m_vertexMark.resize(numVertices, 0);
+    m_faceMark.resize(m_topology.numFaces(), 0);
+
+    // The faces around the moved vertices, and the vertices of those faces, need new normals
+    m_dirtyFaces.clear();
+    m_dirtyNormals.clear();
+    for (std::uint32_t v : moved) {
+        for (std::uint32_t f : m_topology.vertexFaces(v)) {
+            if (m_faceMark[f]) continue;
+            m_faceMark[f] = 1;
+            m_dirtyFaces.push_back(f);
+            for (size_t j = 0; j < 3; ++j) {
+                std::uint32_t u = m_topology.face(f)[j];
+                if (!m_vertexMark[u]) {
+                    m_vertexMark[u] = 1;
+                    m_dirtyNormals.push_back(u);
+                }
+            }
+        }
+    }
+    parallelFor(0, m_dirtyFaces.size(), [this](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) faceNormal(m_dirtyFaces[i]);
+    });
+    parallelFor(0, m_dirtyNormals.size(), [this](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) vertexNormal(m_dirtyNormals[i]);
+    });
+    m_dirty = m_dirtyNormals;
+
+    if (withCurvature && m_curvatureStale) {
+        // Skipped updates have left curvature behind everywhere, so start again from scratch
+        allocateScratch();
+        parallelFor(0, numVertices, [this](size_t begin, size_t end, size_t threadIdx) {
+            Scratch &scratch = m_scratch[threadIdx];
+            for (size_t v = begin; v < end; ++v) curvatureAt(v, scratch);
+        }, 64);
+        m_curvatureStale = false;
+        m_dirty.resize(numVertices);
+        for (size_t v = 0; v < numVertices; ++v) m_dirty[v] = std::uint32_t(v);
+    } else if (withCurvature) {
+        // The fit at a vertex reads the positions and normals of its k-ring, so grow the changed normals by k rings
+        size_t ringBegin = 0;
+        for (unsigned int ring = 0; ring < m_kRing; ++ring) {
+            size_t ringEnd = m_dirty.size();
+            for (size_t i = ringBegin; i < ringEnd; ++i) {
+                std::uint32_t v = m_dirty[i];
+                for (std::uint32_t u : m_topology.vertexNeighbours(v)) {
+                    if (!m_vertexMark[u]) {
+                        m_vertexMark[u] = 1;
+                        m_dirty.push_back(u);
+                    }
+                }
+            }
+            ringBegin = ringEnd;
+        }
+        allocateScratch();
+        parallelFor(0, m_dirty.size(), [this](size_t begin, size_t end, size_t threadIdx) {
+            Scratch &scratch = m_scratch[threadIdx];
+            for (size_t i = begin; i < end; ++i) curvatureAt(m_dirty[i], scratch);
+        }, 64);
+    } else {
+        m_curvatureStale = true;
+    }
+
+    // Clear the flags for next time and leave the dirty list sorted, ready for merging into buffer writes
+    for (std::uint32_t f : m_dirtyFaces) m_faceMark[f] = 0;
+    for (std::uint32_t v : m_dirty) m_vertexMark[v] = 0;
+    std::sort(m_dirty.begin(), m_dirty.end());
+    storePositions(moved);
+}
+
+/**
+ * @brief CurvatureEngine::storePositions
+ * @param vertices The vertices whose current position should be remembered
+ */
+void CurvatureEngine::storePositions(const std::vector<std::uint32_t> &vertices) {
+    float *previous = m_previous.data();
+    parallelFor(0, vertices.size(), [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            const float *p = m_positions + vertices[i] * m_stride;
+            float *q = previous + vertices[i] * 3;
+            q[0] = p[0]; q[1] = p[1]; q[2] = p[2];
+        }
+    });
+}
+
+/**
+ * @brief CurvatureEngine::faceNormal
+ * @param f The face index. The cross product is left unnormalised, so that its length (twice the face area)
+ * gives the area weighting used by igl::per_vertex_normals.
+ */
+void CurvatureEngine::faceNormal(size_t f) {
+    const std::uint32_t *face = m_topology.face(f);
+    Eigen::Vector3d p0 = position(face[0]);
+    m_faceNormals[f] = (position(face[1]) - p0).cross(position(face[2]) - p0);
+}
+
+/**
+ * @brief CurvatureEngine::vertexNormal
+ * @param v The vertex index
+ */
+void CurvatureEngine::vertexNormal(size_t v) {
+    Eigen::Vector3d n = Eigen::Vector3d::Zero();
+    for (std::uint32_t f : m_topology.vertexFaces(v)) {
+        n += m_faceNormals[f];
+    }
+    double len = n.norm();
+    m_normals[v] = (len > 0.0) ? Eigen::Vector3d(n / len) : n;
+}
+
+/**
+ * @brief CurvatureEngine::kRing
+ * @param v The vertex at the centre of the ring
+ * @param scratch The thread scratch storage, the result is returned in scratch.m_ring
+ */
+void CurvatureEngine::kRing(size_t v, Scratch &scratch) const {
+    // Bump the stamp rather than clearing a visited flag per vertex, resetting only when it wraps around
+    if (++scratch.m_currentStamp == 0) {
+        std::fill(scratch.m_stamp.begin(), scratch.m_stamp.end(), 0);
+        scratch.m_currentStamp = 1;
+    }
+    const std::uint32_t stamp = scratch.m_currentStamp;
+
+    scratch.m_ring.clear();
+    scratch.m_queue.clear();
+    scratch.m_queue.push_back(std::make_pair(std::uint32_t(v), 0u));
+    scratch.m_stamp[v] = stamp;
+    for (size_t head = 0; head < scratch.m_queue.size(); ++head) {
+        std::uint32_t current = scratch.m_queue[head].first;
+        std::uint32_t distance = scratch.m_queue[head].second;
+        scratch.m_ring.push_back(current);
+        if (distance >= m_kRing) continue;
+        for (std::uint32_t neighbour : m_topology.vertexNeighbours(current)) {
+            if (scratch.m_stamp[neighbour] != stamp) {
+                scratch.m_stamp[neighbour] = stamp;
+                scratch.m_queue.push_back(std::make_pair(neighbour, distance + 1));
+            }
+        }
+    }
+}
+
+/**
+ * @brief CurvatureEngine::curvatureAt
+ * Fits the quadric z = a u^2 + b uv + c v^2 + d u + e v to the k-ring of v in a local frame around the
+ * vertex normal, and takes the principal curvatures from the eigen decomposition of the shape operator.
+ * @param v The vertex index
+ * @param scratch The thread scratch storage
+ */
+void CurvatureEngine::curvatureAt(size_t v, Scratch &scratch) {
+    m_pd1[v] = m_pd2[v] = Eigen::Vector3d::Zero();
+    m_pv1[v] = m_pv2[v] = 0.0;
+
+    kRing(v, scratch);
+    const std::vector<std::uint32_t> *ring = &scratch.m_ring;
+    if (ring->size() < MIN_NEIGHBOURHOOD) return;
+
+    // Discard vertices facing away from this one, unless this leaves too few for the fit
+    const Eigen::Vector3d &normal = m_normals[v];
+    scratch.m_filtered.clear();
+    for (std::uint32_t i : *ring) {
+        if (m_normals[i].dot(normal) > 0.0) scratch.m_filtered.push_back(i);
+    }
+    if ((scratch.m_filtered.size() >= MIN_NEIGHBOURHOOD) && (scratch.m_filtered.size() < ring->size())) {
+        ring = &scratch.m_filtered;
+    }
+
+    // The local frame has its x axis along the first neighbour projected onto the tangent plane
+    Eigen::Vector3d me = position(v);
+    Eigen::Vector3d first = position(*m_topology.vertexNeighbours(v).begin());
+    first -= normal * (first - me).dot(normal);
+    Eigen::Vector3d xAxis = (first - me).normalized();
+    Eigen::Vector3d yAxis = normal.cross(xAxis).normalized();
+
+    // Least squares fit of the quadric to the neighbourhood in the local frame
+    const size_t cnt = ring->size();
+    scratch.m_A.resize(Eigen::Index(cnt), 5);
+    scratch.m_b.resize(Eigen::Index(cnt));
+    for (size_t i = 0; i < cnt; ++i) {
+        Eigen::Vector3d t = position((*ring)[i]) - me;
+        double u = t.dot(xAxis);
+        double w = t.dot(yAxis);
+        scratch.m_A.row(Eigen::Index(i)) << u*u, u*w, w*w, u, w;
+        scratch.m_b(Eigen::Index(i)) = t.dot(normal);
+    }
+    Eigen::Matrix<double,5,1> q = scratch.m_A.jacobiSvd(Eigen::ComputeThinU | Eigen::ComputeThinV).solve(scratch.m_b);
+    if (!q.allFinite()) return;
+    double a = q[0], b = q[1], c = q[2], d = q[3], e = q[4];
+
+    // First and second fundamental forms of the quadric at the origin
+    double E = 1.0 + d*d;
+    double F = d*e;
+    double G = 1.0 + e*e;
+    Eigen::Vector3d n = Eigen::Vector3d(-d,-e,1.0).normalized();
+    double L = 2.0 * a * n[2];
+    double M = b * n[2];
+    double N = 2.0 * c * n[2];
+
+    Eigen::Matrix2d shape;
+    shape << L*G - M*F, M*E - L*F,
+             M*E - L*F, N*E - M*F;
+    shape /= (E*G - F*F);
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix2d> eig(shape);
+    Eigen::Vector2d values = -eig.eigenvalues();
+    const Eigen::Matrix2d &vectors = eig.eigenvectors();
+
+    // Map the directions back to world space. Like igl, these are scaled by their curvature before normalising,
+    // so the sign of the direction follows the sign of the curvature.
+    Eigen::Vector3d dir[2];
+    for (size_t i = 0; i < 2; ++i) {
+        dir[i] = (xAxis * vectors(0, Eigen::Index(i)) + yAxis * vectors(1, Eigen::Index(i))).normalized() * values[Eigen::Index(i)];
+        double len = dir[i].norm();
+        if (len > 0.0) dir[i] /= len;
+    }
+    size_t lo = (values[0] > values[1]) ? 1 : 0;
+    size_t hi = 1 - lo;
+
+    // Directions which aren't orthogonal indicate a bad fit, so they are dropped
+    if (!dir[lo].allFinite() || !dir[hi].allFinite() || (dir[lo].dot(dir[hi]) > 10e-6)) {
+        dir[lo].setZero();
+        dir[hi].setZero();
+    }
+    m_pd1[v] = dir[lo];
+    m_pd2[v] = dir[hi];
+    m_pv1[v] = values[Eigen::Index(lo)];
+    m_pv2[v] = values[Eigen::Index(hi)];
+}
+
+/**
+ * @brief CurvatureEngine::writeRecord
+ * @param v The vertex index
+ * @param record Output of FLOATS_PER_VERTEX floats
+ */
+void CurvatureEngine::writeRecord(size_t v, float *record) const {
+    const float *p = m_positions + v * m_stride;
+    record[0] = p[0]; record[1] = p[1]; record[2] = p[2];
+    Eigen::Map<Eigen::Vector3f> normal(record + 3);
+    Eigen::Map<Eigen::Vector3f> k1(record + 6);
+    Eigen::Map<Eigen::Vector3f> k2(record + 9);
+    normal = m_normals[v].cast<float>();
+    k1 = m_pd1[v].cast<float>() * float(m_pv1[v]);
+    k2 = m_pd2[v].cast<float>() * float(m_pv2[v]);
+}
+
+/**
+ * @brief CurvatureEngine::writeInterleaved
+ * @param data Output buffer of FLOATS_PER_VERTEX * numVertices() floats
+ */
+void CurvatureEngine::writeInterleaved(float *data) const {
+    const size_t numVertices = m_topology.numVertices();
+    parallelFor(0, numVertices, [&](size_t begin, size_t end, size_t) {
+        for (size_t v = begin; v < end; ++v) writeRecord(v, data + v * FLOATS_PER_VERTEX);
+    });
+}
+
+/**
+ * @brief CurvatureEngine::writeInterleaved
+ * @param data Output buffer of FLOATS_PER_VERTEX * numVertices() floats
+ * @param vertices The vertices to write
+ */
+void CurvatureEngine::writeInterleaved(float *data, const std::vector<std::uint32_t> &vertices) const {
+    parallelFor(0, vertices.size(), [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) writeRecord(vertices[i], data + vertices[i] * FLOATS_PER_VERTEX);
+    });
+}
+
+/**
+ * @brief CurvatureEngine::writeNormals
+ * @param data Pointer to the normal of the first record
+ * @param stride The number of floats between consecutive records
+ * @param vertices The vertices to write
+ */
+void CurvatureEngine::writeNormals(float *data, size_t stride, const std::vector<std::uint32_t> &vertices) const {
+    parallelFor(0, vertices.size(), [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            Eigen::Map<Eigen::Vector3f> normal(data + vertices[i] * stride);
+            normal = m_normals[vertices[i]].cast<float>();
+        }
+    });
+}
@@ -0,0 +1,421 @@
+#include "headlessrunner.h"
+#include "fixedcamera.h"
+#include "tracelog.h"
+#include "bufferhash.h"
+
+// The EGL headers pull in X11 unless told otherwise, which isn't needed without a window
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <string.h>
+
+/**
+ * @brief HeadlessRunner::parseArgs
+ * @param argc The argument count from main()
+ * @param argv The arguments from main()
+ * @param options The options to fill in, which keep their values for anything not given
+ * @return true if --headless was given
+ */
+bool HeadlessRunner::parseArgs(int argc, char **argv, Options &options) {
+    bool isHeadless = false;
+    if (options.m_name.empty() && (argc > 0)) {
+        const char *slash = strrchr(argv[0], '/');
+        options.m_name = (slash == nullptr) ? argv[0] : slash + 1;
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        const bool hasValue = (i + 1 < argc);
+        if (arg == "--headless") {
+            isHeadless = true;
+        } else if ((arg == "--frames") && hasValue) {
+            options.m_frames = std::max(1, atoi(argv[++i]));
+        } else if ((arg == "--warmup") && hasValue) {
+            options.m_warmupFrames = std::max(0, atoi(argv[++i]));
+        } else if ((arg == "--size") && hasValue) {
+            int width, height;
+            if ((sscanf(argv[++i], "%dx%d", &width, &height) == 2) && (width > 0) && (height > 0)) {
+                options.m_width = width;
+                options.m_height = height;
+            } else {
+                std::cerr << "HeadlessRunner::parseArgs() - expected --size WxH, not " << argv[i] << "\n";
+            }
+        } else if ((arg == "--image") && hasValue) {
+            options.m_imageFile = argv[++i];
+        } else if ((arg == "--objects") && hasValue) {
+            options.m_numObjects = std::max(0, atoi(argv[++i]));
+        } else if ((arg == "--report") && hasValue) {
+            options.m_reportFile = argv[++i];
+        } else if ((arg == "--json") && hasValue) {
+            options.m_jsonFile = argv[++i];
+        } else if ((arg == "--trace") && hasValue) {
+            options.m_traceFile = argv[++i];
+        } else if ((arg == "--hashes") && hasValue) {
+            options.m_hashFile = argv[++i];
+        } else if ((arg == "--variant") && hasValue) {
+            options.m_variant = argv[++i];
+        } else if ((arg == "--time") && hasValue) {
+            options.m_time = atof(argv[++i]);
+        } else {
+            std::cerr << "HeadlessRunner::parseArgs() - ignoring " << arg << "\n";
+        }
+    }
+    return isHeadless;
+}
+
+/**
+ * @brief HeadlessRunner::runIfRequested
+ * The whole of the headless path of a demo's main(), so that each only has to fill in its defaults and set up its
+ * variants. The options are read from the command line either way, as the windowed demos also use --trace.
+ * @param argc The argument count from main()
+ * @param argv The arguments from main()
+ * @param scene The scene to run
+ * @param options The demo's defaults, which are overwritten by anything on the command line
+ * @param exitCode Set to the exit code of the run, if there was one
+ * @param setupCallback Called before the run to set up the scene from the options, if not null
+ * @param eyeCallback Passed on to run()
+ * @return true if --headless was given and the scene has been run
+ */
+bool HeadlessRunner::runIfRequested(int argc, char **argv, Scene &scene, Options &options, int &exitCode,
+                                    SetupCallback setupCallback, EyeCallback eyeCallback) {
+    if (!parseArgs(argc, argv, options)) return false;
+    if (setupCallback) setupCallback(options);
+    exitCode = HeadlessRunner(options).run(scene, eyeCallback);
+    return true;
+}
+
+HeadlessRunner::HeadlessRunner(const Options &options) : m_options(options) {
+}
+
+HeadlessRunner::~HeadlessRunner() {
+    destroyContext();
+}
+
+/**
+ * @brief HeadlessRunner::createContext
+ * Uses Mesa's surfaceless platform if it is there, as it needs neither a display server nor a GPU, and otherwise the
+ * default display. Either way the scene renders into a single buffered pbuffer the size of the "window".
+ * @return true if the context is current
+ */
+bool HeadlessRunner::createContext() {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if ((clientExtensions != nullptr) && (strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != nullptr)) {
+        display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major, minor;
+    if ((display == EGL_NO_DISPLAY) || !eglInitialize(display, &major, &minor)) {
+        std::cerr << "HeadlessRunner::createContext() - could not initialise an EGL display\n";
+        return false;
+    }
+    m_display = display;
+
+    const EGLint configAttribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                                    EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+                                    EGL_DEPTH_SIZE, 24,
+                                    EGL_NONE};
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || (numConfigs == 0)) {
+        std::cerr << "HeadlessRunner::createContext() - no EGL config supports OpenGL pbuffers\n";
+        return false;
+    }
+
+    const EGLint surfaceAttribs[] = {EGL_WIDTH, m_options.m_width, EGL_HEIGHT, m_options.m_height, EGL_NONE};
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+    if (surface == EGL_NO_SURFACE) {
+        std::cerr << "HeadlessRunner::createContext() - could not create a " << m_options.m_width << "x"
+                  << m_options.m_height << " pbuffer\n";
+        return false;
+    }
+    m_surface = surface;
+
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION, m_options.m_glMajor,
+                                     EGL_CONTEXT_MINOR_VERSION, m_options.m_glMinor,
+                                     EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                     EGL_NONE};
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "HeadlessRunner::createContext() - could not create an OpenGL " << m_options.m_glMajor << "."
+                  << m_options.m_glMinor << " core context\n";
+        return false;
+    }
+    m_context = context;
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        std::cerr << "HeadlessRunner::createContext() - could not make the context current\n";
+        return false;
+    }
+
+    const GLubyte *renderer = glGetString(GL_RENDERER);
+    m_renderer = (renderer == nullptr) ? std::string("unknown") : std::string(reinterpret_cast<const char*>(renderer));
+    return true;
+}
+
+/**
+ * @brief HeadlessRunner::destroyContext
+ */
+void HeadlessRunner::destroyContext() {
+    if (m_display == nullptr) return;
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_context != nullptr) eglDestroyContext(m_display, m_context);
+    if (m_surface != nullptr) eglDestroySurface(m_display, m_surface);
+    eglTerminate(m_display);
+    m_display = m_surface = m_context = nullptr;
+}
+
+/**
+ * @brief HeadlessRunner::run
+ * The warm up frames are drawn from the start of the orbit, then the camera circles the target about the y-axis over
+ * the timed frames, keeping its distance and height.
+ * @param scene The scene to draw
+ * @param eyeCallback Called with the eye and target before each frame, if set
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if there was no context or the image couldn't be written
+ */
+int HeadlessRunner::run(Scene &scene, EyeCallback eyeCallback) {
+    if (!createContext()) return EXIT_FAILURE;
+    if (!m_options.m_traceFile.empty()) TraceLog::start();
+    if (!m_options.m_hashFile.empty() && !BufferHash::start(m_options.m_hashFile)) return EXIT_FAILURE;
+    if (m_options.m_time >= 0.0) scene.setFixedTime(m_options.m_time);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    scene.initGL();
+    scene.resizeGL(m_options.m_width, m_options.m_height);
+    glFinish();
+    m_initTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    // The GPU time of each frame is the difference of two timestamps, which (unlike GL_TIME_ELAPSED) can't clash
+    // with any timer queries the scene makes itself
+    GLint timerBits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &timerBits);
+    GLuint queries[2] = {0, 0};
+    if (timerBits > 0) glGenQueries(2, queries);
+
+    FixedCamera camera;
+    camera.resize(m_options.m_width, m_options.m_height);
+    const glm::vec3 offset = m_options.m_eye - m_options.m_target;
+    m_frameTimes.clear();
+    m_cpuTimes.clear();
+    m_gpuTimes.clear();
+    m_frameTimes.reserve(size_t(m_options.m_frames));
+    m_cpuTimes.reserve(size_t(m_options.m_frames));
+    m_gpuTimes.reserve(size_t(m_options.m_frames));
+    for (int i = -m_options.m_warmupFrames; i < m_options.m_frames; ++i) {
+        TraceScope trace("frame");
+
+        // Rotate the offset of the start position from the target about the y-axis
+        const float angle = (i < 0) ? 0.0f : glm::two_pi<float>() * float(i) / float(m_options.m_frames);
+        const float c = cosf(angle), s = sinf(angle);
+        const glm::vec3 eye = m_options.m_target + glm::vec3(c * offset.x + s * offset.z, offset.y, c * offset.z - s * offset.x);
+        camera.setEye(eye.x, eye.y, eye.z);
+        camera.setTarget(m_options.m_target.x, m_options.m_target.y, m_options.m_target.z);
+        camera.update();
+
+        auto frameStart = std::chrono::high_resolution_clock::now();
+        scene.setViewMatrix(camera.viewMatrix());
+        scene.setProjMatrix(camera.projMatrix());
+        if (eyeCallback) eyeCallback(eye, m_options.m_target);
+        if (timerBits > 0) glQueryCounter(queries[0], GL_TIMESTAMP);
+        auto paintStart = std::chrono::high_resolution_clock::now();
+        scene.paintGL();
+        auto paintEnd = std::chrono::high_resolution_clock::now();
+        if (timerBits > 0) glQueryCounter(queries[1], GL_TIMESTAMP);
+        glFinish();
+        auto frameEnd = std::chrono::high_resolution_clock::now();
+        if (i < 0) continue;
+
+        m_frameTimes.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+        m_cpuTimes.push_back(std::chrono::duration<double, std::milli>(paintEnd - paintStart).count());
+        if (timerBits > 0) {
+            // Both are available as the frame has finished
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+            m_gpuTimes.push_back(double(end - begin) * 1e-6);
+        }
+    }
+    if (timerBits > 0) glDeleteQueries(2, queries);
+
+    // Read back the last frame
+    m_pixels.resize(size_t(m_options.m_width) * size_t(m_options.m_height) * 4);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_options.m_width, m_options.m_height, GL_RGBA, GL_UNSIGNED_BYTE, m_pixels.data());
+
+    report();
+    if (!m_options.m_traceFile.empty()) TraceLog::write(m_options.m_traceFile);
+    if (!m_options.m_imageFile.empty() &&
+        !writePPM(m_options.m_imageFile, m_options.m_width, m_options.m_height, m_pixels.data())) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief HeadlessRunner::percentile
+ * @param sorted Times in ascending order
+ * @param p The fraction, between 0 and 1
+ * @return The nearest rank percentile, or 0 if there are no times
+ */
+double HeadlessRunner::percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = size_t(std::ceil(p * double(sorted.size())));
+    return sorted[std::min(sorted.size(), std::max(rank, size_t(1))) - 1];
+}
+
+/**
+ * @brief HeadlessRunner::summarise
+ * @param times Times in any order
+ * @return The mean, minimum, maximum and percentiles, which are all 0 if there are no times
+ */
+HeadlessRunner::Stats HeadlessRunner::summarise(const std::vector<double> &times) {
+    Stats stats;
+    if (times.empty()) return stats;
+    std::vector<double> sorted(times);
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double t : sorted) total += t;
+    stats.m_mean = total / double(sorted.size());
+    stats.m_min = sorted.front();
+    stats.m_p50 = percentile(sorted, 0.5);
+    stats.m_p90 = percentile(sorted, 0.9);
+    stats.m_p95 = percentile(sorted, 0.95);
+    stats.m_p99 = percentile(sorted, 0.99);
+    stats.m_max = sorted.back();
+    return stats;
+}
+
+/**
+ * @brief HeadlessRunner::report
+ */
+void HeadlessRunner::report() const {
+    const Stats frame = summarise(m_frameTimes);
+    const Stats cpu = summarise(m_cpuTimes);
+    const Stats gpu = summarise(m_gpuTimes);
+
+    std::ostringstream out;
+    out << "renderer: " << m_renderer << "\n"
+        << "size: " << m_options.m_width << "x" << m_options.m_height << "\n";
+    if (!m_options.m_variant.empty()) out << "variant: " << m_options.m_variant << "\n";
+    out << "frames: " << m_frameTimes.size() << " (after " << m_options.m_warmupFrames << " warm up)\n"
+        << "initGL: " << m_initTime << " ms\n"
+        << "mean: " << frame.m_mean << " ms (" << ((frame.m_mean > 0.0) ? 1000.0 / frame.m_mean : 0.0) << " fps)\n"
+        << "min: " << frame.m_min << " ms\n"
+        << "median: " << frame.m_p50 << " ms\n"
+        << "p95: " << frame.m_p95 << " ms\n"
+        << "max: " << frame.m_max << " ms\n"
+        << "paintGL (CPU) median: " << cpu.m_p50 << " ms, p95: " << cpu.m_p95 << " ms\n";
+    if (m_gpuTimes.empty()) {
+        out << "GPU: no timestamp queries\n";
+    } else {
+        out << "GPU median: " << gpu.m_p50 << " ms, p95: " << gpu.m_p95 << " ms\n";
+    }
+    std::cout << "HeadlessRunner report\n" << out.str();
+
+    if (!m_options.m_reportFile.empty()) {
+        std::ofstream file(m_options.m_reportFile.c_str());
+        file << out.str();
+        if (!file.good()) {
+            std::cerr << "HeadlessRunner::report() - could not write " << m_options.m_reportFile << "\n";
+        }
+    }
+    if (!m_options.m_jsonFile.empty()) writeJSON(m_options.m_jsonFile);
+}
+
+namespace {
+/// Quote a string for JSON, escaping the characters which need it
+std::string jsonString(const std::string &str) {
+    std::string quoted("\"");
+    for (char c : str) {
+        if ((c == '"') || (c == '\\')) {
+            quoted += '\\';
+            quoted += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", int(c));
+            quoted += escaped;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+/// A JSON object of the summary of some times, or null if there are none
+std::string jsonStats(const HeadlessRunner::Stats &stats, bool isEmpty) {
+    if (isEmpty) return "null";
+    std::ostringstream out;
+    out << "{\"mean\": " << stats.m_mean << ", \"min\": " << stats.m_min << ", \"p50\": " << stats.m_p50
+        << ", \"p90\": " << stats.m_p90 << ", \"p95\": " << stats.m_p95 << ", \"p99\": " << stats.m_p99
+        << ", \"max\": " << stats.m_max << "}";
+    return out.str();
+}
+}
+
+/**
+ * @brief HeadlessRunner::writeJSON
+ * The whole report is on one line so that the benchmark suite can gather the reports of many runs into one file
+ * and still find each run by reading it line by line.
+ * @param fileName The file to write
+ * @return true if the file was written
+ */
+bool HeadlessRunner::writeJSON(const std::string &fileName) const {
+    std::ofstream file(fileName.c_str(), std::ios::trunc);
+    file << "{\"scene\": " << jsonString(m_options.m_name)
+         << ", \"renderer\": " << jsonString(m_renderer)
+         << ", \"width\": " << m_options.m_width
+         << ", \"height\": " << m_options.m_height
+         << ", \"objects\": " << m_options.m_numObjects
+         << ", \"variant\": " << jsonString(m_options.m_variant)
+         << ", \"frames\": " << m_frameTimes.size()
+         << ", \"warmup\": " << m_options.m_warmupFrames
+         << ", \"init_ms\": " << m_initTime
+         << ", \"frame_ms\": " << jsonStats(summarise(m_frameTimes), m_frameTimes.empty())
+         << ", \"cpu_ms\": " << jsonStats(summarise(m_cpuTimes), m_cpuTimes.empty())
+         << ", \"gpu_ms\": " << jsonStats(summarise(m_gpuTimes), m_gpuTimes.empty())
+         << "}\n";
+    file.close();
+    if (!file.good()) {
+        std::cerr << "HeadlessRunner::writeJSON() - could not write " << fileName << "\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief HeadlessRunner::writePPM
+ * @param fileName The image file
+ * @param width The width in pixels
+ * @param height The height in pixels
+ * @param rgba The pixels as read by glReadPixels(), so with the bottom row first
+ * @return true if the file was written
+ */
+bool HeadlessRunner::writePPM(const std::string &fileName, int width, int height, const unsigned char *rgba) {
+    std::ofstream file(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<char> row(size_t(width) * 3);
+    for (int y = height - 1; y >= 0; --y) {
+        const unsigned char *src = rgba + size_t(y) * size_t(width) * 4;
+        for (int x = 0; x < width; ++x) {
+            row[size_t(x) * 3 + 0] = char(src[x * 4 + 0]);
+            row[size_t(x) * 3 + 1] = char(src[x * 4 + 1]);
+            row[size_t(x) * 3 + 2] = char(src[x * 4 + 2]);
+        }
+        file.write(row.data(), std::streamsize(row.size()));
+    }
+    file.close();
+    if (!file.good()) {
+        std::cerr << "HeadlessRunner::writePPM() - could not write " << fileName << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#include "instancebuffer.h"
+
+/**
+ * @brief InstanceBuffer::upload
+ * The whole buffer is respecified, as the instances only change when the scene does.
+ */
+void InstanceBuffer::upload() {
+    if (m_buffer == 0) glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(m_instances.size() * sizeof(Instance)), m_instances.data(),
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/**
+ * @brief InstanceBuffer::bind
+ */
+void InstanceBuffer::bind() const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, m_buffer);
+}
+
+/**
+ * @brief InstanceBuffer::draw
+ * @param vao A primitive, for example ngl::VAOPrimitives::instance()->getVAOFromName("teapot")
+ */
+void InstanceBuffer::draw(ngl::AbstractVAO *vao) const {
+    if (m_instances.empty()) return;
+    bind();
+    vao->bind();
+    glDrawArraysInstanced(vao->getMode(), 0, GLsizei(vao->numIndices()), GLsizei(m_instances.size()));
+    vao->unbind();
+}
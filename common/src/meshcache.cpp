@@ -0,0 +1,296 @@
+#include "meshcache.h"
+#include "fnv1a.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdio>
+#include <string.h>
+#include <sys/stat.h>
+
+#if (defined(WIN32))
+#include <stdlib.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+/// Increment this if the Header or the data layout changes, or to force the caches to be rebuilt
+/// (version 2 caches store meshes reordered by MeshOptimiser, version 3 added the levels of detail, version 4 the meshlets
+/// and version 5 the packed vertex records)
+static const std::uint32_t MESHCACHE_VERSION = 5;
+
+MeshCache::MeshCache() : m_map(nullptr), m_mapSize(0), m_header(nullptr) {
+}
+
+MeshCache::~MeshCache() {
+    close();
+}
+
+/**
+ * @brief MeshCache::floatsPerVertex
+ * @param attributes The Attribute flags of the vertex record
+ * @return The number of floats used to store a single vertex
+ */
+std::uint32_t MeshCache::floatsPerVertex(unsigned int attributes) {
+    std::uint32_t cnt = 0;
+    if (attributes & ATTRIB_POSITION) cnt += 3;
+    if (attributes & ATTRIB_NORMAL) cnt += 3;
+    if (attributes & ATTRIB_CURVATURE) cnt += 6;
+    return cnt;
+}
+
+/**
+ * @brief MeshCache::hashFile
+ * @param fileName The file to hash
+ * @return The 64 bit FNV-1a hash of the file contents, or 0 if it could not be read
+ */
+std::uint64_t MeshCache::hashFile(const std::string &fileName) {
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    if (!file.good()) return 0;
+
+    std::uint64_t hash = FNV1A_OFFSET_BASIS;
+    std::vector<char> buffer(1 << 16);
+    while (file) {
+        file.read(buffer.data(), std::streamsize(buffer.size()));
+        hash = fnv1a(buffer.data(), std::size_t(file.gcount()), hash);
+    }
+    return hash;
+}
+
+/**
+ * @brief MeshCache::fileStats
+ * @param fileName The file to query
+ * @param size The size of the file in bytes
+ * @param time The last modification time of the file
+ * @return false if the file doesn't exist
+ */
+bool MeshCache::fileStats(const std::string &fileName, std::uint64_t &size, std::int64_t &time) {
+    struct stat st;
+    if (stat(fileName.c_str(), &st) != 0) return false;
+    size = std::uint64_t(st.st_size);
+    time = std::int64_t(st.st_mtime);
+    return true;
+}
+
+/**
+ * @brief MeshCache::open
+ * @param source The source mesh file that the cache was built from
+ * @param attributes The vertex layout that the caller expects
+ * @return true if a valid cache was mapped. If false is returned the caller should build the mesh
+ * from the source file and call MeshCache::write().
+ */
+bool MeshCache::open(const std::string &source, unsigned int attributes) {
+    close();
+
+    // We can't validate a cache without the source
+    std::uint64_t sourceSize; std::int64_t sourceTime;
+    if (!fileStats(source, sourceSize, sourceTime)) return false;
+
+    std::string cacheName = cacheFileName(source);
+    std::uint64_t cacheSize; std::int64_t cacheTime;
+    if (!fileStats(cacheName, cacheSize, cacheTime)) return false;
+    if (cacheSize < sizeof(Header)) return false;
+
+#if (defined(WIN32))
+    // No mmap here, so fall back on reading the file into a single block of memory
+    m_map = malloc(cacheSize);
+    std::ifstream file(cacheName.c_str(), std::ios::binary);
+    if ((m_map == nullptr) || !file.read(static_cast<char*>(m_map), std::streamsize(cacheSize))) {
+        free(m_map); m_map = nullptr;
+        return false;
+    }
+#else
+    int fd = ::open(cacheName.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    m_map = mmap(nullptr, cacheSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping stays valid after the descriptor is closed
+    if (m_map == MAP_FAILED) {
+        m_map = nullptr;
+        return false;
+    }
+#endif
+    m_mapSize = cacheSize;
+
+    // Check the header matches our version and the layout we want
+    const Header *header = static_cast<const Header*>(m_map);
+    std::uint32_t stride = floatsPerVertex(attributes);
+    bool valid = (strncmp(header->m_magic, "NCMC", 4) == 0) &&
+                 (header->m_version == MESHCACHE_VERSION) &&
+                 (header->m_attributes == attributes) &&
+                 (header->m_floatsPerVertex == stride) &&
+                 (header->m_vertexOffset + std::uint64_t(header->m_numVertices) * stride * sizeof(float) <= m_mapSize) &&
+                 (header->m_indexOffset + std::uint64_t(header->m_numIndices) * sizeof(std::uint32_t) <= m_mapSize) &&
+                 (header->m_numLevels > 0) &&
+                 (header->m_levelOffset + std::uint64_t(header->m_numLevels) * sizeof(MeshLOD::Level) <= m_mapSize) &&
+                 (header->m_meshletOffset + std::uint64_t(header->m_numMeshlets) * sizeof(Meshlets::Meshlet) <= m_mapSize) &&
+                 (header->m_packedOffset + std::uint64_t(header->m_numVertices) * header->m_packedStride <= m_mapSize);
+
+    // Now check the source hasn't changed. Hashing the source is only needed if the time stamp has moved.
+    if (valid) {
+        valid = (header->m_sourceSize == sourceSize);
+        if (valid && (header->m_sourceTime != sourceTime)) {
+            valid = (header->m_sourceHash == hashFile(source));
+        }
+    }
+    if (!valid) {
+        std::cerr << "MeshCache::open() - " << cacheName << " is stale and will be rebuilt\n";
+        close();
+        return false;
+    }
+    m_header = header;
+    return true;
+}
+
+/**
+ * @brief MeshCache::close
+ */
+void MeshCache::close() {
+    if (m_map != nullptr) {
+#if (defined(WIN32))
+        free(m_map);
+#else
+        munmap(m_map, m_mapSize);
+#endif
+    }
+    m_map = nullptr;
+    m_mapSize = 0;
+    m_header = nullptr;
+}
+
+/**
+ * @brief MeshCache::write
+ * @param source The source mesh file that the data was built from
+ * @param attributes The Attribute flags of the interleaved vertex data
+ * @param vertices Interleaved vertex data of floatsPerVertex(attributes) * numVertices floats
+ * @param numVertices The number of vertices
+ * @param indices The triangle indices
+ * @param numIndices The number of indices (3 * number of triangles) in all of the levels
+ * @param levels The levels of detail within the indices, or nullptr if there is only one
+ * @param numLevels The number of levels
+ * @param meshlets The meshlets of the levels, or nullptr if they haven't been split
+ * @param numMeshlets The number of meshlets
+ * @param packed The quantised vertex records, or nullptr if there are none
+ * @param packedStride The size of a packed record in bytes
+ * @param packedBox The minimum corner and extent of the box the packed positions are relative to
+ * @return true if the cache was written successfully
+ */
+bool MeshCache::write(const std::string &source,
+                      unsigned int attributes,
+                      const float *vertices,
+                      std::uint32_t numVertices,
+                      const std::uint32_t *indices,
+                      std::uint32_t numIndices,
+                      const MeshLOD::Level *levels,
+                      std::uint32_t numLevels,
+                      const Meshlets::Meshlet *meshlets,
+                      std::uint32_t numMeshlets,
+                      const void *packed,
+                      std::uint32_t packedStride,
+                      const float *packedBox) {
+    MeshLOD::Level single;
+    single.m_numIndices = numIndices;
+    if ((levels == nullptr) || (numLevels == 0)) {
+        levels = &single;
+        numLevels = 1;
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    memcpy(header.m_magic, "NCMC", 4);
+    header.m_version = MESHCACHE_VERSION;
+    header.m_attributes = attributes;
+    header.m_floatsPerVertex = floatsPerVertex(attributes);
+    header.m_numVertices = numVertices;
+    header.m_numIndices = numIndices;
+    if (!fileStats(source, header.m_sourceSize, header.m_sourceTime)) return false;
+    header.m_sourceHash = hashFile(source);
+
+    // The vertex data follows the header directly, and is followed by the indices, the level, the meshlet and the
+    // packed vertex records
+    header.m_vertexOffset = sizeof(Header);
+    header.m_indexOffset = header.m_vertexOffset + std::uint64_t(numVertices) * header.m_floatsPerVertex * sizeof(float);
+    header.m_numLevels = numLevels;
+    header.m_levelOffset = header.m_indexOffset + std::uint64_t(numIndices) * sizeof(std::uint32_t);
+    header.m_numMeshlets = (meshlets == nullptr) ? 0 : numMeshlets;
+    header.m_meshletOffset = header.m_levelOffset + std::uint64_t(numLevels) * sizeof(MeshLOD::Level);
+    header.m_packedStride = (packed == nullptr) ? 0 : packedStride;
+    if ((packed != nullptr) && (packedBox != nullptr)) memcpy(header.m_packedBox, packedBox, sizeof(header.m_packedBox));
+    header.m_packedOffset = header.m_meshletOffset + std::uint64_t(header.m_numMeshlets) * sizeof(Meshlets::Meshlet);
+
+    // Write to a temporary file first so that a partially written cache is never mapped
+    std::string cacheName = cacheFileName(source);
+    std::string tmpName = cacheName + ".tmp";
+    std::ofstream file(tmpName.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file.good()) {
+        std::cerr << "MeshCache::write() - could not open " << tmpName << " for writing\n";
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char*>(vertices), std::streamsize(header.m_indexOffset - header.m_vertexOffset));
+    file.write(reinterpret_cast<const char*>(indices), std::streamsize(numIndices * sizeof(std::uint32_t)));
+    file.write(reinterpret_cast<const char*>(levels), std::streamsize(numLevels * sizeof(MeshLOD::Level)));
+    file.write(reinterpret_cast<const char*>(meshlets), std::streamsize(header.m_numMeshlets * sizeof(Meshlets::Meshlet)));
+    file.write(static_cast<const char*>(packed), std::streamsize(std::uint64_t(numVertices) * header.m_packedStride));
+    file.close();
+    if (!file.good() || (rename(tmpName.c_str(), cacheName.c_str()) != 0)) {
+        std::cerr << "MeshCache::write() - failed to write " << cacheName << "\n";
+        remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
+
+const float *MeshCache::vertices() const {
+    if (m_header == nullptr) return nullptr;
+    return reinterpret_cast<const float*>(static_cast<const char*>(m_map) + m_header->m_vertexOffset);
+}
+
+const std::uint32_t *MeshCache::indices() const {
+    if (m_header == nullptr) return nullptr;
+    return reinterpret_cast<const std::uint32_t*>(static_cast<const char*>(m_map) + m_header->m_indexOffset);
+}
+
+std::uint32_t MeshCache::numVertices() const {
+    return (m_header == nullptr)?0:m_header->m_numVertices;
+}
+
+std::uint32_t MeshCache::numIndices() const {
+    return (m_header == nullptr)?0:m_header->m_numIndices;
+}
+
+std::uint32_t MeshCache::floatsPerVertex() const {
+    return (m_header == nullptr)?0:m_header->m_floatsPerVertex;
+}
+
+std::uint32_t MeshCache::numLevels() const {
+    return (m_header == nullptr)?0:m_header->m_numLevels;
+}
+
+const MeshLOD::Level *MeshCache::levels() const {
+    if (m_header == nullptr) return nullptr;
+    return reinterpret_cast<const MeshLOD::Level*>(static_cast<const char*>(m_map) + m_header->m_levelOffset);
+}
+
+std::uint32_t MeshCache::numMeshlets() const {
+    return (m_header == nullptr)?0:m_header->m_numMeshlets;
+}
+
+const Meshlets::Meshlet *MeshCache::meshlets() const {
+    if (m_header == nullptr) return nullptr;
+    return reinterpret_cast<const Meshlets::Meshlet*>(static_cast<const char*>(m_map) + m_header->m_meshletOffset);
+}
+
+const void *MeshCache::packedVertices() const {
+    if ((m_header == nullptr) || (m_header->m_packedStride == 0)) return nullptr;
+    return static_cast<const char*>(m_map) + m_header->m_packedOffset;
+}
+
+std::uint32_t MeshCache::packedStride() const {
+    return (m_header == nullptr)?0:m_header->m_packedStride;
+}
+
+const float *MeshCache::packedBox() const {
+    return (m_header == nullptr)?nullptr:m_header->m_packedBox;
+}
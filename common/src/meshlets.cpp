@@ -0,0 +1,299 @@
+#include "meshlets.h"
+#include "meshtopology.h"
+#include "meshoptimiser.h"
+#include "parallelfor.h"
+
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+/**
+ * @brief buildLevel
+ * Grow meshlets over a triangle list. Each meshlet starts from the first unused triangle (so it follows the vertex
+ * cache order of the list) and repeatedly takes the neighbouring triangle which adds the fewest new vertices,
+ * breaking ties by the distance from the centre of the meshlet scaled by how far the normal turns from the axis.
+ * This keeps the meshlets compact, which gives small spheres, and flat, which gives narrow cones.
+ * @param indices The triangle list, which is reordered so that each meshlet is contiguous
+ * @param numIndices The number of indices (3 per triangle)
+ * @param vertices The interleaved vertex records, starting with the position
+ * @param numVertices The number of vertices
+ * @param floatsPerVertex The number of floats in each record
+ * @param maxTriangles The largest number of triangles in a meshlet
+ * @return The meshlets, with indices relative to the start of the list
+ */
+static std::vector<Meshlets::Meshlet> buildLevel(std::uint32_t *indices, size_t numIndices,
+                                                 const float *vertices, size_t numVertices, size_t floatsPerVertex,
+                                                 size_t maxTriangles) {
+    const size_t numFaces = numIndices / 3;
+    std::vector<Meshlets::Meshlet> meshlets;
+    if (numFaces == 0) return meshlets;
+
+    MeshTopology topology;
+    topology.build(indices, numFaces, numVertices);
+
+    // The centre and unit normal of every triangle (degenerate triangles are left with a zero normal)
+    std::vector<float> centres(3 * numFaces), normals(3 * numFaces, 0.0f);
+    for (size_t f = 0; f < numFaces; ++f) {
+        const float *p0 = vertices + size_t(indices[3 * f]) * floatsPerVertex;
+        const float *p1 = vertices + size_t(indices[3 * f + 1]) * floatsPerVertex;
+        const float *p2 = vertices + size_t(indices[3 * f + 2]) * floatsPerVertex;
+        float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        float n[3] = {e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0]};
+        float len = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        for (size_t c = 0; c < 3; ++c) {
+            centres[3 * f + c] = (p0[c] + p1[c] + p2[c]) / 3.0f;
+            if (len > 0.0f) normals[3 * f + c] = n[c] / len;
+        }
+    }
+
+    // Each of these records the meshlet which last touched the face or vertex
+    const std::uint32_t none = 0xffffffff;
+    std::vector<std::uint32_t> faceMeshlet(numFaces, none);
+    std::vector<std::uint32_t> candidateMeshlet(numFaces, none);
+    std::vector<std::uint32_t> vertexMeshlet(numVertices, none);
+    std::vector<std::uint32_t> order, candidates;
+    order.reserve(numFaces);
+
+    size_t seed = 0;
+    while (order.size() < numFaces) {
+        while (faceMeshlet[seed] != none) ++seed;
+        const std::uint32_t id = std::uint32_t(meshlets.size());
+        Meshlets::Meshlet meshlet;
+        meshlet.m_firstIndex = std::uint32_t(3 * order.size());
+
+        float centre[3] = {0.0f, 0.0f, 0.0f}, axis[3] = {0.0f, 0.0f, 0.0f};
+        size_t count = 0;
+        candidates.clear();
+        std::uint32_t f = std::uint32_t(seed);
+        for (;;) {
+            // Take the triangle, and queue up the free triangles around its corners
+            faceMeshlet[f] = id;
+            order.push_back(f);
+            ++count;
+            for (size_t c = 0; c < 3; ++c) {
+                centre[c] += centres[3 * f + c];
+                axis[c] += normals[3 * f + c];
+            }
+            for (size_t i = 0; i < 3; ++i) {
+                std::uint32_t v = indices[3 * f + i];
+                vertexMeshlet[v] = id;
+                for (std::uint32_t g : topology.vertexFaces(v)) {
+                    if ((faceMeshlet[g] == none) && (candidateMeshlet[g] != id)) {
+                        candidateMeshlet[g] = id;
+                        candidates.push_back(g);
+                    }
+                }
+            }
+            if (count == maxTriangles) break;
+
+            float mean[3], dir[3];
+            float axisLen = std::sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+            for (size_t c = 0; c < 3; ++c) {
+                mean[c] = centre[c] / float(count);
+                dir[c] = (axisLen > 0.0f) ? axis[c] / axisLen : 0.0f;
+            }
+
+            // Pick the best of the candidates, dropping any which have been used since they were queued
+            std::uint32_t best = none;
+            size_t bestNew = 4;
+            float bestScore = std::numeric_limits<float>::max();
+            for (size_t i = 0; i < candidates.size();) {
+                std::uint32_t g = candidates[i];
+                if (faceMeshlet[g] != none) {
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                size_t newVertices = 0;
+                for (size_t j = 0; j < 3; ++j) newVertices += (vertexMeshlet[indices[3 * g + j]] != id) ? 1 : 0;
+                float d[3] = {centres[3 * g] - mean[0], centres[3 * g + 1] - mean[1], centres[3 * g + 2] - mean[2]};
+                float turn = 2.0f - (normals[3 * g]*dir[0] + normals[3 * g + 1]*dir[1] + normals[3 * g + 2]*dir[2]);
+                float score = std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]) * turn;
+                if ((newVertices < bestNew) || ((newVertices == bestNew) && (score < bestScore))) {
+                    best = g;
+                    bestNew = newVertices;
+                    bestScore = score;
+                }
+                ++i;
+            }
+            if (best == none) break;
+            f = best;
+        }
+        meshlet.m_numIndices = std::uint32_t(3 * count);
+        meshlets.push_back(meshlet);
+    }
+
+    // Reorder the triangles so that each meshlet is contiguous
+    std::vector<std::uint32_t> faces(indices, indices + 3 * numFaces);
+    for (size_t i = 0; i < numFaces; ++i) {
+        for (size_t j = 0; j < 3; ++j) indices[3 * i + j] = faces[3 * order[i] + j];
+    }
+
+    // Bound each meshlet with the sphere around its box, and the cone around its normals
+    for (Meshlets::Meshlet &meshlet : meshlets) {
+        const size_t first = meshlet.m_firstIndex / 3, last = first + meshlet.m_numIndices / 3;
+        float minCorner[3], maxCorner[3], axis[3] = {0.0f, 0.0f, 0.0f};
+        for (size_t c = 0; c < 3; ++c) {
+            minCorner[c] = std::numeric_limits<float>::max();
+            maxCorner[c] = -std::numeric_limits<float>::max();
+        }
+        for (size_t i = first; i < last; ++i) {
+            const std::uint32_t f = order[i];
+            for (size_t j = 0; j < 3; ++j) {
+                const float *p = vertices + size_t(indices[3 * i + j]) * floatsPerVertex;
+                for (size_t c = 0; c < 3; ++c) {
+                    minCorner[c] = std::min(minCorner[c], p[c]);
+                    maxCorner[c] = std::max(maxCorner[c], p[c]);
+                }
+            }
+            for (size_t c = 0; c < 3; ++c) axis[c] += normals[3 * f + c];
+        }
+        for (size_t c = 0; c < 3; ++c) meshlet.m_centre[c] = 0.5f * (minCorner[c] + maxCorner[c]);
+        float r2 = 0.0f;
+        for (size_t i = 3 * first; i < 3 * last; ++i) {
+            const float *p = vertices + size_t(indices[i]) * floatsPerVertex;
+            float d[3] = {p[0] - meshlet.m_centre[0], p[1] - meshlet.m_centre[1], p[2] - meshlet.m_centre[2]};
+            r2 = std::max(r2, d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+        }
+        meshlet.m_radius = std::sqrt(r2);
+
+        // A cone wider than about 84 degrees either side of the axis would hardly ever be culled
+        float axisLen = std::sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+        float minDot = 1.0f;
+        for (size_t c = 0; c < 3; ++c) meshlet.m_coneAxis[c] = (axisLen > 0.0f) ? axis[c] / axisLen : 0.0f;
+        for (size_t i = first; i < last; ++i) {
+            const float *n = normals.data() + 3 * order[i];
+            if ((n[0] == 0.0f) && (n[1] == 0.0f) && (n[2] == 0.0f)) continue;
+            minDot = std::min(minDot, n[0]*meshlet.m_coneAxis[0] + n[1]*meshlet.m_coneAxis[1] + n[2]*meshlet.m_coneAxis[2]);
+        }
+        meshlet.m_coneCutoff = ((axisLen > 0.0f) && (minDot > 0.1f)) ? std::sqrt(1.0f - minDot * minDot) : 1.0f;
+    }
+
+    // The order the meshlets grew in is poor for the vertex cache, so the triangles of each one are sorted again
+    // using local vertex numbers (which keeps the cost independent of the size of the mesh)
+    std::vector<std::uint32_t> localIndex(numVertices, none), globalIndex, local;
+    for (const Meshlets::Meshlet &meshlet : meshlets) {
+        std::uint32_t *first = indices + meshlet.m_firstIndex;
+        globalIndex.clear();
+        local.resize(meshlet.m_numIndices);
+        for (size_t i = 0; i < meshlet.m_numIndices; ++i) {
+            std::uint32_t &id = localIndex[first[i]];
+            if (id == none) {
+                id = std::uint32_t(globalIndex.size());
+                globalIndex.push_back(first[i]);
+            }
+            local[i] = id;
+        }
+        MeshOptimiser::optimiseTriangles(local.data(), local.size(), globalIndex.size());
+        for (size_t i = 0; i < meshlet.m_numIndices; ++i) first[i] = globalIndex[local[i]];
+        for (std::uint32_t v : globalIndex) localIndex[v] = none;
+    }
+    return meshlets;
+}
+
+/**
+ * @brief Meshlets::build
+ * @param indices The indices of all of the levels, one after the other
+ * @param levels The levels of detail (a mesh without any has a single level covering all of the indices)
+ * @param numLevels The number of levels
+ * @param vertices The interleaved vertex records, starting with the position
+ * @param numVertices The number of vertices
+ * @param floatsPerVertex The number of floats in each record
+ * @param maxTriangles The largest number of triangles in a meshlet
+ * @return The meshlets of all the levels
+ */
+std::vector<Meshlets::Meshlet> Meshlets::build(std::uint32_t *indices, MeshLOD::Level *levels, size_t numLevels,
+                                               const float *vertices, size_t numVertices, size_t floatsPerVertex,
+                                               size_t maxTriangles) {
+    maxTriangles = std::max(size_t(1), std::min(maxTriangles, MAX_TRIANGLES));
+    std::vector<std::vector<Meshlet>> levelMeshlets(numLevels);
+    parallelFor(0, numLevels, [&](size_t begin, size_t end, size_t) {
+        for (size_t l = begin; l < end; ++l) {
+            levelMeshlets[l] = buildLevel(indices + levels[l].m_firstIndex, levels[l].m_numIndices,
+                                          vertices, numVertices, floatsPerVertex, maxTriangles);
+        }
+    }, 1);
+
+    std::vector<Meshlet> meshlets;
+    for (size_t l = 0; l < numLevels; ++l) {
+        levels[l].m_firstMeshlet = std::uint32_t(meshlets.size());
+        levels[l].m_numMeshlets = std::uint32_t(levelMeshlets[l].size());
+        for (Meshlet &meshlet : levelMeshlets[l]) {
+            meshlet.m_firstIndex += levels[l].m_firstIndex;
+            meshlets.push_back(meshlet);
+        }
+    }
+    return meshlets;
+}
+
+/**
+ * @brief Meshlets::cull
+ * @param meshlets The meshlets to test
+ * @param numMeshlets The number of meshlets
+ * @param mvp The column major model-view-projection matrix
+ * @param eye The eye position in model space, or nullptr to keep the meshlets facing away
+ * @param visible The meshlets which may be visible
+ * @param stats The triangle counts are added to these
+ */
+void Meshlets::cull(const Meshlet *meshlets, size_t numMeshlets, const float *mvp, const float *eye,
+                    std::vector<std::uint32_t> &visible, CullStats &stats) {
+    // The frustum planes in model space are sums and differences of the rows of the matrix (Gribb and Hartmann)
+    float planes[6][4];
+    for (size_t p = 0; p < 6; ++p) {
+        const size_t row = p / 2;
+        const float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+        for (size_t c = 0; c < 4; ++c) planes[p][c] = mvp[4 * c + 3] + sign * mvp[4 * c + row];
+        float len = std::sqrt(planes[p][0]*planes[p][0] + planes[p][1]*planes[p][1] + planes[p][2]*planes[p][2]);
+        if (len > 0.0f) for (size_t c = 0; c < 4; ++c) planes[p][c] /= len;
+    }
+
+    visible.clear();
+    for (size_t i = 0; i < numMeshlets; ++i) {
+        const Meshlet &meshlet = meshlets[i];
+        const float *centre = meshlet.m_centre;
+        const size_t triangles = meshlet.m_numIndices / 3;
+
+        bool inside = true;
+        for (size_t p = 0; inside && (p < 6); ++p) {
+            inside = (planes[p][0]*centre[0] + planes[p][1]*centre[1] + planes[p][2]*centre[2] + planes[p][3] >= -meshlet.m_radius);
+        }
+        if (!inside) {
+            stats.m_frustumCulled += triangles;
+            continue;
+        }
+
+        // Every triangle faces away if the eye is behind all of their planes, which holds when the direction to the
+        // sphere is within the cone (widened by the size of the sphere)
+        if (eye != nullptr) {
+            float d[3] = {centre[0] - eye[0], centre[1] - eye[1], centre[2] - eye[2]};
+            float dist = std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+            float along = d[0]*meshlet.m_coneAxis[0] + d[1]*meshlet.m_coneAxis[1] + d[2]*meshlet.m_coneAxis[2];
+            if (along >= meshlet.m_coneCutoff * dist + meshlet.m_radius) {
+                stats.m_coneCulled += triangles;
+                continue;
+            }
+        }
+        visible.push_back(std::uint32_t(i));
+        stats.m_submitted += triangles;
+    }
+    stats.m_meshlets += visible.size();
+    ++stats.m_frames;
+}
+
+/**
+ * @brief Meshlets::report
+ * @param name The name of the mesh or the pass
+ * @param stats The stats to print, which are reset afterwards
+ */
+void Meshlets::report(const char *name, CullStats &stats) {
+    if (stats.m_frames == 0) return;
+    const size_t frames = stats.m_frames;
+    const size_t total = stats.m_submitted + stats.m_frustumCulled + stats.m_coneCulled;
+    std::cout << "Meshlets::cull() - " << name << ": " << stats.m_submitted / frames << " of " << total / frames
+              << " triangles submitted in " << stats.m_meshlets / frames << " meshlets, "
+              << stats.m_frustumCulled / frames << " outside the frustum, "
+              << stats.m_coneCulled / frames << " facing away (average of " << frames << " frames)\n";
+    stats = CullStats();
+}
@@ -0,0 +1,423 @@
+#include "meshlod.h"
+#include "meshtopology.h"
+#include "meshoptimiser.h"
+#include "parallelfor.h"
+
+#include <iostream>
+#include <algorithm>
+#include <queue>
+#include <cmath>
+
+/// The symmetric 4x4 matrix of a sum of squared distances to planes, stored as its upper triangle
+struct Quadric {
+    double m_q[10] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+    /// Add the plane ax + by + cz + d = 0
+    void addPlane(double a, double b, double c, double d) {
+        m_q[0] += a*a; m_q[1] += a*b; m_q[2] += a*c; m_q[3] += a*d;
+        m_q[4] += b*b; m_q[5] += b*c; m_q[6] += b*d;
+        m_q[7] += c*c; m_q[8] += c*d;
+        m_q[9] += d*d;
+    }
+
+    void add(const Quadric &q) {
+        for (size_t i = 0; i < 10; ++i) m_q[i] += q.m_q[i];
+    }
+
+    /// The sum of squared distances from p to the planes
+    double evaluate(const float *p) const {
+        double x = p[0], y = p[1], z = p[2];
+        return x*x*m_q[0] + 2.0*x*y*m_q[1] + 2.0*x*z*m_q[2] + 2.0*x*m_q[3] +
+               y*y*m_q[4] + 2.0*y*z*m_q[5] + 2.0*y*m_q[6] +
+               z*z*m_q[7] + 2.0*z*m_q[8] +
+               m_q[9];
+    }
+};
+
+/// A candidate collapse of one vertex onto a neighbour, valid while neither end has changed since it was queued
+struct Collapse {
+    float m_cost;       //< The priority, which includes a small penalty on the length of the edge
+    float m_error;      //< The quadric error alone
+    std::uint32_t m_from, m_to;
+    std::uint32_t m_fromStamp, m_toStamp;
+    bool operator>(const Collapse &c) const {return m_cost > c.m_cost;}
+};
+
+/**
+ * @brief The ClusterPass struct
+ * The state shared by the clusters of a single pass. Each cluster only writes to the triangles it owns and to the
+ * vertices whose triangles are all in the cluster, so no locking is needed between the threads.
+ */
+struct ClusterPass {
+    const float *m_vertices;
+    size_t m_stride;
+    std::vector<std::uint32_t> &m_triangles;
+    std::vector<char> &m_alive;
+    std::vector<Quadric> &m_quadrics;
+    std::vector<std::uint32_t> m_owner;    //< The cluster owning each vertex, or INVALID if it is locked
+    std::vector<char> m_border;            //< Vertices on an open or non-manifold edge are never removed
+    std::vector<std::uint32_t> m_local;    //< The index of each owned vertex within its cluster
+
+    ClusterPass(const float *vertices, size_t stride, std::vector<std::uint32_t> &triangles,
+                std::vector<char> &alive, std::vector<Quadric> &quadrics)
+        : m_vertices(vertices), m_stride(stride), m_triangles(triangles), m_alive(alive), m_quadrics(quadrics) {}
+
+    const float *position(std::uint32_t v) const {return m_vertices + size_t(v) * m_stride;}
+
+    float simplify(const std::vector<std::uint32_t> &faces, size_t target, std::uint32_t cluster);
+};
+
+/**
+ * @brief ClusterPass::simplify
+ * Collapse the cheapest half-edges between vertices owned by the cluster until it has target triangles left, or
+ * nothing more can be collapsed without folding a triangle over or making the mesh non-manifold.
+ * @param faces The triangles in the cluster
+ * @param target The number of triangles to aim for
+ * @param cluster The index of the cluster
+ * @return The largest quadric error of the collapses made
+ */
+float ClusterPass::simplify(const std::vector<std::uint32_t> &faces, size_t target, std::uint32_t cluster) {
+    // Gather the owned vertices and the triangles around each of them
+    std::vector<std::uint32_t> vertices;
+    std::vector<std::vector<std::uint32_t>> adjacent;
+    for (std::uint32_t f : faces) {
+        for (size_t j = 0; j < 3; ++j) {
+            std::uint32_t v = m_triangles[3 * f + j];
+            if (m_owner[v] != cluster) continue;
+            if (m_local[v] == MeshTopology::INVALID) {
+                m_local[v] = std::uint32_t(vertices.size());
+                vertices.push_back(v);
+                adjacent.push_back(std::vector<std::uint32_t>());
+            }
+            adjacent[m_local[v]].push_back(f);
+        }
+    }
+    std::vector<std::uint32_t> stamp(vertices.size(), 0);
+    std::vector<char> removed(vertices.size(), 0);
+
+    // The one-ring of an owned vertex from its live triangles
+    auto neighbours = [&](std::uint32_t v, std::vector<std::uint32_t> &ring) {
+        ring.clear();
+        for (std::uint32_t f : adjacent[m_local[v]]) {
+            if (!m_alive[f]) continue;
+            for (size_t j = 0; j < 3; ++j) {
+                if (m_triangles[3 * f + j] != v) ring.push_back(m_triangles[3 * f + j]);
+            }
+        }
+        std::sort(ring.begin(), ring.end());
+        ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+    };
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+    auto push = [&](std::uint32_t from, std::uint32_t to) {
+        if (m_border[from]) return;
+        Quadric q = m_quadrics[from];
+        q.add(m_quadrics[to]);
+        // On flat areas every quadric error is zero, and collapsing the shortest edge first stops the
+        // vertices piling up on a single hub
+        const float *pf = position(from), *pt = position(to);
+        float length = (pf[0]-pt[0])*(pf[0]-pt[0]) + (pf[1]-pt[1])*(pf[1]-pt[1]) + (pf[2]-pt[2])*(pf[2]-pt[2]);
+        Collapse c;
+        c.m_error = float(std::max(q.evaluate(pt), 0.0));
+        c.m_cost = c.m_error + 1e-3f * length;
+        c.m_from = from;
+        c.m_to = to;
+        c.m_fromStamp = stamp[m_local[from]];
+        c.m_toStamp = stamp[m_local[to]];
+        queue.push(c);
+    };
+
+    std::vector<std::uint32_t> ring, otherRing;
+    for (std::uint32_t v : vertices) {
+        neighbours(v, ring);
+        for (std::uint32_t w : ring) if (m_owner[w] == cluster) push(v, w);
+    }
+
+    size_t alive = faces.size();
+    float maxCost = 0.0f;
+    while ((alive > target) && !queue.empty()) {
+        Collapse c = queue.top();
+        queue.pop();
+        std::uint32_t u = c.m_from, v = c.m_to;
+        std::uint32_t lu = m_local[u], lv = m_local[v];
+        if (removed[lu] || removed[lv] || (stamp[lu] != c.m_fromStamp) || (stamp[lv] != c.m_toStamp)) continue;
+
+        // The edge must still exist and be shared by exactly two triangles whose other corners are the only
+        // vertices next to both ends, otherwise the collapse would pinch the surface
+        neighbours(u, ring);
+        if (!std::binary_search(ring.begin(), ring.end(), v)) continue;
+        neighbours(v, otherRing);
+        size_t common = 0;
+        for (std::uint32_t w : ring) if (std::binary_search(otherRing.begin(), otherRing.end(), w)) ++common;
+        if (common != 2) continue;
+
+        // Reject the collapse if any of the remaining triangles around u would flip or become a sliver
+        const float *pv = position(v);
+        bool valid = true;
+        for (std::uint32_t f : adjacent[lu]) {
+            const std::uint32_t *tri = &m_triangles[3 * f];
+            if (!m_alive[f] || (tri[0] == v) || (tri[1] == v) || (tri[2] == v)) continue;
+            const float *p[3] = {position(tri[0]), position(tri[1]), position(tri[2])};
+            float before[3], after[3];
+            for (size_t pass = 0; pass < 2; ++pass) {
+                const float *q[3] = {p[0], p[1], p[2]};
+                if (pass == 1) for (size_t j = 0; j < 3; ++j) if (tri[j] == u) q[j] = pv;
+                float e1[3] = {q[1][0] - q[0][0], q[1][1] - q[0][1], q[1][2] - q[0][2]};
+                float e2[3] = {q[2][0] - q[0][0], q[2][1] - q[0][1], q[2][2] - q[0][2]};
+                float *n = (pass == 0) ? before : after;
+                n[0] = e1[1]*e2[2] - e1[2]*e2[1];
+                n[1] = e1[2]*e2[0] - e1[0]*e2[2];
+                n[2] = e1[0]*e2[1] - e1[1]*e2[0];
+            }
+            float d = before[0]*after[0] + before[1]*after[1] + before[2]*after[2];
+            float lb = std::sqrt(before[0]*before[0] + before[1]*before[1] + before[2]*before[2]);
+            float la = std::sqrt(after[0]*after[0] + after[1]*after[1] + after[2]*after[2]);
+            if (d <= 0.2f * lb * la) {
+                valid = false;
+                break;
+            }
+        }
+        if (!valid) continue;
+
+        // Move u onto v: the two triangles on the edge disappear and the rest are handed over to v
+        for (std::uint32_t f : adjacent[lu]) {
+            if (!m_alive[f]) continue;
+            std::uint32_t *tri = &m_triangles[3 * f];
+            if ((tri[0] == v) || (tri[1] == v) || (tri[2] == v)) {
+                m_alive[f] = 0;
+                --alive;
+            } else {
+                for (size_t j = 0; j < 3; ++j) if (tri[j] == u) tri[j] = v;
+                adjacent[lv].push_back(f);
+            }
+        }
+        adjacent[lu].clear();
+        adjacent[lv].erase(std::remove_if(adjacent[lv].begin(), adjacent[lv].end(),
+                                          [&](std::uint32_t f) {return !m_alive[f];}), adjacent[lv].end());
+        m_quadrics[v].add(m_quadrics[u]);
+        removed[lu] = 1;
+        ++stamp[lv];
+        maxCost = std::max(maxCost, c.m_error);
+
+        // Requeue the edges around v, whose costs have all changed
+        neighbours(v, ring);
+        for (std::uint32_t w : ring) {
+            if (m_owner[w] != cluster) continue;
+            push(v, w);
+            push(w, v);
+        }
+    }
+    return maxCost;
+}
+
+/**
+ * @brief simplifyPass Run one clustered pass over the triangle list
+ * @param triangles The triangle list, which is replaced by the simplified one
+ * @param target The number of triangles to aim for
+ * @param pass The pass number, which decides the offset of the cluster grid
+ * @param vertices The interleaved vertex records, starting with the position
+ * @param numVertices The number of vertices
+ * @param stride The number of floats in each record
+ * @param minCorner The minimum corner of the bounding box
+ * @param extent The size of the bounding box
+ * @param quadrics The quadric of each vertex, which are merged as the vertices are removed
+ * @return The largest quadric error of the collapses made
+ */
+static float simplifyPass(std::vector<std::uint32_t> &triangles, size_t target, size_t pass,
+                          const float *vertices, size_t numVertices, size_t stride,
+                          const float *minCorner, const float *extent, std::vector<Quadric> &quadrics) {
+    const size_t numFaces = triangles.size() / 3;
+    MeshTopology topology;
+    topology.build(triangles.data(), numFaces, numVertices);
+
+    std::vector<char> alive(numFaces, 1);
+    ClusterPass state(vertices, stride, triangles, alive, quadrics);
+    state.m_border.assign(numVertices, 0);
+    for (std::uint32_t h = 0; h < topology.numHalfEdges(); ++h) {
+        if (topology.isBoundary(h)) state.m_border[topology.source(h)] = state.m_border[topology.target(h)] = 1;
+    }
+
+    // Aim for a few thousand triangles in each cluster, and shift the grid by half a cell on odd passes
+    size_t cells = std::max(size_t(1), size_t(std::lround(std::cbrt(double(numFaces) / 4096.0))));
+    const size_t dim = cells + 1;
+    const float shift = (pass & 1) ? 0.5f : 0.0f;
+    std::vector<std::uint32_t> faceCluster(numFaces);
+    std::vector<std::vector<std::uint32_t>> clusterFaces(dim * dim * dim);
+    for (size_t f = 0; f < numFaces; ++f) {
+        size_t cell[3];
+        for (size_t c = 0; c < 3; ++c) {
+            float centre = 0.0f;
+            for (size_t j = 0; j < 3; ++j) centre += vertices[size_t(triangles[3 * f + j]) * stride + c];
+            float t = (extent[c] > 0.0f) ? (centre / 3.0f - minCorner[c]) / extent[c] : 0.0f;
+            cell[c] = std::min(size_t(std::max(t * float(cells) + shift, 0.0f)), dim - 1);
+        }
+        faceCluster[f] = std::uint32_t((cell[2] * dim + cell[1]) * dim + cell[0]);
+        clusterFaces[faceCluster[f]].push_back(std::uint32_t(f));
+    }
+
+    // A vertex belongs to a cluster only if all of its triangles do
+    const std::uint32_t invalid = MeshTopology::INVALID;
+    state.m_owner.assign(numVertices, invalid);
+    state.m_local.assign(numVertices, invalid);
+    for (size_t v = 0; v < numVertices; ++v) {
+        MeshTopology::Range faces = topology.vertexFaces(v);
+        if (faces.empty()) continue;
+        std::uint32_t cluster = faceCluster[*faces.begin()];
+        bool inside = true;
+        for (std::uint32_t f : faces) inside = inside && (faceCluster[f] == cluster);
+        if (inside) state.m_owner[v] = cluster;
+    }
+
+    // Every cluster is reduced by the same proportion
+    const double ratio = double(target) / double(numFaces);
+    std::vector<float> costs(clusterFaces.size(), 0.0f);
+    parallelFor(0, clusterFaces.size(), [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            if (clusterFaces[i].empty()) continue;
+            size_t clusterTarget = size_t(std::ceil(double(clusterFaces[i].size()) * ratio));
+            costs[i] = state.simplify(clusterFaces[i], clusterTarget, std::uint32_t(i));
+        }
+    }, 1);
+
+    // Keep the surviving triangles in their original order
+    size_t cnt = 0;
+    for (size_t f = 0; f < numFaces; ++f) {
+        if (!alive[f]) continue;
+        for (size_t j = 0; j < 3; ++j) triangles[3 * cnt + j] = triangles[3 * f + j];
+        ++cnt;
+    }
+    triangles.resize(3 * cnt);
+    return *std::max_element(costs.begin(), costs.end());
+}
+
+/**
+ * @brief MeshLOD::build
+ * @param indices The full resolution triangle list
+ * @param numIndices The number of indices (3 per triangle)
+ * @param vertices The interleaved vertex records, starting with the position
+ * @param numVertices The number of vertices
+ * @param floatsPerVertex The number of floats in each record
+ * @param out The indices of every level, one after the other
+ * @param reduction The fraction of the triangles kept from one level to the next
+ * @param minTriangles Stop once a level has fewer triangles than this
+ * @return The levels, starting with the full resolution mesh
+ */
+std::vector<MeshLOD::Level> MeshLOD::build(const std::uint32_t *indices, size_t numIndices,
+                                           const float *vertices, size_t numVertices, size_t floatsPerVertex,
+                                           std::vector<std::uint32_t> &out, float reduction, size_t minTriangles) {
+    out.assign(indices, indices + numIndices);
+    std::vector<Level> levels(1);
+    levels[0].m_numIndices = std::uint32_t(numIndices);
+    if (numVertices == 0) return levels;
+
+    // Every vertex starts with the planes of the triangles around it
+    std::vector<Quadric> quadrics(numVertices);
+    for (size_t i = 0; i + 2 < numIndices; i += 3) {
+        const float *p0 = vertices + size_t(indices[i]) * floatsPerVertex;
+        const float *p1 = vertices + size_t(indices[i + 1]) * floatsPerVertex;
+        const float *p2 = vertices + size_t(indices[i + 2]) * floatsPerVertex;
+        double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        double n[3] = {e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0]};
+        double len = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if (len == 0.0) continue;
+        for (size_t c = 0; c < 3; ++c) n[c] /= len;
+        double d = -(n[0]*p0[0] + n[1]*p0[1] + n[2]*p0[2]);
+        for (size_t j = 0; j < 3; ++j) quadrics[indices[i + j]].addPlane(n[0], n[1], n[2], d);
+    }
+
+    float minCorner[3], maxCorner[3], extent[3];
+    for (size_t c = 0; c < 3; ++c) minCorner[c] = maxCorner[c] = vertices[c];
+    for (size_t v = 1; v < numVertices; ++v) {
+        for (size_t c = 0; c < 3; ++c) {
+            minCorner[c] = std::min(minCorner[c], vertices[v * floatsPerVertex + c]);
+            maxCorner[c] = std::max(maxCorner[c], vertices[v * floatsPerVertex + c]);
+        }
+    }
+    for (size_t c = 0; c < 3; ++c) extent[c] = maxCorner[c] - minCorner[c];
+
+    // Each level is simplified from the one before, so the error can only grow
+    std::vector<std::uint32_t> triangles(indices, indices + numIndices);
+    float maxCost = 0.0f;
+    size_t pass = 0;
+    while ((levels.size() < MAX_LEVELS) && (triangles.size() / 3 >= minTriangles)) {
+        const size_t before = triangles.size() / 3;
+        const size_t target = size_t(float(before) * reduction);
+        for (size_t attempt = 0; (attempt < 4) && (triangles.size() / 3 > target); ++attempt) {
+            maxCost = std::max(maxCost, simplifyPass(triangles, target, pass++, vertices, numVertices,
+                                                     floatsPerVertex, minCorner, extent, quadrics));
+        }
+
+        // Give up once the locked borders and the fold checks stop the mesh from getting much smaller
+        if (triangles.size() / 3 > before - before / 10) break;
+
+        MeshOptimiser::optimiseTriangles(triangles.data(), triangles.size(), numVertices);
+        Level level;
+        level.m_firstIndex = std::uint32_t(out.size());
+        level.m_numIndices = std::uint32_t(triangles.size());
+        // The square root of the quadric error is a distance, but only an estimate: the quadrics measure the
+        // distance to the planes of the original triangles rather than to the triangles themselves
+        level.m_error = std::sqrt(maxCost);
+        levels.push_back(level);
+        out.insert(out.end(), triangles.begin(), triangles.end());
+    }
+    return levels;
+}
+
+/**
+ * @brief MeshLOD::selectLevel
+ * @param levels The levels from build() or a MeshCache
+ * @param numLevels The number of levels
+ * @param distance The distance from the eye to the nearest point of the bounding sphere
+ * @param pixelsPerUnit The size in pixels of one unit at a distance of one
+ * @param maxPixels The largest acceptable error on the screen
+ * @return The index of the level to draw
+ */
+size_t MeshLOD::selectLevel(const Level *levels, size_t numLevels, float distance, float pixelsPerUnit, float maxPixels) {
+    if (distance <= 0.0f) return 0;
+    for (size_t i = numLevels; i > 1; --i) {
+        if (levels[i - 1].m_error * pixelsPerUnit / distance <= maxPixels) return i - 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief MeshLOD::boundingSphere
+ * @param vertices The interleaved vertex records, starting with the position
+ * @param numVertices The number of vertices
+ * @param floatsPerVertex The number of floats in each record
+ * @param centre Output centre of the sphere (3 floats)
+ * @param radius Output radius of the sphere
+ */
+void MeshLOD::boundingSphere(const float *vertices, size_t numVertices, size_t floatsPerVertex,
+                             float *centre, float &radius) {
+    float minCorner[3] = {0.0f, 0.0f, 0.0f}, maxCorner[3] = {0.0f, 0.0f, 0.0f};
+    for (size_t v = 0; v < numVertices; ++v) {
+        for (size_t c = 0; c < 3; ++c) {
+            float x = vertices[v * floatsPerVertex + c];
+            minCorner[c] = (v == 0) ? x : std::min(minCorner[c], x);
+            maxCorner[c] = (v == 0) ? x : std::max(maxCorner[c], x);
+        }
+    }
+    float r2 = 0.0f;
+    for (size_t c = 0; c < 3; ++c) {
+        centre[c] = 0.5f * (minCorner[c] + maxCorner[c]);
+        r2 += 0.25f * (maxCorner[c] - minCorner[c]) * (maxCorner[c] - minCorner[c]);
+    }
+    radius = std::sqrt(r2);
+}
+
+/**
+ * @brief MeshLOD::report
+ * @param name The name of the mesh
+ * @param levels The levels to print
+ * @param numLevels The number of levels
+ */
+void MeshLOD::report(const char *name, const Level *levels, size_t numLevels) {
+    std::cout << "MeshLOD::build() - " << name << ":";
+    for (size_t i = 0; i < numLevels; ++i) {
+        std::cout << ((i == 0) ? " " : ", ") << levels[i].m_numIndices / 3 << " triangles";
+        if (i > 0) std::cout << " (error " << levels[i].m_error << ")";
+    }
+    std::cout << "\n";
+}
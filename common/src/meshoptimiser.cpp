@@ -0,0 +1,292 @@
+#include "meshoptimiser.h"
+#include "meshtopology.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief MeshOptimiser::analyse
+ * @param indices The triangle list
+ * @param numIndices The number of indices (3 per triangle)
+ * @param numVertices The number of vertices
+ * @param cacheSize The number of entries in the simulated FIFO cache
+ * @return The average cache miss ratio and average transformed vertex ratio
+ */
+MeshOptimiser::Stats MeshOptimiser::analyse(const std::uint32_t *indices, size_t numIndices, size_t numVertices,
+                                            unsigned int cacheSize) {
+    Stats stats;
+    if ((numIndices < 3) || (numVertices == 0)) return stats;
+
+    // A vertex is in the cache if it was added within the last cacheSize misses
+    std::vector<size_t> added(numVertices, 0);
+    std::vector<bool> used(numVertices, false);
+    size_t misses = 0, referenced = 0;
+    for (size_t i = 0; i < numIndices; ++i) {
+        std::uint32_t v = indices[i];
+        if (!used[v]) {
+            used[v] = true;
+            ++referenced;
+        }
+        if ((added[v] == 0) || (misses + 1 - added[v] > cacheSize)) {
+            ++misses;
+            added[v] = misses;
+        }
+    }
+    stats.m_acmr = float(misses) / float(numIndices / 3);
+    stats.m_atvr = float(misses) / float(referenced);
+    return stats;
+}
+
+/**
+ * @brief MeshOptimiser::optimiseTriangles
+ * Tipsify walks the mesh fanning around a vertex at a time, choosing the next vertex from the one-ring of the last
+ * fan that is still in the cache and has the fewest remaining triangles. When the walk gets stuck it backtracks
+ * through recently used vertices and finally falls back to the next vertex in input order.
+ * @param indices The triangle list, which is reordered in place
+ * @param numIndices The number of indices (3 per triangle)
+ * @param numVertices The number of vertices
+ * @param cacheSize The target cache size
+ */
+void MeshOptimiser::optimiseTriangles(std::uint32_t *indices, size_t numIndices, size_t numVertices,
+                                      unsigned int cacheSize) {
+    const size_t numFaces = numIndices / 3;
+    if (numFaces == 0) return;
+    MeshTopology topology;
+    topology.build(indices, numFaces, numVertices);
+
+    // Live triangle count and cache time stamp of each vertex
+    std::vector<std::uint32_t> live(numVertices);
+    for (size_t v = 0; v < numVertices; ++v) live[v] = std::uint32_t(topology.vertexFaces(v).size());
+    std::vector<size_t> stamp(numVertices, 0);
+    std::vector<bool> emitted(numFaces, false);
+    std::vector<std::uint32_t> deadEnd, candidates;
+    deadEnd.reserve(numIndices);
+
+    std::vector<std::uint32_t> output;
+    output.reserve(numIndices);
+    size_t time = cacheSize + 1;
+    size_t cursor = 0;
+    long fan = 0;
+    while (fan >= 0) {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (std::uint32_t f : topology.vertexFaces(size_t(fan))) {
+            if (emitted[f]) continue;
+            emitted[f] = true;
+            for (size_t j = 0; j < 3; ++j) {
+                std::uint32_t v = topology.face(f)[j];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - stamp[v] > cacheSize) {
+                    stamp[v] = time;
+                    ++time;
+                }
+            }
+        }
+
+        // Pick the candidate which will still be in the cache after its remaining triangles are emitted,
+        // preferring the oldest one
+        fan = -1;
+        long best = -1;
+        for (std::uint32_t v : candidates) {
+            if (live[v] == 0) continue;
+            long priority = 0;
+            if (time - stamp[v] + 2 * live[v] <= cacheSize) priority = long(time - stamp[v]);
+            if (priority > best) {
+                best = priority;
+                fan = long(v);
+            }
+        }
+
+        // Otherwise backtrack through the recently used vertices, and then the input order
+        if (fan < 0) {
+            while (!deadEnd.empty()) {
+                std::uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) {
+                    fan = long(v);
+                    break;
+                }
+            }
+        }
+        if (fan < 0) {
+            while ((cursor < numVertices) && (live[cursor] == 0)) ++cursor;
+            if (cursor < numVertices) fan = long(cursor);
+        }
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+/**
+ * @brief MeshOptimiser::optimiseVertices
+ * @param indices The triangle list, which is remapped in place
+ * @param numIndices The number of indices
+ * @param vertices The interleaved vertex records, which are reordered in place
+ * @param numVertices The number of vertices
+ * @param floatsPerVertex The number of floats in each vertex record
+ * @return The new index of each of the original vertices
+ */
+std::vector<std::uint32_t> MeshOptimiser::optimiseVertices(std::uint32_t *indices, size_t numIndices,
+                                                           float *vertices, size_t numVertices,
+                                                           size_t floatsPerVertex) {
+    const std::uint32_t unused = 0xffffffff;
+    std::vector<std::uint32_t> remap(numVertices, unused);
+    std::uint32_t next = 0;
+    for (size_t i = 0; i < numIndices; ++i) {
+        std::uint32_t &r = remap[indices[i]];
+        if (r == unused) r = next++;
+        indices[i] = r;
+    }
+    for (size_t v = 0; v < numVertices; ++v) {
+        if (remap[v] == unused) remap[v] = next++;
+    }
+
+    std::vector<float> reordered(numVertices * floatsPerVertex);
+    for (size_t v = 0; v < numVertices; ++v) {
+        memcpy(&reordered[remap[v] * floatsPerVertex], vertices + v * floatsPerVertex, floatsPerVertex * sizeof(float));
+    }
+    std::copy(reordered.begin(), reordered.end(), vertices);
+    return remap;
+}
+
+/**
+ * @brief appendRun Write the triangles of one run relative to its base vertex, either as they are or joined into
+ * strips. Each strip step crosses the edge formed by the last two strip vertices, into the neighbour whose winding
+ * matches the alternating order of the strip.
+ * @param topology The mesh topology
+ * @param faces The triangles in the run
+ * @param run The run of each triangle, as neighbours are only taken from the same run
+ * @param baseVertex Subtracted from every index
+ * @param stripify Whether to build strips separated by the maximum index value
+ * @param visited Flags for the triangles already in a strip
+ * @param out The indices are appended here
+ */
+template<typename Index>
+static void appendRun(const MeshTopology &topology, const std::vector<std::uint32_t> &faces,
+                      const std::vector<std::uint32_t> &run, std::uint32_t baseVertex, bool stripify,
+                      std::vector<bool> &visited, std::vector<Index> &out) {
+    if (!stripify) {
+        for (std::uint32_t f : faces) {
+            for (size_t j = 0; j < 3; ++j) out.push_back(Index(topology.face(f)[j] - baseVertex));
+        }
+        return;
+    }
+
+    // The neighbour across half-edge h, if it is in this run and not used yet
+    auto available = [&](std::uint32_t h) {
+        std::uint32_t t = topology.twin(h);
+        if (t == MeshTopology::INVALID) return MeshTopology::INVALID;
+        std::uint32_t f = MeshTopology::halfEdgeFace(t);
+        return ((run[f] == run[MeshTopology::halfEdgeFace(h)]) && !visited[f]) ? t : MeshTopology::INVALID;
+    };
+
+    bool first = true;
+    for (std::uint32_t f : faces) {
+        if (visited[f]) continue;
+        visited[f] = true;
+        if (!first) out.push_back(Index(~Index(0)));
+        first = false;
+
+        // Start on the corner whose opposite edge leads somewhere, so the strip can grow
+        std::uint32_t start = 3 * f;
+        for (std::uint32_t r = 0; r < 3; ++r) {
+            if (available(3 * f + (r + 1) % 3) != MeshTopology::INVALID) {
+                start = 3 * f + r;
+                break;
+            }
+        }
+        std::uint32_t h = MeshTopology::next(start);
+        out.push_back(Index(topology.source(start) - baseVertex));
+        out.push_back(Index(topology.source(h) - baseVertex));
+        out.push_back(Index(topology.target(h) - baseVertex));
+
+        // h is the half-edge between the last two strip vertices. Odd steps leave through it, even steps through
+        // the edge that follows it around the new triangle.
+        bool odd = true;
+        for (;;) {
+            std::uint32_t t = available(h);
+            if (t == MeshTopology::INVALID) break;
+            visited[MeshTopology::halfEdgeFace(t)] = true;
+            out.push_back(Index(topology.target(MeshTopology::next(t)) - baseVertex));
+            h = odd ? MeshTopology::prev(t) : MeshTopology::next(t);
+            odd = !odd;
+        }
+    }
+}
+
+/**
+ * @brief MeshOptimiser::compactIndices
+ * Each triangle goes in the window of 32768 vertices holding its smallest index, and is drawn relative to the start
+ * of that window, which leaves room for the rest of the triangle to be up to 32767 vertices further on. Anything
+ * spanning more than that is kept in a 32 bit run. The triangles keep their order within each window, so the cache
+ * order from optimiseTriangles() is only disturbed where a triangle joins vertices used at very different times.
+ * @param indices The triangle list
+ * @param numIndices The number of indices (3 per triangle)
+ * @param numVertices The number of vertices
+ * @param allow16bit Whether 16 bit indices may be used
+ * @param stripify Whether to join the triangles into strips
+ * @return The rewritten indices and the ranges to draw
+ */
+MeshOptimiser::CompactIndices MeshOptimiser::compactIndices(const std::uint32_t *indices, size_t numIndices,
+                                                            size_t numVertices, bool allow16bit, bool stripify) {
+    const std::uint32_t window = 0x8000;
+    const size_t numFaces = numIndices / 3;
+    MeshTopology topology;
+    topology.build(indices, numFaces, numVertices);
+
+    // Windows are numbered from 0, with the 32 bit run after the last of them
+    const std::uint32_t numWindows = allow16bit ? std::uint32_t(numVertices / window + 1) : 0;
+    std::vector<std::uint32_t> run(numFaces, numWindows);
+    std::vector<std::vector<std::uint32_t>> runFaces(numWindows + 1);
+    for (std::uint32_t f = 0; f < numFaces; ++f) {
+        const std::uint32_t *tri = indices + 3 * f;
+        std::uint32_t lo = std::min(tri[0], std::min(tri[1], tri[2]));
+        std::uint32_t hi = std::max(tri[0], std::max(tri[1], tri[2]));
+        if (allow16bit && (hi - (lo / window) * window < 0xffff)) run[f] = lo / window;
+        runFaces[run[f]].push_back(f);
+    }
+
+    CompactIndices result;
+    result.m_strips = stripify;
+    std::vector<bool> visited(numFaces, false);
+    for (std::uint32_t r = 0; r <= numWindows; ++r) {
+        if (runFaces[r].empty()) continue;
+        IndexRange range;
+        if (r < numWindows) {
+            range.m_first = std::uint32_t(result.m_indices16.size());
+            range.m_baseVertex = r * window;
+            appendRun(topology, runFaces[r], run, range.m_baseVertex, stripify, visited, result.m_indices16);
+            range.m_count = std::uint32_t(result.m_indices16.size()) - range.m_first;
+            result.m_ranges16.push_back(range);
+        } else {
+            range.m_first = std::uint32_t(result.m_indices32.size());
+            appendRun(topology, runFaces[r], run, 0, stripify, visited, result.m_indices32);
+            range.m_count = std::uint32_t(result.m_indices32.size()) - range.m_first;
+            result.m_ranges32.push_back(range);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief MeshOptimiser::optimise
+ * @param name A name for the mesh used in the report
+ * @param indices The triangle list
+ * @param numIndices The number of indices
+ * @param vertices The interleaved vertex records
+ * @param numVertices The number of vertices
+ * @param floatsPerVertex The number of floats in each vertex record
+ */
+void MeshOptimiser::optimise(const char *name, std::uint32_t *indices, size_t numIndices,
+                             float *vertices, size_t numVertices, size_t floatsPerVertex) {
+    Stats before = analyse(indices, numIndices, numVertices);
+    optimiseTriangles(indices, numIndices, numVertices);
+    optimiseVertices(indices, numIndices, vertices, numVertices, floatsPerVertex);
+    Stats after = analyse(indices, numIndices, numVertices);
+    std::cout << "MeshOptimiser::optimise() - " << name << ": ACMR " << before.m_acmr << " -> " << after.m_acmr
+              << ", ATVR " << before.m_atvr << " -> " << after.m_atvr
+              << " (FIFO cache of " << DEFAULT_CACHE_SIZE << ")\n";
+}
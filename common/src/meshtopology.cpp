@@ -0,0 +1,136 @@
+#include "meshtopology.h"
+#include "parallelfor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+/**
+ * @brief MeshTopology::build
+ * @param F The triangle indices of the mesh
+ * @param numVertices The number of vertices in the mesh
+ */
+void MeshTopology::build(const MatrixXir &F, size_t numVertices) {
+    std::vector<std::uint32_t> faces(size_t(F.size()));
+    for (size_t i = 0; i < faces.size(); ++i) faces[i] = std::uint32_t(F.data()[i]);
+    build(faces.data(), size_t(F.rows()), numVertices);
+}
+
+/**
+ * @brief MeshTopology::build
+ * @param faces The triangle indices, 3 per face
+ * @param numFaces The number of triangles
+ * @param numVertices The number of vertices in the mesh
+ */
+void MeshTopology::build(const std::uint32_t *faces, size_t numFaces, size_t numVertices) {
+    m_numVertices = numVertices;
+    m_numFaces = numFaces;
+    m_faces.assign(faces, faces + 3 * numFaces);
+    buildVertexFaces();
+    buildVertexNeighbours();
+    buildTwins();
+}
+
+/**
+ * @brief MeshTopology::buildVertexFaces
+ * The counts and the fill are done with atomic counters, which leaves the faces of each vertex in an arbitrary
+ * order. Each list is short, so sorting them afterwards is cheap and makes the result deterministic.
+ */
+void MeshTopology::buildVertexFaces() {
+    const size_t numCorners = m_faces.size();
+    std::unique_ptr<std::atomic<std::uint32_t>[]> counts(new std::atomic<std::uint32_t>[m_numVertices]());
+    parallelFor(0, numCorners, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) counts[m_faces[i]].fetch_add(1, std::memory_order_relaxed);
+    });
+
+    m_vfOffset.resize(m_numVertices + 1);
+    m_vfOffset[0] = 0;
+    for (size_t v = 0; v < m_numVertices; ++v) {
+        m_vfOffset[v + 1] = m_vfOffset[v] + counts[v].load(std::memory_order_relaxed);
+        counts[v].store(m_vfOffset[v], std::memory_order_relaxed);
+    }
+
+    // The counters now hold the next free slot of each vertex
+    m_vfAdj.resize(numCorners);
+    parallelFor(0, numCorners, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            m_vfAdj[counts[m_faces[i]].fetch_add(1, std::memory_order_relaxed)] = std::uint32_t(i / 3);
+        }
+    });
+    parallelFor(0, m_numVertices, [&](size_t begin, size_t end, size_t) {
+        for (size_t v = begin; v < end; ++v) {
+            std::sort(m_vfAdj.begin() + m_vfOffset[v], m_vfAdj.begin() + m_vfOffset[v + 1]);
+        }
+    });
+}
+
+/**
+ * @brief MeshTopology::buildVertexNeighbours
+ * Every face contributes at most two neighbours to each of its vertices, so these are gathered into a worst case
+ * sized buffer, sorted and made unique, and then compacted.
+ */
+void MeshTopology::buildVertexNeighbours() {
+    std::vector<std::uint32_t> neighbours(m_vfAdj.size() * 2);
+    std::vector<std::uint32_t> counts(m_numVertices);
+    parallelFor(0, m_numVertices, [&](size_t begin, size_t end, size_t) {
+        for (size_t v = begin; v < end; ++v) {
+            std::uint32_t *first = neighbours.data() + 2 * m_vfOffset[v];
+            std::uint32_t *last = first;
+            for (std::uint32_t f : vertexFaces(v)) {
+                const std::uint32_t *corners = face(f);
+                for (size_t j = 0; j < 3; ++j) {
+                    if (corners[j] != v) *last++ = corners[j];
+                }
+            }
+            std::sort(first, last);
+            counts[v] = std::uint32_t(std::unique(first, last) - first);
+        }
+    });
+
+    m_vvOffset.resize(m_numVertices + 1);
+    m_vvOffset[0] = 0;
+    for (size_t v = 0; v < m_numVertices; ++v) m_vvOffset[v + 1] = m_vvOffset[v] + counts[v];
+    m_vvAdj.resize(m_vvOffset[m_numVertices]);
+    parallelFor(0, m_numVertices, [&](size_t begin, size_t end, size_t) {
+        for (size_t v = begin; v < end; ++v) {
+            std::copy_n(neighbours.data() + 2 * m_vfOffset[v], counts[v], m_vvAdj.data() + m_vvOffset[v]);
+        }
+    });
+}
+
+/**
+ * @brief MeshTopology::buildTwins
+ * The twin of the half-edge s->t is the half-edge t->s, which can only be in one of the faces around t. Each
+ * half-edge is matched independently, so there are no write conflicts. Edges shared by more than two faces
+ * are treated as boundaries.
+ */
+void MeshTopology::buildTwins() {
+    m_twin.resize(m_faces.size());
+    parallelFor(0, m_faces.size(), [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            std::uint32_t h = std::uint32_t(i);
+            std::uint32_t s = source(h);
+            std::uint32_t t = target(h);
+            std::uint32_t match = INVALID;
+            size_t cnt = 0;
+            for (std::uint32_t f : vertexFaces(t)) {
+                for (std::uint32_t o = 3 * f; o < 3 * f + 3; ++o) {
+                    if ((m_faces[o] == t) && (target(o) == s)) {
+                        match = o;
+                        ++cnt;
+                    }
+                }
+            }
+            // Faces with the same orientation along the edge also make it non-manifold
+            if (cnt == 1) {
+                for (std::uint32_t f : vertexFaces(s)) {
+                    if (f == halfEdgeFace(h)) continue;
+                    for (std::uint32_t o = 3 * f; o < 3 * f + 3; ++o) {
+                        if ((m_faces[o] == s) && (target(o) == t)) cnt = 0;
+                    }
+                }
+            }
+            m_twin[i] = (cnt == 1) ? match : INVALID;
+        }
+    });
+}
@@ -0,0 +1,160 @@
+#include "programbuilder.h"
+#include "tracelog.h"
+
+#include <iostream>
+#include <thread>
+#include <algorithm>
+#include <string.h>
+
+/**
+ * @brief ProgramBuilder::ProgramBuilder
+ * Asks the driver to use as many compiler threads as it likes, if it supports GL_KHR_parallel_shader_compile or the
+ * ARB version. The tokens are the same, but each has its own entry point, and a driver may only expose the ARB one.
+ */
+ProgramBuilder::ProgramBuilder() {
+    m_start = std::chrono::high_resolution_clock::now();
+    m_driver = ProgramCache::driverString();
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &m_numFormats);
+
+    bool hasKHR = false, hasARB = false;
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (GLint i = 0; i < numExtensions; ++i) {
+        const char *ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+        if (ext == nullptr) continue;
+        if (strcmp(ext, "GL_KHR_parallel_shader_compile") == 0) hasKHR = true;
+        if (strcmp(ext, "GL_ARB_parallel_shader_compile") == 0) hasARB = true;
+    }
+    if (hasKHR) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    } else if (hasARB) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+    m_isParallel = hasKHR || hasARB;
+}
+
+/**
+ * @brief ProgramBuilder::elapsed
+ * @return The time in ms since the builder was created
+ */
+double ProgramBuilder::elapsed() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_start).count();
+}
+
+/**
+ * @brief ProgramBuilder::add
+ * @param name The name of the program, which is used to name its cache and look it up
+ * @param stages The stages of the program
+ * @return The index of the program
+ */
+size_t ProgramBuilder::add(const std::string &name, std::initializer_list<ProgramCache::Stage> stages) {
+    TraceScope trace("ProgramBuilder::add");
+    Job job;
+    job.m_name = name;
+    job.m_stages = stages;
+    job.m_queuedTime = elapsed();
+
+    std::vector<std::string> sources;
+    if (job.m_stages.empty() || !ProgramCache::readSources(job.m_stages, sources, job.m_sourceHash)) {
+        // There is nothing to build, so it is finished (and failed) already
+        job.m_isDone = true;
+        job.m_readyTime = job.m_queuedTime;
+        m_jobs.push_back(job);
+        return m_jobs.size() - 1;
+    }
+
+    // Loading a cached binary doesn't need the compiler, so it is ready as soon as it is loaded
+    job.m_cacheName = ProgramCache::cacheFileName(name, job.m_stages.front().m_fileName);
+    if (m_numFormats > 0) job.m_program = ProgramCache::load(job.m_cacheName, job.m_sourceHash, m_driver);
+    if (job.m_program != 0) {
+        job.m_isCached = true;
+        job.m_isDone = true;
+        job.m_readyTime = elapsed();
+    } else {
+        job.m_program = ProgramCache::beginCompile(job.m_stages, sources, job.m_shaders);
+    }
+    m_jobs.push_back(job);
+    return m_jobs.size() - 1;
+}
+
+/**
+ * @brief ProgramBuilder::poll
+ * Checks the completion status of each unfinished program, and finishes the ones which are ready: reporting any
+ * errors, deleting the shaders and writing the cache. Without parallel compilation every program is finished,
+ * blocking until each is linked.
+ * @return true if every program is finished
+ */
+bool ProgramBuilder::poll() {
+    bool isDone = true;
+    for (Job &job : m_jobs) {
+        if (job.m_isDone) continue;
+        if (m_isParallel) {
+            GLint complete = GL_FALSE;
+            glGetProgramiv(job.m_program, GL_COMPLETION_STATUS_KHR, &complete);
+            if (complete != GL_TRUE) {
+                isDone = false;
+                continue;
+            }
+        }
+        job.m_readyTime = elapsed();
+        if (!ProgramCache::endCompile(job.m_name, job.m_program, job.m_stages, job.m_shaders)) {
+            job.m_program = 0;
+        } else if (m_numFormats > 0) {
+            ProgramCache::write(job.m_program, job.m_cacheName, job.m_sourceHash, m_driver);
+        }
+        job.m_shaders.clear();
+        job.m_isDone = true;
+    }
+    return isDone;
+}
+
+/**
+ * @brief ProgramBuilder::finish
+ */
+void ProgramBuilder::finish() {
+    TraceScope trace("ProgramBuilder::finish");
+    while (!poll()) {
+        std::this_thread::yield();
+    }
+    report();
+}
+
+/**
+ * @brief ProgramBuilder::program
+ * @param index The index returned by add()
+ * @return The program, or 0 if it isn't finished or failed to build
+ */
+GLuint ProgramBuilder::program(size_t index) const {
+    if ((index >= m_jobs.size()) || !m_jobs[index].m_isDone) return 0;
+    return m_jobs[index].m_program;
+}
+
+/**
+ * @brief ProgramBuilder::program
+ * @param name The name given to add()
+ * @return The program, or 0 if there isn't one of that name, it isn't finished or it failed to build
+ */
+GLuint ProgramBuilder::program(const std::string &name) const {
+    for (size_t i = 0; i < m_jobs.size(); ++i) {
+        if (m_jobs[i].m_name == name) return program(i);
+    }
+    return 0;
+}
+
+/**
+ * @brief ProgramBuilder::report
+ * The time of each program is measured from when it was queued until poll() found it was finished, so with parallel
+ * compilation the times overlap and the total is less than their sum.
+ */
+void ProgramBuilder::report() const {
+    double total = 0.0;
+    for (const Job &job : m_jobs) {
+        if (!job.m_isDone) continue;
+        std::cout << "ProgramBuilder: " << job.m_name << " "
+                  << ((job.m_program == 0) ? "failed" : (job.m_isCached ? "loaded from cache" : "compiled"))
+                  << " in " << (job.m_readyTime - job.m_queuedTime) << " ms\n";
+        total = std::max(total, job.m_readyTime);
+    }
+    std::cout << "ProgramBuilder: " << m_jobs.size() << " programs ready after " << total << " ms"
+              << (m_isParallel ? " (parallel compilation enabled)\n" : "\n");
+}
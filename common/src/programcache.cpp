@@ -0,0 +1,276 @@
+#include "programcache.h"
+#include "tracelog.h"
+#include "fnv1a.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <string.h>
+
+/// Increment this if the Header or the data layout changes, or to force the caches to be rebuilt
+static const std::uint32_t PROGRAMCACHE_VERSION = 1;
+
+/**
+ * @brief ProgramCache::cacheFileName
+ * @param name The name of the program
+ * @param firstStage The source file of the first stage of the program
+ * @return The cache file name, e.g. "shaders/SDFProgram.programcache"
+ */
+std::string ProgramCache::cacheFileName(const std::string &name, const std::string &firstStage) {
+    const size_t slash = firstStage.find_last_of("/\\");
+    const std::string dir = (slash == std::string::npos) ? std::string() : firstStage.substr(0, slash + 1);
+    return dir + name + ".programcache";
+}
+
+/**
+ * @brief ProgramCache::driverString
+ * @return The vendor, renderer and version of the current context separated by newlines
+ */
+std::string ProgramCache::driverString() {
+    std::string driver;
+    const GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (GLenum name : names) {
+        const GLubyte *str = glGetString(name);
+        if (str != nullptr) driver += reinterpret_cast<const char*>(str);
+        driver += "\n";
+    }
+    return driver;
+}
+
+/**
+ * @brief ProgramCache::build
+ * Loads the program from its cache if the sources and the driver haven't changed, and otherwise compiles it from
+ * source and writes a new cache. Reports how long this took, so that cold and warm start up can be compared.
+ * @param name The name of the program, which is used to name its cache
+ * @param stages The stages of the program
+ * @return The linked program, or 0 if it couldn't be built
+ */
+GLuint ProgramCache::build(const std::string &name, std::initializer_list<Stage> stages) {
+    TraceScope trace("ProgramCache::build");
+    auto start = std::chrono::high_resolution_clock::now();
+    const std::vector<Stage> stageList(stages);
+    std::vector<std::string> sources;
+    std::uint64_t sourceHash;
+    if (stageList.empty() || !readSources(stageList, sources, sourceHash)) return 0;
+
+    // Some drivers support the API but don't have any binary formats, in which case there's nothing to cache
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    const std::string cacheName = cacheFileName(name, stageList.front().m_fileName);
+    const std::string driver = driverString();
+
+    const char *how = "loaded from cache";
+    GLuint program = (numFormats > 0) ? load(cacheName, sourceHash, driver) : 0;
+    if (program == 0) {
+        how = "compiled";
+        std::vector<GLuint> shaders;
+        program = beginCompile(stageList, sources, shaders);
+        if (!endCompile(name, program, stageList, shaders)) {
+            program = 0;
+        } else if (numFormats > 0) {
+            write(program, cacheName, sourceHash, driver);
+        }
+    }
+
+    if (program != 0) {
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << "ProgramCache::build() - " << name << " " << how << " in "
+                  << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+    }
+    return program;
+}
+
+/**
+ * @brief ProgramCache::readSources
+ * @param stages The stages of the program
+ * @param sources The source of each stage
+ * @param sourceHash The hash of the type and source of every stage
+ * @return false if any of the files couldn't be read
+ */
+bool ProgramCache::readSources(const std::vector<Stage> &stages,
+                               std::vector<std::string> &sources,
+                               std::uint64_t &sourceHash) {
+    sources.clear();
+    sourceHash = FNV1A_OFFSET_BASIS;
+    for (const Stage &stage : stages) {
+        std::ifstream file(stage.m_fileName.c_str(), std::ios::binary);
+        if (!file.good()) {
+            std::cerr << "ProgramCache::readSources() - could not open " << stage.m_fileName << "\n";
+            return false;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        sources.push_back(buffer.str());
+
+        const std::uint32_t type = stage.m_type;
+        sourceHash = fnv1a(&type, sizeof(type), sourceHash);
+        sourceHash = fnv1a(sources.back().data(), sources.back().size(), sourceHash);
+    }
+    return true;
+}
+
+/**
+ * @brief ProgramCache::load
+ * @param cacheName The cache file
+ * @param sourceHash The hash of the current sources
+ * @param driver The current driver string
+ * @return The program created from the binary, or 0 if it couldn't be used
+ */
+GLuint ProgramCache::load(const std::string &cacheName, std::uint64_t sourceHash, const std::string &driver) {
+    std::ifstream file(cacheName.c_str(), std::ios::binary);
+    if (!file.good()) return 0;
+
+    Header header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(Header))) return 0;
+    bool valid = (strncmp(header.m_magic, "NCPB", 4) == 0) &&
+                 (header.m_version == PROGRAMCACHE_VERSION) &&
+                 (header.m_sourceHash == sourceHash) &&
+                 (header.m_driverLength == driver.size());
+
+    // The driver string is stored in full rather than hashed, so it can be read when investigating a stale cache
+    std::string cachedDriver(header.m_driverLength, '\0');
+    std::vector<char> binary;
+    if (valid) {
+        valid = file.read(&cachedDriver[0], std::streamsize(cachedDriver.size())) && (cachedDriver == driver);
+    }
+    if (valid) {
+        binary.resize(size_t(header.m_binaryLength));
+        valid = !binary.empty() && file.read(binary.data(), std::streamsize(binary.size()));
+    }
+    if (!valid) {
+        std::cerr << "ProgramCache::load() - " << cacheName << " is stale and will be rebuilt\n";
+        return 0;
+    }
+
+    // The driver can still reject a binary it produced, in which case the link status is false
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.m_binaryFormat, binary.data(), GLsizei(binary.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        std::cerr << "ProgramCache::load() - the driver rejected " << cacheName << ", which will be rebuilt\n";
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+/**
+ * @brief ProgramCache::beginCompile
+ * Hands every stage to the compiler and links the program straight away. When the driver compiles in the background
+ * (see ProgramBuilder) none of these calls wait, and the errors are only read back in endCompile().
+ * @param stages The stages of the program
+ * @param sources The source of each stage
+ * @param shaders The shader objects attached to the program
+ * @return The program
+ */
+GLuint ProgramCache::beginCompile(const std::vector<Stage> &stages,
+                                  const std::vector<std::string> &sources,
+                                  std::vector<GLuint> &shaders) {
+    GLuint program = glCreateProgram();
+    shaders.clear();
+    for (size_t i = 0; i < stages.size(); ++i) {
+        GLuint shader = glCreateShader(stages[i].m_type);
+        const GLchar *source = sources[i].c_str();
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+        shaders.push_back(shader);
+    }
+
+    // Ask the driver to keep the binary around so that it can be written to the cache
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    return program;
+}
+
+/**
+ * @brief ProgramCache::endCompile
+ * @param name The name of the program, used in error messages
+ * @param program The program returned by beginCompile()
+ * @param stages The stages of the program
+ * @param shaders The shaders returned by beginCompile()
+ * @return true if the program linked successfully
+ */
+bool ProgramCache::endCompile(const std::string &name,
+                              GLuint program,
+                              const std::vector<Stage> &stages,
+                              const std::vector<GLuint> &shaders) {
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        // Report the stages which failed to compile, as they are the usual reason the link failed
+        for (size_t i = 0; i < shaders.size(); ++i) {
+            GLint compiled = GL_FALSE;
+            glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compiled);
+            if (compiled == GL_TRUE) continue;
+            GLint length = 0;
+            glGetShaderiv(shaders[i], GL_INFO_LOG_LENGTH, &length);
+            std::vector<GLchar> log(size_t(length) + 1, '\0');
+            glGetShaderInfoLog(shaders[i], GLsizei(log.size()), nullptr, log.data());
+            std::cerr << "ProgramCache::endCompile() - " << stages[i].m_fileName << " failed to compile:\n" << log.data() << "\n";
+        }
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::vector<GLchar> log(size_t(length) + 1, '\0');
+        glGetProgramInfoLog(program, GLsizei(log.size()), nullptr, log.data());
+        std::cerr << "ProgramCache::endCompile() - " << name << " failed to link:\n" << log.data() << "\n";
+    }
+
+    // The shaders aren't needed once the program is linked
+    for (GLuint shader : shaders) {
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
+    }
+    if (linked != GL_TRUE) {
+        glDeleteProgram(program);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief ProgramCache::write
+ * @param program The linked program
+ * @param cacheName The cache file
+ * @param sourceHash The hash of the sources the program was built from
+ * @param driver The driver string
+ * @return true if the cache was written successfully
+ */
+bool ProgramCache::write(GLuint program, const std::string &cacheName, std::uint64_t sourceHash, const std::string &driver) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return false;
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    memcpy(header.m_magic, "NCPB", 4);
+    header.m_version = PROGRAMCACHE_VERSION;
+    header.m_sourceHash = sourceHash;
+    header.m_binaryFormat = format;
+    header.m_driverLength = std::uint32_t(driver.size());
+    header.m_binaryLength = std::uint64_t(length);
+
+    // Write to a temporary file first so that a partially written cache is never loaded
+    std::string tmpName = cacheName + ".tmp";
+    std::ofstream file(tmpName.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file.good()) {
+        std::cerr << "ProgramCache::write() - could not open " << tmpName << " for writing\n";
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    file.write(driver.data(), std::streamsize(driver.size()));
+    file.write(binary.data(), std::streamsize(length));
+    file.close();
+    if (!file.good() || (rename(tmpName.c_str(), cacheName.c_str()) != 0)) {
+        std::cerr << "ProgramCache::write() - failed to write " << cacheName << "\n";
+        remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
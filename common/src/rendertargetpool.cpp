@@ -0,0 +1,133 @@
+#include "rendertargetpool.h"
+
+#include <iostream>
+
+/**
+ * @brief RenderTargetPool::Target::bind
+ */
+void RenderTargetPool::Target::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_width, m_height);
+}
+
+/**
+ * @brief RenderTargetPool::beginFrame
+ * A target still acquired from the last frame is kept however long ago that was, as something is using it.
+ */
+void RenderTargetPool::beginFrame() {
+    ++m_frame;
+    for (size_t i = 0; i < m_targets.size(); ) {
+        Target &target = *m_targets[i];
+        if (!target.m_isInUse && (m_frame - target.m_lastUsed > MAX_IDLE_FRAMES)) {
+            destroy(target);
+            m_targets[i] = std::move(m_targets.back());
+            m_targets.pop_back();
+        } else {
+            ++i;
+        }
+    }
+}
+
+/**
+ * @brief RenderTargetPool::acquire
+ * Only a target with textures in the same bucket is reused, so that a small pass never ties up a large target.
+ * @param width The width to draw at
+ * @param height The height to draw at
+ * @param format The attachments
+ * @return The target, which belongs to the pool and stays valid until it is released and then left idle
+ */
+RenderTargetPool::Target *RenderTargetPool::acquire(GLsizei width, GLsizei height, const Format &format) {
+    const GLsizei textureWidth = bucket(width), textureHeight = bucket(height);
+    Target *found = nullptr;
+    for (std::unique_ptr<Target> &target : m_targets) {
+        if (!target->m_isInUse && (target->m_textureWidth == textureWidth) &&
+            (target->m_textureHeight == textureHeight) && (target->m_format == format)) {
+            found = target.get();
+            break;
+        }
+    }
+    if (found == nullptr) {
+        m_targets.emplace_back(new Target);
+        found = m_targets.back().get();
+        found->m_textureWidth = textureWidth;
+        found->m_textureHeight = textureHeight;
+        found->m_format = format;
+        create(*found);
+    }
+    found->m_width = std::max(width, GLsizei(1));
+    found->m_height = std::max(height, GLsizei(1));
+    found->m_lastUsed = m_frame;
+    found->m_isInUse = true;
+    return found;
+}
+
+/**
+ * @brief RenderTargetPool::release
+ * @param target A target from acquire(), or nullptr
+ */
+void RenderTargetPool::release(Target *target) {
+    if (target != nullptr) target->m_isInUse = false;
+}
+
+/**
+ * @brief RenderTargetPool::clear
+ */
+void RenderTargetPool::clear() {
+    for (std::unique_ptr<Target> &target : m_targets) destroy(*target);
+    m_targets.clear();
+}
+
+/**
+ * @brief RenderTargetPool::create
+ * The textures have immutable storage, and clamp to their edges so that blurs don't wrap around. Array textures are
+ * attached with all their layers, so each primitive goes to the layer its geometry shader picks.
+ * @param target The target, with its texture size and format filled in
+ */
+void RenderTargetPool::create(Target &target) {
+    glGenFramebuffers(1, &target.m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.m_fbo);
+
+    GLuint *textures[2] = {&target.m_colour, &target.m_depth};
+    const GLenum formats[2] = {target.m_format.m_colour, target.m_format.m_depth};
+    const GLenum attachments[2] = {GL_COLOR_ATTACHMENT0, GL_DEPTH_ATTACHMENT};
+    const GLenum textureTarget = target.m_format.textureTarget();
+    for (int i = 0; i < 2; ++i) {
+        if (formats[i] == GL_NONE) continue;
+        glGenTextures(1, textures[i]);
+        glBindTexture(textureTarget, *textures[i]);
+        if (textureTarget == GL_TEXTURE_2D_ARRAY) {
+            glTexStorage3D(textureTarget, 1, formats[i], target.m_textureWidth, target.m_textureHeight,
+                           target.m_format.m_layers);
+        } else {
+            glTexStorage2D(textureTarget, 1, formats[i], target.m_textureWidth, target.m_textureHeight);
+        }
+        glTexParameteri(textureTarget, GL_TEXTURE_MIN_FILTER, GLint(target.m_format.m_filter));
+        glTexParameteri(textureTarget, GL_TEXTURE_MAG_FILTER, GLint(target.m_format.m_filter));
+        glTexParameteri(textureTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(textureTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture(GL_FRAMEBUFFER, attachments[i], *textures[i], 0);
+    }
+    glBindTexture(textureTarget, 0);
+
+    // A depth only target has no colour to write
+    GLenum drawBuffer = (target.m_colour != 0) ? GL_COLOR_ATTACHMENT0 : GL_NONE;
+    glDrawBuffers(1, &drawBuffer);
+    glReadBuffer(drawBuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "RenderTargetPool::create() - the " << target.m_textureWidth << "x" << target.m_textureHeight
+                  << " framebuffer is incomplete\n";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/**
+ * @brief RenderTargetPool::destroy
+ * @param target The target to delete
+ */
+void RenderTargetPool::destroy(Target &target) {
+    if (target.m_colour != 0) glDeleteTextures(1, &target.m_colour);
+    if (target.m_depth != 0) glDeleteTextures(1, &target.m_depth);
+    glDeleteFramebuffers(1, &target.m_fbo);
+    target.m_fbo = target.m_colour = target.m_depth = 0;
+}
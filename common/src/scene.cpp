@@ -1,7 +1,9 @@
 #include "scene.h"
+#include "tracelog.h"
 
 // Needed for memset
 #include <string.h>
+#include <algorithm>
 #include <GL/glu.h>
 
 Scene::Scene() : m_width(1), m_height(1), m_ratio(1.0f) {
@@ -19,6 +21,17 @@ GLvoid Scene::resizeGL(GLint width, GLint height) noexcept {
     m_ratio = m_width / (float) m_height;
 }
 
+/**
+ * @brief Scene::elapsedTime
+ * @param start When the animation started
+ * @return The time in seconds to give the shaders
+ */
+double Scene::elapsedTime(const std::chrono::high_resolution_clock::time_point &start) const {
+    if (m_fixedTime >= 0.0) return m_fixedTime;
+    auto now = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() * 0.001;
+}
+
 /**
  * @brief Scene::CheckError retrieves the last GL error from the log
  * @param label: An arbitrary string used to identify what command you're checking
@@ -114,6 +127,274 @@ GLvoid Scene::CheckProgram(GLuint id, const char *name) noexcept {
     }
 }
 
+/**
+ * @brief Scene::initUniformBlocks
+ * The ring holds UNIFORM_RING_FRAMES frames, each a frame block followed by maxObjects object blocks. It is mapped
+ * once for good, so writing a block is a plain copy, and each draw selects its block with glBindBufferRange() rather
+ * than making several glUniform*() calls. Persistent mapping needs GL 4.4, so older contexts write each block with
+ * glBufferSubData() into an ordinary buffer instead, which is slower but draws the same.
+ * @param maxObjects The largest number of object blocks written in one frame
+ */
+void Scene::initUniformBlocks(size_t maxObjects) {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    m_isUniformPersistent = (major > 4) || ((major == 4) && (minor >= 4));
+
+    // Release any previous ring once the GPU has stopped reading it
+    if (m_uniformBuffer != 0) {
+        for (GLsync &fence : m_uniformFences) {
+            if (fence == nullptr) continue;
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (m_uniformData != nullptr) {
+            glBindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &m_uniformBuffer);
+    }
+
+    // Each block must start on a multiple of the offset alignment
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    auto align = [alignment](GLsizeiptr size) {return ((size + alignment - 1) / alignment) * alignment;};
+    m_frameBlockStride = align(sizeof(FrameBlock));
+    m_objectBlockStride = align(sizeof(ObjectBlock));
+    allocateUniformBlocks(maxObjects);
+}
+
+/**
+ * @brief Scene::allocateUniformBlocks
+ * @param maxObjects The largest number of object blocks written in one frame
+ */
+void Scene::allocateUniformBlocks(size_t maxObjects) {
+    m_uniformFrameSize = m_frameBlockStride + m_objectBlockStride * GLsizeiptr(maxObjects);
+    m_maxObjects = maxObjects;
+
+    const GLsizeiptr size = m_uniformFrameSize * GLsizeiptr(UNIFORM_RING_FRAMES);
+    glGenBuffers(1, &m_uniformBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffer);
+    if (m_isUniformPersistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+        m_uniformData = static_cast<GLubyte*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+    } else {
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        m_uniformData = nullptr;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/**
+ * @brief Scene::growUniformBlocks
+ * The blocks written so far this frame may not have been drawn yet, so they are copied into the new ring on the GPU
+ * and the frame block is bound again. The old buffer is only freed by GL once the draws already using it are done.
+ */
+void Scene::growUniformBlocks() {
+    const GLuint oldBuffer = m_uniformBuffer;
+    const GLintptr oldOffset = m_uniformFrameSize * GLintptr(m_uniformFrame);
+    const GLsizeiptr used = m_frameBlockStride + m_objectBlockStride * GLsizeiptr(m_numObjectBlocks);
+    if (m_uniformData != nullptr) {
+        glBindBuffer(GL_UNIFORM_BUFFER, oldBuffer);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+
+    // The fences guarded the old buffer, and nothing has read the new one yet
+    for (GLsync &fence : m_uniformFences) {
+        if (fence != nullptr) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    allocateUniformBlocks(std::max(m_maxObjects * 2, size_t(1)));
+
+    const GLintptr offset = m_uniformFrameSize * GLintptr(m_uniformFrame);
+    glBindBuffer(GL_COPY_READ_BUFFER, oldBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_uniformBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, oldOffset, offset, used);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &oldBuffer);
+    glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, m_uniformBuffer, offset, sizeof(FrameBlock));
+}
+
+/**
+ * @brief Scene::writeUniformBlock
+ * @param offset The byte offset of the block in the ring
+ * @param block The data of the block
+ * @param size The size of the block in bytes
+ */
+void Scene::writeUniformBlock(GLintptr offset, const void *block, GLsizeiptr size) {
+    if (m_uniformData != nullptr) {
+        memcpy(m_uniformData + offset, block, size_t(size));
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, size, block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+}
+
+/**
+ * @brief Scene::beginUniformBlocks
+ * @param frame The per-frame uniforms
+ */
+void Scene::beginUniformBlocks(const FrameBlock &frame) {
+    m_uniformFrame = (m_uniformFrame + 1) % UNIFORM_RING_FRAMES;
+    m_numObjectBlocks = 0;
+
+    // Normally the GPU finished with this part of the ring a couple of frames ago, so this doesn't wait
+    GLsync &fence = m_uniformFences[m_uniformFrame];
+    if (fence != nullptr) {
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    GLintptr offset = m_uniformFrameSize * GLintptr(m_uniformFrame);
+    writeUniformBlock(offset, &frame, sizeof(FrameBlock));
+    glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, m_uniformBuffer, offset, sizeof(FrameBlock));
+}
+
+/**
+ * @brief Scene::pushObjectBlock
+ * @param object The uniforms of one draw
+ * @return The slot of the block in this frame
+ */
+GLuint Scene::pushObjectBlock(const ObjectBlock &object) {
+    if (m_numObjectBlocks == m_maxObjects) growUniformBlocks();
+    GLuint slot = GLuint(m_numObjectBlocks++);
+    GLintptr offset = m_uniformFrameSize * GLintptr(m_uniformFrame) + m_frameBlockStride + m_objectBlockStride * slot;
+    writeUniformBlock(offset, &object, sizeof(ObjectBlock));
+    return slot;
+}
+
+/**
+ * @brief Scene::bindObjectBlock
+ * @param slot A slot returned by pushObjectBlock() this frame
+ */
+void Scene::bindObjectBlock(GLuint slot) const {
+    GLintptr offset = m_uniformFrameSize * GLintptr(m_uniformFrame) + m_frameBlockStride + m_objectBlockStride * slot;
+    glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, m_uniformBuffer, offset, sizeof(ObjectBlock));
+}
+
+/**
+ * @brief Scene::endUniformBlocks
+ */
+void Scene::endUniformBlocks() {
+    // glBufferSubData() is ordered by the driver, so only the mapped ring needs fencing
+    if (m_uniformData != nullptr) m_uniformFences[m_uniformFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/**
+ * @brief Scene::timeFrame
+ * The interval between frames includes everything the GPU does, as long as the buffer swap waits for it.
+ * @param name The name of the scene, to start the report with
+ * @param description What was drawn
+ */
+void Scene::timeFrame(const char *name, const std::string &description) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (m_numTimedFrames >= 0) {
+        m_totalFrameTime += std::chrono::duration<double, std::milli>(now - m_lastFrameTime).count();
+    }
+    m_lastFrameTime = now;
+
+    if (++m_numTimedFrames == FRAME_REPORT_INTERVAL) {
+        std::cout << name << ": " << description << ", " << m_totalFrameTime / double(m_numTimedFrames)
+                  << "ms per frame\n";
+        m_totalFrameTime = 0.0;
+        m_numTimedFrames = 0;
+    }
+}
+
+/**
+ * @brief Scene::beginProfileFrame
+ * The queries of a frame are only read back PROFILE_RING_FRAMES frames later, when they are almost certainly
+ * available, so the CPU never waits for the GPU. Any which still aren't are dropped rather than waited for.
+ * @param name The name of the scene, to start the report with
+ */
+void Scene::beginProfileFrame(const char *name) {
+    if (m_profileQueries[0][0] == 0) {
+        // The first frame isn't timed, as it includes the driver's lazy set up (and Mesa gives its first query a
+        // bogus result)
+        glGenQueries(GLsizei(PROFILE_RING_FRAMES * PROFILE_MAX_PASSES), &m_profileQueries[0][0]);
+        return;
+    }
+    m_isProfiling = true;
+    if (m_isPassOpen) endPass();
+    m_profileFrame = (m_profileFrame + 1) % PROFILE_RING_FRAMES;
+
+    ProfileFrame &frame = m_profileFrames[m_profileFrame];
+    if (frame.m_numPasses == 0) return;
+    for (size_t i = 0; i < frame.m_numPasses; ++i) {
+        GLint isAvailable = GL_FALSE;
+        glGetQueryObjectiv(m_profileQueries[m_profileFrame][i], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+        if (isAvailable != GL_TRUE) continue;
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(m_profileQueries[m_profileFrame][i], GL_QUERY_RESULT, &elapsed);
+        const double gpuTime = double(elapsed) * 1e-6;
+
+        auto total = m_passTotals.begin();
+        while ((total != m_passTotals.end()) && (total->m_name != frame.m_names[i])) ++total;
+        if (total == m_passTotals.end()) {
+            m_passTotals.push_back(PassTotal());
+            total = m_passTotals.end() - 1;
+            total->m_name = frame.m_names[i];
+        }
+        total->m_cpuTime += frame.m_cpuTime[i];
+        total->m_gpuTime += gpuTime;
+        ++total->m_count;
+
+        TraceLog::gpu(frame.m_names[i], frame.m_cpuStart[i], gpuTime * 1000.0);
+    }
+    frame.m_numPasses = 0;
+
+    if (++m_numProfiledFrames == FRAME_REPORT_INTERVAL) {
+        std::cout << name << " passes:";
+        for (PassTotal &total : m_passTotals) {
+            if (total.m_count == 0) continue;
+            std::cout << " " << total.m_name << " " << total.m_gpuTime / double(total.m_count) << "ms GPU "
+                      << total.m_cpuTime / double(total.m_count) << "ms CPU,";
+            total.m_cpuTime = total.m_gpuTime = 0.0;
+            total.m_count = 0;
+        }
+        std::cout << " averaged over " << m_numProfiledFrames << " frames\n";
+        m_numProfiledFrames = 0;
+    }
+}
+
+/**
+ * @brief Scene::beginPass
+ * @param name The name of the pass, which must outlive the scene (a string literal)
+ */
+void Scene::beginPass(const char *name) {
+    ProfileFrame &frame = m_profileFrames[m_profileFrame];
+    if (!m_isProfiling) return;
+    if (m_isPassOpen || (frame.m_numPasses == PROFILE_MAX_PASSES)) {
+        std::cerr << "Scene::beginPass() - can't time " << name << " inside another pass or after "
+                  << PROFILE_MAX_PASSES << " passes\n";
+        return;
+    }
+    m_isPassOpen = true;
+    TraceLog::begin(name);
+    frame.m_names[frame.m_numPasses] = name;
+    frame.m_cpuStart[frame.m_numPasses] = TraceLog::now();
+    glBeginQuery(GL_TIME_ELAPSED, m_profileQueries[m_profileFrame][frame.m_numPasses]);
+}
+
+/**
+ * @brief Scene::endPass
+ */
+void Scene::endPass() {
+    if (!m_isPassOpen) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    ProfileFrame &frame = m_profileFrames[m_profileFrame];
+    frame.m_cpuTime[frame.m_numPasses] = (TraceLog::now() - frame.m_cpuStart[frame.m_numPasses]) * 0.001;
+    TraceLog::end(frame.m_names[frame.m_numPasses]);
+    ++frame.m_numPasses;
+    m_isPassOpen = false;
+}
+
 /**
  * @brief DofScene::hsv2rgb
  * @param rgb
@@ -0,0 +1,158 @@
+#include "shaderprogram.h"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <ngl/ShaderLib.h>
+#include <iostream>
+
+/**
+ * @brief ShaderProgram::init
+ * Reads the names and locations of all the active uniforms, and the subroutine functions and uniform locations
+ * of every stage which has them.
+ * @param programId The linked program
+ */
+void ShaderProgram::init(GLuint programId) {
+    m_id = programId;
+    m_locations.clear();
+    m_stages.clear();
+
+    GLint numUniforms = 0, maxLength = 0;
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &numUniforms);
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<GLchar> name(size_t(maxLength) + 1);
+    for (GLint i = 0; i < numUniforms; ++i) {
+        GLint size;
+        GLenum type;
+        GLsizei length;
+        glGetActiveUniform(m_id, GLuint(i), GLsizei(name.size()), &length, &size, &type, name.data());
+        std::string uniformName(name.data(), size_t(length));
+        GLint location = glGetUniformLocation(m_id, uniformName.c_str());
+        if (location == -1) continue; // in a uniform block
+
+        // Arrays are listed once as "name[0]", so add the plain name and the locations of the other elements
+        m_locations[uniformName] = location;
+        const size_t bracket = uniformName.rfind("[0]");
+        if ((bracket != std::string::npos) && (bracket + 3 == uniformName.size())) {
+            std::string base = uniformName.substr(0, bracket);
+            m_locations[base] = location;
+            for (GLint j = 1; j < size; ++j) {
+                std::string element = base + "[" + std::to_string(j) + "]";
+                m_locations[element] = glGetUniformLocation(m_id, element.c_str());
+            }
+        }
+    }
+
+    const GLenum stages[] = {GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER,
+                             GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER, GL_COMPUTE_SHADER};
+    for (GLenum stage : stages) {
+        // Only query the stages which have subroutines, as some drivers raise GL_INVALID_OPERATION for the others
+        GLint numSubroutines = 0, numLocations = 0;
+        glGetProgramStageiv(m_id, stage, GL_ACTIVE_SUBROUTINES, &numSubroutines);
+        if (numSubroutines == 0) continue;
+        glGetProgramStageiv(m_id, stage, GL_ACTIVE_SUBROUTINE_UNIFORM_LOCATIONS, &numLocations);
+
+        GLint maxNameLength = 0;
+        glGetProgramStageiv(m_id, stage, GL_ACTIVE_SUBROUTINE_MAX_LENGTH, &maxNameLength);
+        std::vector<GLchar> subroutineName(size_t(maxNameLength) + 1);
+        Stage s;
+        s.m_stage = stage;
+        s.m_numUniformLocations = numLocations;
+        for (GLint i = 0; i < numSubroutines; ++i) {
+            GLsizei length;
+            glGetActiveSubroutineName(m_id, stage, GLuint(i), GLsizei(subroutineName.size()), &length, subroutineName.data());
+            s.m_subroutines[std::string(subroutineName.data(), size_t(length))] = GLuint(i);
+        }
+        m_stages.push_back(s);
+    }
+}
+
+/**
+ * @brief ShaderProgram::init
+ * @param name The name the program was given in ngl::ShaderLib
+ */
+void ShaderProgram::init(const std::string &name) {
+    init(GLuint(ngl::ShaderLib::instance()->getProgramID(name)));
+}
+
+/**
+ * @brief ShaderProgram::location
+ * @param name The name of the uniform
+ * @return The location, or -1 if the program has no active uniform of that name
+ */
+GLint ShaderProgram::location(const std::string &name) const {
+    std::unordered_map<std::string, GLint>::const_iterator it = m_locations.find(name);
+    return (it == m_locations.end()) ? -1 : it->second;
+}
+
+/**
+ * @brief ShaderProgram::subroutineIndex
+ * @param stage The shader stage, e.g. GL_FRAGMENT_SHADER
+ * @param name The name of the subroutine function
+ * @return The index of the function, or GL_INVALID_INDEX if it doesn't exist
+ */
+GLuint ShaderProgram::subroutineIndex(GLenum stage, const std::string &name) const {
+    for (const Stage &s : m_stages) {
+        if (s.m_stage != stage) continue;
+        std::unordered_map<std::string, GLuint>::const_iterator it = s.m_subroutines.find(name);
+        if (it != s.m_subroutines.end()) return it->second;
+    }
+    std::cerr << "ShaderProgram::subroutineIndex() - no subroutine called " << name << "\n";
+    return GL_INVALID_INDEX;
+}
+
+/**
+ * @brief ShaderProgram::setSubroutines
+ * @param stage The shader stage, e.g. GL_FRAGMENT_SHADER
+ * @param indices The subroutine index for each subroutine uniform location of the stage
+ */
+void ShaderProgram::setSubroutines(GLenum stage, const GLuint *indices) const {
+    for (const Stage &s : m_stages) {
+        if (s.m_stage == stage) {
+            glUniformSubroutinesuiv(stage, s.m_numUniformLocations, indices);
+            return;
+        }
+    }
+}
+
+template<> void ShaderProgram::Uniform<bool>::set(const bool &value) const {
+    glUniform1i(m_location, value ? 1 : 0);
+}
+
+template<> void ShaderProgram::Uniform<GLint>::set(const GLint &value) const {
+    glUniform1i(m_location, value);
+}
+
+template<> void ShaderProgram::Uniform<GLuint>::set(const GLuint &value) const {
+    glUniform1ui(m_location, value);
+}
+
+template<> void ShaderProgram::Uniform<GLfloat>::set(const GLfloat &value) const {
+    glUniform1f(m_location, value);
+}
+
+template<> void ShaderProgram::Uniform<glm::vec2>::set(const glm::vec2 &value) const {
+    glUniform2fv(m_location, 1, glm::value_ptr(value));
+}
+
+template<> void ShaderProgram::Uniform<glm::vec3>::set(const glm::vec3 &value) const {
+    glUniform3fv(m_location, 1, glm::value_ptr(value));
+}
+
+template<> void ShaderProgram::Uniform<glm::vec4>::set(const glm::vec4 &value) const {
+    glUniform4fv(m_location, 1, glm::value_ptr(value));
+}
+
+template<> void ShaderProgram::Uniform<glm::mat3>::set(const glm::mat3 &value) const {
+    glUniformMatrix3fv(m_location, 1, false, glm::value_ptr(value));
+}
+
+template<> void ShaderProgram::Uniform<glm::mat4>::set(const glm::mat4 &value) const {
+    glUniformMatrix4fv(m_location, 1, false, glm::value_ptr(value));
+}
+
+template<> void ShaderProgram::Uniform<glm::mat3>::setTransposed(const glm::mat3 &value) const {
+    glUniformMatrix3fv(m_location, 1, true, glm::value_ptr(value));
+}
+
+template<> void ShaderProgram::Uniform<glm::mat4>::setTransposed(const glm::mat4 &value) const {
+    glUniformMatrix4fv(m_location, 1, true, glm::value_ptr(value));
+}
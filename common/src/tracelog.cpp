@@ -0,0 +1,205 @@
+#include "tracelog.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+namespace {
+/// A begin (B), end (E) or complete (X) event, with its times in us
+struct Event {
+    const char *m_name;
+    double m_time;
+    double m_duration;
+    char m_phase;
+};
+
+/// A block of events. Only the owning thread writes it, and it publishes each event by storing the new count.
+struct Chunk {
+    static constexpr size_t SIZE = 4096;
+    Event m_events[SIZE];
+    std::atomic<size_t> m_count{0};
+    std::atomic<Chunk*> m_next{nullptr};
+};
+
+/// The events of one thread (or of the GPU), a list of chunks which only grows
+struct Buffer {
+    /// Stop growing a buffer at around 16M events, rather than exhausting memory if recording is left on
+    static constexpr size_t MAX_CHUNKS = 4096;
+
+    int m_threadId = 0;
+    const char *m_threadName = nullptr;
+    Chunk *m_first = nullptr;
+    Chunk *m_last = nullptr;        //< Only used by the owning thread
+    size_t m_numChunks = 0;         //< Only used by the owning thread
+    std::atomic<size_t> m_numDropped{0};
+    std::atomic<Buffer*> m_next{nullptr};
+};
+
+/// When the program started, which is time 0 of the trace
+const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+std::atomic<bool> g_isEnabled{false};
+
+/// Every buffer, newest first. Buffers are pushed on with a compare and swap and never removed, as a thread may exit
+/// long before the trace is written.
+std::atomic<Buffer*> g_buffers{nullptr};
+std::atomic<int> g_numThreads{0};
+
+/// The buffer of the calling thread, made the first time it records an event
+thread_local Buffer *t_buffer = nullptr;
+
+/// The GPU track and the time its last span ended, both only touched by the GL thread
+Buffer *g_gpuBuffer = nullptr;
+double g_gpuEnd = 0.0;
+
+/// Make a buffer and add it to the list
+Buffer *newBuffer(const char *threadName) {
+    Buffer *buffer = new Buffer;
+    buffer->m_threadId = ++g_numThreads;
+    buffer->m_threadName = threadName;
+    buffer->m_first = buffer->m_last = new Chunk;
+    buffer->m_numChunks = 1;
+    Buffer *head = g_buffers.load(std::memory_order_relaxed);
+    do {
+        buffer->m_next.store(head, std::memory_order_relaxed);
+    } while (!g_buffers.compare_exchange_weak(head, buffer, std::memory_order_release, std::memory_order_relaxed));
+    return buffer;
+}
+
+/// Append an event to a buffer, which must belong to the calling thread
+void push(Buffer *buffer, const Event &event) {
+    Chunk *chunk = buffer->m_last;
+    size_t count = chunk->m_count.load(std::memory_order_relaxed);
+    if (count == Chunk::SIZE) {
+        if (buffer->m_numChunks == Buffer::MAX_CHUNKS) {
+            buffer->m_numDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Chunk *next = new Chunk;
+        chunk->m_next.store(next, std::memory_order_release);
+        buffer->m_last = chunk = next;
+        ++buffer->m_numChunks;
+        count = 0;
+    }
+    chunk->m_events[count] = event;
+    chunk->m_count.store(count + 1, std::memory_order_release);
+}
+}
+
+/**
+ * @brief TraceLog::start
+ */
+void TraceLog::start() {
+    if (t_buffer == nullptr) t_buffer = newBuffer("main");
+    if (g_gpuBuffer == nullptr) g_gpuBuffer = newBuffer("GPU");
+    g_isEnabled.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief TraceLog::stop
+ */
+void TraceLog::stop() {
+    g_isEnabled.store(false, std::memory_order_relaxed);
+}
+
+/**
+ * @brief TraceLog::isEnabled
+ * @return true if recording
+ */
+bool TraceLog::isEnabled() {
+    return g_isEnabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief TraceLog::now
+ * @return The time in us since the program started
+ */
+double TraceLog::now() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - g_epoch).count();
+}
+
+/**
+ * @brief TraceLog::begin
+ * @param name The name of the span (a string literal)
+ */
+void TraceLog::begin(const char *name) {
+    if (!isEnabled()) return;
+    if (t_buffer == nullptr) t_buffer = newBuffer(nullptr);
+    push(t_buffer, {name, now(), 0.0, 'B'});
+}
+
+/**
+ * @brief TraceLog::end
+ * A thread which has recorded anything can always end a span, so that spans begun before recording stopped are
+ * closed.
+ * @param name The name given to begin()
+ */
+void TraceLog::end(const char *name) {
+    if (t_buffer == nullptr) return;
+    push(t_buffer, {name, now(), 0.0, 'E'});
+}
+
+/**
+ * @brief TraceLog::gpu
+ * @param name The name of the span (a string literal)
+ * @param submitted When the work was submitted, from now()
+ * @param duration How long the GPU took in us
+ */
+void TraceLog::gpu(const char *name, double submitted, double duration) {
+    if (!isEnabled() || (g_gpuBuffer == nullptr)) return;
+    const double start = std::max(submitted, g_gpuEnd);
+    g_gpuEnd = start + duration;
+    push(g_gpuBuffer, {name, start, duration, 'X'});
+}
+
+/**
+ * @brief TraceLog::write
+ * Reads each buffer up to the count its thread last published, so threads can carry on recording while it writes.
+ * @param fileName The JSON file
+ * @return true if the file was written
+ */
+bool TraceLog::write(const std::string &fileName) {
+    std::ofstream file(fileName.c_str(), std::ios::trunc);
+    file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool isFirst = true;
+    size_t numEvents = 0, numDropped = 0;
+    for (Buffer *buffer = g_buffers.load(std::memory_order_acquire);
+         buffer != nullptr;
+         buffer = buffer->m_next.load(std::memory_order_relaxed)) {
+        file << (isFirst ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+             << buffer->m_threadId << ", \"args\": {\"name\": \"";
+        if (buffer->m_threadName != nullptr) {
+            file << buffer->m_threadName;
+        } else {
+            file << "thread " << buffer->m_threadId;
+        }
+        file << "\"}}";
+        isFirst = false;
+
+        for (Chunk *chunk = buffer->m_first; chunk != nullptr; chunk = chunk->m_next.load(std::memory_order_acquire)) {
+            const size_t count = chunk->m_count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; ++i) {
+                const Event &event = chunk->m_events[i];
+                file << ",\n{\"name\": \"" << event.m_name << "\", \"ph\": \"" << event.m_phase
+                     << "\", \"pid\": 1, \"tid\": " << buffer->m_threadId << ", \"ts\": " << event.m_time;
+                if (event.m_phase == 'X') file << ", \"dur\": " << event.m_duration;
+                file << "}";
+            }
+            numEvents += count;
+        }
+        numDropped += buffer->m_numDropped.load(std::memory_order_relaxed);
+    }
+    file << "\n]}\n";
+    file.close();
+    if (!file.good()) {
+        std::cerr << "TraceLog::write() - could not write " << fileName << "\n";
+        return false;
+    }
+    std::cout << "TraceLog::write() - " << numEvents << " events written to " << fileName;
+    if (numDropped > 0) std::cout << " (" << numDropped << " dropped as the buffers were full)";
+    std::cout << "\n";
+    return true;
+}
@@ -0,0 +1,198 @@
+#include "vertexpacker.h"
+#include "parallelfor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static_assert(sizeof(VertexPacker::CurvatureVertex) == 24, "CurvatureVertex must be tightly packed");
+
+/**
+ * @brief VertexPacker::floatToHalf
+ * @param f The value to convert
+ * @return The nearest IEEE half float, with overflow going to infinity
+ */
+std::uint16_t VertexPacker::floatToHalf(float f) {
+    std::uint32_t bits;
+    memcpy(&bits, &f, sizeof(float));
+    std::uint16_t sign = std::uint16_t((bits >> 16) & 0x8000);
+    std::uint32_t mantissa = bits & 0x7fffff;
+    int exponent = int((bits >> 23) & 0xff) - 127 + 15;
+
+    // Infinity and NaN
+    if ((bits & 0x7fffffff) >= 0x7f800000) return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    if (exponent >= 31) return sign | 0x7c00;
+
+    // Values too small for a normalised half become denormals, or zero
+    if (exponent <= 0) {
+        if (exponent < -10) return sign;
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        std::uint16_t h = std::uint16_t(mantissa >> shift);
+        if ((mantissa >> (shift - 1)) & 1) ++h;
+        return sign | h;
+    }
+
+    // Rounding may carry into the exponent, which still gives the right answer
+    std::uint16_t h = std::uint16_t(sign | (exponent << 10) | (mantissa >> 13));
+    if (mantissa & 0x1000) ++h;
+    return h;
+}
+
+std::uint16_t VertexPacker::packUnorm16(float f) {
+    return std::uint16_t(std::lround(std::min(std::max(f, 0.0f), 1.0f) * 65535.0f));
+}
+
+std::int16_t VertexPacker::packSnorm16(float f) {
+    return std::int16_t(std::lround(std::min(std::max(f, -1.0f), 1.0f) * 32767.0f));
+}
+
+/**
+ * @brief VertexPacker::packSnorm1010102
+ * @return The components packed as signed normalised values, x in the lowest bits
+ */
+std::uint32_t VertexPacker::packSnorm1010102(float x, float y, float z, float w) {
+    auto pack = [](float f, float range, std::uint32_t mask) {
+        return std::uint32_t(std::lround(std::min(std::max(f, -1.0f), 1.0f) * range)) & mask;
+    };
+    return pack(x, 511.0f, 0x3ff) | (pack(y, 511.0f, 0x3ff) << 10) | (pack(z, 511.0f, 0x3ff) << 20) | (pack(w, 1.0f, 0x3) << 30);
+}
+
+/**
+ * @brief VertexPacker::octEncode
+ * Projects the direction onto the octahedron |x|+|y|+|z| = 1 and folds the lower half over the upper one
+ * @param v The direction (3 floats)
+ * @param out The two encoded values
+ */
+void VertexPacker::octEncode(const float *v, std::int16_t *out) {
+    float l1 = std::fabs(v[0]) + std::fabs(v[1]) + std::fabs(v[2]);
+    if (l1 == 0.0f) {
+        out[0] = out[1] = 0;
+        return;
+    }
+    float u = v[0] / l1;
+    float w = v[1] / l1;
+    if (v[2] < 0.0f) {
+        float fu = (1.0f - std::fabs(w)) * ((u >= 0.0f) ? 1.0f : -1.0f);
+        float fw = (1.0f - std::fabs(u)) * ((w >= 0.0f) ? 1.0f : -1.0f);
+        u = fu;
+        w = fw;
+    }
+    out[0] = packSnorm16(u);
+    out[1] = packSnorm16(w);
+}
+
+/**
+ * @brief VertexPacker::bounds
+ * @param records The interleaved records, each starting with a position
+ * @param numVertices The number of records
+ * @param floatsPerVertex The size of each record
+ * @param minCorner Output minimum corner (3 floats)
+ * @param extent Output size of the box (3 floats)
+ */
+void VertexPacker::bounds(const float *records, size_t numVertices, size_t floatsPerVertex,
+                          float *minCorner, float *extent) {
+    float maxCorner[3];
+    for (size_t c = 0; c < 3; ++c) {
+        minCorner[c] = (numVertices > 0) ? records[c] : 0.0f;
+        maxCorner[c] = minCorner[c];
+    }
+    for (size_t i = 1; i < numVertices; ++i) {
+        const float *p = records + i * floatsPerVertex;
+        for (size_t c = 0; c < 3; ++c) {
+            minCorner[c] = std::min(minCorner[c], p[c]);
+            maxCorner[c] = std::max(maxCorner[c], p[c]);
+        }
+    }
+    for (size_t c = 0; c < 3; ++c) extent[c] = maxCorner[c] - minCorner[c];
+}
+
+/**
+ * @brief VertexPacker::packCurvature
+ * @param records The 12 float position, normal, K1, K2 records
+ * @param numVertices The number of records
+ * @param minCorner The minimum corner of the position box
+ * @param extent The size of the position box
+ * @param out The packed records
+ * @param vertices If not null, only these records are packed
+ */
+void VertexPacker::packCurvature(const float *records, size_t numVertices,
+                                 const float *minCorner, const float *extent, CurvatureVertex *out,
+                                 const std::vector<std::uint32_t> *vertices) {
+    const size_t cnt = (vertices == nullptr) ? numVertices : vertices->size();
+    parallelFor(0, cnt, [&](size_t begin, size_t end, size_t) {
+        for (size_t j = begin; j < end; ++j) {
+            size_t i = (vertices == nullptr) ? j : (*vertices)[j];
+            const float *r = records + i * 12;
+            CurvatureVertex &o = out[i];
+            for (size_t c = 0; c < 3; ++c) {
+                o.m_position[c] = packUnorm16((extent[c] > 0.0f) ? (r[c] - minCorner[c]) / extent[c] : 0.0f);
+            }
+            o.m_position[3] = 0;
+            o.m_normal = packSnorm1010102(r[3], r[4], r[5]);
+
+            // The curvature vectors are split into a unit direction and a magnitude
+            octEncode(r + 6, o.m_k1);
+            octEncode(r + 9, o.m_k2);
+            o.m_kappa[0] = floatToHalf(std::sqrt(r[6]*r[6] + r[7]*r[7] + r[8]*r[8]));
+            o.m_kappa[1] = floatToHalf(std::sqrt(r[9]*r[9] + r[10]*r[10] + r[11]*r[11]));
+        }
+    });
+}
+
+/**
+ * @brief VertexPacker::morphDeltaScales
+ * @param records The BlendshapeLoader records
+ * @param numVertices The number of records
+ * @param numTargets The number of targets (including the base)
+ * @return numTargets-1 scales, one for each delta
+ */
+std::vector<float> VertexPacker::morphDeltaScales(const float *records, size_t numVertices, size_t numTargets) {
+    const size_t stride = numTargets * 6;
+    std::vector<float> scales(numTargets - 1, 0.0f);
+    for (size_t i = 0; i < numVertices; ++i) {
+        const float *r = records + i * stride;
+        for (size_t t = 1; t < numTargets; ++t) {
+            for (size_t c = 0; c < 3; ++c) scales[t - 1] = std::max(scales[t - 1], std::fabs(r[3 * t + c]));
+        }
+    }
+    // Avoid dividing by zero for a target which doesn't move anything
+    for (float &s : scales) if (s == 0.0f) s = 1.0f;
+    return scales;
+}
+
+/**
+ * @brief VertexPacker::packMorph
+ * @param records The BlendshapeLoader records
+ * @param numVertices The number of records
+ * @param numTargets The number of targets (including the base)
+ * @param scales The delta scales from morphDeltaScales()
+ * @param out The packed records of morphStride(numTargets) bytes
+ * @param vertices If not null, only these records are packed
+ */
+void VertexPacker::packMorph(const float *records, size_t numVertices, size_t numTargets,
+                             const std::vector<float> &scales, std::uint8_t *out,
+                             const std::vector<std::uint32_t> *vertices) {
+    const size_t stride = numTargets * 6;
+    const size_t packedStride = morphStride(numTargets);
+    const size_t cnt = (vertices == nullptr) ? numVertices : vertices->size();
+    parallelFor(0, cnt, [&](size_t begin, size_t end, size_t) {
+        for (size_t j = begin; j < end; ++j) {
+            size_t i = (vertices == nullptr) ? j : (*vertices)[j];
+            const float *r = records + i * stride;
+            std::uint8_t *o = out + i * packedStride;
+            memcpy(o, r, 3 * sizeof(float));
+            for (size_t t = 1; t < numTargets; ++t) {
+                std::int16_t delta[4];
+                for (size_t c = 0; c < 3; ++c) delta[c] = packSnorm16(r[3 * t + c] / scales[t - 1]);
+                delta[3] = 0;
+                memcpy(o + morphDeltaOffset(t), delta, sizeof(delta));
+            }
+            for (size_t t = 0; t < numTargets; ++t) {
+                const float *n = r + 3 * (numTargets + t);
+                std::uint32_t normal = packSnorm1010102(n[0], n[1], n[2]);
+                memcpy(o + morphNormalOffset(numTargets, t), &normal, sizeof(normal));
+            }
+        }
+    });
+}
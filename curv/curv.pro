@@ -8,16 +8,46 @@ TARGET = curv
 # Input
 SOURCES += src/main.cpp \
            src/curvscene.cpp \
-           src/MultiBufferIndexVAO.cpp \
+           ../common/src/MultiBufferIndexVAO.cpp \
+           ../common/src/meshcache.cpp \
+           ../common/src/meshoptimiser.cpp \
+           ../common/src/meshlod.cpp \
+           ../common/src/meshlets.cpp \
+           ../common/src/vertexpacker.cpp \
+           ../common/src/curvatureengine.cpp \
+           ../common/src/meshtopology.cpp \
            ../common/src/scene.cpp \
            ../common/src/camera.cpp \
-           ../common/src/trackballcamera.cpp
+           ../common/src/trackballcamera.cpp \
+           ../common/src/shaderprogram.cpp \
+           ../common/src/programcache.cpp \
+           ../common/src/programbuilder.cpp \
+           ../common/src/fixedcamera.cpp \
+           ../common/src/headlessrunner.cpp \
+           ../common/src/tracelog.cpp \
+           ../common/src/bufferhash.cpp
 
 HEADERS += src/curvscene.h \
-           src/MultiBufferIndexVAO.h \
+           ../common/include/MultiBufferIndexVAO.h \
+           ../common/include/meshcache.h \
+           ../common/include/meshoptimiser.h \
+           ../common/include/meshlod.h \
+           ../common/include/meshlets.h \
+           ../common/include/vertexpacker.h \
+           ../common/include/curvatureengine.h \
+           ../common/include/meshtopology.h \
+           ../common/include/parallelfor.h \
            ../common/include/scene.h \
            ../common/include/camera.h \
-           ../common/include/trackballcamera.h
+           ../common/include/trackballcamera.h \
+           ../common/include/shaderprogram.h \
+           ../common/include/programcache.h \
+           ../common/include/programbuilder.h \
+           ../common/include/fixedcamera.h \
+           ../common/include/headlessrunner.h \
+           ../common/include/tracelog.h \
+           ../common/include/bufferhash.h \
+           ../common/include/fnv1a.h
 
 OTHER_FILES += shaders/*.glsl \
                README.md
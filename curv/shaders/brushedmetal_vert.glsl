@@ -4,26 +4,50 @@ layout (location = 1) in vec3 VertNormal; // The input normal
 layout (location = 2) in vec2 VertUV;     // The input UV coordinate
 layout (location = 3) in vec3 VertK1;     // The input maximum principle curvature
 layout (location = 4) in vec3 VertK2;     // The input minimum principle curvature
+layout (location = 5) in vec2 VertKappa;  // The curvature magnitudes (packed attributes only)
 
 uniform mat4 MVP;                         // The Model View Projection matrix
 uniform mat4 MV;                          // The Model View matrix
 uniform mat3 N;                           // The inverse transpose of the MV matrix
 
+// When the attributes are packed the position is quantised within a box, and the curvature directions are
+// octahedral encoded with separate magnitudes. The defaults leave float attributes untouched.
+uniform bool packedAttribs = false;
+uniform vec3 posOffset = vec3(0.0);
+uniform vec3 posScale = vec3(1.0);
+
 out vec4 GeoPosition;                    // The output position
 out vec3 GeoNormal;                      // The output normal
 out vec3 GeoK1;                          // The output minimum curvature
 out vec3 GeoK2;                          // The output maximum curvature
 
+/// Decode a unit vector from its octahedral encoding
+vec3 octDecode(vec2 e) {
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0) {
+        v.xy = (1.0 - abs(v.yx)) * vec2((v.x >= 0.0) ? 1.0 : -1.0, (v.y >= 0.0) ? 1.0 : -1.0);
+    }
+    return normalize(v);
+}
+
 void main(void)
 {
+    vec3 pos = VertPos * posScale + posOffset;
+    vec3 k1 = VertK1;
+    vec3 k2 = VertK2;
+    if (packedAttribs) {
+        k1 = octDecode(VertK1.xy) * VertKappa.x;
+        k2 = octDecode(VertK2.xy) * VertKappa.y;
+    }
+
     // The transformed position, required for rasterization
-    gl_Position = MVP*vec4(VertPos,1.0);
+    gl_Position = MVP*vec4(pos,1.0);
 
     // Passing on the unprojected vertex for shading
-    GeoPosition = MV * vec4(VertPos, 1.0);
+    GeoPosition = MV * vec4(pos, 1.0);
 
     // The transformed normal and principle curvature directions
     GeoNormal = N * VertNormal;
-    GeoK1 = N * VertK1;
-    GeoK2 = N * VertK2;
+    GeoK1 = N * k1;
+    GeoK2 = N * k2;
 }
@@ -11,16 +11,40 @@ layout (location = 3) in vec3 inK1;
 
 layout (location = 4) in vec3 inK2;
 
+/// @brief the curvature magnitudes (packed attributes only)
+layout (location = 5) in vec2 inKappa;
+
 uniform mat4 MVP;
+
+/// @brief how to decode packed attributes, the defaults leave float attributes untouched
+uniform bool packedAttribs = false;
+uniform vec3 posOffset = vec3(0.0);
+uniform vec3 posScale = vec3(1.0);
 out vec4 normal;
 out vec4 K1;
 out vec4 K2;
 
+/// @brief decode a unit vector from its octahedral encoding
+vec3 octDecode(vec2 e)
+{
+        vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+        if (v.z < 0.0)
+                v.xy = (1.0 - abs(v.yx)) * vec2((v.x >= 0.0) ? 1.0 : -1.0, (v.y >= 0.0) ? 1.0 : -1.0);
+        return normalize(v);
+}
+
 void main(void)
 {
-        gl_Position = MVP*vec4(inVert,1);
+        vec3 k1 = inK1;
+        vec3 k2 = inK2;
+        if (packedAttribs)
+        {
+                k1 = octDecode(inK1.xy) * inKappa.x;
+                k2 = octDecode(inK2.xy) * inKappa.y;
+        }
+        gl_Position = MVP*vec4(inVert * posScale + posOffset,1);
         normal=MVP*vec4(inNormal,0);
-        K1=MVP*vec4(inK1,0);
-        K2=MVP*vec4(inK2,0);
+        K1=MVP*vec4(k1,0);
+        K2=MVP*vec4(k2,0);
 }
 
@@ -1,78 +0,0 @@
-#ifndef MULTIBUFFERINDEXVAO_H_
-#define MULTIBUFFERINDEXVAO_H_
-
-#include <ngl/AbstractVAO.h>
-
-
-class  MultiBufferIndexVAO : public ngl::AbstractVAO
-{
-  public :
-    //----------------------------------------------------------------------------------------------------------------------
-    /// @brief creator method for the factory
-    /// @param _mode the mode to draw with.
-    /// @returns a new AbstractVAO * object
-    //----------------------------------------------------------------------------------------------------------------------
-    static std::unique_ptr<ngl::AbstractVAO>create(GLenum _mode=GL_TRIANGLES) { return std::unique_ptr<AbstractVAO>(new MultiBufferIndexVAO(_mode)); }
-    //----------------------------------------------------------------------------------------------------------------------
-    /// @brief draw the VAO using glDrawArrays
-    //----------------------------------------------------------------------------------------------------------------------
-    virtual void draw() const;
-    virtual void draw(int _startIndex, int _amount) const;
-    //----------------------------------------------------------------------------------------------------------------------
-    /// @brief dtor don't do anything as the remove clears things
-    //----------------------------------------------------------------------------------------------------------------------
-    virtual ~MultiBufferIndexVAO()=default;
-    //----------------------------------------------------------------------------------------------------------------------
-    /// @brief remove the VAO and buffers created
-    //----------------------------------------------------------------------------------------------------------------------
-    virtual void removeVAO();
-    //----------------------------------------------------------------------------------------------------------------------
-    /// @brief, this method sets the data for the VAO if data has already been set it will remove the existing data
-    /// and then re-set with the new data.
-    /// @param _size the size of the raw data passed
-    /// @param _data the actual data to set for the VOA
-    /// @param _indexSize the size of the index array passed
-    /// @param _indexData the actual data to set for the VOA indexes (only GLubyte data at present need to write more methods
-    /// but usually only use this
-    /// @param _indexType the type of the values in the indices buffer. Must be one of GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, or GL_UNSIGNED_INT.
-    /// @param _mode the draw mode hint used by GL
-    //----------------------------------------------------------------------------------------------------------------------
-    virtual void setData(const VertexData &_data);
-    void setIndices(unsigned int _indexSize,const GLvoid *_indexData,GLenum _indexType,GLenum _mode=GL_STATIC_DRAW);
-
-    //----------------------------------------------------------------------------------------------------------------------
-    /// @brief return the id of the buffer, if there is only 1 buffer just return this
-    /// if we have the more than one buffer the sub class manages the id's
-    /// @param _buffer index (default to 0 for single buffer VAO's)
-    //----------------------------------------------------------------------------------------------------------------------
-     GLuint getBufferID(unsigned int ){return m_buffer;}
-
-     //----------------------------------------------------------------------------------------------------------------------
-     /// @brief grab a raw pointer to the data
-     /// @param _index the index to the buffer (0) default for simple
-     /// @param _mode the access more
-     //----------------------------------------------------------------------------------------------------------------------
-     ngl::Real * mapBuffer(unsigned int _index=0, GLenum _accessMode=GL_READ_WRITE);
-  protected :
-    //----------------------------------------------------------------------------------------------------------------------
-    /// @brief ctor calles parent ctor to allocate vao;
-    //----------------------------------------------------------------------------------------------------------------------
-    MultiBufferIndexVAO(GLenum _mode)  : ngl::AbstractVAO(_mode)
-    {
-
-    }
-
-  private :
-    //----------------------------------------------------------------------------------------------------------------------
-    /// @brief the id of the buffer for the VAO
-    //----------------------------------------------------------------------------------------------------------------------
-    GLuint m_buffer=0;
-    //----------------------------------------------------------------------------------------------------------------------
-    /// @brief data type of the index data (e.g. GL_UNSIGNED_INT)
-    //----------------------------------------------------------------------------------------------------------------------
-    GLenum m_indexType;
-
-
-};
-
-#endif
@@ -1,7 +1,19 @@
 #include "curvscene.h"
+#include "tracelog.h"
+#include "bufferhash.h"
+#include "meshcache.h"
+#include "curvatureengine.h"
+#include "meshoptimiser.h"
+#include "meshlod.h"
+#include "meshlets.h"
+#include "vertexpacker.h"
+#include "programbuilder.h"
+#include <algorithm>
+#include <cmath>
 
 // The headers below are needed to get matrices from GLM
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
 #include <glm/gtx/string_cast.hpp>
 
 // The NGL includes are needed for the creation of VAO's from geometry
@@ -10,9 +22,7 @@
 #include <ngl/VAOFactory.h>
 #include <ngl/ShaderLib.h>
 
-// The headers below are required for the maths calculations on the geometry
-#include <igl/per_vertex_normals.h>
-#include <igl/principal_curvature.h>
+// The headers below are required to read the geometry
 #include <igl/read_triangle_mesh.h>
 #include <Eigen/Core>
 #include <Eigen/Dense>
@@ -21,6 +31,7 @@
  * @brief DofScene::DofScene
  */
 CurvScene::CurvScene() : Scene() {
+    m_startTime = std::chrono::high_resolution_clock::now();
 }
 
 
@@ -28,6 +39,8 @@ CurvScene::CurvScene() : Scene() {
  * @brief DofScene::initGL
  */
 void CurvScene::initGL() noexcept {
+    TraceScope trace("CurvScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -43,162 +56,348 @@ void CurvScene::initGL() noexcept {
     // enable multisampling for smoother drawing
     glEnable(GL_MULTISAMPLE);
 
-    // Create and compile the vertex and fragment shader
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-
-    // Create the basic shader used to render the scene with Gouraud shading
-    shader->loadShader("GouraudProgram",                        // Name of program
-                       "../common/shaders/gouraud_vert.glsl",   // Vertex shader
-                       "../common/shaders/gouraud_frag.glsl");  // Fragment shader
-
-    shader->loadShader("BrushedMetalProgram",
-                       "shaders/brushedmetal_vert.glsl",
-                       "shaders/brushedmetal_frag.glsl");
-
-
-    // Build the brushed metal shader the old fashioned way as we have an additional pipeline stage
-    shader->createShaderProgram("BrushedMetal");
-
-    shader->attachShader("BrushedMetalVertex",ngl::ShaderType::VERTEX);
-    shader->loadShaderSource("BrushedMetalVertex","shaders/brushedmetal_vert.glsl");
-
-    shader->attachShader("BrushedMetalFragment",ngl::ShaderType::FRAGMENT);
-    shader->loadShaderSource("BrushedMetalFragment","shaders/brushedmetal_frag.glsl");
-
-    shader->attachShader("BrushedMetalGeometry",ngl::ShaderType::GEOMETRY);
-    shader->loadShaderSource("BrushedMetalGeometry","shaders/brushedmetal_geo.glsl");
-
-    shader->compileShader("BrushedMetalVertex");
-    shader->compileShader("BrushedMetalFragment");
-    shader->compileShader("BrushedMetalGeometry");
-    shader->attachShaderToProgram("BrushedMetal","BrushedMetalVertex");
-    shader->attachShaderToProgram("BrushedMetal","BrushedMetalFragment");
-    shader->attachShaderToProgram("BrushedMetal","BrushedMetalGeometry");
-    shader->linkProgramObject("BrushedMetal");
-
-    // Build the curvature shader the old fashioned way as we have an additional pipeline stage
-    shader->createShaderProgram("Curvature");
-
-    shader->attachShader("CurvVertex",ngl::ShaderType::VERTEX);
-    shader->loadShaderSource("CurvVertex","shaders/curv_vert.glsl");
-
-    shader->attachShader("CurvFragment",ngl::ShaderType::FRAGMENT);
-    shader->loadShaderSource("CurvFragment","shaders/curv_frag.glsl");
-
-    shader->attachShader("CurvGeometry",ngl::ShaderType::GEOMETRY);
-    shader->loadShaderSource("CurvGeometry","shaders/curv_geo.glsl");
-
-    shader->compileShader("CurvVertex");
-    shader->compileShader("CurvFragment");
-    shader->compileShader("CurvGeometry");
-    shader->attachShaderToProgram("Curvature","CurvVertex");
-    shader->attachShaderToProgram("Curvature","CurvFragment");
-    shader->attachShaderToProgram("Curvature","CurvGeometry");
-    shader->linkProgramObject("Curvature");
-
-    // Create the Vertex Array Object. This loads the geometry and calculates the curvature properties of the mesh.
+    // Queue the brushed metal and curvature shaders, which have an additional geometry stage. The linked programs
+    // are cached between runs, so they only need to be compiled when the sources or the driver change.
+    ProgramBuilder builder;
+    const size_t metal = builder.add("BrushedMetal", {{GL_VERTEX_SHADER, "shaders/brushedmetal_vert.glsl"},
+                                                      {GL_GEOMETRY_SHADER, "shaders/brushedmetal_geo.glsl"},
+                                                      {GL_FRAGMENT_SHADER, "shaders/brushedmetal_frag.glsl"}});
+    const size_t curv = builder.add("Curvature", {{GL_VERTEX_SHADER, "shaders/curv_vert.glsl"},
+                                                  {GL_GEOMETRY_SHADER, "shaders/curv_geo.glsl"},
+                                                  {GL_FRAGMENT_SHADER, "shaders/curv_frag.glsl"}});
+
+    // Load the geometry and create the Vertex Array Object while they compile. On the first run this also
+    // calculates the curvature properties of the mesh.
+    loadMesh();
     buildVAO();
+    builder.finish();
+    m_metalProgram.init(builder.program(metal));
+    m_curvProgram.init(builder.program(curv));
+
+    // Look up the uniforms once, rather than by name every frame
+    m_metalMVP = m_metalProgram.uniform<glm::mat4>("MVP");
+    m_metalMV = m_metalProgram.uniform<glm::mat4>("MV");
+    m_metalN = m_metalProgram.uniform<glm::mat3>("N");
+    m_alphaXUniform = m_metalProgram.uniform<GLfloat>("alphaX");
+    m_alphaYUniform = m_metalProgram.uniform<GLfloat>("alphaY");
+    m_metalDecode = findDecodeUniforms(m_metalProgram);
+
+    m_curvMVP = m_curvProgram.uniform<glm::mat4>("MVP");
+    m_curvDecode = findDecodeUniforms(m_curvProgram);
 }
 
 /**
- * @brief NGLScene::buildVAO
- * This function creates the Vertex Array Object from an input file and copies the data to the GPU,
- * ready for rendering.
+ * @brief CurvScene::loadMesh
+ * Maps the processed mesh from the binary cache, or on the first run reads it, computes the curvature, optimises,
+ * simplifies and packs it and writes the cache. Either way the records stay in memory (in the mapped cache or the
+ * stores) so that the vertex layout can be switched without doing any of this again.
  */
-void CurvScene::buildVAO() {
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-
-    // Register a new VAO factory for our indexed buffer array object
-    ngl::VAOFactory::registerVAOCreator("multiBufferIndexVAO", MultiBufferIndexVAO::create);
+void CurvScene::loadMesh() {
+    TraceScope trace("CurvScene::loadMesh");
 
     // Currently the filename is hardcoded (sorry)
     //std::string filename = "../common/models/bust.off";
     std::string filename = "../common/models/fertility.off";
 
-    typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixXfr;
     typedef Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixXir;
 
-    // Read a mesh from a file into igl
-    MatrixXfr V;
-    MatrixXir F;
-    igl::read_triangle_mesh(filename, V, F);
+    // On a warm start the processed mesh is mapped straight from the binary cache, so nothing is parsed or computed
+    if (m_cache.open(filename, ATTRIBUTES)) {
+        m_vertexData = m_cache.vertices();
+        m_indexData = m_cache.indices();
+        m_numVertices = m_cache.numVertices();
+        m_numIndices = m_cache.numIndices();
+        m_levels.assign(m_cache.levels(), m_cache.levels() + m_cache.numLevels());
+        m_meshlets.assign(m_cache.meshlets(), m_cache.meshlets() + m_cache.numMeshlets());
+        if (m_cache.packedStride() == sizeof(VertexPacker::CurvatureVertex)) {
+            m_packedData = static_cast<const VertexPacker::CurvatureVertex*>(m_cache.packedVertices());
+            std::copy(m_cache.packedBox(), m_cache.packedBox() + 6, m_packedBox);
+        } else {
+            // A cache written without the packed records (e.g. by another scene) can still be used
+            VertexPacker::bounds(m_vertexData, m_numVertices, FLOATS_PER_VERTEX, m_packedBox, m_packedBox + 3);
+            m_packedStore.resize(m_numVertices);
+            VertexPacker::packCurvature(m_vertexData, m_numVertices, m_packedBox, m_packedBox + 3, m_packedStore.data());
+            m_packedData = m_packedStore.data();
+        }
+    } else {
+        // Read a mesh from a file into igl
+        CurvatureEngine::MatrixXfr V;
+        MatrixXir F;
+        TraceLog::begin("read mesh");
+        igl::read_triangle_mesh(filename, V, F);
+        TraceLog::end("read mesh");
+        m_numVertices = size_t(V.rows());
+
+        // Determine the smooth normals and the principle curvature directions and magnitude using quadric fitting.
+        // The engine writes the position, normal, K1 and K2 straight into the interleaved record.
+        TraceLog::begin("curvature");
+        CurvatureEngine engine;
+        engine.build(F, m_numVertices);
+        engine.compute(V);
+        m_vertexStore.resize(m_numVertices * FLOATS_PER_VERTEX);
+        engine.writeInterleaved(m_vertexStore.data());
+        TraceLog::end("curvature");
+
+        // Reorder the triangles for the vertex cache and the vertices for fetch locality before they are cached
+        TraceLog::begin("optimise");
+        MeshOptimiser::optimise(filename.c_str(),
+                                reinterpret_cast<std::uint32_t*>(F.data()), F.size(),
+                                m_vertexStore.data(), m_numVertices, FLOATS_PER_VERTEX);
+
+        // Simplify the mesh into a chain of levels of detail which all index the same vertices
+        m_levels = MeshLOD::build(reinterpret_cast<std::uint32_t*>(F.data()), F.size(),
+                                  m_vertexStore.data(), m_numVertices, FLOATS_PER_VERTEX, m_indexStore);
+        MeshLOD::report(filename.c_str(), m_levels.data(), m_levels.size());
+
+        // Split each level into meshlets which can be culled on their own
+        m_meshlets = Meshlets::build(m_indexStore.data(), m_levels.data(), m_levels.size(),
+                                     m_vertexStore.data(), m_numVertices, FLOATS_PER_VERTEX);
+        TraceLog::end("optimise");
+
+        // Quantise the records to 24 bytes: positions in the bounding box, the normal as 10:10:10:2 and the
+        // curvature as octahedral directions with half float magnitudes
+        VertexPacker::bounds(m_vertexStore.data(), m_numVertices, FLOATS_PER_VERTEX, m_packedBox, m_packedBox + 3);
+        m_packedStore.resize(m_numVertices);
+        VertexPacker::packCurvature(m_vertexStore.data(), m_numVertices, m_packedBox, m_packedBox + 3, m_packedStore.data());
+
+        m_vertexData = m_vertexStore.data();
+        m_indexData = m_indexStore.data();
+        m_packedData = m_packedStore.data();
+        m_numIndices = m_indexStore.size();
+
+        // Store the result so that the next launch can skip all of the above
+        TraceLog::begin("write cache");
+        MeshCache::write(filename, ATTRIBUTES, m_vertexData, m_numVertices, m_indexData, m_numIndices,
+                         m_levels.data(), m_levels.size(), m_meshlets.data(), m_meshlets.size(),
+                         m_packedData, sizeof(VertexPacker::CurvatureVertex), m_packedBox);
+        TraceLog::end("write cache");
+    }
 
-    // Determine the smooth corner normals
-    MatrixXfr N;
-    igl::per_vertex_normals(V,F,N);
+    // The processed mesh must be the same whether it was computed or read from the cache
+    BufferHash::record("curv vertices", m_vertexData, m_numVertices * FLOATS_PER_VERTEX * sizeof(GLfloat));
+    BufferHash::record("curv indices", m_indexData, m_numIndices * sizeof(GLuint));
+    BufferHash::record("curv packed", m_packedData, m_numVertices * sizeof(VertexPacker::CurvatureVertex));
 
-    // Compute the principle curvature directions and magnitude using quadric fitting
-    MatrixXfr K1,K2;
-    Eigen::VectorXf KV1,KV2;
-    igl::principal_curvature(V,F,K1,K2,KV1,KV2);
-    MatrixXfr KV1_mat(K1.rows(), K1.cols()); KV1_mat << KV1,KV1,KV1;
-    MatrixXfr KV2_mat(K2.rows(), K2.cols()); KV2_mat << KV2,KV2,KV2;
-    K1.array() = KV1_mat.array() * K1.array();
-    K2.array() = KV2_mat.array() * K2.array();
+    // The bounding sphere is used to choose the level of detail
+    MeshLOD::boundingSphere(m_vertexData, m_numVertices, FLOATS_PER_VERTEX, glm::value_ptr(m_centre), m_radius);
+}
 
-    // Now concatenate our per vertex data into a big chunk of data in Eigen
-    MatrixXfr Vertices(V.rows(), V.cols() + N.cols() + K1.cols() + K2.cols());
-    Vertices << V, N, K1, K2;
+/**
+ * @brief CurvScene::buildVAO
+ * This function creates the Vertex Array Object from the loaded mesh and copies the data to the GPU, ready for
+ * rendering.
+ */
+void CurvScene::buildVAO() {
+    TraceScope trace("CurvScene::buildVAO");
 
-    // Retrieve the data from the vertex matrix as a raw array
-    GLuint v_cnt = Vertices.rows() * Vertices.cols();
-    GLuint f_cnt = F.rows() * F.cols();
+    // Register a new VAO factory for our indexed buffer array object
+    ngl::VAOFactory::registerVAOCreator("multiBufferIndexVAO", MultiBufferIndexVAO::create);
 
     // create a vao as a series of GL_TRIANGLES
     m_vao = ngl::VAOFactory::createVAO("multiBufferIndexVAO", GL_TRIANGLES);
     m_vao->bind();
 
-    // in this case we are going to set our data as the vertices above
-    m_vao->setData(MultiBufferIndexVAO::VertexData(v_cnt * sizeof(float),Vertices.data()[0]));
+    setIndexLayout();
+    setVertexLayout();
+
+    // Anything toggled before the scene was initialised is already in place
+    m_isVAODirty = m_isIndexDirty = false;
+}
+
+/**
+ * @brief CurvScene::setIndexLayout
+ * Each level is converted to 16 bit where possible and can be drawn on its own with setPart(). Unless the mesh is
+ * drawn as strips, each meshlet becomes a range of its own so that it can be culled.
+ */
+void CurvScene::setIndexLayout() {
+    // as we are storing the abstract we need to get the concrete here to set the indices, do a quick cast.
+    MultiBufferIndexVAO *vao = static_cast<MultiBufferIndexVAO *>( m_vao.get());
+    if (m_stripIndices || m_meshlets.empty()) {
+        std::vector<GLuint> levelSizes;
+        for (const MeshLOD::Level &level : m_levels) levelSizes.push_back(level.m_numIndices);
+        vao->setCompactIndices(levelSizes, m_indexData, GLuint(m_numVertices), m_stripIndices);
+    } else {
+        std::vector<GLuint> levelMeshlets, meshletSizes;
+        for (const MeshLOD::Level &level : m_levels) levelMeshlets.push_back(level.m_numMeshlets);
+        for (const Meshlets::Meshlet &meshlet : m_meshlets) meshletSizes.push_back(meshlet.m_numIndices);
+        vao->setClusterIndices(levelMeshlets, meshletSizes, m_indexData, GLuint(m_numVertices));
+    }
+}
+
+/**
+ * @brief CurvScene::setVertexLayout
+ * Uploads the records in the current layout and points the attributes at them. Both sets of records are kept on
+ * the CPU, so switching layout replaces the vertex buffer but leaves the VAO and its indices alone.
+ */
+void CurvScene::setVertexLayout() {
+    MultiBufferIndexVAO *vao = static_cast<MultiBufferIndexVAO *>( m_vao.get());
+    if (m_packAttributes) {
+        // The quantised records are uploaded as they are, whether they were just packed or mapped from the cache
+        const GLsizei stride = sizeof(VertexPacker::CurvatureVertex);
+        m_posOffset = glm::vec3(m_packedBox[0], m_packedBox[1], m_packedBox[2]);
+        m_posScale = glm::vec3(m_packedBox[3], m_packedBox[4], m_packedBox[5]);
+        vao->setData(m_numVertices * stride, m_packedData);
+        vao->setVertexAttribute(0, 3, GL_UNSIGNED_SHORT, stride, offsetof(VertexPacker::CurvatureVertex, m_position), true);
+        vao->setVertexAttribute(1, 4, GL_INT_2_10_10_10_REV, stride, offsetof(VertexPacker::CurvatureVertex, m_normal), true);
+        vao->setVertexAttribute(3, 2, GL_SHORT, stride, offsetof(VertexPacker::CurvatureVertex, m_k1), true);
+        vao->setVertexAttribute(4, 2, GL_SHORT, stride, offsetof(VertexPacker::CurvatureVertex, m_k2), true);
+        vao->setVertexAttribute(5, 2, GL_HALF_FLOAT, stride, offsetof(VertexPacker::CurvatureVertex, m_kappa), false);
+        return;
+    }
 
-    // as we are storing the abstract we need to get the concrete here to call setIndices, do a quick cast
-    static_cast<MultiBufferIndexVAO *>( m_vao.get())->setIndices(f_cnt, F.data(), GL_UNSIGNED_INT);
+    // in this case we are going to set our data as the vertices above, which need no decoding
+    m_posOffset = glm::vec3(0.0f);
+    m_posScale = glm::vec3(1.0f);
+    vao->setData(m_numVertices * FLOATS_PER_VERTEX * sizeof(GLfloat), m_vertexData);
 
-    // Don't know why I need to specify this twice . . .
-    m_vao->setNumIndices(f_cnt); 
+    // The magnitudes are only separate in the packed records
+    glDisableVertexAttribArray(5);
 
     // Set the vertex attribute pointer
+    const GLsizei stride = FLOATS_PER_VERTEX * sizeof(GLfloat);
     m_vao->setVertexAttributePointer(0, // GLuint _id
                                      3, // GLint _size
                                      GL_FLOAT, // GLenum _type
-                                     12 * sizeof(GLfloat), // GLsizei _stride
-                                     0, // unsigned int _dataOffset
+                                     stride, // GLsizei _stride
+                                     MeshCache::attributeOffset(ATTRIBUTES, MeshCache::ATTRIB_POSITION), // unsigned int _dataOffset
                                      false); // bool _normalise=false
     // Set the normal attribute pointer
     m_vao->setVertexAttributePointer(1, // GLuint _id
                                      3, // GLint _size
                                      GL_FLOAT, // GLenum _type
-                                     12 * sizeof(GLfloat), // GLsizei _stride
-                                     3, // unsigned int _dataOffset
+                                     stride, // GLsizei _stride
+                                     MeshCache::attributeOffset(ATTRIBUTES, MeshCache::ATTRIB_NORMAL), // unsigned int _dataOffset
                                      true); // bool _normalise=false
     // Set the K1 attribute pointer (disable normalise for magnitude visualisation)
     m_vao->setVertexAttributePointer(3, // GLuint _id
                                      3, // GLint _size
                                      GL_FLOAT, // GLenum _type
-                                     12 * sizeof(GLfloat), // GLsizei _stride
-                                     6, // unsigned int _dataOffset
+                                     stride, // GLsizei _stride
+                                     MeshCache::attributeOffset(ATTRIBUTES, MeshCache::ATTRIB_CURVATURE), // unsigned int _dataOffset
                                      true); // bool _normalise=false
 
-    // Set the K2 attribute pointer (disable normalise for magnitude visualisation)
+    // Set the K2 attribute pointer, which follows K1 (disable normalise for magnitude visualisation)
     m_vao->setVertexAttributePointer(4, // GLuint _id
                                      3, // GLint _size
                                      GL_FLOAT, // GLenum _type
-                                     12 * sizeof(GLfloat), // GLsizei _stride
-                                     9, // unsigned int _dataOffset
+                                     stride, // GLsizei _stride
+                                     MeshCache::attributeOffset(ATTRIBUTES, MeshCache::ATTRIB_CURVATURE) + 3, // unsigned int _dataOffset
                                      true); // bool _normalise=false
 }
 
+/**
+ * @brief CurvScene::beginSculpt
+ * The engine computes the normals and curvature once more on the full resolution triangles, so that each update
+ * starts from exactly what a full compute of the rest pose would give. The bump is centred on the vertex nearest the
+ * camera (which starts on the -z axis) and fades out smoothly to its edge, moving each vertex along its rest normal.
+ */
+void CurvScene::beginSculpt() {
+    TraceScope trace("CurvScene::beginSculpt");
+
+    // The records are edited in place, so a mesh mapped from the cache is copied first
+    if (m_vertexData != m_vertexStore.data()) {
+        m_vertexStore.assign(m_vertexData, m_vertexData + m_numVertices * FLOATS_PER_VERTEX);
+        m_vertexData = m_vertexStore.data();
+    }
+    float *records = m_vertexStore.data();
+    const MeshLOD::Level &full = m_levels[0];
+    m_engine.build(m_indexData + full.m_firstIndex, full.m_numIndices / 3, m_numVertices);
+    m_engine.compute(records, FLOATS_PER_VERTEX);
+    m_engine.writeInterleaved(records);
+
+    const size_t position = MeshCache::attributeOffset(ATTRIBUTES, MeshCache::ATTRIB_POSITION);
+    const size_t normal = MeshCache::attributeOffset(ATTRIBUTES, MeshCache::ATTRIB_NORMAL);
+    size_t seed = 0;
+    for (size_t v = 1; v < m_numVertices; ++v) {
+        if (records[v * FLOATS_PER_VERTEX + position + 2] < records[seed * FLOATS_PER_VERTEX + position + 2]) seed = v;
+    }
+    const glm::vec3 centre = glm::make_vec3(records + seed * FLOATS_PER_VERTEX + position);
+    const float radius = 0.15f * m_radius;
+    const float height = 0.3f * radius;
+    for (size_t v = 0; v < m_numVertices; ++v) {
+        const float *r = records + v * FLOATS_PER_VERTEX;
+        const float d = glm::distance(glm::make_vec3(r + position), centre) / radius;
+        if (d >= 1.0f) continue;
+        m_sculptVertices.push_back(std::uint32_t(v));
+        m_sculptRest.push_back(glm::make_vec3(r + position));
+        m_sculptOffset.push_back(glm::make_vec3(r + normal) * (height * (1.0f - d * d) * (1.0f - d * d)));
+    }
+
+    // The quantised positions are relative to a box, which has to grow to hold the bump at its full height
+    VertexPacker::bounds(records, m_numVertices, FLOATS_PER_VERTEX, m_packedBox, m_packedBox + 3);
+    for (size_t c = 0; c < 3; ++c) {
+        m_packedBox[c] -= height;
+        m_packedBox[3 + c] += 2.0f * height;
+    }
+    m_packedStore.resize(m_numVertices);
+    VertexPacker::packCurvature(records, m_numVertices, m_packedBox, m_packedBox + 3, m_packedStore.data());
+    m_packedData = m_packedStore.data();
+    m_radius += height;
+
+    // Both sets of records have changed everywhere, so the next frame uploads them in full
+    m_isVAODirty = true;
+}
+
+/**
+ * @brief CurvScene::sculpt
+ * The bump rises and falls over four seconds while the sculpt is on, and drops straight back to the rest pose once
+ * it is switched off. Both sets of records are kept up to date, so that the layout can still be switched.
+ * @param t The time in seconds
+ */
+void CurvScene::sculpt(double t) {
+    if (m_engine.numVertices() == 0) beginSculpt();
+    const float height = m_sculpt ? float(std::sin(t * glm::pi<double>() * 0.5)) : 0.0f;
+    if (height == m_sculptHeight) return;
+    m_sculptHeight = height;
+    TraceScope trace("CurvScene::sculpt");
+
+    float *records = m_vertexStore.data();
+    const size_t position = MeshCache::attributeOffset(ATTRIBUTES, MeshCache::ATTRIB_POSITION);
+    for (size_t i = 0; i < m_sculptVertices.size(); ++i) {
+        const glm::vec3 p = m_sculptRest[i] + m_sculptOffset[i] * height;
+        std::copy_n(glm::value_ptr(p), 3, records + m_sculptVertices[i] * FLOATS_PER_VERTEX + position);
+    }
+
+    // Only the normals and curvature within reach of the moved vertices are recomputed, and only those records
+    // are packed and sent to the GPU
+    m_engine.update(records, FLOATS_PER_VERTEX, m_sculptVertices);
+    const std::vector<std::uint32_t> &dirty = m_engine.dirtyVertices();
+    m_engine.writeInterleaved(records, dirty);
+    VertexPacker::packCurvature(records, m_numVertices, m_packedBox, m_packedBox + 3, m_packedStore.data(), &dirty);
+
+    // The buffer may still hold the other layout, in which case it is about to be replaced in full anyway
+    if (m_isVAODirty) return;
+    MultiBufferIndexVAO *vao = static_cast<MultiBufferIndexVAO *>(m_vao.get());
+    if (m_packAttributes) {
+        vao->updateRecords(dirty, sizeof(VertexPacker::CurvatureVertex), m_packedStore.data());
+    } else {
+        vao->updateRecords(dirty, FLOATS_PER_VERTEX * sizeof(GLfloat), records);
+    }
+}
 
 void CurvScene::paintGL() noexcept {
+    TraceScope trace("CurvScene::paintGL");
+
+    // The sculpt edits the records, so it goes before a change of layout uploads them
+    if (m_sculpt || (m_sculptHeight != 0.0f)) sculpt(elapsedTime(m_startTime));
+
+    // Switching between the packed and float records only replaces the vertex buffer, and switching between strips
+    // and meshlets only the indices
+    if (m_isVAODirty) {
+        setVertexLayout();
+        m_isVAODirty = false;
+    }
+    if (m_isIndexDirty) {
+        setIndexLayout();
+        m_isIndexDirty = false;
+    }
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // Set up the viewport
     glViewport(0,0,m_width,m_height);
 
-    // Use our shader for this draw
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-
     // Our MVP matrices
     glm::mat4 M = glm::scale(glm::mat4(1.0f), glm::vec3(0.01f));
     glm::mat4 MVP, MV;
@@ -209,37 +408,78 @@ void CurvScene::paintGL() noexcept {
     MV = m_V * M;
     N = glm::inverse(glm::mat3(MV));
 
-    (*shader)["BrushedMetal"]->use();
-    GLint pid = shader->getProgramID("BrushedMetal");
-    // Set this MVP on the GPU
-    glUniformMatrix4fv(glGetUniformLocation(pid, "MVP"), //location of uniform
-                       1, // how many matrices to transfer
-                       false, // whether to transpose matrix
-                       glm::value_ptr(MVP)); // a raw pointer to the data
-    glUniformMatrix4fv(glGetUniformLocation(pid, "MV"), //location of uniform
-                       1, // how many matrices to transfer
-                       false, // whether to transpose matrix
-                       glm::value_ptr(MV)); // a raw pointer to the data
-    glUniformMatrix3fv(glGetUniformLocation(pid, "N"), //location of uniform
-                       1, // how many matrices to transfer
-                       true, // whether to transpose matrix
-                       glm::value_ptr(N)); // a raw pointer to the data
+    // Draw the coarsest level of detail whose error is less than a pixel, measured at the nearest point of the
+    // bounding sphere
+    size_t level = 0;
+    if (m_useLOD) {
+        float scale = glm::length(glm::vec3(MV[0]));
+        float distance = glm::length(glm::vec3(MV * glm::vec4(m_centre, 1.0f))) - m_radius * scale;
+        float pixelsPerUnit = 0.5f * float(m_height) * m_P[1][1] * scale;
+        level = MeshLOD::selectLevel(m_levels.data(), m_levels.size(), distance, pixelsPerUnit);
+    }
+    MultiBufferIndexVAO *vao = static_cast<MultiBufferIndexVAO *>(m_vao.get());
+    vao->setPart(level);
+
+    // Find the meshlets of this level which are inside the frustum and facing the eye, which is at the origin of
+    // view space. Their bounds are those of the rest pose, so nothing is culled while the sculpt has moved it.
+    const MeshLOD::Level &lod = m_levels[level];
+    const bool cull = m_cullMeshlets && !m_stripIndices && (m_sculptHeight == 0.0f) && !m_meshlets.empty() &&
+                      (lod.m_numMeshlets > 0);
+    if (cull) {
+        glm::vec4 eye = glm::inverse(MV) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        Meshlets::cull(m_meshlets.data() + lod.m_firstMeshlet, lod.m_numMeshlets,
+                       glm::value_ptr(MVP), glm::value_ptr(eye), m_visible, m_cullStats);
+        if (m_cullStats.m_frames == 300) Meshlets::report("CurvScene", m_cullStats);
+    }
+
+    m_metalProgram.use();
+    // Set this MVP on the GPU (N is transposed to give the inverse transpose of MV)
+    m_metalMVP.set(MVP);
+    m_metalMV.set(MV);
+    m_metalN.setTransposed(N);
     
     // The shading parameters
-    glUniform1f(glGetUniformLocation(pid, "alphaX"), m_alphaX);
-    glUniform1f(glGetUniformLocation(pid, "alphaY"), m_alphaY);
+    m_alphaXUniform.set(m_alphaX);
+    m_alphaYUniform.set(m_alphaY);
 
-    m_vao->draw();
+    // How to decode the vertex attributes
+    setDecodeUniforms(m_metalDecode);
+
+    if (cull) {
+        vao->drawClusters(m_visible.data(), m_visible.size());
+    } else {
+        m_vao->draw();
+    }
 
     // Now draw with the curvature vectors displayed
     if (m_vectors) {
-        (*shader)["Curvature"]->use();
-        pid = shader->getProgramID("Curvature");
+        m_curvProgram.use();
         // Set this MVP on the GPU
-        glUniformMatrix4fv(glGetUniformLocation(pid, "MVP"), //location of uniform
-                        1, // how many matrices to transfer
-                        false, // whether to transpose matrix
-                        glm::value_ptr(MVP)); // a raw pointer to the data
+        m_curvMVP.set(MVP);
+        setDecodeUniforms(m_curvDecode);
         m_vao->draw();
     }
 }
+
+/**
+ * @brief CurvScene::findDecodeUniforms
+ * @param program A program which reads the vertex records
+ * @return The handles of its decode uniforms
+ */
+CurvScene::DecodeUniforms CurvScene::findDecodeUniforms(const ShaderProgram &program) {
+    DecodeUniforms uniforms;
+    uniforms.m_packedAttribs = program.uniform<bool>("packedAttribs");
+    uniforms.m_posOffset = program.uniform<glm::vec3>("posOffset");
+    uniforms.m_posScale = program.uniform<glm::vec3>("posScale");
+    return uniforms;
+}
+
+/**
+ * @brief CurvScene::setDecodeUniforms
+ * @param uniforms The decode uniforms of the program in use
+ */
+void CurvScene::setDecodeUniforms(const DecodeUniforms &uniforms) const {
+    uniforms.m_packedAttribs.set(m_packAttributes);
+    uniforms.m_posOffset.set(m_posOffset);
+    uniforms.m_posScale.set(m_posScale);
+}
@@ -5,6 +5,12 @@
 #include "scene.h"
 #include <ngl/Obj.h>
 #include "MultiBufferIndexVAO.h"
+#include "meshlod.h"
+#include "meshlets.h"
+#include "meshcache.h"
+#include "vertexpacker.h"
+#include "shaderprogram.h"
+#include "curvatureengine.h"
 
 class CurvScene : public Scene {
 public:
@@ -20,6 +26,23 @@ public:
     /// Toggle whether the vectors are visible
     void toggleVectors() {m_vectors = !m_vectors;}
 
+    /// Toggle whether the level of detail is chosen from the distance, or the full resolution mesh is always drawn
+    void toggleLOD() {m_useLOD = !m_useLOD;}
+
+    /// Toggle whether the meshlets outside the view or facing away are culled
+    void toggleCulling() {m_cullMeshlets = !m_cullMeshlets;}
+
+    /// Toggle between drawing each level as triangle strips with primitive restart and as meshlets which can be
+    /// culled (the indices are replaced on the next frame)
+    void toggleStrips() {m_stripIndices = !m_stripIndices; m_isIndexDirty = true;}
+
+    /// Toggle between the quantised vertex records and the float records (the vertex buffer is replaced next frame)
+    void togglePackedAttributes() {m_packAttributes = !m_packAttributes; m_isVAODirty = true;}
+
+    /// Toggle the sculpt, which raises and lowers a bump on the front of the mesh and updates the normals and
+    /// curvature around it every frame. Switching it off puts the surface back.
+    void toggleSculpt() {m_sculpt = !m_sculpt;}
+
     /// Get / Set methods for the anisotropic parameter
     float getAlphaX() const {return m_alphaX;};
     void setAlphaX(const float &_alphaX) {m_alphaX = _alphaX;};
@@ -30,15 +53,108 @@ private:
     /// Store a unique pointer to the vertex array object to be rendered in our scene
     std::unique_ptr<ngl::AbstractVAO> m_vao;
 
+    /// Map the processed mesh from the cache, or compute it and write the cache
+    void loadMesh();
+
     /// Build the Vertex Array Object to store all the curvature information
     void buildVAO();
 
+    /// Upload the vertex records in the current layout and point the attributes at them
+    void setVertexLayout();
+
+    /// Upload the indices of every level, as strips or as meshlets
+    void setIndexLayout();
+
+    /// Copy the records out of the cache, build the curvature engine and choose the vertices to move, the first
+    /// time the sculpt is switched on
+    void beginSculpt();
+
+    /// Move the sculpted vertices to the height for time t and update the records this affects
+    void sculpt(double /*t*/);
+
+    /// The attributes of the float records, which hold FLOATS_PER_VERTEX floats
+    static const unsigned int ATTRIBUTES = MeshCache::ATTRIB_POSITION | MeshCache::ATTRIB_NORMAL | MeshCache::ATTRIB_CURVATURE;
+    static const size_t FLOATS_PER_VERTEX = CurvatureEngine::FLOATS_PER_VERTEX;
+
+    /// The cache the mesh was mapped from, which stays open as the records are uploaded again when the layout changes
+    MeshCache m_cache;
+
+    /// The mesh when it has just been computed rather than mapped from the cache
+    std::vector<float> m_vertexStore;
+    std::vector<std::uint32_t> m_indexStore;
+    std::vector<VertexPacker::CurvatureVertex> m_packedStore;
+
+    /// The float records, the indices of every level and the quantised records, in the cache or the stores above
+    const float *m_vertexData = nullptr;
+    const std::uint32_t *m_indexData = nullptr;
+    const VertexPacker::CurvatureVertex *m_packedData = nullptr;
+    size_t m_numVertices = 0;
+    size_t m_numIndices = 0;
+
+    /// The box the quantised positions are relative to (the minimum corner then the extent)
+    float m_packedBox[6];
+
     /// These two parameters set our anisotropic properties on the shader
     float m_alphaX = 1.0f;
     float m_alphaY = 1.0f;
 
     /// Whether or not the curvature vectors are visible
     bool m_vectors = false;
+
+    /// Upload quantised records (see VertexPacker) rather than the float records
+    bool m_packAttributes = true;
+    bool m_isVAODirty = false;
+
+    /// The levels of detail of the mesh, and the bounding sphere used to choose between them
+    std::vector<MeshLOD::Level> m_levels;
+    glm::vec3 m_centre = glm::vec3(0.0f);
+    float m_radius = 0.0f;
+    bool m_useLOD = true;
+
+    /// The meshlets of every level, the ones which survived culling this frame and the number of triangles culled
+    std::vector<Meshlets::Meshlet> m_meshlets;
+    std::vector<std::uint32_t> m_visible;
+    Meshlets::CullStats m_cullStats;
+    bool m_cullMeshlets = true;
+
+    /// Draw the mesh as triangle strips with primitive restart rather than a triangle list
+    bool m_stripIndices = false;
+    bool m_isIndexDirty = false;
+
+    /// The sculpt: the engine which keeps the normals and curvature up to date, the vertices which move with their
+    /// rest positions and the offset of each at full height, and the current height as a fraction of the full one
+    bool m_sculpt = false;
+    CurvatureEngine m_engine;
+    std::vector<std::uint32_t> m_sculptVertices;
+    std::vector<glm::vec3> m_sculptRest, m_sculptOffset;
+    float m_sculptHeight = 0.0f;
+    std::chrono::high_resolution_clock::time_point m_startTime;
+
+    /// The box used to decode the quantised positions (left as identity for the float records)
+    glm::vec3 m_posOffset = glm::vec3(0.0f);
+    glm::vec3 m_posScale = glm::vec3(1.0f);
+
+    /// The uniforms which tell a program how to decode the vertex records
+    struct DecodeUniforms {
+        ShaderProgram::Uniform<bool> m_packedAttribs;
+        ShaderProgram::Uniform<glm::vec3> m_posOffset, m_posScale;
+    };
+
+    /// The brushed metal program and its uniforms
+    ShaderProgram m_metalProgram;
+    ShaderProgram::Uniform<glm::mat4> m_metalMVP, m_metalMV;
+    ShaderProgram::Uniform<glm::mat3> m_metalN;
+    ShaderProgram::Uniform<GLfloat> m_alphaXUniform, m_alphaYUniform;
+    DecodeUniforms m_metalDecode;
+
+    /// The curvature vector program and its uniforms
+    ShaderProgram m_curvProgram;
+    ShaderProgram::Uniform<glm::mat4> m_curvMVP;
+    DecodeUniforms m_curvDecode;
+
+    /// Find the decode uniforms of a program, and set them on it while it is in use
+    static DecodeUniforms findDecodeUniforms(const ShaderProgram &/*program*/);
+    void setDecodeUniforms(const DecodeUniforms &/*uniforms*/) const;
 };
 
 #endif // CURVSCENE_H
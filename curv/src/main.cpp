@@ -1,5 +1,7 @@
 // Must include our scene first because of GL dependency order
 #include "curvscene.h"
+#include "headlessrunner.h"
+#include "tracelog.h"
 #include "trackballcamera.h"
 #include "fixedcamera.h"
 
@@ -50,6 +52,21 @@ void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action, int
         case GLFW_KEY_SPACE: // toggle whether the vectors are visible
             g_scene.toggleVectors();
             break;
+        case GLFW_KEY_L: // toggle the level of detail selection
+            g_scene.toggleLOD();
+            break;
+        case GLFW_KEY_C: // toggle the meshlet culling
+            g_scene.toggleCulling();
+            break;
+        case GLFW_KEY_P: // toggle the packed vertex records
+            g_scene.togglePackedAttributes();
+            break;
+        case GLFW_KEY_T: // toggle between triangle strips and meshlets
+            g_scene.toggleStrips();
+            break;
+        case GLFW_KEY_S: // toggle the sculpt
+            g_scene.toggleSculpt();
+            break;
         }
     }
     // Any other keypress should be handled by our camera
@@ -65,7 +82,24 @@ void resize_callback(GLFWwindow */*window*/, int width, int height) {
     g_scene.resizeGL(width,height);
 }
 
-int main() {
+int main(int argc, char **argv) {
+    // Without a window, draw a scripted orbit of the scene and report the frame times (see HeadlessRunner)
+    HeadlessRunner::Options options;
+    options.m_glMinor = 3;
+    int exitCode;
+    if (HeadlessRunner::runIfRequested(argc, argv, g_scene, options, exitCode, [](const HeadlessRunner::Options &options) {
+        if (options.m_variant == "strips") {
+            g_scene.toggleStrips();
+        } else if (options.m_variant == "sculpt") {
+            g_scene.toggleSculpt();
+        } else if (!options.m_variant.empty() && (options.m_variant != "meshlets")) {
+            std::cerr << "main() - unknown variant " << options.m_variant << " (meshlets, strips or sculpt)\n";
+        }
+    })) return exitCode;
+
+    // With --trace file.json, record where start up and each frame spend their time (see TraceLog)
+    if (!options.m_traceFile.empty()) TraceLog::start();
+
     if (!glfwInit()) {
         // Initialisation failed
         glfwTerminate();
@@ -122,6 +156,11 @@ int main() {
               << "Keypad-: Decrease alpha_y by 0.1\n"
               << "Keypad+: Increase alpha_y by 0.1\n"
               << "<SPACE>: Toggle curvature vector visualisation\n"
+              << "L: Toggle level of detail selection\n"
+              << "C: Toggle meshlet culling\n"
+              << "P: Toggle packed vertex attributes\n"
+              << "T: Toggle triangle strips (which can't be culled) and meshlets\n"
+              << "S: Toggle sculpting a bump, which updates the curvature around it\n"
               << "<ESC>: Quit\n"
               << "****************************************************\n";
 
@@ -151,4 +190,5 @@ int main() {
     // Close up shop
     glfwDestroyWindow(window);
     glfwTerminate();
+    if (!options.m_traceFile.empty()) TraceLog::write(options.m_traceFile);
 }
@@ -10,19 +10,43 @@ SOURCES += src/main.cpp \
            src/dofscene.cpp \
            ../common/src/scene.cpp \
            ../common/src/camera.cpp \
-           ../common/src/trackballcamera.cpp
+           ../common/src/trackballcamera.cpp \
+           ../common/src/shaderprogram.cpp \
+           ../common/src/instancebuffer.cpp \
+           ../common/src/rendertargetpool.cpp \
+           ../common/src/programcache.cpp \
+           ../common/src/programbuilder.cpp \
+           ../common/src/fixedcamera.cpp \
+           ../common/src/headlessrunner.cpp \
+           ../common/src/tracelog.cpp \
+           ../common/src/bufferhash.cpp
 
 HEADERS += src/dofscene.h \
            ../common/include/scene.h \
            ../common/include/camera.h \
-           ../common/include/trackballcamera.h
+           ../common/include/trackballcamera.h \
+           ../common/include/shaderprogram.h \
+           ../common/include/instancebuffer.h \
+           ../common/include/rendertargetpool.h \
+           ../common/include/programcache.h \
+           ../common/include/programbuilder.h \
+           ../common/include/parallelfor.h \
+           ../common/include/fixedcamera.h \
+           ../common/include/headlessrunner.h \
+           ../common/include/tracelog.h \
+           ../common/include/bufferhash.h \
+           ../common/include/fnv1a.h
 
 OTHER_FILES += shaders/*.glsl
 
 DISTFILES += \
 	     shaders/dof_frag.glsl \
              shaders/dof_vert.glsl \
+             shaders/dof_coc_frag.glsl \
+             shaders/dof_blur_frag.glsl \
+             shaders/dof_composite_frag.glsl \
              ../common/shaders/gouraud_frag.glsl \
-             ../common/shaders/gouraud_vert.glsl
+             ../common/shaders/gouraud_blocks_vert.glsl \
+             ../common/shaders/gouraud_instanced_vert.glsl
 	
 	
@@ -0,0 +1,48 @@
+#version 430
+
+// The downsampled colour, with the blur of each pixel in alpha
+uniform sampler2D sourceTex;
+
+// The direction of this pass, either (1,0) or (0,1)
+uniform vec2 direction;
+
+// The size of the part of the source which has been drawn to
+uniform vec2 targetSize;
+
+// The output colour, keeping the blur of the pixel for the next pass
+layout (location=0) out vec4 fragColor;
+
+// The furthest a tap can be from the centre, which caps the cost of the most blurred pixels
+const int MAX_RADIUS = 32;
+
+void main() {
+    ivec2 pos = ivec2(gl_FragCoord.xy);
+    ivec2 last = ivec2(targetSize) - 1;
+    ivec2 offset = ivec2(direction);
+    vec4 centre = texelFetch(sourceTex, pos, 0);
+
+    // The taps cover 2.5 standard deviations either side, so the cost grows linearly with the blur
+    float sigma = centre.a;
+    int radius = min(int(ceil(2.5 * sigma)), MAX_RADIUS);
+    if (radius == 0) {
+        fragColor = centre;
+        return;
+    }
+
+    float k = -0.5 / (sigma * sigma);
+    vec3 colour = centre.rgb;
+    float total = 1.0;
+    for (int i = 1; i <= radius; ++i) {
+        float w = exp(k * float(i * i));
+        for (int side = -1; side <= 1; side += 2) {
+            vec4 s = texelFetch(sourceTex, clamp(pos + side * i * offset, ivec2(0), last), 0);
+
+            // A sample only spreads as far as its own blur, so that sharp objects don't bleed into a blurred
+            // background (scatter as gather)
+            float ws = w * clamp(2.5 * s.a - float(i) + 1.0, 0.0, 1.0);
+            colour += ws * s.rgb;
+            total += ws;
+        }
+    }
+    fragColor = vec4(colour / total, sigma);
+}
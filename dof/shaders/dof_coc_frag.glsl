@@ -0,0 +1,43 @@
+#version 430
+
+// The colour and depth of the scene at full resolution
+uniform sampler2D colourTex;
+uniform sampler2D depthTex;
+
+// The depth at which we want to focus
+uniform float focalDepth = 0.5;
+
+// A scale factor for the radius of blur
+uniform float blurRadius = 0.008;
+
+// The full resolution size, and how many full resolution pixels each output pixel covers in x and y
+uniform vec2 windowSize;
+uniform int downsample = 2;
+
+// The averaged colour, with the blur of the pixel in alpha
+layout (location=0) out vec4 fragColor;
+
+// The circle of confusion of a depth, as the standard deviation of a Gaussian in full resolution pixels. This
+// matches the spread of the 9x9 kernel in dof_frag.glsl, whose taps are blurRadius apart in texture coordinates.
+float circleOfConfusion(float depth) {
+    return 1.5 * abs(focalDepth - depth) * blurRadius * windowSize.x;
+}
+
+void main() {
+    // Average the block of full resolution pixels under this one, and keep its largest blur so that the edges of
+    // blurred objects aren't lost
+    ivec2 base = ivec2(gl_FragCoord.xy) * downsample;
+    ivec2 last = ivec2(windowSize) - 1;
+    vec3 colour = vec3(0.0);
+    float coc = 0.0;
+    for (int y = 0; y < downsample; ++y) {
+        for (int x = 0; x < downsample; ++x) {
+            ivec2 pos = min(base + ivec2(x, y), last);
+            colour += texelFetch(colourTex, pos, 0).rgb;
+            coc = max(coc, circleOfConfusion(texelFetch(depthTex, pos, 0).x));
+        }
+    }
+
+    // The blur is stored in the pixels of this resolution
+    fragColor = vec4(colour / float(downsample * downsample), coc / float(downsample));
+}
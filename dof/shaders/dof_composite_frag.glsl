@@ -0,0 +1,54 @@
+#version 430
+
+// The colour and depth of the scene at full resolution, and the blurred colour at the lower resolution
+uniform sampler2D colourTex;
+uniform sampler2D depthTex;
+uniform sampler2D blurTex;
+
+// The depth at which we want to focus
+uniform float focalDepth = 0.5;
+
+// A scale factor for the radius of blur
+uniform float blurRadius = 0.008;
+
+// The full resolution size, the size of the blurred image, and the ratio between them
+uniform vec2 windowSize;
+uniform vec2 blurSize;
+uniform int downsample = 2;
+
+// The output colour. At location 0 it will be sent to the screen.
+layout (location=0) out vec4 fragColor;
+
+// The circle of confusion of a depth in full resolution pixels (see dof_coc_frag.glsl)
+float circleOfConfusion(float depth) {
+    return 1.5 * abs(focalDepth - depth) * blurRadius * windowSize.x;
+}
+
+void main() {
+    ivec2 pos = ivec2(gl_FragCoord.xy);
+    vec3 sharp = texelFetch(colourTex, pos, 0).rgb;
+    float coc = circleOfConfusion(texelFetch(depthTex, pos, 0).x);
+
+    // Upsample the blurred image from the four pixels around this one. Their bilinear weights are reduced where
+    // their blur differs from this pixel's, which keeps the blur of one depth from smearing across an edge.
+    vec2 lowPos = gl_FragCoord.xy / float(downsample) - 0.5;
+    ivec2 base = ivec2(floor(lowPos));
+    vec2 f = lowPos - vec2(base);
+    ivec2 last = ivec2(blurSize) - 1;
+    float lowCoc = coc / float(downsample);
+    vec3 blurred = vec3(0.0);
+    float total = 0.0;
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 2; ++x) {
+            vec4 s = texelFetch(blurTex, clamp(base + ivec2(x, y), ivec2(0), last), 0);
+            float w = ((x == 1) ? f.x : 1.0 - f.x) * ((y == 1) ? f.y : 1.0 - f.y);
+            w *= 1.0 / (1.0 + 4.0 * abs(s.a - lowCoc));
+            blurred += w * s.rgb;
+            total += w;
+        }
+    }
+    blurred /= max(total, 1e-5);
+
+    // Fade from the sharp image to the blurred one over the first pixel of blur
+    fragColor = vec4(mix(sharp, blurred, smoothstep(0.0, 1.0, coc)), 1.0);
+}
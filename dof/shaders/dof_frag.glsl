@@ -16,6 +16,14 @@ layout (location=0) out vec4 fragColor;
 // We pass the window size to the shader.
 uniform vec2 windowSize;
 
+// The textures come from a pool and can be larger than the window, so this maps window coordinates onto them
+uniform vec2 uvScale = vec2(1.0);
+
+// Find where a window coordinate is in the textures, clamping it to the part drawn to
+vec2 targetCoord(vec2 texpos) {
+    return clamp(texpos, vec2(0.0), vec2(1.0)) * uvScale;
+}
+
 // The signature for our blur function
 subroutine vec4 blurFunctionType(vec2 texpos, float sigma);
 
@@ -59,7 +67,7 @@ subroutine (blurFunctionType) vec4 GaussianFilter(vec2 texpos, float sigma) {
     for (i=0; i<SZ; ++i) {
         for (j=0; j<SZ; ++j) {
             samplepos = texpos + sigma*vec2(float(i)-HSZ, float(j)-HSZ);
-            colour += G[i*SZ+j] * texture(colourTex, samplepos);
+            colour += G[i*SZ+j] * texture(colourTex, targetCoord(samplepos));
         }
     }
     return colour;
@@ -84,12 +92,12 @@ float rand(vec2 co){
 // The Poisson filter for irregular blurring
 subroutine (blurFunctionType) vec4 PoissonFilter(vec2 texpos, float sigma) {
     int i;
-    vec4 colour = texture(colourTex, texpos);
+    vec4 colour = texture(colourTex, targetCoord(texpos));
     float angle = rand(texpos);
     mat2 rot = mat2(cos(angle), -sin(angle), sin(angle), cos(angle));
     for (i = 0; i < 12; ++i) {
         vec2 samplepos = texpos + 2 * sigma * rot * PoissonDisc[i];
-        colour += texture(colourTex, samplepos);
+        colour += texture(colourTex, targetCoord(samplepos));
     }
     return colour * 0.076923077; // Same as "/ 13.0"
 }
@@ -99,7 +107,7 @@ void main() {
     vec2 texpos = gl_FragCoord.xy / windowSize;
 
     // Determine sigma, the blur radius of this pixel
-    float sigma = abs(focalDepth - texture(depthTex, texpos).x) * blurRadius;
+    float sigma = abs(focalDepth - texture(depthTex, targetCoord(texpos)).x) * blurRadius;
 
     // Now execute the use specified blur function on this pixel based on the depth difference
     fragColor = blurFunction(texpos, sigma);
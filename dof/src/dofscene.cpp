@@ -1,4 +1,6 @@
 #include "dofscene.h"
+#include "tracelog.h"
+#include "programbuilder.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtc/type_ptr.hpp>
@@ -7,6 +9,7 @@
 #include <ngl/NGLInit.h>
 #include <ngl/VAOPrimitives.h>
 #include <ngl/ShaderLib.h>
+#include <algorithm>
 
 /**
  * @brief DofScene::DofScene
@@ -14,15 +17,12 @@
 DofScene::DofScene() : Scene() {
 }
 
-void DofScene::resizeGL(GLint width, GLint height) noexcept {
-    Scene::resizeGL(width,height);
-    m_isFBODirty = true;
-}
-
 /**
  * @brief DofScene::initGL
  */
 void DofScene::initGL() noexcept {
+    TraceScope trace("DofScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -38,192 +38,379 @@ void DofScene::initGL() noexcept {
     // enable multisampling for smoother drawing
     glEnable(GL_MULTISAMPLE);
 
-    // Create and compile the vertex and fragment shader
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+    // Queue all of the programs at once, so that the driver can compile them side by side
+    ProgramBuilder builder;
 
-    // Create the basic shader used to render the scene with Gouraud shading
-    shader->loadShader("GouraudProgram",              // Name of program
-                       "../common/shaders/gouraud_vert.glsl",   // Vertex shader
-                       "../common/shaders/gouraud_frag.glsl");  // Fragment shader
+    // Create the basic shader used to render the scene with Gouraud shading, with the matrices in uniform blocks
+    const size_t gouraud = builder.add("GouraudProgram", {{GL_VERTEX_SHADER, "../common/shaders/gouraud_blocks_vert.glsl"},
+                                                          {GL_FRAGMENT_SHADER, "../common/shaders/gouraud_frag.glsl"}});
 
-    // Create the depth of field shader program, which combines pixels in the fragment shader
-    shader->loadShader("DofProgram",                // Name of program
-                       "shaders/dof_vert.glsl",     // Vertex shader
-                       "shaders/dof_frag.glsl");    // Fragment shader
+    // The same shading for all the teapots at once, which reads the model matrices from the instance buffer
+    const size_t instanced = builder.add("GouraudInstancedProgram",
+                                         {{GL_VERTEX_SHADER, "../common/shaders/gouraud_instanced_vert.glsl"},
+                                          {GL_FRAGMENT_SHADER, "../common/shaders/gouraud_frag.glsl"}});
 
-    // Create a screen oriented plane
+    // Create the depth of field shader program, which combines pixels in the fragment shader
+    const size_t dof = builder.add("DofProgram", {{GL_VERTEX_SHADER, "shaders/dof_vert.glsl"},
+                                                  {GL_FRAGMENT_SHADER, "shaders/dof_frag.glsl"}});
+
+    // The passes of the separable blur, which all draw the same screen aligned plane
+    const size_t coc = builder.add("DofCocProgram", {{GL_VERTEX_SHADER, "shaders/dof_vert.glsl"},
+                                                     {GL_FRAGMENT_SHADER, "shaders/dof_coc_frag.glsl"}});
+    const size_t blur = builder.add("DofBlurProgram", {{GL_VERTEX_SHADER, "shaders/dof_vert.glsl"},
+                                                       {GL_FRAGMENT_SHADER, "shaders/dof_blur_frag.glsl"}});
+    const size_t composite = builder.add("DofCompositeProgram", {{GL_VERTEX_SHADER, "shaders/dof_vert.glsl"},
+                                                                 {GL_FRAGMENT_SHADER, "shaders/dof_composite_frag.glsl"}});
+
+    // Create a screen oriented plane while they compile
     ngl::VAOPrimitives *prim=ngl::VAOPrimitives::instance();
-    prim->createTrianglePlane("plane",2,2,1,1,ngl::Vec3(0,1,0));   
+    prim->createTrianglePlane("plane",2,2,1,1,ngl::Vec3(0,1,0));
+    builder.finish();
+
+    // Look up the uniforms and subroutines once, rather than by name every frame
+    m_gouraudProgram.init(builder.program(gouraud));
+    m_instancedProgram.init(builder.program(instanced));
+
+    m_dofProgram.init(builder.program(dof));
+    m_colourTex = m_dofProgram.uniform<GLint>("colourTex");
+    m_depthTex = m_dofProgram.uniform<GLint>("depthTex");
+    m_focalDepthUniform = m_dofProgram.uniform<GLfloat>("focalDepth");
+    m_blurRadiusUniform = m_dofProgram.uniform<GLfloat>("blurRadius");
+    m_windowSize = m_dofProgram.uniform<glm::vec2>("windowSize");
+    m_uvScale = m_dofProgram.uniform<glm::vec2>("uvScale");
+    m_planeMVP = m_dofProgram.uniform<glm::mat4>("MVP");
+    m_gaussianFilter = m_dofProgram.subroutineIndex(GL_FRAGMENT_SHADER, "GaussianFilter");
+    m_poissonFilter = m_dofProgram.subroutineIndex(GL_FRAGMENT_SHADER, "PoissonFilter");
+
+    m_cocProgram.init(builder.program(coc));
+    m_cocColourTex = m_cocProgram.uniform<GLint>("colourTex");
+    m_cocDepthTex = m_cocProgram.uniform<GLint>("depthTex");
+    m_cocDownsample = m_cocProgram.uniform<GLint>("downsample");
+    m_cocFocalDepth = m_cocProgram.uniform<GLfloat>("focalDepth");
+    m_cocBlurRadius = m_cocProgram.uniform<GLfloat>("blurRadius");
+    m_cocWindowSize = m_cocProgram.uniform<glm::vec2>("windowSize");
+    m_cocMVP = m_cocProgram.uniform<glm::mat4>("MVP");
+
+    m_blurProgram.init(builder.program(blur));
+    m_blurSourceTex = m_blurProgram.uniform<GLint>("sourceTex");
+    m_blurDirection = m_blurProgram.uniform<glm::vec2>("direction");
+    m_blurTargetSize = m_blurProgram.uniform<glm::vec2>("targetSize");
+    m_blurMVP = m_blurProgram.uniform<glm::mat4>("MVP");
+
+    m_compositeProgram.init(builder.program(composite));
+    m_compositeColourTex = m_compositeProgram.uniform<GLint>("colourTex");
+    m_compositeDepthTex = m_compositeProgram.uniform<GLint>("depthTex");
+    m_compositeBlurTex = m_compositeProgram.uniform<GLint>("blurTex");
+    m_compositeDownsample = m_compositeProgram.uniform<GLint>("downsample");
+    m_compositeFocalDepth = m_compositeProgram.uniform<GLfloat>("focalDepth");
+    m_compositeBlurRadius = m_compositeProgram.uniform<GLfloat>("blurRadius");
+    m_compositeWindowSize = m_compositeProgram.uniform<glm::vec2>("windowSize");
+    m_compositeBlurSize = m_compositeProgram.uniform<glm::vec2>("blurSize");
+    m_compositeMVP = m_compositeProgram.uniform<glm::mat4>("MVP");
 }
 
 /**
- * @brief DofScene::initFBO
+ * @brief DofScene::toggleBlurFilter
  */
-void DofScene::initFBO() {
-    // First delete the FBO if it has been created previously
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fboId);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER)==GL_FRAMEBUFFER_COMPLETE) {
-        glDeleteTextures(1, &m_fboTextureId);
-        glDeleteTextures(1, &m_fboDepthId);
-        glDeleteFramebuffers(1, &m_fboId);
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+void DofScene::toggleBlurFilter() {
+    setBlurFilter(BlurFilter((m_blurFilter + 1) % 3));
+}
 
-    // Generate a texture to write the FBO result to
-    glGenTextures(1, &m_fboTextureId);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, m_fboTextureId);
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_RGB,
-                 m_width,
-                 m_height,
-                 0,
-                 GL_RGB,
-                 GL_UNSIGNED_BYTE,
-                 NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(GL_TEXTURE_2D, 0);
+/**
+ * @brief DofScene::setBlurFilter
+ * @param filter The filter to use from the next frame
+ */
+void DofScene::setBlurFilter(BlurFilter filter) {
+    m_blurFilter = filter;
+    updateWorkload();
+}
 
-    // The depth buffer is rendered to a texture buffer too
-    glGenTextures(1, &m_fboDepthId);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, m_fboDepthId);
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_DEPTH_COMPONENT,
-                 m_width,
-                 m_height,
-                 0,
-                 GL_DEPTH_COMPONENT,
-                 GL_UNSIGNED_BYTE,
-                 NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(GL_TEXTURE_2D, 0);
+/**
+ * @brief DofScene::toggleDownsample
+ */
+void DofScene::toggleDownsample() {
+    m_downsample = (m_downsample == 2) ? 4 : 2;
+    updateWorkload();
+}
+
+/**
+ * @brief DofScene::scaleBlurRadius
+ * @param scale What to multiply the blur radius by
+ */
+void DofScene::scaleBlurRadius(GLfloat scale) {
+    m_blurRadius = std::max(0.001f, std::min(m_blurRadius * scale, 0.1f));
+    updateWorkload();
+}
 
-    // Create the frame buffer
-    glGenFramebuffers(1, &m_fboId);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fboId);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_fboTextureId, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_fboDepthId, 0);
+/**
+ * @brief DofScene::cycleNumObjects
+ */
+void DofScene::cycleNumObjects() {
+    m_numObjects = (m_numObjects >= MAX_OBJECTS) ? 5 : std::min(m_numObjects * 10, MAX_OBJECTS);
+    m_isObjectsDirty = true;
+}
 
-    // Set the fragment shader output targets (DEPTH_ATTACHMENT is done automatically)
-    GLenum drawBufs[] = {GL_COLOR_ATTACHMENT0};
-    glDrawBuffers(1, drawBufs);
+/**
+ * @brief DofScene::setNumObjects
+ * @param numObjects The number of teapots
+ */
+void DofScene::setNumObjects(int numObjects) {
+    m_numObjects = std::max(1, std::min(numObjects, MAX_OBJECTS));
+    m_isObjectsDirty = true;
+}
 
-    // Check it is ready to rock and roll
-    CheckFrameBuffer();
+/**
+ * @brief DofScene::objectTransform
+ * The teapots are cascaded in depth and x, starting a new row every OBJECTS_PER_ROW teapots. This is called from
+ * several threads when the instances are built.
+ * @param i The index of the teapot
+ * @param M The model matrix
+ * @param rgb The colour
+ */
+void DofScene::objectTransform(size_t i, glm::mat4 &M, glm::vec3 &rgb) const {
+    // Calculate colour by cycling in HSV colour space
+    hsv2rgb(rgb, glm::vec3(float(i) / float(m_numObjects), 1.0f, 1.0f));
+
+    // Translate in depth and x to get a cascade effect
+    float column = float(i % OBJECTS_PER_ROW);
+    float row = float(i / OBJECTS_PER_ROW);
+    M = glm::translate(glm::mat4(1.0f), glm::vec3(column + row, 0.0f, column - row));
+}
 
-    // Unbind the framebuffer to revert to default render pipeline
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+/**
+ * @brief DofScene::initObjects
+ */
+void DofScene::initObjects() {
+    // Drawn one at a time each teapot needs a block in the uniform ring, otherwise only the pass does
+    initUniformBlocks(m_instanced ? 1 : size_t(m_numObjects));
+    m_instances.build(size_t(m_numObjects), [this](size_t i, glm::mat4 &M, glm::vec3 &rgb) {
+        objectTransform(i, M, rgb);
+    });
+
+    updateWorkload();
+}
+
+/**
+ * @brief DofScene::updateWorkload
+ */
+void DofScene::updateWorkload() {
+    m_workload = std::to_string(m_numObjects) + (m_instanced ? " teapots instanced" : " teapots drawn one at a time");
+    switch (m_blurFilter) {
+    case BLUR_POISSON:
+        m_workload += ", Poisson blur";
+        break;
+    case BLUR_SEPARABLE:
+        m_workload += ", separable blur at 1/" + std::to_string(m_downsample) + " resolution";
+        break;
+    default:
+        m_workload += ", Gaussian blur";
+        break;
+    }
+    m_workload += " of radius " + std::to_string(m_blurRadius);
+    resetFrameTimer();
 }
 
 /**
  * @brief DofScene::paintGL
- * This is a two stage render process: firstly we render a bunch of teapots into our FBO, which
- * writes the colour and depth buffer areas to the textures m_fboTextureId and m_fboDepthId.
+ * This is a two stage render process: firstly we render a bunch of teapots into a target from the pool, which
+ * writes the colour and depth buffer areas to its textures.
  * In the second render pass we bind these two textures and draw a screen aligned plane with
  * these textures applied. The depth of field effect is made by combining these two stages on
  * the fragment shader.
  */
 void DofScene::paintGL() noexcept {
-    // Check if the FBO needs to be recreated. This occurs after a resize.
-    if (m_isFBODirty) {
-        initFBO();
-        m_isFBODirty = false;
+    TraceScope trace("DofScene::paintGL");
+
+    // Rebuild the uniform ring and the instances after the teapots change
+    if (m_isObjectsDirty) {
+        initObjects();
+        m_isObjectsDirty = false;
     }
+    timeFrame("DofScene", m_workload);
+    beginProfileFrame("DofScene");
 
-    // Bind the FBO to specify an alternative render target
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fboId);
-
-    // Set up the viewport
-    glViewport(0,0,m_width,m_height);
+    // Take a colour and depth target the size of the window from the pool, which also sets the viewport
+    m_renderTargets.beginFrame();
+    RenderTargetPool::Format format;
+    format.m_colour = GL_RGB8;
+    RenderTargetPool::Target *target = m_renderTargets.acquire(m_width, m_height, format);
+    beginPass("teapots");
+    target->bind();
 
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Use our shader for this draw
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-    (*shader)["GouraudProgram"]->use();
-
-    // Our MVP matrices
-    glm::mat4 MVP, MV;
-    glm::mat3 N;
+    // The light is fixed in eye space
+    beginUniformBlocks({m_V, m_P, glm::vec4(2.0f, 2.0f, 10.0f, 1.0f)});
 
     // Grab and instance of the VAO primitives path
     ngl::VAOPrimitives *prim=ngl::VAOPrimitives::instance();
 
-    // Needed for colour cycling
-    float colourStep = 1.0f / float(m_numObjects);
-    glm::vec3 hsv, rgb;
-
-    // Store the program id
-    GLint pid = shader->getProgramID("GouraudProgram");
-
-    int i;
-    for (i=0; i<m_numObjects; ++i) {
-        // Calculate colour by cycling in HSV colour space
-        hsv = glm::vec3(float(i) * colourStep, 1.0f, 1.0f);
-        hsv2rgb(rgb, hsv);
-
-        // Translate in depth and x to get a cascade effect
-        glm::mat4 M = glm::translate(glm::mat4(1.0f), glm::vec3(float(i), 0.0f, float(i)));
-
-        // Note the matrix multiplication order as we are in COLUMN MAJOR storage
-        MVP = m_P * m_V * M;
-        MV = m_V * M;
-        N = glm::inverse(glm::mat3(MV));
-
-        // Set this MVP on the GPU
-        glUniformMatrix4fv(glGetUniformLocation(pid, "MVP"), //location of uniform
-                           1, // how many matrices to transfer
-                           false, // whether to transpose matrix
-                           glm::value_ptr(MVP)); // a raw pointer to the data
-        glUniformMatrix4fv(glGetUniformLocation(pid, "MV"), //location of uniform
-                           1, // how many matrices to transfer
-                           false, // whether to transpose matrix
-                           glm::value_ptr(MV)); // a raw pointer to the data
-        glUniformMatrix3fv(glGetUniformLocation(pid, "N"), //location of uniform
-                           1, // how many matrices to transfer
-                           true, // whether to transpose matrix
-                           glm::value_ptr(N)); // a raw pointer to the data
-
-        glUniform3fv(glGetUniformLocation(pid, "Material.Kd"), 1, glm::value_ptr(rgb));
-
-        // Draw a teapot primitive
-        prim->draw("teapot");
-
+    // Our MVP matrices (the fields a draw doesn't set are left zeroed)
+    ObjectBlock object{};
+
+    if (m_instanced) {
+        // The block holds the matrices of the pass, and the shader multiplies in the model matrix of each teapot
+        m_instancedProgram.use();
+        object.m_MVP = m_P * m_V;
+        object.m_MV = m_V;
+        object.m_N = glm::mat4(glm::transpose(glm::inverse(glm::mat3(m_V))));
+        bindObjectBlock(pushObjectBlock(object));
+
+        // Draw all the teapots at once
+        m_instances.draw(prim->getVAOFromName("teapot"));
+    } else {
+        // Use our shader for this draw
+        m_gouraudProgram.use();
+
+        glm::mat4 M;
+        glm::vec3 rgb;
+        for (size_t i = 0; i < size_t(m_numObjects); ++i) {
+            // Find where the teapot goes and what colour it is
+            objectTransform(i, M, rgb);
+
+            // Note the matrix multiplication order as we are in COLUMN MAJOR storage
+            object.m_MVP = m_P * m_V * M;
+            object.m_MV = m_V * M;
+            object.m_N = glm::mat4(glm::transpose(glm::inverse(glm::mat3(object.m_MV))));
+            object.m_colour = glm::vec4(rgb, 1.0f);
+
+            // Write this teapot's block into the ring and point the shader at it
+            bindObjectBlock(pushObjectBlock(object));
+
+            // Draw a teapot primitive
+            prim->draw("teapot");
+        }
     }
+
     // Unbind our FBO
     glBindFramebuffer(GL_FRAMEBUFFER,0);
+    endPass();
+
+    // The separable blur has passes of its own
+    if (m_blurFilter == BLUR_SEPARABLE) {
+        separableBlur(target);
+        m_renderTargets.release(target);
+        endUniformBlocks();
+        return;
+    }
 
     // Find the depth of field shader
+    beginPass("blur");
     glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glViewport(0,0,m_width,m_height);
 
     // Now bind our rendered image which should be in the frame buffer for the next render pass
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, m_fboTextureId);
+    glBindTexture(GL_TEXTURE_2D, target->m_colour);
     glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, m_fboDepthId);
+    glBindTexture(GL_TEXTURE_2D, target->m_depth);
+
+    m_dofProgram.use();
+    m_colourTex.set(1);
+    m_depthTex.set(2);
+    m_focalDepthUniform.set(m_focalDepth);
+    m_blurRadiusUniform.set(m_blurRadius);
+    m_windowSize.set(glm::vec2(m_width, m_height));
+    m_uvScale.set(target->uvScale());
+    setShaderSubroutine();
 
-    (*shader)["DofProgram"]->use();
-    pid = shader->getProgramID("DofProgram");
+    m_planeMVP.set(glm::rotate(glm::mat4(1.0f), glm::pi<float>() * 0.5f, glm::vec3(1.0f,0.0f,0.0f)));
 
-    glUniform1i(glGetUniformLocation(pid, "colourTex"), 1);
-    glUniform1i(glGetUniformLocation(pid, "depthTex"), 2);
-    glUniform1f(glGetUniformLocation(pid, "focalDepth"), m_focalDepth);
-    glUniform1f(glGetUniformLocation(pid, "blurRadius"), m_blurRadius);
-    glUniform2f(glGetUniformLocation(pid, "windowSize"), m_width, m_height);
-    setShaderSubroutine();
+    prim->draw("plane");
+    glBindTexture(GL_TEXTURE_2D, 0);
+    endPass();
+    m_renderTargets.release(target);
 
-    MVP = glm::rotate(glm::mat4(1.0f), glm::pi<float>() * 0.5f, glm::vec3(1.0f,0.0f,0.0f));
-    glUniformMatrix4fv(glGetUniformLocation(pid, "MVP"), 1, false, glm::value_ptr(MVP));
+    // The GPU is now done with this frame's blocks once everything above has executed
+    endUniformBlocks();
+}
 
+/**
+ * @brief DofScene::separableBlur
+ * Each pass draws the screen aligned plane into a target from the pool, reading the last with texelFetch(). The blur
+ * of each pixel is carried in the alpha channel from the first pass to the composite, so the two blur passes only
+ * take as many taps as the pixel needs, and their cost grows linearly with the blur radius rather than with its
+ * square. The low resolution passes also have a quarter (or a sixteenth) of the pixels.
+ * @param target The colour and depth of the scene
+ */
+void DofScene::separableBlur(const RenderTargetPool::Target *target) {
+    ngl::VAOPrimitives *prim=ngl::VAOPrimitives::instance();
+    const glm::mat4 planeMVP = glm::rotate(glm::mat4(1.0f), glm::pi<float>() * 0.5f, glm::vec3(1.0f,0.0f,0.0f));
+    const GLsizei lowWidth = std::max(m_width / m_downsample, 1);
+    const GLsizei lowHeight = std::max(m_height / m_downsample, 1);
+    RenderTargetPool::Format format;
+    format.m_colour = GL_RGBA16F;
+    format.m_depth = GL_NONE;
+    format.m_filter = GL_NEAREST;
+
+    // Find the circle of confusion of each pixel while averaging the colour down to the lower resolution
+    beginPass("coc downsample");
+    RenderTargetPool::Target *low = m_renderTargets.acquire(lowWidth, lowHeight, format);
+    low->bind();
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, target->m_colour);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, target->m_depth);
+    m_cocProgram.use();
+    m_cocColourTex.set(1);
+    m_cocDepthTex.set(2);
+    m_cocDownsample.set(m_downsample);
+    m_cocFocalDepth.set(m_focalDepth);
+    m_cocBlurRadius.set(m_blurRadius);
+    m_cocWindowSize.set(glm::vec2(m_width, m_height));
+    m_cocMVP.set(planeMVP);
+    prim->draw("plane");
+    endPass();
+
+    // Blur along the rows into a second target, then along the columns back into the first
+    RenderTargetPool::Target *rows = m_renderTargets.acquire(lowWidth, lowHeight, format);
+    m_blurProgram.use();
+    m_blurSourceTex.set(1);
+    m_blurTargetSize.set(glm::vec2(lowWidth, lowHeight));
+    m_blurMVP.set(planeMVP);
+    glActiveTexture(GL_TEXTURE1);
+
+    beginPass("blur horizontal");
+    rows->bind();
+    glBindTexture(GL_TEXTURE_2D, low->m_colour);
+    m_blurDirection.set(glm::vec2(1.0f, 0.0f));
+    prim->draw("plane");
+    endPass();
+
+    beginPass("blur vertical");
+    low->bind();
+    glBindTexture(GL_TEXTURE_2D, rows->m_colour);
+    m_blurDirection.set(glm::vec2(0.0f, 1.0f));
+    prim->draw("plane");
+    endPass();
+    m_renderTargets.release(rows);
+
+    // Blend the sharp and blurred images in the window by the circle of confusion of each pixel
+    beginPass("composite");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0,0,m_width,m_height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, target->m_colour);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, target->m_depth);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, low->m_colour);
+    m_compositeProgram.use();
+    m_compositeColourTex.set(1);
+    m_compositeDepthTex.set(2);
+    m_compositeBlurTex.set(3);
+    m_compositeDownsample.set(m_downsample);
+    m_compositeFocalDepth.set(m_focalDepth);
+    m_compositeBlurRadius.set(m_blurRadius);
+    m_compositeWindowSize.set(glm::vec2(m_width, m_height));
+    m_compositeBlurSize.set(glm::vec2(lowWidth, lowHeight));
+    m_compositeMVP.set(planeMVP);
     prim->draw("plane");
     glBindTexture(GL_TEXTURE_2D, 0);
+    endPass();
+    m_renderTargets.release(low);
 }
 
 /**
@@ -232,27 +419,19 @@ void DofScene::paintGL() noexcept {
  * are all set at once using an array with the indices of each of the subroutines to use.
  */
 void DofScene::setShaderSubroutine() {
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-    (*shader)["DofProgram"]->use();
-    GLint pid = shader->getProgramID("DofProgram");
-
-    // Determine the different subroutine indices for our blur filters
-    GLuint GaussianFilter = glGetSubroutineIndex(pid, GL_FRAGMENT_SHADER, "GaussianFilter");
-    GLuint PoissonFilter = glGetSubroutineIndex(pid, GL_FRAGMENT_SHADER, "PoissonFilter");
-
-    // Technically these must all be set, but we should only have 1
+    // The subroutine indices of our blur filters were found when the program was loaded
     GLuint blurFilter;
     switch(m_blurFilter) {
     case BLUR_POISSON:
-        blurFilter = PoissonFilter;
+        blurFilter = m_poissonFilter;
         break;
     default:
-        blurFilter = GaussianFilter;
+        blurFilter = m_gaussianFilter;
         break;
     }
 
-    // Set the subroutine on the shader
-    glUniformSubroutinesuiv(GL_FRAGMENT_SHADER, 1, &blurFilter);
+    // Set the subroutine on the shader (which must be in use, as GL forgets the subroutines when it changes)
+    m_dofProgram.setSubroutine(GL_FRAGMENT_SHADER, blurFilter);
 }
 
 
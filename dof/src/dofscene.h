@@ -3,14 +3,19 @@
 
 // The parent class for this scene
 #include "scene.h"
+#include "shaderprogram.h"
+#include "instancebuffer.h"
+#include "rendertargetpool.h"
 
 #include <ngl/Obj.h>
 
 class DofScene : public Scene
 {
 public:
-    /// An enumerated type to allow the user to select an alternative blur function
-    typedef enum {BLUR_GAUSSIAN, BLUR_POISSON} BlurFilter;
+    /// An enumerated type to allow the user to select an alternative blur function. The Gaussian and Poisson filters
+    /// gather a 2D kernel for every pixel in one pass, while the separable blur works at a lower resolution over
+    /// several passes.
+    typedef enum {BLUR_GAUSSIAN, BLUR_POISSON, BLUR_SEPARABLE} BlurFilter;
 
     /// Construct our scene
     DofScene();
@@ -24,36 +29,101 @@ public:
     /// Set the depth for this DOF shader
     void setFocalDepth(const GLfloat &d) {m_focalDepth = d;}
 
-    /// Toggle which blurring filter is active
-    void toggleBlurFilter() {m_blurFilter = (m_blurFilter==BLUR_GAUSSIAN)?BLUR_POISSON:BLUR_GAUSSIAN;}
+    /// Cycle through the blurring filters, so that their frame times can be compared
+    void toggleBlurFilter();
 
-    /// Resize the window (must resize the FBO)
-    void resizeGL(GLint /*width*/, GLint /*height*/) noexcept;
+    /// Choose the blurring filter
+    void setBlurFilter(BlurFilter /*filter*/);
+
+    /// Switch the separable blur between half and quarter resolution
+    void toggleDownsample();
+
+    /// Scale the blur radius, to see how the cost of each filter grows with it
+    void scaleBlurRadius(GLfloat /*scale*/);
+
+    /// Toggle between one draw call per teapot and a single instanced draw call
+    void toggleInstancing() {m_instanced = !m_instanced; m_isObjectsDirty = true;}
+
+    /// Cycle the number of teapots through 5, 50, 500, 5000 and MAX_OBJECTS, to compare the cost of the two paths
+    void cycleNumObjects();
+
+    /// Draw a particular number of teapots (clamped to between 1 and MAX_OBJECTS), as the benchmark suite does
+    void setNumObjects(int /*numObjects*/);
 
 private:
-    /// Initialise the FBO
-    void initFBO();
+    /// The most teapots drawn, and the number in each row of the cascade
+    static constexpr int MAX_OBJECTS = 20000;
+    static constexpr size_t OBJECTS_PER_ROW = 64;
+
+    /// The model matrix and colour of a teapot, shared by both ways of drawing them
+    void objectTransform(size_t /*i*/, glm::mat4 &/*M*/, glm::vec3 &/*rgb*/) const;
+
+    /// Size the uniform ring and rebuild the instances after the number of teapots changes
+    void initObjects();
 
-    /// Keep track of whether the FBO needs to be recreated
-    bool m_isFBODirty = true;
+    /// Describe the teapots and the blur for the frame time report, and start the average again
+    void updateWorkload();
+
+    /// Blur the scene in target with the separable filter and composite it into the window: the circle of confusion
+    /// is found while downsampling, then blurred horizontally and vertically, and the result upsampled
+    void separableBlur(const RenderTargetPool::Target */*target*/);
 
     /// The number of objects to draw
     int m_numObjects = 5;
 
+    /// Whether the teapots are drawn with one instanced draw, and whether the objects need rebuilding
+    bool m_instanced = true;
+    bool m_isObjectsDirty = true;
+
+    /// The model matrices and colours of the teapots for the instanced draw
+    InstanceBuffer m_instances;
+
+    /// What is being drawn, for the frame time report
+    std::string m_workload;
+
     /// The focal depth
     GLfloat m_focalDepth = 1.0f;
 
     /// A weighting of the blur radius (bit like inverse focal length)
     GLfloat m_blurRadius = 0.01f;
 
-    /// Id's used for the frame buffer object and associated textures
-    GLuint m_fboId, m_fboTextureId, m_fboDepthId;
+    /// The targets of the passes, which follow the window size without being rebuilt on every resize
+    RenderTargetPool m_renderTargets;
 
     /// The default blur filter to use
     BlurFilter m_blurFilter = BLUR_GAUSSIAN;
 
+    /// How many full resolution pixels each pixel of the separable blur covers in x and y
+    GLint m_downsample = 2;
+
     /// Set the currently desired shader subroutine on the shader (from m_blurFilter)
     void setShaderSubroutine();
+
+    /// The programs used to shade the teapots one at a time and all at once. Both read the frame and object
+    /// uniform blocks, and the instanced one also reads the instance buffer.
+    ShaderProgram m_gouraudProgram, m_instancedProgram;
+
+    /// The depth of field program, its uniforms and the indices of the blur filter subroutines
+    ShaderProgram m_dofProgram;
+    ShaderProgram::Uniform<GLint> m_colourTex, m_depthTex;
+    ShaderProgram::Uniform<GLfloat> m_focalDepthUniform, m_blurRadiusUniform;
+    ShaderProgram::Uniform<glm::vec2> m_windowSize, m_uvScale;
+    ShaderProgram::Uniform<glm::mat4> m_planeMVP;
+    GLuint m_gaussianFilter, m_poissonFilter;
+
+    /// The passes of the separable blur and their uniforms
+    ShaderProgram m_cocProgram, m_blurProgram, m_compositeProgram;
+    ShaderProgram::Uniform<GLint> m_cocColourTex, m_cocDepthTex, m_cocDownsample;
+    ShaderProgram::Uniform<GLfloat> m_cocFocalDepth, m_cocBlurRadius;
+    ShaderProgram::Uniform<glm::vec2> m_cocWindowSize;
+    ShaderProgram::Uniform<glm::mat4> m_cocMVP;
+    ShaderProgram::Uniform<GLint> m_blurSourceTex;
+    ShaderProgram::Uniform<glm::vec2> m_blurDirection, m_blurTargetSize;
+    ShaderProgram::Uniform<glm::mat4> m_blurMVP;
+    ShaderProgram::Uniform<GLint> m_compositeColourTex, m_compositeDepthTex, m_compositeBlurTex, m_compositeDownsample;
+    ShaderProgram::Uniform<GLfloat> m_compositeFocalDepth, m_compositeBlurRadius;
+    ShaderProgram::Uniform<glm::vec2> m_compositeWindowSize, m_compositeBlurSize;
+    ShaderProgram::Uniform<glm::mat4> m_compositeMVP;
 };
 
 #endif // DOFSCENE_H
@@ -1,5 +1,7 @@
 // Must include our scene first because of GL dependency order
 #include "dofscene.h"
+#include "headlessrunner.h"
+#include "tracelog.h"
 #include "firstpersoncamera.h"
 #include "trackballcamera.h"
 #include "fixedcamera.h"
@@ -42,9 +44,24 @@ void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action, int
             g_focalDepth += (g_focalDepth < 3.0f)?0.1f:0.0f;
             g_scene.setFocalDepth(g_focalDepth);
             break;
-        case GLFW_KEY_B: // toggle blur filter method
+        case GLFW_KEY_B: // cycle the blur filter method
             g_scene.toggleBlurFilter();
             break;
+        case GLFW_KEY_H: // toggle half or quarter resolution for the separable blur
+            g_scene.toggleDownsample();
+            break;
+        case GLFW_KEY_MINUS: // decrease the blur radius
+            g_scene.scaleBlurRadius(0.5f);
+            break;
+        case GLFW_KEY_EQUAL: // increase the blur radius
+            g_scene.scaleBlurRadius(2.0f);
+            break;
+        case GLFW_KEY_I: // toggle instanced drawing
+            g_scene.toggleInstancing();
+            break;
+        case GLFW_KEY_N: // change the number of teapots
+            g_scene.cycleNumObjects();
+            break;
         }
     }
     // Any other keypress should be handled by our camera
@@ -60,7 +77,27 @@ void resize_callback(GLFWwindow */*window*/, int width, int height) {
     g_scene.resizeGL(width,height);
 }
 
-int main() {
+int main(int argc, char **argv) {
+    // Without a window, draw a scripted orbit of the scene and report the frame times (see HeadlessRunner)
+    HeadlessRunner::Options options;
+    options.m_glMinor = 3;
+    int exitCode;
+    if (HeadlessRunner::runIfRequested(argc, argv, g_scene, options, exitCode, [](const HeadlessRunner::Options &options) {
+        if (options.m_numObjects > 0) g_scene.setNumObjects(options.m_numObjects);
+        if (options.m_variant == "poisson") {
+            g_scene.setBlurFilter(DofScene::BLUR_POISSON);
+        } else if ((options.m_variant == "separable") || (options.m_variant == "separable-quarter")) {
+            g_scene.setBlurFilter(DofScene::BLUR_SEPARABLE);
+            if (options.m_variant == "separable-quarter") g_scene.toggleDownsample();
+        } else if (!options.m_variant.empty() && (options.m_variant != "gaussian")) {
+            std::cerr << "main() - unknown variant " << options.m_variant
+                      << " (gaussian, poisson, separable or separable-quarter)\n";
+        }
+    })) return exitCode;
+
+    // With --trace file.json, record where start up and each frame spend their time (see TraceLog)
+    if (!options.m_traceFile.empty()) TraceLog::start();
+
     if (!glfwInit()) {
         // Initialisation failed
         glfwTerminate();
@@ -88,6 +125,9 @@ int main() {
     // Make the window an OpenGL window
     glfwMakeContextCurrent(window);
 
+    // Don't wait for the vertical retrace, so the reported frame time is the cost of drawing
+    glfwSwapInterval(0);
+
     // Set keyboard callback
     glfwSetKeyCallback(window, key_callback);
 
@@ -114,7 +154,11 @@ int main() {
     std::cout << "******************* USAGE **************************\n"
               << "[: Decrease focal depth target\n"
               << "]: Increase focal depth target\n"
-              << "b: Switch blurring method (either Gaussian or Poisson)\n"              
+              << "b: Switch blurring method (Gaussian, Poisson or separable at a lower resolution)\n"
+              << "h: Run the separable blur at half or quarter resolution\n"
+              << "-/=: Halve or double the blur radius, to compare how the cost of each method grows\n"
+              << "i: Toggle drawing the teapots with one instanced draw call\n"
+              << "n: Change the number of teapots (5 to 20000), to compare the frame times\n"
               << "<ESC>: Quit\n"
               << "****************************************************\n";
     
@@ -144,4 +188,5 @@ int main() {
     // Close up shop
     glfwDestroyWindow(window);
     glfwTerminate();
+    if (!options.m_traceFile.empty()) TraceLog::write(options.m_traceFile);
 }
@@ -1,4 +1,5 @@
 #include "envscene.h"
+#include "tracelog.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <ngl/Obj.h>
@@ -11,6 +12,8 @@
 EnvScene::EnvScene() : Scene() {}
 
 void EnvScene::initGL() noexcept {
+    TraceScope trace("EnvScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -25,9 +28,11 @@ void EnvScene::initGL() noexcept {
 
     // Create and compile the vertex and fragment shader
     ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+    TraceLog::begin("loadShader");
     shader->loadShader("EnvironmentProgram",
                        "shaders/env_vert.glsl",
                        "shaders/env_frag.glsl");
+    TraceLog::end("loadShader");
 
     // Initialise our environment map here
     initEnvironment();
@@ -40,6 +45,8 @@ void EnvScene::initGL() noexcept {
 }
 
 void EnvScene::paintGL() noexcept {
+    TraceScope trace("EnvScene::paintGL");
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -1,4 +1,10 @@
 #include "finscene.h"
+#include "tracelog.h"
+#include "meshcache.h"
+#include "meshoptimiser.h"
+#include "meshlod.h"
+#include "meshlets.h"
+#include "programbuilder.h"
 
 // The headers below are needed to get matrices from GLM
 #include <glm/gtc/type_ptr.hpp>
@@ -10,12 +16,19 @@
 #include <ngl/VAOFactory.h>
 #include <ngl/ShaderLib.h>
 
+// The headers below are required to load the mesh and compute the normals
+#include <igl/per_vertex_normals.h>
+#include <igl/read_triangle_mesh.h>
+#include <Eigen/Core>
+
 FinScene::FinScene() : Scene() {
     m_finScale = 0.01f;
 }
 
 
 void FinScene::initGL() noexcept {
+    TraceScope trace("FinScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -31,49 +44,123 @@ void FinScene::initGL() noexcept {
     // enable multisampling for smoother drawing
     glEnable(GL_MULTISAMPLE);
 
-    // Create and compile the vertex and fragment shader
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-
-    // Create the basic shader used to render the scene with Gouraud shading
-    shader->loadShader("ToonShader",               // Name of program
-                       "shaders/toon_vert.glsl",   // Vertex shader
-                       "shaders/toon_frag.glsl");  // Fragment shader
-
-    // Build the curvature shader the old fashioned way as we have an additional pipeline stage
-    shader->createShaderProgram("FinShader");
-
-    shader->attachShader("FinVertex",ngl::ShaderType::VERTEX);
-    shader->loadShaderSource("FinVertex","shaders/fins_vert.glsl");
-
-    shader->attachShader("FinFragment",ngl::ShaderType::FRAGMENT);
-    shader->loadShaderSource("FinFragment","shaders/fins_frag.glsl");
-
-    shader->attachShader("FinGeometry",ngl::ShaderType::GEOMETRY);
-    shader->loadShaderSource("FinGeometry","shaders/fins_geo.glsl");
-
-    shader->compileShader("FinVertex");
-    shader->compileShader("FinFragment");
-    shader->compileShader("FinGeometry");
-    shader->attachShaderToProgram("FinShader","FinVertex");
-    shader->attachShaderToProgram("FinShader","FinFragment");
-    shader->attachShaderToProgram("FinShader","FinGeometry");
-    shader->linkProgramObject("FinShader");
+    // Queue the toon shader and the fin shader, which has an additional geometry stage. The linked programs are
+    // cached between runs, so they only need to be compiled when the sources or the driver change.
+    ProgramBuilder builder;
+    const size_t toon = builder.add("ToonShader", {{GL_VERTEX_SHADER, "shaders/toon_vert.glsl"},
+                                                   {GL_FRAGMENT_SHADER, "shaders/toon_frag.glsl"}});
+    const size_t fin = builder.add("FinShader", {{GL_VERTEX_SHADER, "shaders/fins_vert.glsl"},
+                                                 {GL_GEOMETRY_SHADER, "shaders/fins_geo.glsl"},
+                                                 {GL_FRAGMENT_SHADER, "shaders/fins_frag.glsl"}});
+
+    // Load the Obj file and create a Vertex Array Object while they compile
+    buildVAO();
+    builder.finish();
+    m_toonProgram.init(builder.program(toon));
+    m_finProgram.init(builder.program(fin));
+
+    // Look up the uniforms once, rather than by name every frame
+    m_toonMVP = m_toonProgram.uniform<glm::mat4>("MVP");
+    m_toonMV = m_toonProgram.uniform<glm::mat4>("MV");
+    m_toonN = m_toonProgram.uniform<glm::mat3>("N");
+    m_finMVP = m_finProgram.uniform<glm::mat4>("MVP");
+    m_finN = m_finProgram.uniform<glm::mat3>("N");
+    m_finScaleUniform = m_finProgram.uniform<GLfloat>("finScale");
+}
 
-    // Load the Obj file and create a Vertex Array Object
-    m_mesh.reset(new ngl::Obj("../common/models/dragon_lowres.obj"));
-    m_mesh->createVAO();
+/**
+ * @brief FinScene::buildVAO
+ * Creates an indexed Vertex Array Object of the positions and normals of our mesh. The processed mesh
+ * is stored in a binary cache next to the source file, so after the first run nothing needs to be parsed.
+ */
+void FinScene::buildVAO() {
+    TraceScope trace("FinScene::buildVAO");
+
+    // Register a new VAO factory for our indexed buffer array object
+    ngl::VAOFactory::registerVAOCreator("multiBufferIndexVAO", MultiBufferIndexVAO::create);
+
+    std::string filename = "../common/models/dragon_lowres.obj";
+
+    typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixXfr;
+    typedef Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixXir;
+
+    const GLfloat *vertexData;
+    const GLuint *indexData;
+    GLuint v_cnt, f_cnt;
+    MatrixXfr Vertices;
+    MatrixXir F;
+    std::vector<std::uint32_t> lodIndices;
+
+    const unsigned int attributes = MeshCache::ATTRIB_POSITION | MeshCache::ATTRIB_NORMAL;
+    MeshCache cache;
+    if (cache.open(filename, attributes)) {
+        vertexData = cache.vertices();
+        indexData = cache.indices();
+        v_cnt = cache.numVertices() * cache.floatsPerVertex();
+        f_cnt = cache.numIndices();
+        m_levels.assign(cache.levels(), cache.levels() + cache.numLevels());
+        m_meshlets.assign(cache.meshlets(), cache.meshlets() + cache.numMeshlets());
+    } else {
+        // Read the mesh and compute the smooth vertex normals
+        MatrixXfr V, N;
+        igl::read_triangle_mesh(filename, V, F);
+        igl::per_vertex_normals(V,F,N);
+
+        Vertices.resize(V.rows(), V.cols() + N.cols());
+        Vertices << V, N;
+
+        // Reorder the triangles for the vertex cache and the vertices for fetch locality
+        MeshOptimiser::optimise(filename.c_str(),
+                                reinterpret_cast<std::uint32_t*>(F.data()), F.size(),
+                                Vertices.data(), Vertices.rows(), Vertices.cols());
+
+        // Simplify the mesh into a chain of levels of detail which all index the same vertices
+        m_levels = MeshLOD::build(reinterpret_cast<std::uint32_t*>(F.data()), F.size(),
+                                  Vertices.data(), Vertices.rows(), Vertices.cols(), lodIndices);
+        MeshLOD::report(filename.c_str(), m_levels.data(), m_levels.size());
+
+        // Split each level into meshlets which can be culled on their own
+        m_meshlets = Meshlets::build(lodIndices.data(), m_levels.data(), m_levels.size(),
+                                     Vertices.data(), Vertices.rows(), Vertices.cols());
+
+        vertexData = Vertices.data();
+        indexData = lodIndices.data();
+        v_cnt = Vertices.rows() * Vertices.cols();
+        f_cnt = lodIndices.size();
+        MeshCache::write(filename, attributes, vertexData, Vertices.rows(), indexData, f_cnt,
+                         m_levels.data(), m_levels.size(), m_meshlets.data(), m_meshlets.size());
+    }
+
+    // create a vao as a series of GL_TRIANGLES
+    m_vao = ngl::VAOFactory::createVAO("multiBufferIndexVAO", GL_TRIANGLES);
+    m_vao->bind();
+    static_cast<MultiBufferIndexVAO *>( m_vao.get())->setData(v_cnt * sizeof(float), vertexData);
+
+    // Each level of detail can be drawn on its own with setPart(), and each of its meshlets with drawClusters()
+    std::vector<GLuint> levelMeshlets, meshletSizes;
+    for (const MeshLOD::Level &level : m_levels) levelMeshlets.push_back(level.m_numMeshlets);
+    for (const Meshlets::Meshlet &meshlet : m_meshlets) meshletSizes.push_back(meshlet.m_numIndices);
+    const GLuint floatsPerVertex = MeshCache::floatsPerVertex(attributes);
+    const GLuint numVertices = v_cnt / floatsPerVertex;
+    static_cast<MultiBufferIndexVAO *>( m_vao.get())->setClusterIndices(levelMeshlets, meshletSizes, indexData, numVertices);
+    MeshLOD::boundingSphere(vertexData, numVertices, floatsPerVertex, glm::value_ptr(m_centre), m_radius);
+
+    // Positions and normals are interleaved in each record
+    const GLsizei stride = floatsPerVertex * sizeof(GLfloat);
+    m_vao->setVertexAttributePointer(0, 3, GL_FLOAT, stride, MeshCache::attributeOffset(attributes, MeshCache::ATTRIB_POSITION), false);
+    m_vao->setVertexAttributePointer(1, 3, GL_FLOAT, stride, MeshCache::attributeOffset(attributes, MeshCache::ATTRIB_NORMAL), true);
+    m_vao->unbind();
 }
 
 void FinScene::paintGL() noexcept {
+    TraceScope trace("FinScene::paintGL");
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // Set up the viewport
     glViewport(0,0,m_width,m_height);
 
-    // Use our shader for this draw
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-
     // Our MVP matrices
     glm::mat4 M, MVP, MV;
     glm::mat3 N;
@@ -83,36 +170,55 @@ void FinScene::paintGL() noexcept {
     MV = m_V * M;
     N = glm::inverse(glm::mat3(MV));
 
-    (*shader)["ToonShader"]->use();
-    GLint pid = shader->getProgramID("ToonShader");
-    // Set this MVP on the GPU
-    glUniformMatrix4fv(glGetUniformLocation(pid, "MVP"), //location of uniform
-                       1, // how many matrices to transfer
-                       false, // whether to transpose matrix
-                       glm::value_ptr(MVP)); // a raw pointer to the data
-    glUniformMatrix4fv(glGetUniformLocation(pid, "MV"), //location of uniform
-                       1, // how many matrices to transfer
-                       false, // whether to transpose matrix
-                       glm::value_ptr(MV)); // a raw pointer to the data
-    glUniformMatrix3fv(glGetUniformLocation(pid, "N"), //location of uniform
-                       1, // how many matrices to transfer
-                       true, // whether to transpose matrix
-                       glm::value_ptr(N)); // a raw pointer to the data
-    m_mesh->draw();
-
-    (*shader)["FinShader"]->use();
-    pid = shader->getProgramID("FinShader");
-    glUniformMatrix4fv(glGetUniformLocation(pid, "MVP"), //location of uniform
-                       1, // how many matrices to transfer
-                       false, // whether to transpose matrix
-                       glm::value_ptr(MVP)); // a raw pointer to the data
-    glUniformMatrix3fv(glGetUniformLocation(pid, "N"), //location of uniform
-                       1, // how many matrices to transfer
-                       true, // whether to transpose matrix
-                       glm::value_ptr(N)); // a raw pointer to the data
-    glUniform1f(glGetUniformLocation(pid,"finScale"), m_finScale);
-
-
-    // Draw our Obj mesh
-    m_mesh->draw();
+    // Draw the coarsest level of detail whose error is less than a pixel, measured at the nearest point of the
+    // bounding sphere
+    size_t level = 0;
+    if (m_useLOD) {
+        float scale = glm::length(glm::vec3(MV[0]));
+        float distance = glm::length(glm::vec3(MV * glm::vec4(m_centre, 1.0f))) - m_radius * scale;
+        float pixelsPerUnit = 0.5f * float(m_height) * m_P[1][1] * scale;
+        level = MeshLOD::selectLevel(m_levels.data(), m_levels.size(), distance, pixelsPerUnit);
+    }
+    MultiBufferIndexVAO *vao = static_cast<MultiBufferIndexVAO *>(m_vao.get());
+    vao->setPart(level);
+
+    // Find the meshlets of this level which are inside the frustum, and of those the ones facing the eye. The fins
+    // are extruded from the vertex normals, so they can grow from triangles which face away and only use the frustum.
+    const MeshLOD::Level &lod = m_levels[level];
+    const bool cull = m_cullMeshlets && (lod.m_numMeshlets > 0);
+    if (cull) {
+        glm::vec4 eye = glm::inverse(MV) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        Meshlets::cull(m_meshlets.data() + lod.m_firstMeshlet, lod.m_numMeshlets,
+                       glm::value_ptr(MVP), glm::value_ptr(eye), m_visible, m_cullStats);
+        Meshlets::cull(m_meshlets.data() + lod.m_firstMeshlet, lod.m_numMeshlets,
+                       glm::value_ptr(MVP), nullptr, m_finVisible, m_finCullStats);
+        if (m_cullStats.m_frames == 300) {
+            Meshlets::report("FinScene", m_cullStats);
+            Meshlets::report("FinScene fins", m_finCullStats);
+        }
+    }
+
+    m_toonProgram.use();
+    m_toonMVP.set(MVP);
+    m_toonMV.set(MV);
+    m_toonN.setTransposed(N);
+    m_vao->bind();
+    if (cull) {
+        vao->drawClusters(m_visible.data(), m_visible.size());
+    } else {
+        m_vao->draw();
+    }
+
+    m_finProgram.use();
+    m_finMVP.set(MVP);
+    m_finN.setTransposed(N);
+    m_finScaleUniform.set(m_finScale);
+
+    // Draw our mesh
+    if (cull) {
+        vao->drawClusters(m_finVisible.data(), m_finVisible.size());
+    } else {
+        m_vao->draw();
+    }
+    m_vao->unbind();
 }
@@ -3,7 +3,11 @@
 
 // The parent class for this scene
 #include "scene.h"
+#include "shaderprogram.h"
 #include <ngl/Obj.h>
+#include "MultiBufferIndexVAO.h"
+#include "meshlod.h"
+#include "meshlets.h"
 
 class FinScene : public Scene {
 public:
@@ -20,14 +24,42 @@ public:
     void increaseFins() {m_finScale += m_finScaleIncrement;}
     void decreaseFins() {m_finScale = ((m_finScale-m_finScaleIncrement) < 0.0f)?0.0f:m_finScale - m_finScaleIncrement;}
 
+    /// Toggle whether the level of detail is chosen from the distance, or the full resolution mesh is always drawn
+    void toggleLOD() {m_useLOD = !m_useLOD;}
+
+    /// Toggle whether the meshlets outside the view or facing away are culled
+    void toggleCulling() {m_cullMeshlets = !m_cullMeshlets;}
+
 private:
-    /// A unique pointer storing our mesh object
-    std::unique_ptr<ngl::Obj> m_mesh;
+    /// Store a unique pointer to the vertex array object holding our mesh
+    std::unique_ptr<ngl::AbstractVAO> m_vao;
+
+    /// Build the Vertex Array Object from the mesh (or its cache)
+    void buildVAO();
 
     /// The scalable value for the fin scaling
     GLfloat m_finScale;
 
     const GLfloat m_finScaleIncrement = 0.001;
+
+    /// The levels of detail of the mesh, and the bounding sphere used to choose between them
+    std::vector<MeshLOD::Level> m_levels;
+    glm::vec3 m_centre = glm::vec3(0.0f);
+    float m_radius = 0.0f;
+    bool m_useLOD = true;
+
+    /// The meshlets of every level, the ones which survived culling this frame for the shaded mesh and the fins,
+    /// and the number of triangles culled from each
+    std::vector<Meshlets::Meshlet> m_meshlets;
+    std::vector<std::uint32_t> m_visible, m_finVisible;
+    Meshlets::CullStats m_cullStats, m_finCullStats;
+    bool m_cullMeshlets = true;
+
+    /// The programs which shade the mesh and extrude the fins, and their uniforms
+    ShaderProgram m_toonProgram, m_finProgram;
+    ShaderProgram::Uniform<glm::mat4> m_toonMVP, m_toonMV, m_finMVP;
+    ShaderProgram::Uniform<glm::mat3> m_toonN, m_finN;
+    ShaderProgram::Uniform<GLfloat> m_finScaleUniform;
 };
 
 #endif // FINSCENE_H
@@ -1,5 +1,7 @@
 // Must include our scene first because of GL dependency order
 #include "finscene.h"
+#include "headlessrunner.h"
+#include "tracelog.h"
 #include "trackballcamera.h"
 #include "fixedcamera.h"
 
@@ -39,6 +41,12 @@ void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action, int
         case GLFW_KEY_RIGHT_BRACKET: // increase fin size
             g_scene.increaseFins();
             break;
+        case GLFW_KEY_L: // toggle the level of detail selection
+            g_scene.toggleLOD();
+            break;
+        case GLFW_KEY_C: // toggle the meshlet culling
+            g_scene.toggleCulling();
+            break;
         }
     }
     // Any other keypress should be handled by our camera
@@ -54,7 +62,16 @@ void resize_callback(GLFWwindow */*window*/, int width, int height) {
     g_scene.resizeGL(width,height);
 }
 
-int main() {
+int main(int argc, char **argv) {
+    // Without a window, draw a scripted orbit of the scene and report the frame times (see HeadlessRunner)
+    HeadlessRunner::Options options;
+    options.m_glMinor = 3;
+    int exitCode;
+    if (HeadlessRunner::runIfRequested(argc, argv, g_scene, options, exitCode)) return exitCode;
+
+    // With --trace file.json, record where start up and each frame spend their time (see TraceLog)
+    if (!options.m_traceFile.empty()) TraceLog::start();
+
     if (!glfwInit()) {
         // Initialisation failed
         glfwTerminate();
@@ -109,6 +126,8 @@ int main() {
     std::cout << "******************* USAGE **************************\n"
               << "[: Decrease fin size\n"
               << "]: Increase fin size\n"              
+              << "L: Toggle level of detail selection\n"
+              << "C: Toggle meshlet culling\n"
               << "<ESC>: Quit\n"
               << "****************************************************\n";  
 
@@ -138,4 +157,5 @@ int main() {
     // Close up shop
     glfwDestroyWindow(window);
     glfwTerminate();
+    if (!options.m_traceFile.empty()) TraceLog::write(options.m_traceFile);
 }
@@ -11,12 +11,21 @@ TARGET = fractal
 HEADERS += src/fractalscene.h \
            ../common/include/camera.h \
            ../common/include/trackballcamera.h \
-           ../common/include/scene.h
+           ../common/include/scene.h \
+           ../common/include/fixedcamera.h \
+           ../common/include/headlessrunner.h \
+           ../common/include/tracelog.h \
+           ../common/include/bufferhash.h \
+           ../common/include/fnv1a.h
 
 SOURCES += src/main.cpp src/fractalscene.cpp \
            ../common/src/camera.cpp \
            ../common/src/trackballcamera.cpp \
-           ../common/src/scene.cpp
+           ../common/src/scene.cpp \
+           ../common/src/fixedcamera.cpp \
+           ../common/src/headlessrunner.cpp \
+           ../common/src/tracelog.cpp \
+           ../common/src/bufferhash.cpp
 
 OTHER_FILES += shaders/fractal_vert.glsl \
 	       shaders/fractal_frag.glsl
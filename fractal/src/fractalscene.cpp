@@ -1,4 +1,5 @@
 #include "fractalscene.h"
+#include "tracelog.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <ngl/Obj.h>
@@ -13,6 +14,8 @@ FractalScene::FractalScene() : Scene() {
 
 
 void FractalScene::initGL() noexcept {
+    TraceScope trace("FractalScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -27,9 +30,11 @@ void FractalScene::initGL() noexcept {
 
     // Create and compile the vertex and fragment shader
     ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+    TraceLog::begin("loadShader");
     shader->loadShader("FractalProgram",
                        "shaders/fractal_vert.glsl",
                        "shaders/fractal_frag.glsl");
+    TraceLog::end("loadShader");
 
     // Create a screen oriented plane
     ngl::VAOPrimitives *prim=ngl::VAOPrimitives::instance();
@@ -37,6 +42,8 @@ void FractalScene::initGL() noexcept {
 }
 
 void FractalScene::paintGL() noexcept {
+    TraceScope trace("FractalScene::paintGL");
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -52,8 +59,7 @@ void FractalScene::paintGL() noexcept {
     // For animating scenes we need to send an elapsed time to the shader
     double t = 0.0;
     if (m_animating) {
-        auto now = std::chrono::high_resolution_clock::now();
-        t = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_startTime).count()  * 0.001;
+        t = elapsedTime(m_startTime);
     }
     glUniform1f(glGetUniformLocation(pid, "t"), t);
 
@@ -1,5 +1,7 @@
 // Must include our scene first because of GL dependency order
 #include "fractalscene.h"
+#include "headlessrunner.h"
+#include "tracelog.h"
 
 // This will probably already be included by a scene file
 //#include "glinclude.h"
@@ -105,7 +107,16 @@ void resize_callback(GLFWwindow */*window*/, int width, int height) {
  * @brief main The main application loop
  * @return Whatever glfw returns when you glfwTerminate()
  */
-int main() {
+int main(int argc, char **argv) {
+    // Without a window, draw a scripted orbit of the scene and report the frame times (see HeadlessRunner)
+    HeadlessRunner::Options options;
+    options.m_width = 1024; options.m_height = 768;
+    int exitCode;
+    if (HeadlessRunner::runIfRequested(argc, argv, g_scene, options, exitCode)) return exitCode;
+
+    // With --trace file.json, record where start up and each frame spend their time (see TraceLog)
+    if (!options.m_traceFile.empty()) TraceLog::start();
+
     if (!glfwInit()) {
         // Initialisation failed
         glfwTerminate();        
@@ -199,4 +210,5 @@ int main() {
     // Close up shop
     glfwDestroyWindow(window);
     glfwTerminate();
+    if (!options.m_traceFile.empty()) TraceLog::write(options.m_traceFile);
 }
@@ -0,0 +1,18 @@
+# The golden image tests start each demo with --headless, so they only need zlib to read and write the PNG files
+TEMPLATE = app
+TARGET = golden
+
+CONFIG += console c++11 debug
+CONFIG -= qt app_bundle
+
+OBJECTS_DIR = obj
+
+LIBS += -lz
+
+# Input
+SOURCES += src/main.cpp \
+           src/goldensuite.cpp \
+           src/pngimage.cpp
+
+HEADERS += src/goldensuite.h \
+           src/pngimage.h
@@ -0,0 +1,258 @@
+#include "goldensuite.h"
+#include "pngimage.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**
+ * @brief GoldenSuite::GoldenSuite
+ */
+GoldenSuite::GoldenSuite() {
+    m_scenes = {"phong", "dof", "shadows", "sdf", "fractal", "fins", "morph", "curv", "noise", "wood",
+                "environment", "shadermaps", "bump", "3dtex", "objviewer"};
+}
+
+/**
+ * @brief GoldenSuite::usage
+ * @param program The name of the executable
+ */
+void GoldenSuite::usage(const char *program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --root DIR              The directory holding the built demos (default ..)\n"
+              << "  --references DIR        The reference images and hashes (default references)\n"
+              << "  --out DIR               Where the new images, hashes and differences go (default results)\n"
+              << "  --scenes a,b,...        The demos to check (default all of them)\n"
+              << "  --size WxH              The framebuffer size (default 320x240)\n"
+              << "  --time S                The time the animated scenes are drawn at (default 1)\n"
+              << "  --threshold DB          The lowest PSNR which passes (default 40)\n"
+              << "  --update                Record new references instead of comparing\n";
+}
+
+/**
+ * @brief GoldenSuite::parseArgs
+ * @param argc The argument count from main()
+ * @param argv The arguments from main()
+ * @return false if an option was unknown or malformed
+ */
+bool GoldenSuite::parseArgs(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        const bool hasValue = (i + 1 < argc);
+        if ((arg == "--root") && hasValue) {
+            m_rootDir = argv[++i];
+        } else if ((arg == "--references") && hasValue) {
+            m_refDir = argv[++i];
+        } else if ((arg == "--out") && hasValue) {
+            m_outDir = argv[++i];
+        } else if ((arg == "--scenes") && hasValue) {
+            m_scenes = split(argv[++i]);
+        } else if ((arg == "--size") && hasValue) {
+            if ((sscanf(argv[++i], "%dx%d", &m_width, &m_height) != 2) || (m_width <= 0) || (m_height <= 0)) {
+                std::cerr << "GoldenSuite::parseArgs() - expected WxH, not " << argv[i] << "\n";
+                return false;
+            }
+        } else if ((arg == "--time") && hasValue) {
+            m_time = std::max(0.0, atof(argv[++i]));
+        } else if ((arg == "--threshold") && hasValue) {
+            m_threshold = atof(argv[++i]);
+        } else if (arg == "--update") {
+            m_update = true;
+        } else {
+            std::cerr << "GoldenSuite::parseArgs() - unknown option " << arg << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief GoldenSuite::exec
+ * The output of the demos goes to a log file in the results directory, to keep the console readable.
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if any demo failed to run or differed from its references
+ */
+int GoldenSuite::exec() {
+    // The demos run in their own directories, so the files they write need absolute paths
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) == nullptr) {
+        std::cerr << "GoldenSuite::exec() - could not find the working directory\n";
+        return EXIT_FAILURE;
+    }
+    const std::string refDir = (m_refDir[0] == '/') ? m_refDir : std::string(cwd) + "/" + m_refDir;
+    const std::string outDir = (m_outDir[0] == '/') ? m_outDir : std::string(cwd) + "/" + m_outDir;
+    if (m_update) mkdir(refDir.c_str(), 0755);
+    mkdir(outDir.c_str(), 0755);
+    const std::string logFile = outDir + "/golden.log";
+    std::ofstream(logFile.c_str(), std::ios::trunc);
+
+    int numFailed = 0, numRecorded = 0;
+    for (size_t i = 0; i < m_scenes.size(); ++i) {
+        std::cout << "[" << (i + 1) << "/" << m_scenes.size() << "] " << m_scenes[i] << std::flush;
+        switch (check(m_scenes[i], refDir, outDir, logFile)) {
+        case FAILED: ++numFailed; break;
+        case RECORDED: ++numRecorded; break;
+        case PASSED: break;
+        }
+    }
+    std::cout << (m_scenes.size() - size_t(numFailed) - size_t(numRecorded)) << " passed, " << numFailed
+              << " failed, " << numRecorded << " recorded\n";
+    return (numFailed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * @brief GoldenSuite::check
+ * A few frames are drawn before the one compared, so that anything a scene builds over its first frames (such as
+ * the blend of the morph targets) has settled. The camera stays at its start position until the last frame.
+ * @param scene The demo, which is also its directory and executable name
+ * @param refDir The directory of the references
+ * @param outDir Where the new image, hashes and difference image are written
+ * @param logFile The file collecting the output of the demos
+ * @return Whether the demo matched its references, or had them recorded with --update
+ */
+GoldenSuite::Result GoldenSuite::check(const std::string &scene,
+                                       const std::string &refDir,
+                                       const std::string &outDir,
+                                       const std::string &logFile) const {
+    const std::string ppmFile = outDir + "/" + scene + ".ppm";
+    const std::string pngFile = outDir + "/" + scene + ".png";
+    const std::string hashFile = outDir + "/" + scene + ".hashes";
+    const std::string refPNGFile = refDir + "/" + scene + ".png";
+    const std::string refHashFile = refDir + "/" + scene + ".hashes";
+    remove(ppmFile.c_str());
+    remove(hashFile.c_str());
+
+    std::ostringstream command;
+    command << "(cd '" << m_rootDir << "/" << scene << "' && './" << scene << "' --headless --frames 1 --warmup 2"
+            << " --size " << m_width << "x" << m_height << " --time " << m_time
+            << " --image '" << ppmFile << "' --hashes '" << hashFile << "') >> '" << logFile << "' 2>&1";
+    PNGImage image;
+    if ((std::system(command.str().c_str()) != 0) || !image.readPPM(ppmFile)) {
+        std::cout << ": failed to run (see " << logFile << ")\n";
+        return FAILED;
+    }
+    remove(ppmFile.c_str());
+    image.writePNG(pngFile);
+
+    // Record the references only if asked to. Missing ones are a failure, otherwise a suite run without any
+    // references (or with the wrong --references directory) would pass without comparing anything.
+    if (m_update) {
+        if (!image.writePNG(refPNGFile) || !copyFile(hashFile, refHashFile)) {
+            std::cout << ": could not record the references\n";
+            return FAILED;
+        }
+        std::cout << ": recorded\n";
+        return RECORDED;
+    }
+    if (!std::ifstream(refPNGFile.c_str()).good() || !std::ifstream(refHashFile.c_str()).good()) {
+        std::cout << ": no references in " << refDir << " (run with --update to record them)\n";
+        return FAILED;
+    }
+    PNGImage reference;
+    if (!reference.readPNG(refPNGFile)) {
+        std::cout << ": could not read " << refPNGFile << "\n";
+        return FAILED;
+    }
+
+    bool isPassed = true;
+    if ((reference.m_width != image.m_width) || (reference.m_height != image.m_height)) {
+        std::cout << ": the reference is " << reference.m_width << "x" << reference.m_height << "\n";
+        isPassed = false;
+    } else {
+        const double psnr = PNGImage::psnr(reference, image);
+        std::cout << ": PSNR ";
+        if (std::isinf(psnr)) {
+            std::cout << "identical";
+        } else {
+            std::ostringstream decibels;
+            decibels << std::fixed << std::setprecision(1) << psnr << " dB";
+            std::cout << decibels.str();
+        }
+        if (psnr < m_threshold) {
+            const std::string diffFile = outDir + "/" + scene + "_diff.png";
+            PNGImage::difference(reference, image).writePNG(diffFile);
+            std::cout << " is below " << m_threshold << " dB (see " << diffFile << ")";
+            isPassed = false;
+        }
+        std::cout << "\n";
+    }
+    if (!compareHashes(refHashFile, hashFile)) isPassed = false;
+    return isPassed ? PASSED : FAILED;
+}
+
+/**
+ * @brief GoldenSuite::compareHashes
+ * Each line is the name, size and hash of a buffer, in the order the demo made them.
+ * @param refFile The stored hashes
+ * @param newFile The hashes of this run
+ * @return true if every line matches
+ */
+bool GoldenSuite::compareHashes(const std::string &refFile, const std::string &newFile) {
+    std::vector<std::string> refLines, newLines;
+    if (!readLines(refFile, refLines) || !readLines(newFile, newLines)) return false;
+    bool isMatched = true;
+    const size_t numLines = std::max(refLines.size(), newLines.size());
+    for (size_t i = 0; i < numLines; ++i) {
+        if ((i < refLines.size()) && (i < newLines.size()) && (refLines[i] == newLines[i])) continue;
+        std::cout << "    buffer " << (i + 1) << " differs: "
+                  << ((i < refLines.size()) ? refLines[i] : std::string("(none)")) << " -> "
+                  << ((i < newLines.size()) ? newLines[i] : std::string("(none)")) << "\n";
+        isMatched = false;
+    }
+    if (!newLines.empty() && isMatched) std::cout << "    " << newLines.size() << " buffer hashes match\n";
+    return isMatched;
+}
+
+/**
+ * @brief GoldenSuite::readLines
+ * @param fileName The text file
+ * @param lines Its lines
+ * @return false if it couldn't be read
+ */
+bool GoldenSuite::readLines(const std::string &fileName, std::vector<std::string> &lines) {
+    std::ifstream file(fileName.c_str());
+    if (!file.good()) {
+        std::cout << "    could not read " << fileName << "\n";
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) lines.push_back(line);
+    return true;
+}
+
+/**
+ * @brief GoldenSuite::copyFile
+ * @param from The file to copy
+ * @param to The copy, which is replaced
+ * @return true if the copy was written
+ */
+bool GoldenSuite::copyFile(const std::string &from, const std::string &to) {
+    std::ifstream in(from.c_str(), std::ios::binary);
+    if (!in.good()) return false;
+    const std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::ofstream out(to.c_str(), std::ios::binary | std::ios::trunc);
+    out << contents;
+    out.close();
+    return out.good();
+}
+
+/**
+ * @brief GoldenSuite::split
+ * @param list A comma separated list
+ * @return The items, skipping empty ones
+ */
+std::vector<std::string> GoldenSuite::split(const std::string &list) {
+    std::vector<std::string> items;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
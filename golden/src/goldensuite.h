@@ -0,0 +1,63 @@
+#ifndef GOLDENSUITE_H
+#define GOLDENSUITE_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief The GoldenSuite class
+ * Checks that a change hasn't altered what the demos draw, so that a faster way of baking noise, packing meshes or
+ * rendering a pass can be accepted safely. Each demo is started with --headless (see HeadlessRunner) from its own
+ * directory and draws a few frames at a small size, with the clock of the animated scenes stopped at a fixed time.
+ * Its last frame is compared with a reference PNG by its peak signal to noise ratio, which allows for the small
+ * differences between drivers, and the hashes of the buffers it made on the CPU (see BufferHash) must match the
+ * stored ones exactly, as those don't depend on the GPU at all. A demo without references fails, so a missing file
+ * can't pass unnoticed: --update records them (see golden/README.md), both for a new demo and once a change in the
+ * output is intended.
+ */
+class GoldenSuite
+{
+public:
+    /// Check every demo by default
+    GoldenSuite();
+
+    /// Read the command line. Returns false if it couldn't be understood.
+    bool parseArgs(int /*argc*/, char **/*argv*/);
+
+    /// Run the checks, returning the exit code for main()
+    int exec();
+
+    /// Print the command line options
+    static void usage(const char */*program*/);
+
+private:
+    /// The outcome of checking a demo
+    enum Result {PASSED, FAILED, RECORDED};
+
+    /// Render one demo and compare it with its references
+    Result check(const std::string &/*scene*/, const std::string &/*refDir*/, const std::string &/*outDir*/,
+                 const std::string &/*logFile*/) const;
+
+    /// Compare two hash files written by BufferHash, printing the buffers which differ. Returns true if they match.
+    static bool compareHashes(const std::string &/*refFile*/, const std::string &/*newFile*/);
+
+    /// Read the lines of a text file
+    static bool readLines(const std::string &/*fileName*/, std::vector<std::string> &/*lines*/);
+
+    /// Copy a text file
+    static bool copyFile(const std::string &/*from*/, const std::string &/*to*/);
+
+    /// Split a comma separated list
+    static std::vector<std::string> split(const std::string &/*list*/);
+
+    std::vector<std::string> m_scenes;
+    std::string m_rootDir = "..";
+    std::string m_refDir = "references";
+    std::string m_outDir = "results";
+    int m_width = 320, m_height = 240;
+    double m_time = 1.0;        //< The time in seconds the animated scenes are drawn at
+    double m_threshold = 40.0;  //< The lowest PSNR in dB which still passes
+    bool m_update = false;      //< Record new references rather than comparing
+};
+
+#endif // GOLDENSUITE_H
@@ -0,0 +1,20 @@
+#include "goldensuite.h"
+
+#include <cstdlib>
+
+/**
+ * Renders every demo headlessly and compares the images and CPU buffer hashes with the stored references:
+ *
+ *     cd golden && ./golden --update   (records the references from a known good build, see README.md)
+ *     ... change something and rebuild ...
+ *     ./golden                         (fails if any demo now draws or builds something different)
+ *     ./golden --update                (once a change in the output is intended)
+ */
+int main(int argc, char **argv) {
+    GoldenSuite suite;
+    if (!suite.parseArgs(argc, argv)) {
+        GoldenSuite::usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    return suite.exec();
+}
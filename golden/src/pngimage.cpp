@@ -0,0 +1,248 @@
+#include "pngimage.h"
+
+#include <zlib.h>
+
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string.h>
+
+namespace {
+/// The eight bytes every PNG file starts with
+const unsigned char PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+/// Read and write the big endian integers of the chunks
+std::uint32_t readUint32(const unsigned char *bytes) {
+    return (std::uint32_t(bytes[0]) << 24) | (std::uint32_t(bytes[1]) << 16) |
+           (std::uint32_t(bytes[2]) << 8) | std::uint32_t(bytes[3]);
+}
+
+void appendUint32(std::vector<unsigned char> &bytes, std::uint32_t value) {
+    bytes.push_back((unsigned char)(value >> 24));
+    bytes.push_back((unsigned char)(value >> 16));
+    bytes.push_back((unsigned char)(value >> 8));
+    bytes.push_back((unsigned char)(value));
+}
+
+/// Append a chunk: its length, type, data and the CRC of the type and data
+void appendChunk(std::vector<unsigned char> &bytes, const char *type, const std::vector<unsigned char> &data) {
+    appendUint32(bytes, std::uint32_t(data.size()));
+    const size_t start = bytes.size();
+    bytes.insert(bytes.end(), type, type + 4);
+    bytes.insert(bytes.end(), data.begin(), data.end());
+    appendUint32(bytes, std::uint32_t(crc32(0L, bytes.data() + start, uInt(bytes.size() - start))));
+}
+
+/// The Paeth predictor of the PNG specification
+unsigned char paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if ((pa <= pb) && (pa <= pc)) return (unsigned char)(a);
+    return (unsigned char)((pb <= pc) ? b : c);
+}
+}
+
+/**
+ * @brief PNGImage::readPNG
+ * @param fileName The PNG file
+ * @return true if the image was read
+ */
+bool PNGImage::readPNG(const std::string &fileName) {
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if ((bytes.size() < 8) || (memcmp(bytes.data(), PNG_SIGNATURE, 8) != 0)) {
+        std::cerr << "PNGImage::readPNG() - " << fileName << " is not a PNG file\n";
+        return false;
+    }
+
+    // Walk the chunks, keeping the header and gathering the compressed data
+    std::vector<unsigned char> compressed;
+    bool hasHeader = false;
+    size_t pos = 8;
+    while (pos + 12 <= bytes.size()) {
+        const std::uint32_t length = readUint32(&bytes[pos]);
+        const std::string type(reinterpret_cast<const char*>(&bytes[pos + 4]), 4);
+        const unsigned char *data = &bytes[pos + 8];
+        if (pos + 12 + length > bytes.size()) break;
+        if ((type == "IHDR") && (length >= 13)) {
+            m_width = int(readUint32(data));
+            m_height = int(readUint32(data + 4));
+            const int bitDepth = data[8], colourType = data[9], interlace = data[12];
+            if ((bitDepth != 8) || ((colourType != 2) && (colourType != 6)) || (interlace != 0)) {
+                std::cerr << "PNGImage::readPNG() - " << fileName
+                          << " must be non-interlaced 8 bit RGB or RGBA\n";
+                return false;
+            }
+            m_channels = (colourType == 6) ? 4 : 3;
+            hasHeader = true;
+        } else if (type == "IDAT") {
+            compressed.insert(compressed.end(), data, data + length);
+        } else if (type == "IEND") {
+            break;
+        }
+        pos += 12 + length;
+    }
+    if (!hasHeader || (m_width <= 0) || (m_height <= 0)) {
+        std::cerr << "PNGImage::readPNG() - " << fileName << " has no image header\n";
+        return false;
+    }
+
+    // Each row is preceded by the byte saying how it was filtered
+    const size_t rowSize = size_t(m_width) * size_t(m_channels);
+    std::vector<unsigned char> filtered(size_t(m_height) * (rowSize + 1));
+    uLongf filteredSize = uLongf(filtered.size());
+    if ((uncompress(filtered.data(), &filteredSize, compressed.data(), uLong(compressed.size())) != Z_OK) ||
+        (filteredSize != filtered.size())) {
+        std::cerr << "PNGImage::readPNG() - the image data of " << fileName << " is damaged\n";
+        return false;
+    }
+
+    // Undo the filters, each of which predicts a byte from the pixel to its left (a), above (b) and above left (c)
+    m_pixels.resize(size_t(m_height) * rowSize);
+    for (size_t y = 0; y < size_t(m_height); ++y) {
+        const unsigned char filter = filtered[y * (rowSize + 1)];
+        const unsigned char *in = &filtered[y * (rowSize + 1) + 1];
+        unsigned char *out = &m_pixels[y * rowSize];
+        const unsigned char *above = (y > 0) ? out - rowSize : nullptr;
+        for (size_t x = 0; x < rowSize; ++x) {
+            const int a = (x >= size_t(m_channels)) ? out[x - size_t(m_channels)] : 0;
+            const int b = (above != nullptr) ? above[x] : 0;
+            const int c = ((above != nullptr) && (x >= size_t(m_channels))) ? above[x - size_t(m_channels)] : 0;
+            switch (filter) {
+            case 0: out[x] = in[x]; break;
+            case 1: out[x] = (unsigned char)(in[x] + a); break;
+            case 2: out[x] = (unsigned char)(in[x] + b); break;
+            case 3: out[x] = (unsigned char)(in[x] + (a + b) / 2); break;
+            case 4: out[x] = (unsigned char)(in[x] + paeth(a, b, c)); break;
+            default:
+                std::cerr << "PNGImage::readPNG() - " << fileName << " has an unknown row filter\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief PNGImage::writePNG
+ * Every row is filtered with the difference from the row above, which suits the smooth images the demos draw.
+ * @param fileName The PNG file
+ * @return true if the file was written
+ */
+bool PNGImage::writePNG(const std::string &fileName) const {
+    const size_t rowSize = size_t(m_width) * 3;
+    std::vector<unsigned char> filtered(size_t(m_height) * (rowSize + 1));
+    for (size_t y = 0; y < size_t(m_height); ++y) {
+        unsigned char *out = &filtered[y * (rowSize + 1)];
+        *out++ = (y > 0) ? 2 : 0;
+        for (size_t x = 0; x < size_t(m_width); ++x) {
+            for (size_t c = 0; c < 3; ++c) {
+                const size_t i = (y * size_t(m_width) + x) * size_t(m_channels) + c;
+                const unsigned char above = (y > 0) ? m_pixels[i - size_t(m_width) * size_t(m_channels)] : 0;
+                out[x * 3 + c] = (unsigned char)(m_pixels[i] - above);
+            }
+        }
+    }
+    std::vector<unsigned char> compressed(compressBound(uLong(filtered.size())));
+    uLongf compressedSize = uLongf(compressed.size());
+    if (compress2(compressed.data(), &compressedSize, filtered.data(), uLong(filtered.size()), 9) != Z_OK) {
+        std::cerr << "PNGImage::writePNG() - could not compress " << fileName << "\n";
+        return false;
+    }
+    compressed.resize(compressedSize);
+
+    // The header is the size, 8 bits per channel, RGB, and the standard compression, filtering and no interlace
+    std::vector<unsigned char> header;
+    appendUint32(header, std::uint32_t(m_width));
+    appendUint32(header, std::uint32_t(m_height));
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+
+    std::vector<unsigned char> bytes(PNG_SIGNATURE, PNG_SIGNATURE + 8);
+    appendChunk(bytes, "IHDR", header);
+    appendChunk(bytes, "IDAT", compressed);
+    appendChunk(bytes, "IEND", std::vector<unsigned char>());
+
+    std::ofstream file(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), std::streamsize(bytes.size()));
+    file.close();
+    if (!file.good()) {
+        std::cerr << "PNGImage::writePNG() - could not write " << fileName << "\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief PNGImage::readPPM
+ * @param fileName The PPM file, as written by HeadlessRunner::writePPM()
+ * @return true if the image was read
+ */
+bool PNGImage::readPPM(const std::string &fileName) {
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    std::string magic;
+    int maxValue = 0;
+    file >> magic >> m_width >> m_height >> maxValue;
+    file.get();
+    if (!file.good() || (magic != "P6") || (m_width <= 0) || (m_height <= 0) || (maxValue != 255)) {
+        std::cerr << "PNGImage::readPPM() - " << fileName << " is not an 8 bit binary PPM file\n";
+        return false;
+    }
+    m_channels = 3;
+    m_pixels.resize(size_t(m_width) * size_t(m_height) * 3);
+    file.read(reinterpret_cast<char*>(m_pixels.data()), std::streamsize(m_pixels.size()));
+    if (!file.good()) {
+        std::cerr << "PNGImage::readPPM() - " << fileName << " is too short\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief PNGImage::psnr
+ * @param a The first image
+ * @param b The second image, which must be the same size
+ * @return The PSNR in dB, infinity if they are identical, or 0 if their sizes differ
+ */
+double PNGImage::psnr(const PNGImage &a, const PNGImage &b) {
+    if ((a.m_width != b.m_width) || (a.m_height != b.m_height)) return 0.0;
+    const size_t numPixels = size_t(a.m_width) * size_t(a.m_height);
+    double total = 0.0;
+    for (size_t i = 0; i < numPixels; ++i) {
+        for (size_t c = 0; c < 3; ++c) {
+            const double d = double(a.m_pixels[i * size_t(a.m_channels) + c]) -
+                             double(b.m_pixels[i * size_t(b.m_channels) + c]);
+            total += d * d;
+        }
+    }
+    if (total == 0.0) return std::numeric_limits<double>::infinity();
+    const double mse = total / double(numPixels * 3);
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+/**
+ * @brief PNGImage::difference
+ * @param a The first image
+ * @param b The second image, which must be the same size
+ * @param scale What the differences are multiplied by
+ * @return An RGB image of the differences, or an empty image if the sizes differ
+ */
+PNGImage PNGImage::difference(const PNGImage &a, const PNGImage &b, int scale) {
+    PNGImage diff;
+    if ((a.m_width != b.m_width) || (a.m_height != b.m_height)) return diff;
+    diff.m_width = a.m_width;
+    diff.m_height = a.m_height;
+    const size_t numPixels = size_t(a.m_width) * size_t(a.m_height);
+    diff.m_pixels.resize(numPixels * 3);
+    for (size_t i = 0; i < numPixels; ++i) {
+        for (size_t c = 0; c < 3; ++c) {
+            const int d = std::abs(int(a.m_pixels[i * size_t(a.m_channels) + c]) -
+                                   int(b.m_pixels[i * size_t(b.m_channels) + c]));
+            diff.m_pixels[i * 3 + c] = (unsigned char)(std::min(255, d * scale));
+        }
+    }
+    return diff;
+}
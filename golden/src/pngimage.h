@@ -0,0 +1,38 @@
+#ifndef PNGIMAGE_H
+#define PNGIMAGE_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief The PNGImage class
+ * An 8 bit RGB or RGBA image, top row first, which can be read from and written to a PNG file with zlib. Only what
+ * the golden image tests need is supported: reading non-interlaced 8 bit RGB or RGBA files with any of the row
+ * filters, and writing RGB files. The demos themselves write binary PPM files, which can be read too.
+ */
+class PNGImage
+{
+public:
+    int m_width = 0;
+    int m_height = 0;
+    int m_channels = 3;                     //< 3 for RGB or 4 for RGBA
+    std::vector<unsigned char> m_pixels;    //< Each row from the top, each pixel m_channels bytes
+
+    /// Read a PNG file, returning false (with a message) if it isn't one that can be read
+    bool readPNG(const std::string &/*fileName*/);
+
+    /// Write the image as an RGB PNG file, dropping any alpha
+    bool writePNG(const std::string &/*fileName*/) const;
+
+    /// Read a binary (P6) PPM file with 8 bit channels
+    bool readPPM(const std::string &/*fileName*/);
+
+    /// The peak signal to noise ratio in dB between the RGB channels of two images of the same size, which is
+    /// infinite if they are the same
+    static double psnr(const PNGImage &/*a*/, const PNGImage &/*b*/);
+
+    /// The absolute difference of the RGB channels, scaled up so that small changes can be seen
+    static PNGImage difference(const PNGImage &/*a*/, const PNGImage &/*b*/, int /*scale*/ = 8);
+};
+
+#endif // PNGIMAGE_H
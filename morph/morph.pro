@@ -12,14 +12,36 @@ HEADERS += src/morphscene.h \
            ../common/include/camera.h \
            ../common/include/trackballcamera.h \
            ../common/include/scene.h \
-    src/MultiBufferIndexVAO.h
+           ../common/include/MultiBufferIndexVAO.h \
+           ../common/include/blendshapeloader.h \
+           ../common/include/curvatureengine.h \
+           ../common/include/vertexpacker.h \
+           ../common/include/meshtopology.h \
+           ../common/include/meshoptimiser.h \
+           ../common/include/parallelfor.h \
+           ../common/include/shaderprogram.h \
+           ../common/include/fixedcamera.h \
+           ../common/include/headlessrunner.h \
+           ../common/include/tracelog.h \
+           ../common/include/bufferhash.h \
+           ../common/include/fnv1a.h
 
 SOURCES += src/main.cpp \
            src/morphscene.cpp \
            ../common/src/camera.cpp \
            ../common/src/trackballcamera.cpp \
            ../common/src/scene.cpp \
-    src/MultiBufferIndexVAO.cpp
+           ../common/src/MultiBufferIndexVAO.cpp \
+           ../common/src/blendshapeloader.cpp \
+           ../common/src/curvatureengine.cpp \
+           ../common/src/vertexpacker.cpp \
+           ../common/src/meshtopology.cpp \
+           ../common/src/meshoptimiser.cpp \
+           ../common/src/shaderprogram.cpp \
+           ../common/src/fixedcamera.cpp \
+           ../common/src/headlessrunner.cpp \
+           ../common/src/tracelog.cpp \
+           ../common/src/bufferhash.cpp
 
 OTHER_FILES +=
 
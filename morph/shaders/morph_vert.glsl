@@ -11,6 +11,10 @@ uniform mat3 N; // This is the inverse transpose of the mv matrix
 // Store the blending weights for our morph targets in a single vec4
 uniform vec4 w = vec4(1.0,0.0,0.0,0.0);
 
+// The scale of each target's relative positions. These are 1 for float attributes, and the range of the
+// deltas when they are quantised to 16 bits.
+uniform vec4 deltaScale = vec4(1.0);
+
 // The positional and normal information for each face state. Note that V[0] contains the ABSOLUTE
 // vertex location, while V[1-4] contain the RELATIVE vertex locations. This is not the same as the
 // vertex normals, which are all "absolute".
@@ -33,7 +37,7 @@ void main() {
     // Now blend together the contribution of the other input targets
     int i;
     for (i=0; i<4; ++i) {
-        VertexPosition += w[i] * Verts[i+1];
+        VertexPosition += w[i] * deltaScale[i] * Verts[i+1];
         FragmentNormal += w[i] * Normals[i+1];
     }
     FragmentNormal = N * normalize(FragmentNormal);
@@ -1,5 +1,7 @@
 // Must include our scene first because of GL dependency order
 #include "morphscene.h"
+#include "headlessrunner.h"
+#include "tracelog.h"
 
 // This will probably already be included by a scene file
 #include "trackballcamera.h"
@@ -66,6 +68,9 @@ void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action, int
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);        
     } else {
+        // N switches between blended and recomputed normals
+        if (key == GLFW_KEY_N && action == GLFW_PRESS) g_scene.toggleNormals();
+
         // Any other keypress should be handled by our camera
         g_camera.handleKey(key, (action == GLFW_PRESS) );
     }
@@ -86,7 +91,17 @@ void resize_callback(GLFWwindow */*window*/, int width, int height) {
  * @brief main The main application loop
  * @return Whatever glfw returns when you glfwTerminate()
  */
-int main() {
+int main(int argc, char **argv) {
+    // Without a window, draw a scripted orbit of the scene and report the frame times (see HeadlessRunner)
+    HeadlessRunner::Options options;
+    options.m_width = 1024; options.m_height = 768;
+    options.m_eye = glm::vec3(0.0f, 0.0f, -3.0f);
+    int exitCode;
+    if (HeadlessRunner::runIfRequested(argc, argv, g_scene, options, exitCode)) return exitCode;
+
+    // With --trace file.json, record where start up and each frame spend their time (see TraceLog)
+    if (!options.m_traceFile.empty()) TraceLog::start();
+
     if (!glfwInit()) {
         // Initialisation failed
         glfwTerminate();        
@@ -162,4 +177,5 @@ int main() {
     // Close up shop
     glfwDestroyWindow(window);
     glfwTerminate();
+    if (!options.m_traceFile.empty()) TraceLog::write(options.m_traceFile);
 }
@@ -1,4 +1,6 @@
 #include "morphscene.h"
+#include "tracelog.h"
+#include "bufferhash.h"
 
 // GLM includes
 #define GLM_ENABLE_EXPERIMENTAL
@@ -11,12 +13,12 @@
 #include <ngl/VAOFactory.h>
 #include <ngl/ShaderLib.h>
 
-// The headers below are required for the maths calculations on the geometry
-#include <igl/per_vertex_normals.h>
-#include <igl/principal_curvature.h>
-#include <igl/read_triangle_mesh.h>
-#include <Eigen/Core>
-#include <Eigen/Dense>
+// The loader reads and processes all of the morph targets in parallel
+#include "blendshapeloader.h"
+#include "parallelfor.h"
+#include "vertexpacker.h"
+
+#include <cstdlib>
 
 MorphScene::MorphScene() : Scene() {
     m_startTime = std::chrono::high_resolution_clock::now();
@@ -24,6 +26,8 @@ MorphScene::MorphScene() : Scene() {
 
 
 void MorphScene::initGL() noexcept {
+    TraceScope trace("MorphScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -38,84 +42,111 @@ void MorphScene::initGL() noexcept {
 
     // Create and compile the vertex and fragment shader
     ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+    TraceLog::begin("loadShader");
     shader->loadShader("MorphProgram",
                        "shaders/morph_vert.glsl",
                        "shaders/morph_frag.glsl");
-
-    initMeshes();
+    TraceLog::end("loadShader");
+
+    // Look up the uniforms once, rather than by name every frame
+    m_morphProgram.init("MorphProgram");
+    m_MVPUniform = m_morphProgram.uniform<glm::mat4>("MVP");
+    m_MVUniform = m_morphProgram.uniform<glm::mat4>("MV");
+    m_NUniform = m_morphProgram.uniform<glm::mat3>("N");
+    m_weightsUniform = m_morphProgram.uniform<glm::vec4>("w");
+    m_deltaScaleUniform = m_morphProgram.uniform<glm::vec4>("deltaScale");
+
+    // There is nothing to draw without the targets, so give up with a failure status
+    if (!initMeshes()) {
+        std::cerr << "MorphScene::initGL() - no meshes to draw, exiting\n";
+        std::exit(EXIT_FAILURE);
+    }
 }
 
-void MorphScene::initMeshes() {
+/**
+ * @brief MorphScene::initMeshes Load the morph targets and set up the vertex arrays that draw them
+ * @return false if the targets couldn't be loaded
+ */
+bool MorphScene::initMeshes() {
     ngl::ShaderLib *shader=ngl::ShaderLib::instance();
 
     // Register a new VAO factory for our indexed buffer array object
     ngl::VAOFactory::registerVAOCreator("multiBufferIndexVAO", MultiBufferIndexVAO::create);
 
-    typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixXfr;
-    typedef Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> MatrixXir;
-
-    // Read a mesh from a file into igl - note that the faces are all the same
-    MatrixXfr V0, V1, V2, V3, V4;
-    MatrixXir F;
-    igl::read_triangle_mesh("data/face_mesh_neutral.off", V0, F);
-    igl::read_triangle_mesh("data/face_mesh_disgust.off", V1, F);
-    igl::read_triangle_mesh("data/face_mesh_scared.off", V2, F);
-    igl::read_triangle_mesh("data/face_mesh_happy.off", V3, F);
-    igl::read_triangle_mesh("data/face_mesh_oh.off", V4, F);
-
-    // Determine our bounding box by finding the min and max corner of the data
-    Eigen::Vector3f minCorner = V0.colwise().minCoeff();
-    Eigen::Vector3f maxCorner = V0.colwise().maxCoeff();
-    Eigen::Vector3f ones(1.0f, 1.0f, 1.0f);
-
-    // Create a 1/(max-min) matrix in one line using Eigen
-    float maxScale = ones.cwiseQuotient(maxCorner - minCorner).maxCoeff();
-
-    MatrixXfr scaleMat = (Eigen::Vector3f(maxScale,maxScale,maxScale)).rowwise().replicate(V0.rows()).transpose();
-    MatrixXfr minMat = minCorner.rowwise().replicate(V0.rows()).transpose();
-    MatrixXfr cntrMat = ((maxCorner-minCorner) * (-0.5f) * maxScale).rowwise().replicate(V0.rows()).transpose();
-    // Scale our vertex data so that it fits within 0 and 1
-    V0 = (V0 - minMat).cwiseProduct(scaleMat) + cntrMat;
-    V1 = (V1 - minMat).cwiseProduct(scaleMat) + cntrMat;
-    V2 = (V2 - minMat).cwiseProduct(scaleMat) + cntrMat;
-    V3 = (V3 - minMat).cwiseProduct(scaleMat) + cntrMat;
-    V4 = (V4 - minMat).cwiseProduct(scaleMat) + cntrMat;
-
-    // Determine the smooth corner vertex normals
-    MatrixXfr N0,N1,N2,N3,N4;
-    igl::per_vertex_normals(V0,F,N0);
-    igl::per_vertex_normals(V1,F,N1);
-    igl::per_vertex_normals(V2,F,N2);
-    igl::per_vertex_normals(V3,F,N3);
-    igl::per_vertex_normals(V4,F,N4);
-
-    // Now concatenate our per vertex data into a big chunk of data in Eigen
-    MatrixXfr Vertices(V0.rows(), V0.cols()*5 + N0.cols()*5);
-    Vertices << V0, V1-V0, V2-V0, V3-V0, V4-V0, N0, N1, N2, N3, N4;
-    int sz = Vertices.cols(); // The total size of a data record
-
-    // Retrieve the data from the vertex matrix as a raw array
-    GLuint v_cnt = Vertices.rows() * Vertices.cols();
-    GLuint f_cnt = F.rows() * F.cols();
+    // Read all of the targets concurrently - note that the faces must all be the same
+    BlendshapeLoader loader;
+    if (!loader.load({"data/face_mesh_neutral.off",
+                      "data/face_mesh_disgust.off",
+                      "data/face_mesh_scared.off",
+                      "data/face_mesh_happy.off",
+                      "data/face_mesh_oh.off"})) {
+        std::cerr << "MorphScene::initMeshes() - failed to load the morph targets\n";
+        return false;
+    }
+
+    // The loader has already interleaved the data as V0, V1-V0, V2-V0, V3-V0, V4-V0, N0, N1, N2, N3, N4
+    int sz = loader.floatsPerVertex(); // The total size of a data record
+
+    // Retrieve the data from the loader as a raw array
+    GLuint v_cnt = loader.vertexData().size();
+    GLuint f_cnt = loader.faces().size();
+
+    // Take the data (rather than copying it) so that the base target slots can be overwritten by the CPU blend
+    m_vertexData = loader.takeVertexData();
+    m_stride = sz;
+    m_numTargets = loader.numTargets();
+    size_t numVertices = loader.numVertices();
+    m_basePositions.resize(numVertices * 3);
+    m_baseNormals.resize(numVertices * 3);
+    for (size_t i = 0; i < numVertices; ++i) {
+        std::copy_n(&m_vertexData[i * m_stride], 3, &m_basePositions[i * 3]);
+        std::copy_n(&m_vertexData[i * m_stride + 3 * m_numTargets], 3, &m_baseNormals[i * 3]);
+    }
+
+    // Build the connectivity once, and start the normal engine from the base target
+    m_blended = m_basePositions;
+    m_engine.build(loader.faces(), numVertices);
+    m_engine.compute(m_blended.data(), 3, false);
+    BufferHash::record("morph targets", m_vertexData.data(), m_vertexData.size() * sizeof(float));
 
     // create a vao as a series of GL_TRIANGLES
     m_vao = ngl::VAOFactory::createVAO("multiBufferIndexVAO", GL_TRIANGLES);
     m_vao->bind();
+    MultiBufferIndexVAO *vao = static_cast<MultiBufferIndexVAO *>( m_vao.get());
 
-    // in this case we are going to set our data as the vertices above
-    m_vao->setData(MultiBufferIndexVAO::VertexData(v_cnt * sizeof(float),Vertices.data()[0]));
-
-    // Copy across the face indices
-    static_cast<MultiBufferIndexVAO *>( m_vao.get())->setIndices(f_cnt, F.data(), GL_UNSIGNED_INT);
-
-    // Don't know why I need to specify this twice . . .
-    m_vao->setNumIndices(f_cnt);
+    // Copy across the face indices, as 16 bit where they fit (which also sets the number of indices)
+    vao->setCompactIndices(f_cnt, reinterpret_cast<const GLuint*>(loader.faces().data()), numVertices);
 
     // Set the attribute pointers for both shaders
     (*shader)["MorphProgram"]->use();
 
-    // Set the vertex attribute pointers for the vertices and normals in one loop
+    // the buffer is dynamic as the base target is rewritten when the normals are computed on the CPU
     int i;
+    if (m_packAttributes) {
+        // The deltas are scaled to fit 16 bits per component, and the scales are passed to the shader
+        std::vector<float> scales = VertexPacker::morphDeltaScales(m_vertexData.data(), numVertices, m_numTargets);
+        for (i = 0; i < int(scales.size()) && i < 4; ++i) m_deltaScale[i] = scales[size_t(i)];
+        GLsizei stride = GLsizei(VertexPacker::morphStride(m_numTargets));
+        m_packedData.resize(numVertices * size_t(stride));
+        VertexPacker::packMorph(m_vertexData.data(), numVertices, m_numTargets, scales, m_packedData.data());
+        BufferHash::record("morph packed", m_packedData.data(), m_packedData.size());
+        vao->setData(m_packedData.size(), m_packedData.data(), GL_DYNAMIC_DRAW);
+
+        // The base position stays as floats, the deltas are snorm16 and the normals are 10:10:10:2
+        vao->setVertexAttribute(0, 3, GL_FLOAT, stride, 0, false);
+        for (i=1;i<5;++i) {
+            vao->setVertexAttribute(i, 3, GL_SHORT, stride, VertexPacker::morphDeltaOffset(size_t(i)), true);
+        }
+        for (i=0;i<5;++i) {
+            vao->setVertexAttribute(5 + i, 4, GL_INT_2_10_10_10_REV, stride, VertexPacker::morphNormalOffset(m_numTargets, size_t(i)), true);
+        }
+        return true;
+    }
+
+    // in this case we are going to set our data as the vertices above
+    vao->setData(v_cnt * sizeof(float), m_vertexData.data(), GL_DYNAMIC_DRAW);
+
+    // Set the vertex attribute pointers for the vertices and normals in one loop
     for (i=0;i<10;++i) {
         m_vao->setVertexAttributePointer(i, // GLuint _id
                                          3, // GLint _size
@@ -124,9 +155,96 @@ void MorphScene::initMeshes() {
                                          i * 3, // unsigned int _dataOffset
                                          (i<5)?false:true); // bool _normalise=false
     }
+    return true;
+}
+
+/**
+ * @brief MorphScene::uploadRecords
+ * @param vertices The sorted records of m_vertexData to send to the GPU
+ */
+void MorphScene::uploadRecords(const std::vector<std::uint32_t> &vertices) {
+    MultiBufferIndexVAO *vao = static_cast<MultiBufferIndexVAO *>( m_vao.get());
+    m_vao->bind();
+    if (m_packAttributes) {
+        // The delta scales don't change, as only the base target is ever rewritten
+        std::vector<float> scales(m_numTargets - 1);
+        for (size_t i = 0; i < scales.size() && i < 4; ++i) scales[i] = m_deltaScale[int(i)];
+        VertexPacker::packMorph(m_vertexData.data(), m_basePositions.size() / 3, m_numTargets, scales, m_packedData.data(), &vertices);
+        vao->updateRecords(vertices, VertexPacker::morphStride(m_numTargets), m_packedData.data());
+    } else {
+        vao->updateRecords(vertices, m_stride * sizeof(float), m_vertexData.data());
+    }
+}
+
+/**
+ * @brief MorphScene::toggleNormals
+ * When the CPU normals are switched off the original base target is put back, so the shader blend is unchanged.
+ */
+void MorphScene::toggleNormals() {
+    m_cpuNormals = !m_cpuNormals;
+    m_blendWeights = glm::vec4(-1.0f);
+    if (m_cpuNormals) return;
+
+    size_t numVertices = m_basePositions.size() / 3;
+    for (size_t i = 0; i < numVertices; ++i) {
+        std::copy_n(&m_basePositions[i * 3], 3, &m_vertexData[i * m_stride]);
+        std::copy_n(&m_baseNormals[i * 3], 3, &m_vertexData[i * m_stride + 3 * m_numTargets]);
+    }
+    m_blended = m_basePositions;
+    m_engine.compute(m_blended.data(), 3, false);
+    uploadRecords(m_engine.dirtyVertices());
+}
+
+/**
+ * @brief MorphScene::updateBlend
+ * Blends the targets on the CPU and recomputes the normals, which are written into the base target slots and
+ * uploaded. Every target moves every vertex of the face, so a new set of weights always changes the whole mesh and
+ * CurvatureEngine::update() would only add the cost of finding that out. The blend is skipped while the weights
+ * are unchanged, e.g. with the clock stopped.
+ * @param w The weights of targets 1 to 4
+ */
+void MorphScene::updateBlend(const glm::vec4 &w) {
+    if (w == m_blendWeights) return;
+    m_blendWeights = w;
+
+    const size_t numVertices = m_basePositions.size() / 3;
+    const size_t numWeights = std::min(m_numTargets - 1, size_t(4));
+    const size_t stride = m_stride;
+    const float *data = m_vertexData.data();
+    const float *base = m_basePositions.data();
+    float *blended = m_blended.data();
+    parallelFor(0, numVertices, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            const float *record = data + i * stride;
+            for (size_t c = 0; c < 3; ++c) {
+                float p = base[i * 3 + c];
+                for (size_t j = 0; j < numWeights; ++j) {
+                    p += w[int(j)] * record[3 * (j + 1) + c];
+                }
+                blended[i * 3 + c] = p;
+            }
+        }
+    });
+
+    // Recompute the normals, which lists every vertex as dirty
+    m_engine.compute(blended, 3, false);
+    const std::vector<std::uint32_t> &dirty = m_engine.dirtyVertices();
+
+    // Write the blended positions and new normals into the base target slots and upload the records
+    float *out = m_vertexData.data();
+    parallelFor(0, dirty.size(), [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            std::copy_n(blended + dirty[i] * 3, 3, out + dirty[i] * stride);
+        }
+    });
+    m_engine.writeNormals(out + 3 * m_numTargets, stride, dirty);
+    BufferHash::record("morph blend", m_vertexData.data(), m_vertexData.size() * sizeof(float));
+    uploadRecords(dirty);
 }
 
 void MorphScene::paintGL() noexcept {
+    TraceScope trace("MorphScene::paintGL");
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -134,9 +252,7 @@ void MorphScene::paintGL() noexcept {
     glViewport(0,0,m_width,m_height);
 
     // Use our shader for this draw
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-    (*shader)["MorphProgram"]->use();
-    GLint pid = shader->getProgramID("MorphProgram");
+    m_morphProgram.use();
 
     // Our MVP matrices
     glm::mat4 M = glm::rotate(glm::mat4(1.0f),
@@ -150,25 +266,15 @@ void MorphScene::paintGL() noexcept {
     N = glm::inverse(glm::mat3(MV));
     MVP = m_P * MV;
 
-    // Set this MVP on the GPU
-    glUniformMatrix4fv(glGetUniformLocation(pid, "MVP"), //location of uniform
-                       1, // how many matrices to transfer
-                       false, // whether to transpose matrix
-                       glm::value_ptr(MVP)); // a raw pointer to the data
-    glUniformMatrix4fv(glGetUniformLocation(pid, "MV"), //location of uniform
-                       1, // how many matrices to transfer
-                       false, // whether to transpose matrix
-                       glm::value_ptr(MV)); // a raw pointer to the data
-    glUniformMatrix3fv(glGetUniformLocation(pid, "N"), //location of uniform
-                       1, // how many matrices to transfer
-                       true, // whether to transpose matrix
-                       glm::value_ptr(N)); // a raw pointer to the data
+    // Set this MVP on the GPU (N is transposed to give the inverse transpose of MV)
+    m_MVPUniform.set(MVP);
+    m_MVUniform.set(MV);
+    m_NUniform.setTransposed(N);
 
     // Set the the weights on the shader to cycle between the input faces
     // We will make the vec4 w cycle between (0,0,0,0)->(1,0,0,0)->(0,1,0,0)->(0,0,1,0)->(0,0,0,1)->(0,0,0,0) based
     // on the elapsed time to give a lame face workout based on a 10 second cycle
-    auto now = std::chrono::high_resolution_clock::now();
-    double _t = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_startTime).count()  * 0.001;
+    double _t = elapsedTime(m_startTime);
     double t = fmod(_t, 5.0); // Find our 5 second cycle using modulus
 
     // Declare our points used for the workout cycle
@@ -198,8 +304,15 @@ void MorphScene::paintGL() noexcept {
         break;
     }
 
+    // With CPU normals the blended shape is written into the base target, so the shader doesn't need to add anything
+    if (m_cpuNormals) {
+        updateBlend(w);
+        w = glm::vec4(0.0f);
+    }
+
     // Copy our vector over the the GPU
-    glUniform4fv(glGetUniformLocation(pid, "w"), 1, glm::value_ptr(w));
+    m_weightsUniform.set(w);
+    m_deltaScaleUniform.set(m_deltaScale);
 
     // Draw our buffer
     m_vao->draw();
@@ -5,6 +5,8 @@
 #include "scene.h"
 #include <ngl/AbstractVAO.h>
 #include "MultiBufferIndexVAO.h"
+#include "curvatureengine.h"
+#include "shaderprogram.h"
 #include <chrono>
 
 class MorphScene : public Scene
@@ -18,15 +20,56 @@ public:
     /// Called when the scene is to be initialised
     void initGL() noexcept;
 
+    /// Switch between blending the target normals in the shader and recomputing them on the CPU
+    void toggleNormals();
+
 private:
-    /// Create our meshes and store them in the vertex buffer object
-    void initMeshes();
+    /// Create our meshes and store them in the vertex buffer object, returning false if the targets couldn't be loaded
+    bool initMeshes();
+
+    /// Blend the targets on the CPU, recompute the normals and upload them to the base target slots
+    void updateBlend(const glm::vec4 &/*w*/);
 
     /// Store a unique pointer to the vertex array object to be rendered in our scene
     std::unique_ptr<ngl::AbstractVAO> m_vao;
 
     /// Keep track of the last time
     std::chrono::high_resolution_clock::time_point m_startTime;
+
+    /// The CPU copy of the interleaved vertex buffer, the number of floats in each record and the number of targets
+    std::vector<float> m_vertexData;
+    size_t m_stride = 0;
+    size_t m_numTargets = 0;
+
+    /// The original base target positions and normals, restored when the CPU normals are switched off
+    std::vector<float> m_basePositions, m_baseNormals;
+
+    /// The blended positions, and the engine which keeps their normals up to date
+    std::vector<float> m_blended;
+    CurvatureEngine m_engine;
+
+    /// Whether the normals are recomputed on the CPU rather than blended in the shader. This is the default, as a
+    /// blend of the target normals is only an approximation of the normals of the blended shape.
+    bool m_cpuNormals = true;
+
+    /// The weights of the last CPU blend, which isn't repeated until they change
+    glm::vec4 m_blendWeights = glm::vec4(-1.0f);
+
+    /// Upload quantised records (see VertexPacker) with 16 bit deltas and 10:10:10:2 normals, rather than floats
+    bool m_packAttributes = true;
+
+    /// The quantised copy of m_vertexData that is actually uploaded, and the scale of each target's deltas
+    std::vector<std::uint8_t> m_packedData;
+    glm::vec4 m_deltaScale = glm::vec4(1.0f);
+
+    /// Upload the listed records of m_vertexData, packing them first if needed
+    void uploadRecords(const std::vector<std::uint32_t> &/*vertices*/);
+
+    /// The morph program and the uniforms set on it every frame
+    ShaderProgram m_morphProgram;
+    ShaderProgram::Uniform<glm::mat4> m_MVPUniform, m_MVUniform;
+    ShaderProgram::Uniform<glm::mat3> m_NUniform;
+    ShaderProgram::Uniform<glm::vec4> m_weightsUniform, m_deltaScaleUniform;
 };
 
 #endif // MORPHSCENE_H
@@ -11,13 +11,20 @@ HEADERS += \
            ../common/include/fixedcamera.h \
            ../common/include/scene.h \
            ../common/include/trackballcamera.h \
-           src/noisescene.h
+           src/noisescene.h \
+           ../common/include/headlessrunner.h \
+           ../common/include/tracelog.h \
+           ../common/include/bufferhash.h \
+           ../common/include/fnv1a.h
 SOURCES += src/main.cpp \
            ../common/src/camera.cpp \
            ../common/src/fixedcamera.cpp \
            ../common/src/scene.cpp \
            ../common/src/trackballcamera.cpp \
-           src/noisescene.cpp
+           src/noisescene.cpp \
+           ../common/src/headlessrunner.cpp \
+           ../common/src/tracelog.cpp \
+           ../common/src/bufferhash.cpp
 
 OTHER_FILES +=    \
     shaders/datanoise_frag.glsl \
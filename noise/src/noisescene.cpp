@@ -1,4 +1,5 @@
 #include "noisescene.h"
+#include "tracelog.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <ngl/Obj.h>
@@ -12,6 +13,8 @@ NoiseScene::NoiseScene() : Scene(), m_noiseTex(12, 10.0f, 0.5f, 0.0f, 1.0f, 1024
  * @brief ObjLoaderScene::initGL
  */
 void NoiseScene::initGL() noexcept {
+    TraceScope trace("NoiseScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -26,8 +29,10 @@ void NoiseScene::initGL() noexcept {
 
     // Create and compile all of our shaders
     ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+    TraceLog::begin("loadShader");
     shader->loadShader("DataNoiseProgram","shaders/datanoise_vert.glsl","shaders/datanoise_frag.glsl");
     shader->loadShader("ShaderNoiseProgram","shaders/shadernoise_vert.glsl","shaders/shadernoise_frag.glsl");
+    TraceLog::end("loadShader");
 
     // Our third 3D texture is for diffuse and specular variation, and is simplex noise
     glActiveTexture(GL_TEXTURE0);
@@ -43,6 +48,8 @@ void NoiseScene::initGL() noexcept {
 }
 
 void NoiseScene::paintGL() noexcept {
+    TraceScope trace("NoiseScene::paintGL");
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
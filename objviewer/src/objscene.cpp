@@ -1,4 +1,5 @@
 #include "objscene.h"
+#include "tracelog.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <ngl/Obj.h>
@@ -12,6 +13,8 @@ ObjScene::ObjScene() : Scene() {}
  * @brief ObjLoaderScene::initGL
  */
 void ObjScene::initGL() noexcept {
+    TraceScope trace("ObjScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -26,7 +29,15 @@ void ObjScene::initGL() noexcept {
 
     // Create and compile all of our shaders
     ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+    TraceLog::begin("loadShader");
     shader->loadShader("PhongProgram","shaders/phong_vert.glsl","shaders/phong_frag.glsl");
+    TraceLog::end("loadShader");
+
+    // Look up the uniforms once, rather than by name every frame
+    m_phongProgram.init("PhongProgram");
+    m_MVPUniform = m_phongProgram.uniform<glm::mat4>("MVP");
+    m_MVUniform = m_phongProgram.uniform<glm::mat4>("MV");
+    m_NUniform = m_phongProgram.uniform<glm::mat3>("N");
 
     // Load the Obj file and create a Vertex Array Object
     m_mesh.reset(new ngl::Obj("data/sonic_mesh.obj", "data/sonic_texture.png"));
@@ -34,6 +45,8 @@ void ObjScene::initGL() noexcept {
 }
 
 void ObjScene::paintGL() noexcept {
+    TraceScope trace("ObjScene::paintGL");
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -41,9 +54,7 @@ void ObjScene::paintGL() noexcept {
     glViewport(0,0,m_width,m_height);
 
     // Use our shader for this draw
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-    (*shader)["PhongProgram"]->use();
-    GLint pid = shader->getProgramID("PhongProgram");
+    m_phongProgram.use();
 
     // Our MVP matrices (note: Sonic needs to be centered first)
     glm::mat4 M = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.5f, 0.0f));
@@ -55,19 +66,10 @@ void ObjScene::paintGL() noexcept {
     N = glm::inverse(glm::mat3(MV));
     MVP = m_P * MV;
 
-    // Set this MVP on the GPU
-    glUniformMatrix4fv(glGetUniformLocation(pid, "MVP"), //location of uniform
-                       1, // how many matrices to transfer
-                       false, // whether to transpose matrix
-                       glm::value_ptr(MVP)); // a raw pointer to the data
-    glUniformMatrix4fv(glGetUniformLocation(pid, "MV"), //location of uniform
-                       1, // how many matrices to transfer
-                       false, // whether to transpose matrix
-                       glm::value_ptr(MV)); // a raw pointer to the data
-    glUniformMatrix3fv(glGetUniformLocation(pid, "N"), //location of uniform
-                       1, // how many matrices to transfer
-                       true, // whether to transpose matrix
-                       glm::value_ptr(N)); // a raw pointer to the data
+    // Set this MVP on the GPU (N is transposed to give the inverse transpose of MV)
+    m_MVPUniform.set(MVP);
+    m_MVUniform.set(MV);
+    m_NUniform.setTransposed(N);
 
     // Draw our Obj mesh
     m_mesh->draw();
@@ -3,6 +3,7 @@
 
 // The parent class for this scene
 #include "scene.h"
+#include "shaderprogram.h"
 #include <ngl/Obj.h>
 #include <memory>
 
@@ -21,6 +22,11 @@ public:
 private:
     /// A unique pointer storing our mesh object
     std::unique_ptr<ngl::Obj> m_mesh;
+
+    /// The Phong program and the uniforms set on it every frame
+    ShaderProgram m_phongProgram;
+    ShaderProgram::Uniform<glm::mat4> m_MVPUniform, m_MVUniform;
+    ShaderProgram::Uniform<glm::mat3> m_NUniform;
 };
 
 #endif // SHADERSCENE_H
@@ -1,4 +1,5 @@
 #include "shaderscene.h"
+#include "tracelog.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <ngl/Obj.h>
@@ -12,6 +13,8 @@ ShaderScene::ShaderScene() : Scene() {}
  * @brief ObjLoaderScene::initGL
  */
 void ShaderScene::initGL() noexcept {
+    TraceScope trace("ShaderScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -26,13 +29,17 @@ void ShaderScene::initGL() noexcept {
 
     // Create and compile all of our shaders
     ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+    TraceLog::begin("loadShader");
     shader->loadShader("GouraudProgram","../common/shaders/gouraud_vert.glsl","../common/shaders/gouraud_frag.glsl");
     shader->loadShader("PhongProgram","shaders/phong_vert.glsl","shaders/phong_frag.glsl");
     shader->loadShader("CookTorranceProgram","shaders/phong_vert.glsl","shaders/cooktorrance_frag.glsl");
     shader->loadShader("ToonProgram","shaders/phong_vert.glsl","shaders/toon_frag.glsl");
+    TraceLog::end("loadShader");
 }
 
 void ShaderScene::paintGL() noexcept {
+    TraceScope trace("ShaderScene::paintGL");
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -11,13 +11,26 @@ HEADERS += \
            ../common/include/fixedcamera.h \
            ../common/include/scene.h \
            ../common/include/trackballcamera.h \
-           src/sdfscene.h
+           ../common/include/shaderprogram.h \
+           ../common/include/programcache.h \
+           src/sdfscene.h \
+           ../common/include/headlessrunner.h \
+           ../common/include/tracelog.h \
+           ../common/include/bufferhash.h \
+           ../common/include/fnv1a.h \
+           ../common/include/rendertargetpool.h
 SOURCES += src/main.cpp \
            ../common/src/camera.cpp \
            ../common/src/fixedcamera.cpp \
            ../common/src/scene.cpp \
            ../common/src/trackballcamera.cpp \
-           src/sdfscene.cpp
+           ../common/src/shaderprogram.cpp \
+           ../common/src/programcache.cpp \
+           src/sdfscene.cpp \
+           ../common/src/headlessrunner.cpp \
+           ../common/src/tracelog.cpp \
+           ../common/src/bufferhash.cpp \
+           ../common/src/rendertargetpool.cpp
 
 OTHER_FILES += shaders/sdf_frag.glsl \
 	       shaders/sdf_vert.glsl 
@@ -13,13 +13,21 @@ uniform int marchIter = 64;             // The maximum number of iterations for
 uniform int shadowIter = 32;             // The maximum number of shadow iterations permitted
 uniform float marchDist = 40.0;          // The maximum distance to ray march
 uniform float epsilon = 0.001;          // The error tolerance - lower means slower by better
+uniform float relaxation = 1.0;          // How far past the safe distance each step goes (1 is plain sphere tracing)
+
+// The cone pass marches one ray for each tile of tileSize pixels into coneDepth, which the full resolution pass then
+// starts its rays from (a tileSize of 0 means there is no cone pass)
+uniform bool isConePass = false;
+uniform int tileSize = 0;
+uniform sampler2D coneDepth;
 
 // Ambient occlusion parameters
 uniform int aoIter = 8;                  // The number of iterations for ambient occlusion. Higher is better quality.
 uniform float aoDist = 1.0;              // The size of the ambient occlusion kernel
 uniform float aoPower = 16.0;             // The exponent for the ao kernel - a larger power increases the fall-off
 
-// Colouring mode (1=black&white, 2=AO visualisation, 3=depth visualisation, 4=lambert shading visualisation, 5=shadow visualisation)
+// Colouring mode (1=black&white, 2=AO visualisation, 3=depth visualisation, 4=lambert shading visualisation, 5=shadow visualisation,
+// 6=march iteration count visualisation)
 uniform int colourMode = 1;
 
 // Modeling parameters
@@ -163,18 +171,49 @@ float sceneWithoutGround(vec3 p) {
 /** This is where the magic happens. The algorithm was taken from https://www.shadertoy.com/view/XlXyD4  but it is 
   * quite generic and was originally taken from (and explained rather well) here:
   * http://jamie-wong.com/2016/07/15/ray-marching-signed-distance-functions/
+  * With a relaxation above 1 each step goes further than the distance to the scene, which is safe as long as the
+  * sphere around the new point overlaps the one around the last. When it doesn't the step may have passed through
+  * the surface, so the march goes back to the end of the safe step and carries on without relaxation. This is the
+  * over-relaxed sphere tracing of Keinert et al., "Enhanced Sphere Tracing" (2014).
   */
-float march(vec3 eye, vec3 dir) {
-    float depth = 0.0;
-    for (int i = 0; i < marchIter; ++i) {
+float march(vec3 eye, vec3 dir, float start, out int iterations) {
+    float depth = start;
+    float omega = relaxation;
+    float lastDist = 0.0, stepLength = 0.0;
+    for (iterations = 0; iterations < marchIter; ++iterations) {
         float dist = scene(eye + depth * dir);
-        depth += dist;
+        if ((omega > 1.0) && (abs(dist) + lastDist < stepLength)) {
+            depth += lastDist - stepLength;
+            stepLength = lastDist;
+            omega = 1.0;
+            continue;
+        }
+        lastDist = dist;
+        stepLength = dist * omega;
+        depth += stepLength;
         if (dist < epsilon || depth >= marchDist)
 			break;
     }
     return depth;
 }
 
+/** March a cone through the pixels of a tile, returning a depth which none of the rays inside it reach the surface
+  * before. The points of the rays at a depth t are within t * spread of the same point on the middle ray, so the cone
+  * is free for a step of (dist - t * spread) / (1 + spread) from each point. It stops once the gap left around the
+  * cone is smaller than the cone, as the rays are about to part.
+  */
+float coneMarch(vec3 eye, vec3 dir, float spread) {
+    float depth = 0.0;
+    for (int i = 0; i < marchIter; ++i) {
+        float dist = scene(eye + depth * dir);
+        float radius = depth * spread;
+        if (dist - radius < max(radius, epsilon) || depth >= marchDist)
+            break;
+        depth += (dist - radius) / (1.0 + spread);
+    }
+    return depth;
+}
+
 /** This is an implementation of ambient occlusion method for SDF scenes, 
   * described here: http://iquilezles.org/www/material/nvscene2008/rwwtt.pdf .
   * Note this is considerably faster than the method implemented here: https://www.shadertoy.com/view/XlXyD4
@@ -265,18 +304,47 @@ float softShadow( in vec3 p, in vec3 dir, float maxt) {
     return res;
 }
 
+/** A colour ramp from blue for a few iterations to red for the most.
+  */
+vec3 heat(float t) {
+    return clamp(vec3(2.0 * t - 0.5, 1.0 - abs(2.0 * t - 1.0), 1.5 - 2.0 * t), 0.0, 1.0);
+}
+
 void main() {
+    // The cone pass is drawn at one fragment per tile, each of which marches the ray through the middle of its tile
+    float spread = 0.0;
+    vec2 fragCoord = gl_FragCoord.xy;
+    if (isConePass) {
+        fragCoord = floor(gl_FragCoord.xy) * float(tileSize) + 0.5 * float(tileSize);
+
+        // The distance from the middle of the tile to its corner pixels, over the distance to the image plane, which
+        // is at least the angle between the rays through them
+        spread = 0.7072 * float(tileSize) / (2.5 * iResolution.y);
+    }
+
     // Determine where the viewer is looking based on the provided eye position and scene target
-    vec3 dir = ray(2.5, iResolution.xy, gl_FragCoord.xy);
+    vec3 dir = ray(2.5, iResolution.xy, fragCoord);
     mat3 mat = viewMatrix(target - eyepos, vec3(0.0, 1.0, 0.0));
     vec3 eye = eyepos;
     dir = mat * dir;
 
     // Initialise the scene based on the current elapsed time
     setScene();
-    
+
+    if (isConePass) {
+        fragColor = vec4(coneMarch(eye, dir, spread));
+        return;
+    }
+
     // March until it hits the object. The depth indicates how far you have to travel down dir to get to the object.
-    float depth = march(eye, dir);
+    // After a cone pass the march starts from where the cone of the pixel's tile stopped.
+    float start = (tileSize > 0) ? texelFetch(coneDepth, ivec2(gl_FragCoord.xy) / tileSize, 0).r : 0.0;
+    int iterations;
+    float depth = march(eye, dir, start, iterations);
+    if (colourMode == 6) {
+        fragColor = vec4(heat(float(iterations) / float(marchIter)), 1.0);
+        return;
+    }
     if (depth >= marchDist - epsilon) {
         fragColor = vec4(depth);
 		return;
@@ -1,5 +1,7 @@
 // Must include our scene first because of GL dependency order
 #include "sdfscene.h"
+#include "headlessrunner.h"
+#include "tracelog.h"
 
 // This will probably already be included by a scene file
 #include "fixedcamera.h"
@@ -91,6 +93,12 @@ void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action, int
         case (GLFW_KEY_5):
             g_scene.setColourMode(5);
             break;
+        case (GLFW_KEY_6):
+            g_scene.setColourMode(6);
+            break;
+        case (GLFW_KEY_M):
+            g_scene.cycleMarchMethod();
+            break;
         }
     }
     // Any other keypress should be handled by our camera
@@ -107,7 +115,30 @@ void resize_callback(GLFWwindow */*window*/, int width, int height) {
     g_scene.resizeGL(width,height);
 }
 
-int main() {
+int main(int argc, char **argv) {
+    // Without a window, draw a scripted orbit of the scene and report the frame times (see HeadlessRunner)
+    HeadlessRunner::Options options;
+    options.m_width = 1024; options.m_height = 768;
+    options.m_glMinor = 3;
+    options.m_eye = glm::vec3(0.0f, 10.0f, 15.0f);
+    options.m_target = glm::vec3(0.0f, 1.0f, 0.0f);
+    int exitCode;
+    if (HeadlessRunner::runIfRequested(argc, argv, g_scene, options, exitCode, [](const HeadlessRunner::Options &options) {
+        if (options.m_variant == "sphere") {
+            g_scene.setMarchMethod(SDFScene::MARCH_SPHERE);
+        } else if (options.m_variant == "relaxed") {
+            g_scene.setMarchMethod(SDFScene::MARCH_RELAXED);
+        } else if (!options.m_variant.empty() && (options.m_variant != "cone")) {
+            std::cerr << "main() - unknown variant " << options.m_variant << " (sphere, relaxed or cone)\n";
+        }
+    }, [](const glm::vec3 &eye, const glm::vec3 &target) {
+        g_scene.setEye(eye);
+        g_scene.setTarget(target);
+    })) return exitCode;
+
+    // With --trace file.json, record where start up and each frame spend their time (see TraceLog)
+    if (!options.m_traceFile.empty()) TraceLog::start();
+
     if (!glfwInit()) {
         // Initialisation failed
         glfwTerminate();
@@ -167,6 +198,8 @@ int main() {
               << "3: Visualise distance on the ground plane\n"
               << "4: Visualise Lambert shading value (e.g. N dot L)\n"
               << "5: Visualise the shadow penumbra\n"
+              << "6: Visualise the number of steps each ray marches\n"
+              << "m: Cycle the ray marching (sphere tracing, relaxed sphere tracing, cone marching)\n"
               << "<SPACE>: Cycle between surfaces\n"
               << "b: Toggle blending on/off\n"
               << "****************************************************";
@@ -193,4 +226,5 @@ int main() {
     // Close up shop
     glfwDestroyWindow(window);
     glfwTerminate();
+    if (!options.m_traceFile.empty()) TraceLog::write(options.m_traceFile);
 }
@@ -1,4 +1,6 @@
 #include "sdfscene.h"
+#include "tracelog.h"
+#include "programcache.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/ext.hpp>
@@ -15,12 +17,15 @@ SDFScene::SDFScene() : Scene() {
     m_isBlending = true;
     m_eye = glm::vec3(0.0, 0.0, 2.0);
     m_target = glm::vec3(0.0, 0.0, 0.0);
+    updateWorkload();
 }
 
 /**
  * @brief ObjLoaderScene::initGL
  */
 void SDFScene::initGL() noexcept {
+    TraceScope trace("SDFScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -33,26 +38,75 @@ void SDFScene::initGL() noexcept {
     // enable multisampling for smoother drawing
     glEnable(GL_MULTISAMPLE);
 
-    // Create and compile all of our shaders
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-    shader->loadShader("SDFProgram","shaders/sdf_vert.glsl","shaders/sdf_frag.glsl");
+    // The ray marching fragment shader is large and slow to compile, so the linked program is cached between runs
+    m_sdfProgram.init(ProgramCache::build("SDFProgram", {{GL_VERTEX_SHADER, "shaders/sdf_vert.glsl"},
+                                                         {GL_FRAGMENT_SHADER, "shaders/sdf_frag.glsl"}}));
+    m_resolution = m_sdfProgram.uniform<glm::vec3>("iResolution");
+    m_time = m_sdfProgram.uniform<GLfloat>("iTime");
+    m_colourModeUniform = m_sdfProgram.uniform<GLint>("colourMode");
+    m_shapeTypeUniform = m_sdfProgram.uniform<GLint>("shapeType");
+    m_isBlendingUniform = m_sdfProgram.uniform<bool>("isBlending");
+    m_MVP = m_sdfProgram.uniform<glm::mat4>("MVP");
+    m_eyeUniform = m_sdfProgram.uniform<glm::vec3>("eyepos");
+    m_targetUniform = m_sdfProgram.uniform<glm::vec3>("target");
+    m_relaxationUniform = m_sdfProgram.uniform<GLfloat>("relaxation");
+    m_isConePassUniform = m_sdfProgram.uniform<bool>("isConePass");
+    m_tileSizeUniform = m_sdfProgram.uniform<GLint>("tileSize");
+    m_coneDepthUniform = m_sdfProgram.uniform<GLint>("coneDepth");
 
     // Create a screen oriented plane
     ngl::VAOPrimitives *prim=ngl::VAOPrimitives::instance();
     prim->createTrianglePlane("plane",2,2,1,1,ngl::Vec3(0,1,0));
 }
 
+/**
+ * @brief SDFScene::setMarchMethod
+ * @param method The way of marching the rays from the next frame
+ */
+void SDFScene::setMarchMethod(MarchMethod method) {
+    m_marchMethod = method;
+    updateWorkload();
+}
+
+/**
+ * @brief SDFScene::updateWorkload
+ */
+void SDFScene::updateWorkload() {
+    switch (m_marchMethod) {
+    case MARCH_RELAXED:
+        m_workload = "relaxed sphere tracing";
+        break;
+    case MARCH_CONE:
+        m_workload = "cone marching " + std::to_string(TILE_SIZE) + "x" + std::to_string(TILE_SIZE) +
+                     " tiles then relaxed sphere tracing";
+        break;
+    default:
+        m_workload = "sphere tracing";
+        break;
+    }
+    resetFrameTimer();
+}
+
+/**
+ * @brief SDFScene::paintGL
+ * The rays of every pixel are marched by the same program. Cone marching first draws it at one fragment per tile of
+ * TILE_SIZE pixels, and the full resolution pass then starts each ray from the depth its tile reached. The full
+ * resolution pass is timed under the name of the march, so cycling the methods puts their GPU times side by side in
+ * the report.
+ */
 void SDFScene::paintGL() noexcept {
+    TraceScope trace("SDFScene::paintGL");
+
+    // Collect the raymarch times of a few frames ago
+    timeFrame("SDFScene", m_workload);
+    beginProfileFrame("SDFScene");
+    m_renderTargets.beginFrame();
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Set up the viewport
-    glViewport(0,0,m_width,m_height);
-
     // Use our shader for this draw
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-    (*shader)["SDFProgram"]->use();
-    GLint pid = shader->getProgramID("SDFProgram");
+    m_sdfProgram.use();
 
     // Our MVP matrices
     glm::mat4 M = glm::mat4(1.0f);
@@ -65,40 +119,74 @@ void SDFScene::paintGL() noexcept {
     MVP = m_P * MV;
 
     // Calculate the elapsed time since the programme started
-    auto now = std::chrono::high_resolution_clock::now();
-    double t = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_startTime).count()  * 0.001;
+    double t = elapsedTime(m_startTime);
 
     // Set the viewport resolution
-    glUniform3fv(glGetUniformLocation(pid, "iResolution"), 1, glm::value_ptr(glm::vec3(float(m_width), float(m_height), 0.0f)));
+    m_resolution.set(glm::vec3(float(m_width), float(m_height), 0.0f));
 
     // Set the time elapsed since the programme started
-    glUniform1f(glGetUniformLocation(pid, "iTime"), float(t));
+    m_time.set(float(t));
 
     // Set the current colour mode (0,1 or 2)
-    glUniform1i(glGetUniformLocation(pid, "colourMode"), m_colourMode);
+    m_colourModeUniform.set(m_colourMode);
 
     // Set the current shape to render
-    glUniform1i(glGetUniformLocation(pid, "shapeType"), m_shapeType);
+    m_shapeTypeUniform.set(m_shapeType);
 
     // Set whether blending is used between shapes
-    glUniform1i(glGetUniformLocation(pid, "isBlending"), (m_isBlending)?1:0);    
+    m_isBlendingUniform.set(m_isBlending);    
     
     // The default NGL plane isn't screen oriented so we still have to rotate it around the x-axis
     // to align with the screen
     MVP = glm::rotate(glm::mat4(1.0f), glm::pi<float>() * 0.5f, glm::vec3(1.0f,0.0f,0.0f));
-    glUniformMatrix4fv(glGetUniformLocation(pid, "MVP"), 1, false, glm::value_ptr(MVP));
+    m_MVP.set(MVP);
 
     // Transfer over the eye and target position
-    glUniform3fv(glGetUniformLocation(pid, "eyepos"), 1, glm::value_ptr(m_eye));
-    glUniform3fv(glGetUniformLocation(pid, "target"), 1, glm::value_ptr(m_target));
-    
-    // Draw the plane that we've created
+    m_eyeUniform.set(m_eye);
+    m_targetUniform.set(m_target);
     ngl::VAOPrimitives *prim=ngl::VAOPrimitives::instance();
-    prim->draw("plane");    
+
+    // March a cone through each tile into a low resolution target, which also sets the viewport to its size
+    RenderTargetPool::Target *coneDepth = nullptr;
+    if (m_marchMethod == MARCH_CONE) {
+        ProfileScope cone(*this, "cone march");
+        RenderTargetPool::Format format;
+        format.m_colour = GL_R32F;
+        format.m_depth = GL_NONE;
+        format.m_filter = GL_NEAREST;
+        coneDepth = m_renderTargets.acquire((m_width + TILE_SIZE - 1) / TILE_SIZE,
+                                            (m_height + TILE_SIZE - 1) / TILE_SIZE,
+                                            format);
+        coneDepth->bind();
+        m_isConePassUniform.set(true);
+        m_tileSizeUniform.set(TILE_SIZE);
+        prim->draw("plane");
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // The full resolution pass reads the depths back from the active texture unit
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, coneDepth->m_colour);
+        m_coneDepthUniform.set(0);
+    }
+
+    // Set up the viewport
+    glViewport(0,0,m_width,m_height);
+    m_isConePassUniform.set(false);
+    m_tileSizeUniform.set((coneDepth != nullptr) ? TILE_SIZE : 0);
+    m_relaxationUniform.set((m_marchMethod == MARCH_SPHERE) ? 1.0f : RELAXATION);
+
+    // Draw the plane that we've created, which raymarches every pixel
+    static const char *passNames[] = {"sphere trace", "relaxed trace", "cone start trace"};
+    {
+        ProfileScope raymarch(*this, passNames[m_marchMethod]);
+        prim->draw("plane");
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_renderTargets.release(coneDepth);
 }
 
 void SDFScene::setColourMode(const int& _mode) {    
-    if ((_mode >= 1) && (_mode <= 5)) {
+    if ((_mode >= 1) && (_mode <= 6)) {
         m_colourMode = _mode;
     }
 }
\ No newline at end of file
@@ -3,12 +3,19 @@
 
 // The parent class for this scene
 #include "scene.h"
+#include "shaderprogram.h"
+#include "rendertargetpool.h"
 #include <chrono>
 #include <ngl/Obj.h>
 
 class SDFScene : public Scene
 {
 public:
+    /// The ways of marching the rays. Sphere tracing steps by the distance to the scene, relaxed sphere tracing steps
+    /// further and falls back when that overshoots, and cone marching adds a low resolution pass which finds where
+    /// each tile of pixels can start its relaxed march from.
+    typedef enum {MARCH_SPHERE, MARCH_RELAXED, MARCH_CONE} MarchMethod;
+
     /// Constructor
     SDFScene();
 
@@ -27,11 +34,26 @@ public:
     /// Toggle whether blending is used
     void toggleBlending() {m_isBlending = !m_isBlending;}
 
+    /// Cycle between the ways of marching the rays, to compare their times
+    void cycleMarchMethod() {setMarchMethod(MarchMethod((m_marchMethod + 1) % 3));}
+
+    /// Choose the way of marching the rays
+    void setMarchMethod(MarchMethod /*method*/);
+
     /// Set the target and eye position
     void setEye(const glm::vec3& eye) {m_eye = eye;}
     void setTarget(const glm::vec3& target) {m_target = target;}
 
 private:
+    /// The size in pixels of the square tiles the cone pass marches a ray for
+    static constexpr GLint TILE_SIZE = 8;
+
+    /// How far past the distance to the scene a relaxed step goes
+    static constexpr GLfloat RELAXATION = 1.2f;
+
+    /// Describe the march for the frame time report, and start the average again
+    void updateWorkload();
+
     /// Keep track of the last time
     std::chrono::high_resolution_clock::time_point m_startTime;
 
@@ -41,8 +63,23 @@ private:
     /// Determine whether blending is used in the shader
     bool m_isBlending;
 
+    /// How the rays are marched, and a description of it for the frame time report
+    MarchMethod m_marchMethod = MARCH_CONE;
+    std::string m_workload;
+
+    /// The target holding the depth each tile's rays start from
+    RenderTargetPool m_renderTargets;
+
     /// Sets the target and eye position on the shader
     glm::vec3 m_eye, m_target;
+
+    /// The ray marching program and its uniforms
+    ShaderProgram m_sdfProgram;
+    ShaderProgram::Uniform<glm::vec3> m_resolution, m_eyeUniform, m_targetUniform;
+    ShaderProgram::Uniform<GLfloat> m_time, m_relaxationUniform;
+    ShaderProgram::Uniform<GLint> m_colourModeUniform, m_shapeTypeUniform, m_tileSizeUniform, m_coneDepthUniform;
+    ShaderProgram::Uniform<bool> m_isBlendingUniform, m_isConePassUniform;
+    ShaderProgram::Uniform<glm::mat4> m_MVP;
 };
 
 #endif // SDFSCENE_H
@@ -10,12 +10,21 @@ HEADERS += \
            ../common/include/camera.h \
            ../common/include/scene.h \
            ../common/include/trackballcamera.h \
-           src/shaderscene.h
+           src/shaderscene.h \
+           ../common/include/fixedcamera.h \
+           ../common/include/headlessrunner.h \
+           ../common/include/tracelog.h \
+           ../common/include/bufferhash.h \
+           ../common/include/fnv1a.h
 SOURCES += src/main.cpp \
            ../common/src/camera.cpp \
            ../common/src/scene.cpp \
            ../common/src/trackballcamera.cpp \
-           src/shaderscene.cpp
+           src/shaderscene.cpp \
+           ../common/src/fixedcamera.cpp \
+           ../common/src/headlessrunner.cpp \
+           ../common/src/tracelog.cpp \
+           ../common/src/bufferhash.cpp
 
 OTHER_FILES += shaders/phong_vert.glsl \
                shaders/phong_frag.glsl \
@@ -1,4 +1,5 @@
 #include "shaderscene.h"
+#include "tracelog.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <ngl/Obj.h>
@@ -12,6 +13,8 @@ ShaderScene::ShaderScene() : Scene() {}
  * @brief ObjLoaderScene::initGL
  */
 void ShaderScene::initGL() noexcept {
+    TraceScope trace("ShaderScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -26,7 +29,9 @@ void ShaderScene::initGL() noexcept {
 
     // Create and compile all of our shaders
     ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+    TraceLog::begin("loadShader");
     shader->loadShader("ShaderProgram","shaders/phong_vert.glsl","shaders/cooktorrance_frag.glsl");
+    TraceLog::end("loadShader");
 
     // Load up our textures
     initTexture(0, m_colourTex, "images/brick_colour.jpg");
@@ -49,6 +54,8 @@ void ShaderScene::initGL() noexcept {
 }
 
 void ShaderScene::paintGL() noexcept {
+    TraceScope trace("ShaderScene::paintGL");
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
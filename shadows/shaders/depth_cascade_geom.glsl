@@ -0,0 +1,33 @@
+#version 430
+
+// Each triangle is drawn once for every cascade, so that they are all rendered in one pass over the scene
+layout (triangles, invocations = 4) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+// The view projection matrix of the light for each cascade (see ShadowScene::fitCascades()), how many are used, and
+// a bit for each cascade being drawn (the others are kept from an earlier frame)
+uniform mat4 cascadeVP[4];
+uniform int numCascades = 3;
+uniform int cascadeMask = 15;
+
+void main() {
+    if ((gl_InvocationID >= numCascades) || ((cascadeMask & (1 << gl_InvocationID)) == 0)) return;
+
+    // The vertex shader leaves the positions in world space
+    vec4 position[3];
+    for (int i = 0; i < 3; ++i) {
+        position[i] = cascadeVP[gl_InvocationID] * gl_in[i].gl_Position;
+    }
+
+    // Skip the triangles which are entirely to one side of the cascade, rather than leaving them to the clipper
+    bvec2 below = lessThan(max(max(position[0].xy, position[1].xy), position[2].xy), vec2(-1.0));
+    bvec2 above = greaterThan(min(min(position[0].xy, position[1].xy), position[2].xy), vec2(1.0));
+    if (any(below) || any(above)) return;
+
+    for (int i = 0; i < 3; ++i) {
+        gl_Layer = gl_InvocationID;
+        gl_Position = position[i];
+        EmitVertex();
+    }
+    EndPrimitive();
+}
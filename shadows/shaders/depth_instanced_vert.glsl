@@ -0,0 +1,30 @@
+#version 430
+
+// The vertex position attribute
+layout (location=0) in vec3 VertexPosition;
+
+// The matrices of the pass from the light, which are combined with the model matrix of each instance (see
+// Scene::ObjectBlock). MVP is the identity, as the geometry shader applies the matrix of each cascade.
+layout (std140, binding=1) uniform ObjectBlock {
+    mat4 MVP;
+    mat4 MV;
+    mat4 N;
+    mat4 depthBiasMVP;
+    vec4 Colour;
+} Object;
+
+// The model matrices and colours of every copy being drawn (see InstanceBuffer::Instance)
+struct InstanceInfo {
+    mat4 M;
+    mat4 N; // This is the inverse transpose of M (only the top left 3x3 is used)
+    vec4 Colour;
+};
+layout (std430, binding=2) readonly buffer InstanceBuffer {
+    InstanceInfo Instances[];
+};
+
+void main() {
+    // Set the position of the current vertex in world space
+    gl_Position = Object.MVP * Instances[gl_InstanceID].M * vec4(VertexPosition, 1.0);
+}
+
@@ -3,11 +3,18 @@
 // The vertex position attribute
 layout (location=0) in vec3 VertexPosition;
 
-// We need an MVP because the plane needs to be rotated
-uniform mat4 MVP;
+// The matrices of the object being drawn from the light (see Scene::ObjectBlock). MVP is only the model matrix, as
+// the geometry shader applies the matrix of each cascade.
+layout (std140, binding=1) uniform ObjectBlock {
+    mat4 MVP;
+    mat4 MV;
+    mat4 N;
+    mat4 depthBiasMVP;
+    vec4 Colour;
+} Object;
 
 void main() {
-    // Set the position of the current vertex
-    gl_Position = MVP * vec4(VertexPosition, 1.0);
+    // Set the position of the current vertex in world space
+    gl_Position = Object.MVP * vec4(VertexPosition, 1.0);
 }
 
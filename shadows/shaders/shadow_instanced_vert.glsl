@@ -0,0 +1,64 @@
+#version 430
+
+// The matrices and light shared by every object this frame (see Scene::FrameBlock)
+layout (std140, binding=0) uniform FrameBlock {
+    mat4 V;
+    mat4 P;
+    vec4 LightPosition; // Light position in eye coords.
+} Frame;
+
+// The matrices of the pass, which are combined with the model matrix of each instance (see Scene::ObjectBlock)
+layout (std140, binding=1) uniform ObjectBlock {
+    mat4 MVP;
+    mat4 MV;
+    mat4 N; // This is the inverse transpose of the MV matrix (only the top left 3x3 is used)
+    mat4 depthBiasMVP; // The identity, as the instances hold the model matrices
+    vec4 Colour;
+} Object;
+
+// The model matrices and colours of every copy being drawn (see InstanceBuffer::Instance)
+struct InstanceInfo {
+    mat4 M;
+    mat4 N; // This is the inverse transpose of M (only the top left 3x3 is used)
+    vec4 Colour;
+};
+layout (std430, binding=2) readonly buffer InstanceBuffer {
+    InstanceInfo Instances[];
+};
+
+// The vertex position attribute
+layout (location=0) in vec3 VertexPosition;
+
+// The vertex normal attribute
+layout (location=1) in vec3 VertexNormal;
+
+// The texture coordinate attribute
+layout (location=2) in vec2 TexCoord;
+
+// Passed onto the fragment shader
+out vec3 FragmentNormal;
+out vec4 FragmentPosition;
+out vec4 WorldPosition;
+out vec3 FragmentColour;
+
+
+/************************************************************************************/
+void main() {
+    InstanceInfo instance = Instances[gl_InstanceID];
+    vec4 position = instance.M * vec4(VertexPosition, 1.0);
+
+    // Set the position of the current vertex
+    gl_Position = Object.MVP * position;
+    // Transform the normal
+    FragmentNormal = mat3(Object.N) * mat3(instance.N) * VertexNormal;
+
+    // Transform the world space fragment coordinates for shading
+    FragmentPosition = Object.MV * position;
+
+    // The world space position, which the fragment shader projects into the cascade it falls in
+    WorldPosition = Object.depthBiasMVP * position;
+
+    // The diffuse reflectivity of the object
+    FragmentColour = instance.Colour.rgb;
+}
+
@@ -1,12 +1,20 @@
 #version 430
 
-// The modelview and projection matrices are no longer given in OpenGL 4.2
-uniform mat4 MV;
-uniform mat4 MVP;
-uniform mat3 N; // This is the inverse transpose of the MV matrix
-
-/// Store the depth bias model view projection matrix
-uniform mat4 depthBiasMVP;
+// The matrices and light shared by every object this frame (see Scene::FrameBlock)
+layout (std140, binding=0) uniform FrameBlock {
+    mat4 V;
+    mat4 P;
+    vec4 LightPosition; // Light position in eye coords.
+} Frame;
+
+// The matrices and colour of the object being drawn (see Scene::ObjectBlock)
+layout (std140, binding=1) uniform ObjectBlock {
+    mat4 MVP;
+    mat4 MV;
+    mat4 N; // This is the inverse transpose of the MV matrix (only the top left 3x3 is used)
+    mat4 depthBiasMVP; // The model matrix, which takes positions to world space for the cascades
+    vec4 Colour;
+} Object;
 
 // The vertex position attribute
 layout (location=0) in vec3 VertexPosition;
@@ -20,20 +28,24 @@ layout (location=2) in vec2 TexCoord;
 // Passed onto the fragment shader
 out vec3 FragmentNormal;
 out vec4 FragmentPosition;
-out vec4 ShadowCoord;
+out vec4 WorldPosition;
+out vec3 FragmentColour;
 
 
 /************************************************************************************/
 void main() {
     // Set the position of the current vertex
-    gl_Position = MVP * vec4(VertexPosition, 1.0);
+    gl_Position = Object.MVP * vec4(VertexPosition, 1.0);
     // Transform the normal
-    FragmentNormal = N * VertexNormal;
+    FragmentNormal = mat3(Object.N) * VertexNormal;
 
     // Transform the world space fragment coordinates for shading
-    FragmentPosition = MV * vec4(VertexPosition, 1.0);
+    FragmentPosition = Object.MV * vec4(VertexPosition, 1.0);
+
+    // The world space position, which the fragment shader projects into the cascade it falls in
+    WorldPosition = Object.depthBiasMVP * vec4(VertexPosition, 1.0);
 
-    // Transform the model space coordinates for shadow coordinate projection
-    ShadowCoord = depthBiasMVP * vec4(VertexPosition, 1.0);
+    // The diffuse reflectivity of the object
+    FragmentColour = Object.Colour.rgb;
 }
 
@@ -10,12 +10,32 @@ SOURCES += src/main.cpp \
            src/shadowscene.cpp \
            ../common/src/scene.cpp \
            ../common/src/camera.cpp \
-           ../common/src/trackballcamera.cpp
+           ../common/src/trackballcamera.cpp \
+           ../common/src/shaderprogram.cpp \
+           ../common/src/instancebuffer.cpp \
+           ../common/src/rendertargetpool.cpp \
+           ../common/src/programcache.cpp \
+           ../common/src/programbuilder.cpp \
+           ../common/src/fixedcamera.cpp \
+           ../common/src/headlessrunner.cpp \
+           ../common/src/tracelog.cpp \
+           ../common/src/bufferhash.cpp
 
 HEADERS += src/shadowscene.h \
            ../common/include/scene.h \
            ../common/include/camera.h \
-           ../common/include/trackballcamera.h
+           ../common/include/trackballcamera.h \
+           ../common/include/shaderprogram.h \
+           ../common/include/instancebuffer.h \
+           ../common/include/rendertargetpool.h \
+           ../common/include/programcache.h \
+           ../common/include/programbuilder.h \
+           ../common/include/parallelfor.h \
+           ../common/include/fixedcamera.h \
+           ../common/include/headlessrunner.h \
+           ../common/include/tracelog.h \
+           ../common/include/bufferhash.h \
+           ../common/include/fnv1a.h
 
 OTHER_FILES += shaders/*.glsl
 
@@ -23,6 +43,9 @@ DISTFILES += \
 	     shaders/depth_frag.glsl \
              shaders/depth_vert.glsl \
 	     shaders/shadow_frag.glsl \
-	     shaders/shadow_vert.glsl
+	     shaders/shadow_vert.glsl \
+             shaders/depth_instanced_vert.glsl \
+             shaders/shadow_instanced_vert.glsl \
+             shaders/depth_cascade_geom.glsl
 	
 	
@@ -1,5 +1,7 @@
 // Must include our scene first because of GL dependency order
 #include "shadowscene.h"
+#include "headlessrunner.h"
+#include "tracelog.h"
 #include "firstpersoncamera.h"
 #include "trackballcamera.h"
 #include "fixedcamera.h"
@@ -38,6 +40,15 @@ void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action, int
             break;
         case GLFW_KEY_RIGHT_BRACKET:
             break;
+        case GLFW_KEY_I: // toggle instanced drawing
+            g_scene.toggleInstancing();
+            break;
+        case GLFW_KEY_N: // change the number of teapots
+            g_scene.cycleNumObjects();
+            break;
+        case GLFW_KEY_C: // change the number of shadow cascades
+            g_scene.cycleNumCascades();
+            break;
         }
     }
     // Any other keypress should be handled by our camera
@@ -53,7 +64,17 @@ void resize_callback(GLFWwindow */*window*/, int width, int height) {
     g_scene.resizeGL(width,height);
 }
 
-int main() {
+int main(int argc, char **argv) {
+    // Without a window, draw a scripted orbit of the scene and report the frame times (see HeadlessRunner)
+    HeadlessRunner::Options options;
+    int exitCode;
+    if (HeadlessRunner::runIfRequested(argc, argv, g_scene, options, exitCode, [](const HeadlessRunner::Options &options) {
+        if (options.m_numObjects > 0) g_scene.setNumObjects(options.m_numObjects);
+    })) return exitCode;
+
+    // With --trace file.json, record where start up and each frame spend their time (see TraceLog)
+    if (!options.m_traceFile.empty()) TraceLog::start();
+
     if (!glfwInit()) {
         // Initialisation failed
         glfwTerminate();
@@ -64,7 +85,7 @@ int main() {
 
     // Set our OpenGL version
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
 
     // Create our window in a platform agnostic manner
     int width = 640; int height = 480;
@@ -81,6 +102,9 @@ int main() {
     // Make the window an OpenGL window
     glfwMakeContextCurrent(window);
 
+    // Don't wait for the vertical retrace, so the reported frame time is the cost of drawing
+    glfwSwapInterval(0);
+
     // Set keyboard callback
     glfwSetKeyCallback(window, key_callback);
 
@@ -108,6 +132,9 @@ int main() {
               << "[: Decrease focal depth target\n"
               << "]: Increase focal depth target\n"
               << "b: Switch blurring method (either Gaussian or Poisson)\n"              
+              << "i: Toggle drawing the teapots with one instanced draw call\n"
+              << "n: Change the number of teapots (5 to 20000), to compare the frame times\n"
+              << "c: Change the number of shadow cascades (2 to 4)\n"
               << "<ESC>: Quit\n"
               << "****************************************************\n";
     
@@ -137,4 +164,5 @@ int main() {
     // Close up shop
     glfwDestroyWindow(window);
     glfwTerminate();
+    if (!options.m_traceFile.empty()) TraceLog::write(options.m_traceFile);
 }
@@ -1,4 +1,6 @@
 #include "shadowscene.h"
+#include "tracelog.h"
+#include "programbuilder.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtc/type_ptr.hpp>
@@ -7,6 +9,9 @@
 #include <ngl/NGLInit.h>
 #include <ngl/VAOPrimitives.h>
 #include <ngl/ShaderLib.h>
+#include <algorithm>
+#include <limits>
+#include <cmath>
 
 /**
  * @brief ShadowScene::ShadowScene
@@ -16,7 +21,6 @@ ShadowScene::ShadowScene() : Scene() {
 
 void ShadowScene::resizeGL(GLint width, GLint height) noexcept {
     Scene::resizeGL(width,height);
-    m_isFBODirty = true;
     m_lightPos = glm::vec3(0.2f,0.2f,1.0f);
 }
 
@@ -24,6 +28,8 @@ void ShadowScene::resizeGL(GLint width, GLint height) noexcept {
  * @brief ShadowScene::initGL
  */
 void ShadowScene::initGL() noexcept {
+    TraceScope trace("ShadowScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -39,198 +45,466 @@ void ShadowScene::initGL() noexcept {
     // enable multisampling for smoother drawing
     glEnable(GL_MULTISAMPLE);
 
-    // Create and compile the vertex and fragment shader
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
+    // Queue all of the programs at once, so that the driver can compile them side by side
+    ProgramBuilder builder;
+
+    // The program which renders the depth from the light into every cascade of the shadow map at once
+    const size_t depth = builder.add("DepthProgram", {{GL_VERTEX_SHADER, "shaders/depth_vert.glsl"},
+                                                      {GL_GEOMETRY_SHADER, "shaders/depth_cascade_geom.glsl"},
+                                                      {GL_FRAGMENT_SHADER, "shaders/depth_frag.glsl"}});
 
-    // Create the basic shader used to render the scene with Gouraud shading
-    shader->loadShader("DepthProgram",              // Name of program
-                       "shaders/depth_vert.glsl",   // Vertex shader
-                       "shaders/depth_frag.glsl");  // Fragment shader
+    // The program which shades the scene, looking up the shadow map
+    const size_t shadow = builder.add("ShadowProgram", {{GL_VERTEX_SHADER, "shaders/shadow_vert.glsl"},
+                                                        {GL_FRAGMENT_SHADER, "shaders/shadow_frag.glsl"}});
 
-    // Create the depth of field shader program, which combines pixels in the fragment shader
-    shader->loadShader("ShadowProgram",                // Name of program
-                       "shaders/shadow_vert.glsl",     // Vertex shader
-                       "shaders/shadow_frag.glsl");    // Fragment shader
+    // The same two programs for drawing all the teapots at once, which read the model matrices from the instances
+    const size_t depthInstanced = builder.add("DepthInstancedProgram",
+                                              {{GL_VERTEX_SHADER, "shaders/depth_instanced_vert.glsl"},
+                                               {GL_GEOMETRY_SHADER, "shaders/depth_cascade_geom.glsl"},
+                                               {GL_FRAGMENT_SHADER, "shaders/depth_frag.glsl"}});
+    const size_t shadowInstanced = builder.add("ShadowInstancedProgram",
+                                               {{GL_VERTEX_SHADER, "shaders/shadow_instanced_vert.glsl"},
+                                                {GL_FRAGMENT_SHADER, "shaders/shadow_frag.glsl"}});
 
-    // Create a ground plane
+    // Create a ground plane while they compile
     ngl::VAOPrimitives *prim=ngl::VAOPrimitives::instance();
-    prim->createTrianglePlane("plane",2,2,1,1,ngl::Vec3(0,1,0));   
+    prim->createTrianglePlane("plane",2,2,1,1,ngl::Vec3(0,1,0));
+    builder.finish();
+
+    // Look up the uniforms once, rather than for every object drawn
+    m_depthProgram.init(builder.program(depth));
+    m_shadowProgram.init(builder.program(shadow));
+    m_depthInstancedProgram.init(builder.program(depthInstanced));
+    m_shadowInstancedProgram.init(builder.program(shadowInstanced));
+    m_depthCascades.init(m_depthProgram);
+    m_shadowCascades.init(m_shadowProgram);
+    m_depthInstancedCascades.init(m_depthInstancedProgram);
+    m_shadowInstancedCascades.init(m_shadowInstancedProgram);
 }
 
 /**
- * @brief ShadowScene::initFBO
+ * @brief ShadowScene::CascadeUniforms::init
+ * The depth programs don't read the shadow map or the splits, and the shadow programs don't read the mask of the
+ * cascades to draw, so those handles are inactive for them.
+ * @param program The program to look the uniforms up in
  */
-void ShadowScene::initFBO() {
-    // First delete the FBO if it has been created previously
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fboId);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER)==GL_FRAMEBUFFER_COMPLETE) {
-        glDeleteTextures(1, &m_fboDepthId);
-        glDeleteFramebuffers(1, &m_fboId);
+void ShadowScene::CascadeUniforms::init(const ShaderProgram &program) {
+    for (int i = 0; i < MAX_CASCADES; ++i) {
+        m_VP[i] = program.uniform<glm::mat4>("cascadeVP[" + std::to_string(i) + "]");
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    m_splits = program.uniform<glm::vec4>("cascadeSplits");
+    m_numCascades = program.uniform<GLint>("numCascades");
+    m_mask = program.uniform<GLint>("cascadeMask");
+    m_depthTex = program.uniform<GLint>("depthTex");
+}
 
-    // The depth buffer is rendered to a texture buffer too
-    glGenTextures(1, &m_fboDepthId);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_fboDepthId);
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_DEPTH_COMPONENT16,
-                 m_shadowRes,
-                 m_shadowRes,
-                 0,
-                 GL_DEPTH_COMPONENT,
-                 GL_UNSIGNED_BYTE,
-                 NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    // Create the frame buffer
-    glGenFramebuffers(1, &m_fboId);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fboId);    
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_fboDepthId, 0);
-
-    // Set the fragment shader output targets (DEPTH_ATTACHMENT is done automatically)
-    GLenum drawBufs[] = {GL_NONE};
-    glDrawBuffers(1, drawBufs);
-
-    // Check it is ready to rock and roll
-    CheckFrameBuffer();
-
-    // Unbind the framebuffer to revert to default render pipeline
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+/**
+ * @brief ShadowScene::cycleNumObjects
+ */
+void ShadowScene::cycleNumObjects() {
+    m_numObjects = (m_numObjects >= MAX_OBJECTS) ? 5 : std::min(m_numObjects * 10, MAX_OBJECTS);
+    m_isObjectsDirty = true;
 }
 
 /**
- * @brief ShadowScene::paintGL
- * This is a two stage render process: firstly we render a bunch of teapots into our FBO, which
- * writes the colour and depth buffer areas to the textures m_fboTextureId and m_fboDepthId.
- * In the second render pass we bind these two textures and draw a screen aligned plane with
- * these textures applied. The depth of field effect is made by combining these two stages on
- * the fragment shader.
+ * @brief ShadowScene::setNumObjects
+ * @param numObjects The number of teapots
  */
-void ShadowScene::paintGL() noexcept {
-    // Check if the FBO needs to be recreated. This occurs after a resize.
-    if (m_isFBODirty) {
-        initFBO();
-        m_isFBODirty = false;
+void ShadowScene::setNumObjects(int numObjects) {
+    m_numObjects = std::max(1, std::min(numObjects, MAX_OBJECTS));
+    m_isObjectsDirty = true;
+}
+
+/**
+ * @brief ShadowScene::cycleNumCascades
+ */
+void ShadowScene::cycleNumCascades() {
+    m_numCascades = (m_numCascades >= MAX_CASCADES) ? 2 : m_numCascades + 1;
+    updateWorkload();
+}
+
+/**
+ * @brief ShadowScene::objectTransform
+ * The teapots are cascaded in depth and x, starting a new row every OBJECTS_PER_ROW teapots. This is called from
+ * several threads when the instances are built.
+ * @param i The index of the teapot
+ * @param M The model matrix
+ * @param rgb The colour
+ */
+void ShadowScene::objectTransform(size_t i, glm::mat4 &M, glm::vec3 &rgb) const {
+    // Calculate colour by cycling in HSV colour space
+    hsv2rgb(rgb, glm::vec3(float(i) / float(m_numObjects), 1.0f, 1.0f));
+
+    // Translate in depth and x to get a cascade effect
+    float column = float(i % OBJECTS_PER_ROW);
+    float row = float(i / OBJECTS_PER_ROW);
+    M = glm::translate(glm::mat4(1.0f), glm::vec3(column + row, 0.0f, column - row));
+}
+
+/**
+ * @brief ShadowScene::initObjects
+ */
+void ShadowScene::initObjects() {
+    // Drawn one at a time every teapot needs a block in the uniform ring in both passes, otherwise only the passes do
+    initUniformBlocks(m_instanced ? 2 : 2 * size_t(m_numObjects));
+    m_instances.build(size_t(m_numObjects), [this](size_t i, glm::mat4 &M, glm::vec3 &rgb) {
+        objectTransform(i, M, rgb);
+    });
+
+    // The cascades are fitted around the teapots every frame
+    m_objectCentres.resize(size_t(m_numObjects));
+    m_lightCentres.resize(size_t(m_numObjects));
+    glm::mat4 M;
+    glm::vec3 rgb;
+    for (size_t i = 0; i < m_objectCentres.size(); ++i) {
+        objectTransform(i, M, rgb);
+        m_objectCentres[i] = glm::vec3(M[3]);
     }
 
-    // Bind the FBO to specify an alternative render target
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fboId);
+    // The teapots only move when they are rebuilt, so this is the only time the shadow map needs drawing for them
+    m_isCastersDirty = true;
+    updateWorkload();
+}
 
-    // Set up the viewport
-    glViewport(0,0,m_width,m_height);
+/**
+ * @brief ShadowScene::updateWorkload
+ */
+void ShadowScene::updateWorkload() {
+    m_workload = std::to_string(m_numObjects) + (m_instanced ? " teapots instanced" : " teapots drawn one at a time");
+    m_workload += ", " + std::to_string(m_numCascades) + " shadow cascades";
+    resetFrameTimer();
+}
+
+/**
+ * @brief ShadowScene::fitCascades
+ * The splits blend evenly spaced depths with logarithmically spaced ones, which keep the size of a texel on screen
+ * about the same in every cascade, over the range of depths which actually has teapots in it. Each cascade is then
+ * bounded in light space: across the light it only covers the part of its slice of the view frustum which has
+ * teapots in it, and along the light it reaches back to the nearest teapot which could cast a shadow into it.
+ * A cascade which has already been drawn keeps its light frustum for as long as that still covers these bounds
+ * without wasting too many texels, so that the camera can move a little without the cascade being drawn again.
+ * @param lightV The view matrix of the light
+ */
+void ShadowScene::fitCascades(const glm::mat4 &lightV) {
+    TraceScope trace("ShadowScene::fitCascades");
+    const float maxFloat = std::numeric_limits<float>::max();
+
+    // The near and far planes of the camera's perspective projection
+    const float zNear = m_P[3][2] / (m_P[2][2] - 1.0f);
+    const float zFar = m_P[3][2] / (m_P[2][2] + 1.0f);
+
+    // The distances of the sides of the view frustum (where |x| P[0][0] or |y| P[1][1] is the depth) are scaled by
+    const float xScale = std::sqrt(1.0f + m_P[0][0] * m_P[0][0]), yScale = std::sqrt(1.0f + m_P[1][1] * m_P[1][1]);
+
+    // Find the teapots from the light, and the range of depths covered by those the camera can see
+    float minDepth = maxFloat, maxDepth = -maxFloat;
+    for (size_t i = 0; i < m_objectCentres.size(); ++i) {
+        const glm::vec4 centre(m_objectCentres[i], 1.0f);
+        m_lightCentres[i] = glm::vec3(lightV * centre);
+        const glm::vec3 p(m_V * centre);
+        const float depth = -p.z;
+        if ((std::abs(p.x) * m_P[0][0] - depth > OBJECT_RADIUS * xScale) ||
+            (std::abs(p.y) * m_P[1][1] - depth > OBJECT_RADIUS * yScale)) continue;
+        minDepth = std::min(minDepth, depth - OBJECT_RADIUS);
+        maxDepth = std::max(maxDepth, depth + OBJECT_RADIUS);
+    }
+    float nearDepth = std::max(zNear, minDepth), farDepth = std::min(zFar, maxDepth);
+    if (nearDepth >= farDepth) {
+        nearDepth = zNear;
+        farDepth = zFar;
+    }
+
+    // The corners of the view frustum on its near and far planes, in world space
+    const glm::mat4 inverseVP = glm::inverse(m_P * m_V);
+    glm::vec3 nearCorners[4], farCorners[4];
+    for (int i = 0; i < 4; ++i) {
+        const float x = (i & 1) ? 1.0f : -1.0f, y = (i & 2) ? 1.0f : -1.0f;
+        const glm::vec4 nearCorner = inverseVP * glm::vec4(x, y, -1.0f, 1.0f);
+        const glm::vec4 farCorner = inverseVP * glm::vec4(x, y, 1.0f, 1.0f);
+        nearCorners[i] = glm::vec3(nearCorner) / nearCorner.w;
+        farCorners[i] = glm::vec3(farCorner) / farCorner.w;
+    }
+
+    float start = nearDepth;
+    for (int c = 0; c < m_numCascades; ++c) {
+        const float t = float(c + 1) / float(m_numCascades);
+        const float end = glm::mix(nearDepth + (farDepth - nearDepth) * t,
+                                   nearDepth * std::pow(farDepth / nearDepth, t),
+                                   SPLIT_LAMBDA);
+        m_cascadeSplits[c] = end;
+
+        // Bound the slice of the view frustum from start to end in light space. The depth along each edge of the
+        // frustum grows linearly from its near corner to its far corner.
+        glm::vec3 sliceMin(maxFloat), sliceMax(-maxFloat);
+        for (int i = 0; i < 4; ++i) {
+            for (float depth : {start, end}) {
+                const glm::vec3 corner = glm::mix(nearCorners[i], farCorners[i], (depth - zNear) / (zFar - zNear));
+                const glm::vec3 p(lightV * glm::vec4(corner, 1.0f));
+                sliceMin = glm::min(sliceMin, p);
+                sliceMax = glm::max(sliceMax, p);
+            }
+        }
+
+        // Bound the teapots which overlap the slice as seen from the light, wherever they are along it
+        glm::vec3 casterMin(maxFloat), casterMax(-maxFloat);
+        for (const glm::vec3 &p : m_lightCentres) {
+            if ((p.x + OBJECT_RADIUS < sliceMin.x) || (p.x - OBJECT_RADIUS > sliceMax.x) ||
+                (p.y + OBJECT_RADIUS < sliceMin.y) || (p.y - OBJECT_RADIUS > sliceMax.y)) continue;
+            casterMin = glm::min(casterMin, p - glm::vec3(OBJECT_RADIUS));
+            casterMax = glm::max(casterMax, p + glm::vec3(OBJECT_RADIUS));
+        }
+
+        // Shadows only fall on the teapots inside the slice, but can be cast by any of them nearer the light (the
+        // light looks down -z, so nearer is larger z)
+        glm::vec3 lo = glm::max(sliceMin, casterMin), hi = glm::min(sliceMax, casterMax);
+        hi.z = casterMax.z;
+        if ((lo.x >= hi.x) || (lo.y >= hi.y) || (lo.z >= hi.z)) {
+            // There's nothing to shadow in this cascade, so any frustum will do
+            lo = sliceMin;
+            hi = sliceMax;
+        }
+
+        // Keep the light frustum the cascade was last drawn with if it still fits, otherwise fit it again with a
+        // margin around the bounds, so that it has some room to move
+        const glm::vec3 &cachedMin = m_cascadeMin[c], &cachedMax = m_cascadeMax[c];
+        const bool isCovered = (cachedMin.x <= lo.x) && (cachedMin.y <= lo.y) && (cachedMin.z <= lo.z) &&
+                               (cachedMax.x >= hi.x) && (cachedMax.y >= hi.y) && (cachedMax.z >= hi.z);
+        const float area = (hi.x - lo.x) * (hi.y - lo.y);
+        const float cachedArea = (cachedMax.x - cachedMin.x) * (cachedMax.y - cachedMin.y);
+        if ((m_dirtyCascades & (1 << c)) || !isCovered || (cachedArea > area * MAX_CASCADE_SLACK)) {
+            const glm::vec3 margin = (hi - lo) * CASCADE_MARGIN;
+            m_cascadeMin[c] = lo - margin;
+            m_cascadeMax[c] = hi + margin;
+            m_cascadeVP[c] = glm::ortho(m_cascadeMin[c].x, m_cascadeMax[c].x, m_cascadeMin[c].y, m_cascadeMax[c].y,
+                                        -m_cascadeMax[c].z, -m_cascadeMin[c].z) * lightV;
+            m_dirtyCascades |= 1 << c;
+        }
+        start = end;
+    }
+}
+
+/**
+ * @brief ShadowScene::cullCasters
+ * A teapot can only cast a shadow into a cascade if its bounding sphere is inside the cascade's light frustum, which
+ * reaches from the teapots nearest the light back to the farthest one it shadows. The rest would only be clipped
+ * away by the GPU, after the cost of transforming them.
+ */
+void ShadowScene::cullCasters() {
+    TraceScope trace("ShadowScene::cullCasters");
+    m_casters.clear();
+    for (size_t i = 0; i < m_lightCentres.size(); ++i) {
+        const glm::vec3 &p = m_lightCentres[i];
+        for (int c = 0; c < m_numCascades; ++c) {
+            const glm::vec3 &lo = m_cascadeMin[c], &hi = m_cascadeMax[c];
+            if (!(m_dirtyCascades & (1 << c)) ||
+                (p.x + OBJECT_RADIUS < lo.x) || (p.x - OBJECT_RADIUS > hi.x) ||
+                (p.y + OBJECT_RADIUS < lo.y) || (p.y - OBJECT_RADIUS > hi.y) ||
+                (p.z + OBJECT_RADIUS < lo.z) || (p.z - OBJECT_RADIUS > hi.z)) continue;
+            m_casters.push_back(i);
+            break;
+        }
+    }
+
+    // Instanced, the teapots left are given their own instances to draw
+    if (m_instanced) {
+        m_casterInstances.build(m_casters.size(), [this](size_t i, glm::mat4 &M, glm::vec3 &rgb) {
+            objectTransform(m_casters[i], M, rgb);
+        });
+    }
+}
+
+/**
+ * @brief ShadowScene::setCascadeUniforms
+ * @param uniforms The handles of the program in use
+ */
+void ShadowScene::setCascadeUniforms(const CascadeUniforms &uniforms) const {
+    for (int i = 0; i < m_numCascades; ++i) uniforms.m_VP[i].set(m_cascadeVP[i]);
+    uniforms.m_splits.set(m_cascadeSplits);
+    uniforms.m_numCascades.set(m_numCascades);
+    uniforms.m_mask.set(m_dirtyCascades);
+
+    // This is the active texture unit!
+    uniforms.m_depthTex.set(0);
+}
 
-    // Clear the screen (fill with our glClearColor)
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+/**
+ * @brief ShadowScene::paintGL
+ * This is a two stage render process: firstly we render a bunch of teapots from the light into a layered depth
+ * target from the pool, which becomes the shadow map. The view frustum is split into cascades along its depth, each
+ * with a light frustum fitted around its teapots (see fitCascades()), so that the near teapots get as many texels
+ * as the far ones and none are spent on empty space. A geometry shader draws every triangle into each cascade's
+ * layer in the same pass.
+ * The shadow map is kept from frame to frame, and a cascade is only drawn again when the light or the teapots change,
+ * or the camera moves far enough that its light frustum has to be fitted again. Only the teapots which can cast a
+ * shadow into the cascades being drawn are sent to the GPU, so a static scene costs a single depth pass.
+ * In the second render pass the scene is drawn from the camera, looking up the cascade each fragment falls in to
+ * find which fragments the light can't see.
+ */
+void ShadowScene::paintGL() noexcept {
+    TraceScope trace("ShadowScene::paintGL");
 
-    // Use our shader for this draw
-    ngl::ShaderLib *shader=ngl::ShaderLib::instance();
-    (*shader)["DepthProgram"]->use();
-    GLint pid = shader->getProgramID("DepthProgram");
+    // Rebuild the uniform ring and the instances after the teapots change
+    if (m_isObjectsDirty) {
+        initObjects();
+        m_isObjectsDirty = false;
+    }
+    timeFrame("ShadowScene", m_workload);
+    beginProfileFrame("ShadowScene");
+
+    // Keep the depth only target with a layer for each cascade from frame to frame, only taking a new one from the
+    // pool when the number of cascades changes
+    const GLint allCascades = (1 << m_numCascades) - 1;
+    m_renderTargets.beginFrame();
+    if ((m_shadowMap == nullptr) || (m_shadowMap->m_format.m_layers != m_numCascades)) {
+        m_renderTargets.release(m_shadowMap);
+        RenderTargetPool::Format format;
+        format.m_colour = GL_NONE;
+        format.m_depth = GL_DEPTH_COMPONENT16;
+        format.m_layers = m_numCascades;
+        m_shadowMap = m_renderTargets.acquire(m_shadowRes, m_shadowRes, format);
+        m_dirtyCascades = allCascades;
+    }
+
+    // Every cascade is drawn again after the light or the teapots change
+    if (m_isCastersDirty || (m_lightPos != m_shadowLightPos)) {
+        m_dirtyCascades = allCascades;
+        m_isCastersDirty = false;
+        m_shadowLightPos = m_lightPos;
+    }
 
-    glm::mat4 depthProjectionMatrix = glm::ortho<float>(-10.0f, 10.0f, -10.0f, 10.0f, -10.0f, 10.0f);
+    // Fit the light frustum of each cascade to the view from the camera, which marks those which have to be redrawn
     glm::mat4 depthViewMatrix = glm::lookAt(-m_lightPos, glm::vec3(0.0f,0.0f,0.0f), glm::vec3(0.0f,1.0f,0.0f));
+    fitCascades(depthViewMatrix);
+
+    // The light position is shared by every object drawn this frame
+    beginUniformBlocks({m_V, m_P, glm::vec4(m_lightPos,1.0f)});
+
+    if (m_dirtyCascades != 0) {
+        beginPass("shadow depth");
+        cullCasters();
+
+        // Bind the target, which also sets the viewport to its resolution, and clear the layers being drawn, leaving
+        // the other cascades as they were
+        m_shadowMap->bind();
+        const GLfloat farDepth = 1.0f;
+        for (int c = 0; c < m_numCascades; ++c) {
+            if (!(m_dirtyCascades & (1 << c))) continue;
+            glClearTexSubImage(m_shadowMap->m_depth, 0, 0, 0, c, m_shadowMap->m_width, m_shadowMap->m_height, 1,
+                               GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+        }
 
-    // Draw the scene from the light perspective
-    drawScene(pid, depthViewMatrix, depthProjectionMatrix, glm::mat4(1.0f));
+        // Use our shader for this draw, which only draws into the dirty layers
+        if (m_instanced) {
+            m_depthInstancedProgram.use();
+            setCascadeUniforms(m_depthInstancedCascades);
+        } else {
+            m_depthProgram.use();
+            setCascadeUniforms(m_depthCascades);
+        }
 
-    // Unbind our FBO
-    glBindFramebuffer(GL_FRAMEBUFFER,0);
+        // Draw the casters from the light perspective. The depths are pushed back by their slope, so that surfaces
+        // facing the light don't shadow themselves.
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(2.0f, 4.0f);
+        drawCasters();
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        m_dirtyCascades = 0;
+
+        // Unbind our FBO
+        glBindFramebuffer(GL_FRAMEBUFFER,0);
+        endPass();
+    }
 
-    // Find the depth of field shader
+    // Draw the scene from the camera, looking up the shadows in the cascades
+    beginPass("lit");
     glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glViewport(0,0,m_width,m_height);
 
-    // Now bind our rendered image which should be in the frame buffer for the next render pass    
+    // Now bind our rendered image which should be in the frame buffer for the next render pass
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_fboDepthId);
-    (*shader)["ShadowProgram"]->use();
-    pid = shader->getProgramID("ShadowProgram");
-
-    // This is the active texture unit!
-    glUniform1i(glGetUniformLocation(pid, "depthTex"), 0);
-
-    // Set the light position on the shader
-    glUniform4fv(glGetUniformLocation(pid, "Light.Position"), 1, glm::value_ptr(glm::vec4(m_lightPos,1.0f)));
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_shadowMap->m_depth);
+    if (m_instanced) {
+        m_shadowInstancedProgram.use();
+        setCascadeUniforms(m_shadowInstancedCascades);
+    } else {
+        m_shadowProgram.use();
+        setCascadeUniforms(m_shadowCascades);
+    }
 
     // Draw the scene, this time from the camera perspective
-    drawScene(pid, m_V, m_P, depthViewMatrix * depthProjectionMatrix);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    drawScene(m_V, m_P);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    endPass();
+
+    // Fence this frame's blocks so they aren't overwritten while the GPU is reading them
+    endUniformBlocks();
 }
 
 /**
  * @brief drawScene
- * @param pid
+ * Writes an object block for each teapot into the uniform ring and draws it, or when instancing writes one block for
+ * the pass and draws every teapot at once. The shadow map is looked up from the world space position, as the cascade depends on the fragment, so
+ * the depth bias matrix of the block is just the model matrix.
  * @param V The view matrix
  * @param P The projection matrix
  */
-void ShadowScene::drawScene(const GLuint &pid, const glm::mat4 &V, const glm::mat4 &P, const glm::mat4 &depthVP) {
-    int i;
-    glm::vec3 hsv, rgb;
-
+void ShadowScene::drawScene(const glm::mat4 &V, const glm::mat4 &P) {
     // Grab and instance of the VAO primitives path
     ngl::VAOPrimitives *prim=ngl::VAOPrimitives::instance();
 
-    // Needed for colour cycling
-    float colourStep = 1.0f / float(m_numObjects);
-    glm::mat4 M, MV, MVP;
-    glm::mat3 N;
-    glm::mat4 depthBiasMVP;
-    glm::mat4 biasMatrix(0.5, 0.0, 0.0, 0.0,
-                         0.0, 0.5, 0.0, 0.0,
-                         0.0, 0.0, 0.5, 0.0,
-                         0.5, 0.5, 0.5, 1.0);
-    GLuint loc;
-
-    for (i=0; i<m_numObjects; ++i) {
-        // Calculate colour by cycling in HSV colour space
-        hsv = glm::vec3(float(i) * colourStep, 1.0f, 1.0f);
-        hsv2rgb(rgb, hsv);
-
-        // Translate in depth and x to get a cascade effect
-        M = glm::translate(glm::mat4(1.0f), glm::vec3(float(i), 0.0f, float(i)));
-
-        // Set this MVP on the GPU
-        MVP = P * V * M;
-        glUniformMatrix4fv(glGetUniformLocation(pid, "MVP"), //location of uniform
-                           1, // how many matrices to transfer
-                           false, // whether to transpose matrix
-                           glm::value_ptr(MVP)); // a raw pointer to the data
-
-        // Check if these uniforms exist before setting them
-        if ((loc = glGetUniformLocation(pid, "MV")) != -1) {
-            MV = V * M;
-            glUniformMatrix4fv(loc, //location of uniform
-                               1, // how many matrices to transfer
-                               false, // whether to transpose matrix
-                               glm::value_ptr(MV)); // a raw pointer to the data
-        }
-        if ((loc = glGetUniformLocation(pid, "N")) != -1) {
-            N = glm::inverse(glm::mat3(MV));
-            glUniformMatrix3fv(loc, //location of uniform
-                               1, // how many matrices to transfer
-                               true, // whether to transpose matrix
-                               glm::value_ptr(N)); // a raw pointer to the data
-        }
-        if ((loc = glGetUniformLocation(pid, "Material.Kd")) != -1) {
-            glUniform3fv(loc, 1, glm::value_ptr(rgb));
-        }
-        if ((loc = glGetUniformLocation(pid, "depthBiasMVP")) != -1) {
-            depthBiasMVP = biasMatrix*depthVP*M;
-            glUniformMatrix4fv(loc, //location of uniform
-                               1, // how many matrices to transfer
-                               false, // whether to transpose matrix
-                               glm::value_ptr(depthBiasMVP)); // a raw pointer to the data
-        }
-        // Draw a teapot primitive
-        prim->draw("teapot");
+    ObjectBlock object{};
+    if (m_instanced) {
+        // The block holds the matrices of the pass, and the shader multiplies in the model matrix of each teapot
+        object.m_MVP = P * V;
+        object.m_MV = V;
+        object.m_N = glm::mat4(glm::transpose(glm::inverse(glm::mat3(V))));
+        object.m_depthBiasMVP = glm::mat4(1.0f);
+        bindObjectBlock(pushObjectBlock(object));
+        m_instances.draw(prim->getVAOFromName("teapot"));
+        return;
     }
 
+    glm::mat4 M;
+    glm::vec3 rgb;
+    for (size_t i = 0; i < size_t(m_numObjects); ++i) {
+        // Find where the teapot goes and what colour it is
+        objectTransform(i, M, rgb);
+
+        // Fill in the block for this teapot
+        object.m_MVP = P * V * M;
+        object.m_MV = V * M;
+        object.m_N = glm::mat4(glm::transpose(glm::inverse(glm::mat3(object.m_MV))));
+        object.m_depthBiasMVP = M;
+        object.m_colour = glm::vec4(rgb, 1.0f);
+
+        // Write it into the ring and draw a teapot primitive with it
+        bindObjectBlock(pushObjectBlock(object));
+        prim->draw("teapot");
+    }
 }
 
+/**
+ * @brief ShadowScene::drawCasters
+ * The depth programs read the same object block as the shadow programs, but only use its MVP, which is just the
+ * model matrix (or the identity when instancing) as the geometry shader applies the matrix of each cascade.
+ */
+void ShadowScene::drawCasters() {
+    ngl::VAOPrimitives *prim=ngl::VAOPrimitives::instance();
 
+    ObjectBlock object{};
+    if (m_instanced) {
+        object.m_MVP = glm::mat4(1.0f);
+        bindObjectBlock(pushObjectBlock(object));
+        m_casterInstances.draw(prim->getVAOFromName("teapot"));
+        return;
+    }
+
+    glm::mat4 M;
+    glm::vec3 rgb;
+    for (size_t i : m_casters) {
+        objectTransform(i, M, rgb);
+        object.m_MVP = M;
+        bindObjectBlock(pushObjectBlock(object));
+        prim->draw("teapot");
+    }
+}
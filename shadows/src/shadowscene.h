@@ -3,6 +3,9 @@
 
 // The parent class for this scene
 #include "scene.h"
+#include "shaderprogram.h"
+#include "instancebuffer.h"
+#include "rendertargetpool.h"
 
 #include <ngl/Obj.h>
 
@@ -19,36 +22,128 @@ public:
     /// Called when the scene is to be initialised
     void initGL() noexcept;
 
-    /// Resize the window (must resize the FBO)
+    /// Resize the window
     void resizeGL(GLint /*width*/, GLint /*height*/) noexcept;
 
+    /// Toggle between one draw call per teapot and a single instanced draw call in each pass
+    void toggleInstancing() {m_instanced = !m_instanced; m_isObjectsDirty = true;}
+
+    /// Cycle the number of teapots through 5, 50, 500, 5000 and MAX_OBJECTS, to compare the cost of the two paths
+    void cycleNumObjects();
+
+    /// Draw a particular number of teapots (clamped to between 1 and MAX_OBJECTS), as the benchmark suite does
+    void setNumObjects(int /*numObjects*/);
+
+    /// Cycle the number of shadow cascades from 2 to MAX_CASCADES
+    void cycleNumCascades();
+
 private:
-    /// Draw some teapots given the particular View and Projection matrices
-    void drawScene(const GLuint &/*pid*/,
-                   const glm::mat4 &/*V*/,
-                   const glm::mat4 &/*P*/,
-                   const glm::mat4 &/*depthVP*/);
+    /// The most teapots drawn, and the number in each row of the cascade
+    static constexpr int MAX_OBJECTS = 20000;
+    static constexpr size_t OBJECTS_PER_ROW = 64;
+
+    /// The most shadow cascades, which must match the arrays in the shaders
+    static constexpr int MAX_CASCADES = 4;
+
+    /// How the cascades are split between evenly spaced (0) and logarithmically spaced (1) depths
+    static constexpr float SPLIT_LAMBDA = 0.75f;
+
+    /// The radius of a sphere around the teapot primitive, for fitting the light frusta
+    static constexpr float OBJECT_RADIUS = 1.0f;
+
+    /// How much a cascade is grown on each side when it is fitted, as a fraction of its size, and how many times the
+    /// area it needs it can cover before it is fitted again
+    static constexpr float CASCADE_MARGIN = 0.1f;
+    static constexpr float MAX_CASCADE_SLACK = 2.0f;
+
+    /// The uniforms of the cascades, which the programs of both passes have
+    struct CascadeUniforms {
+        ShaderProgram::Uniform<glm::mat4> m_VP[MAX_CASCADES];
+        ShaderProgram::Uniform<glm::vec4> m_splits;
+        ShaderProgram::Uniform<GLint> m_numCascades, m_mask, m_depthTex;
+
+        /// Look up the uniforms of a program
+        void init(const ShaderProgram &/*program*/);
+    };
+
+    /// The model matrix and colour of a teapot, shared by both ways of drawing them
+    void objectTransform(size_t /*i*/, glm::mat4 &/*M*/, glm::vec3 &/*rgb*/) const;
+
+    /// Size the uniform ring and rebuild the instances after the number of teapots changes
+    void initObjects();
+
+    /// Describe the teapots and cascades for the frame time report, and start the average again
+    void updateWorkload();
 
-    /// Initialise the FBO
-    void initFBO();
+    /// Split the view frustum into cascades and fit a light frustum around the teapots in each of them, marking the
+    /// cascades which no longer fit as dirty
+    void fitCascades(const glm::mat4 &/*lightV*/);
 
-    /// Keep track of whether the FBO needs to be recreated
-    bool m_isFBODirty = true;
+    /// Find the teapots which can cast a shadow into a dirty cascade
+    void cullCasters();
+
+    /// Set the cascade uniforms of the program in use
+    void setCascadeUniforms(const CascadeUniforms &/*uniforms*/) const;
+
+    /// Draw some teapots given the particular View and Projection matrices
+    void drawScene(const glm::mat4 &/*V*/,
+                   const glm::mat4 &/*P*/);
+
+    /// Draw the teapots left by cullCasters() into the dirty cascades of the shadow map
+    void drawCasters();
 
     /// The number of objects to draw
     int m_numObjects = 5;
 
+    /// Whether the teapots are drawn with one instanced draw, and whether the objects need rebuilding
+    bool m_instanced = true;
+    bool m_isObjectsDirty = true;
+
+    /// The model matrices and colours of the teapots for the instanced draws
+    InstanceBuffer m_instances;
+
+    /// The centre of each teapot, and where it is seen from the light this frame, for fitting the cascades
+    std::vector<glm::vec3> m_objectCentres, m_lightCentres;
+
+    /// The number of cascades, the view projection matrix of the light for each, and the distance from the camera
+    /// at which each ends
+    int m_numCascades = 3;
+    glm::mat4 m_cascadeVP[MAX_CASCADES];
+    glm::vec4 m_cascadeSplits;
+
+    /// The light space bounds each cascade was last drawn with, and a bit for each cascade which must be drawn again
+    glm::vec3 m_cascadeMin[MAX_CASCADES], m_cascadeMax[MAX_CASCADES];
+    GLint m_dirtyCascades = 0;
+
+    /// The teapots drawn into the dirty cascades, and their instances when instancing
+    std::vector<size_t> m_casters;
+    InstanceBuffer m_casterInstances;
+
+    /// Whether the teapots have changed since the shadow map was drawn, and the light position it was drawn from
+    bool m_isCastersDirty = true;
+    glm::vec3 m_shadowLightPos;
+
+    /// What is being drawn, for the frame time report
+    std::string m_workload;
+
     /// A weighting of the blur radius (bit like inverse focal length)
     GLfloat m_blurRadius = 0.01f;
 
-    /// Id's used for the frame buffer object and associated textures
-    GLuint m_fboId, m_fboDepthId;
+    /// The layered target the cascades of the shadow map are drawn into, which is kept from frame to frame
+    RenderTargetPool m_renderTargets;
+    RenderTargetPool::Target *m_shadowMap = nullptr;
 
-    /// The shadow resolution
-    GLuint m_shadowRes = 1024;
+    /// The resolution of each cascade, a multiple of RenderTargetPool::BUCKET_SIZE so that it fills its texture
+    GLsizei m_shadowRes = 1024;
 
     /// Keep track of the light position
     glm::vec3 m_lightPos;
+
+    /// The programs which render the shadow map and the programs which read it, drawing one teapot or all of them
+    /// at once (the rest of their uniforms are in the frame and object blocks)
+    ShaderProgram m_depthProgram, m_shadowProgram;
+    ShaderProgram m_depthInstancedProgram, m_shadowInstancedProgram;
+    CascadeUniforms m_depthCascades, m_shadowCascades, m_depthInstancedCascades, m_shadowInstancedCascades;
 };
 
 #endif // SHADOWSCENE_H
@@ -0,0 +1,217 @@
+#include "unittests.h"
+#include "curvatureengine.h"
+
+#include <igl/read_triangle_mesh.h>
+#include <igl/principal_curvature.h>
+#include <Eigen/Core>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+/// The largest difference allowed between a record from update() and from compute(), relative to the value
+static const float RECORD_TOLERANCE = 1e-5f;
+
+/// The largest difference allowed between a principal curvature from the engine and from igl, relative to igl's
+static const double CURVATURE_TOLERANCE = 1e-4;
+
+/// The smallest |cos| allowed between a principal direction from the engine and from igl (about 0.8 degrees apart),
+/// checked where the two curvatures differ by more than DISTINCT_CURVATURES of their size
+static const double DIRECTION_TOLERANCE = 0.9999;
+static const double DISTINCT_CURVATURES = 0.01;
+
+/**
+ * @brief torusMesh A closed torus, which curves differently in each direction so that every part of the record
+ * is exercised
+ * @param V The vertex positions
+ * @param F The triangles
+ */
+static void torusMesh(CurvatureEngine::MatrixXfr &V, CurvatureEngine::MatrixXir &F) {
+    const int around = 96, across = 48;
+    const float major = 1.0f, minor = 0.4f;
+    V.resize(around * across, 3);
+    F.resize(2 * around * across, 3);
+    for (int i = 0; i < around; ++i) {
+        const float u = 2.0f * float(M_PI) * float(i) / float(around);
+        for (int j = 0; j < across; ++j) {
+            const float v = 2.0f * float(M_PI) * float(j) / float(across);
+            const int vertex = i * across + j;
+            V.row(vertex) << (major + minor * std::cos(v)) * std::cos(u),
+                             (major + minor * std::cos(v)) * std::sin(u),
+                             minor * std::sin(v);
+            const int right = ((i + 1) % around) * across + j;
+            const int up = i * across + (j + 1) % across;
+            const int diagonal = ((i + 1) % around) * across + (j + 1) % across;
+            F.row(2 * vertex) << vertex, right, diagonal;
+            F.row(2 * vertex + 1) << vertex, diagonal, up;
+        }
+    }
+}
+
+/**
+ * @brief bump Push the vertices within radius of the centre out along their normal, falling off to nothing at the
+ * edge of the bump
+ * @param V The vertex positions, which are moved
+ * @param normals The normals to move along
+ * @param centre The vertex at the middle of the bump
+ * @param radius The size of the bump
+ * @param height How far the centre moves
+ * @return The vertices which moved
+ */
+static std::vector<std::uint32_t> bump(CurvatureEngine::MatrixXfr &V, const std::vector<Eigen::Vector3d> &normals,
+                                       int centre, float radius, float height) {
+    const Eigen::Vector3f middle = V.row(centre).transpose();
+    std::vector<std::uint32_t> moved;
+    for (int v = 0; v < V.rows(); ++v) {
+        const float d = (V.row(v).transpose() - middle).norm() / radius;
+        if (d >= 1.0f) continue;
+        V.row(v) += normals[size_t(v)].cast<float>().transpose() * (height * (1.0f - d * d) * (1.0f - d * d));
+        moved.push_back(std::uint32_t(v));
+    }
+    return moved;
+}
+
+/**
+ * @brief matchesCompute Check the records kept up to date from update() against those of a full compute() of the
+ * same positions. Any vertex which update() should have listed as dirty but didn't is left stale, so this also
+ * checks dirtyVertices().
+ * @param step The edit, for the report
+ * @param V The current vertex positions
+ * @param F The triangles
+ * @param records The records written by writeInterleaved() for the dirty vertices of each update
+ * @return true if every record matches
+ */
+static bool matchesCompute(const char *step, const CurvatureEngine::MatrixXfr &V, const CurvatureEngine::MatrixXir &F,
+                           const std::vector<float> &records) {
+    CurvatureEngine engine;
+    engine.build(F, size_t(V.rows()));
+    engine.compute(V);
+    std::vector<float> expected(records.size());
+    engine.writeInterleaved(expected.data());
+
+    size_t numWrong = 0;
+    float maxError = 0.0f;
+    for (size_t i = 0; i < records.size(); ++i) {
+        const float error = std::fabs(records[i] - expected[i]) / (1.0f + std::fabs(expected[i]));
+        maxError = std::max(maxError, error);
+        if (!(error <= RECORD_TOLERANCE)) ++numWrong;
+    }
+    std::cout << "    " << step << ": largest relative difference " << maxError << "\n";
+    if (numWrong > 0) {
+        std::cout << "    " << numWrong << " of " << records.size() << " record values differ by more than "
+                  << RECORD_TOLERANCE << "\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief testUpdateMatchesCompute
+ * Edits a small part of a torus several times, keeping a copy of the records up to date from the dirty vertices of
+ * each update() as the curv sculpt does. The moved vertices are found by the engine, then given by the caller, and
+ * finally one part is moved with the curvature skipped, which the next update of another part has to catch up on.
+ * @return true if the records match a full compute() after every edit
+ */
+bool testUpdateMatchesCompute() {
+    CurvatureEngine::MatrixXfr V;
+    CurvatureEngine::MatrixXir F;
+    torusMesh(V, F);
+    CurvatureEngine engine;
+    engine.build(F, size_t(V.rows()));
+    engine.compute(V);
+    std::vector<float> records(size_t(V.rows()) * CurvatureEngine::FLOATS_PER_VERTEX);
+    engine.writeInterleaved(records.data());
+
+    bool isPassed = true;
+    bump(V, engine.normals(), 0, 0.3f, 0.05f);
+    engine.update(V.data(), 3);
+    std::cout << "    " << engine.dirtyVertices().size() << " of " << V.rows() << " vertices updated\n";
+    engine.writeInterleaved(records.data(), engine.dirtyVertices());
+    isPassed = matchesCompute("found moved", V, F, records) && isPassed;
+
+    const std::vector<std::uint32_t> moved = bump(V, engine.normals(), 1000, 0.25f, -0.03f);
+    engine.update(V.data(), 3, moved);
+    engine.writeInterleaved(records.data(), engine.dirtyVertices());
+    isPassed = matchesCompute("given moved", V, F, records) && isPassed;
+
+    bump(V, engine.normals(), 3000, 0.2f, 0.02f);
+    engine.update(V.data(), 3, false);
+    bump(V, engine.normals(), 4000, 0.2f, 0.02f);
+    engine.update(V.data(), 3);
+    engine.writeInterleaved(records.data(), engine.dirtyVertices());
+    isPassed = matchesCompute("after skipping the curvature", V, F, records) && isPassed;
+    return isPassed;
+}
+
+/**
+ * @brief matchesIgl Compare the curvature of one model with igl::principal_curvature, which the engine follows.
+ * Both are given the same float positions. The directions are compared up to sign, and only where the curvatures
+ * are far enough apart to pick them out, as near umbilic points any pair of tangents will do.
+ * @param fileName The model
+ * @return true if every vertex is within the tolerances
+ */
+static bool matchesIgl(const std::string &fileName) {
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi F;
+    if (!igl::read_triangle_mesh(fileName, V, F) || (V.rows() == 0)) {
+        std::cout << "    could not read " << fileName << "\n";
+        return false;
+    }
+    const CurvatureEngine::MatrixXfr positions = V.cast<float>();
+    V = positions.cast<double>();
+
+    Eigen::MatrixXd PD1, PD2;
+    Eigen::VectorXd PV1, PV2;
+    igl::principal_curvature(V, F, PD1, PD2, PV1, PV2);
+    CurvatureEngine engine;
+    engine.build(CurvatureEngine::MatrixXir(F), size_t(V.rows()));
+    engine.compute(positions);
+
+    size_t numCurvatures = 0, numDirections = 0, numCompared = 0;
+    double maxCurvature = 0.0, minCos = 1.0;
+    for (size_t v = 0; v < size_t(V.rows()); ++v) {
+        const Eigen::Index i = Eigen::Index(v);
+        const double k[2] = {engine.minCurvatures()[v], engine.maxCurvatures()[v]};
+        const double kIgl[2] = {PV1(i), PV2(i)};
+        const Eigen::Vector3d d[2] = {engine.minDirections()[v], engine.maxDirections()[v]};
+        const Eigen::Vector3d dIgl[2] = {PD1.row(i).transpose(), PD2.row(i).transpose()};
+        bool isCurvatureWrong = false, isDirectionWrong = false;
+        for (size_t j = 0; j < 2; ++j) {
+            const double error = std::fabs(k[j] - kIgl[j]) / (1.0 + std::fabs(kIgl[j]));
+            maxCurvature = std::max(maxCurvature, error);
+            if (!(error <= CURVATURE_TOLERANCE)) isCurvatureWrong = true;
+        }
+        if (std::fabs(kIgl[1] - kIgl[0]) > DISTINCT_CURVATURES * (std::fabs(kIgl[0]) + std::fabs(kIgl[1]))) {
+            ++numCompared;
+            for (size_t j = 0; j < 2; ++j) {
+                const double cosine = std::fabs(d[j].dot(dIgl[j]));
+                minCos = std::min(minCos, cosine);
+                if (!(cosine >= DIRECTION_TOLERANCE)) isDirectionWrong = true;
+            }
+        }
+        if (isCurvatureWrong) ++numCurvatures;
+        if (isDirectionWrong) ++numDirections;
+    }
+    std::cout << "    " << fileName << ": " << V.rows() << " vertices, largest relative curvature difference "
+              << maxCurvature << ", smallest |cos| between directions " << minCos << " over " << numCompared
+              << " vertices\n";
+    if ((numCurvatures > 0) || (numDirections > 0)) {
+        std::cout << "    " << numCurvatures << " vertices differ in curvature by more than " << CURVATURE_TOLERANCE
+                  << " and " << numDirections << " in direction by more than |cos| " << DIRECTION_TOLERANCE << "\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief testMatchesIgl
+ * Run from the tests directory, so that the models in common can be found.
+ * @return true if the curvature of the bundled models matches igl::principal_curvature
+ */
+bool testMatchesIgl() {
+    const bool isBustPassed = matchesIgl("../common/models/bust.off");
+    const bool isFertilityPassed = matchesIgl("../common/models/fertility.off");
+    return isBustPassed && isFertilityPassed;
+}
@@ -0,0 +1,46 @@
+#include "unittests.h"
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+/// Every test by the name it is run with
+static const struct {
+    const char *m_name;
+    UnitTest m_test;
+} TESTS[] = {
+    {"compactIndicesRestoreTriangles", testCompactIndicesRestoreTriangles},
+    {"stripsRestoreTriangles", testStripsRestoreTriangles},
+    {"updateMatchesCompute", testUpdateMatchesCompute},
+    {"matchesIgl", testMatchesIgl},
+};
+
+/**
+ * Runs the tests named on the command line, or all of them, and fails if any of them did (see unittests.h).
+ */
+int main(int argc, char **argv) {
+    const size_t numTests = sizeof(TESTS) / sizeof(TESTS[0]);
+    for (int i = 1; i < argc; ++i) {
+        bool isKnown = false;
+        for (size_t t = 0; t < numTests; ++t) isKnown = isKnown || (std::string(argv[i]) == TESTS[t].m_name);
+        if (!isKnown) {
+            std::cerr << "Usage: " << argv[0] << " [test ...]\nThe tests are:\n";
+            for (size_t t = 0; t < numTests; ++t) std::cerr << "  " << TESTS[t].m_name << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    int numRun = 0, numFailed = 0;
+    for (size_t t = 0; t < numTests; ++t) {
+        bool isSelected = (argc == 1);
+        for (int i = 1; i < argc; ++i) isSelected = isSelected || (std::string(argv[i]) == TESTS[t].m_name);
+        if (!isSelected) continue;
+        std::cout << TESTS[t].m_name << std::endl;
+        const bool isPassed = TESTS[t].m_test();
+        std::cout << "    " << (isPassed ? "passed" : "FAILED") << "\n";
+        ++numRun;
+        if (!isPassed) ++numFailed;
+    }
+    std::cout << (numRun - numFailed) << " passed, " << numFailed << " failed\n";
+    return (numFailed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+#include "unittests.h"
+#include "meshoptimiser.h"
+
+#include <iostream>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <random>
+#include <cstdint>
+
+typedef std::array<std::uint32_t, 3> Triangle;
+
+/**
+ * @brief gridMesh A grid of more vertices than 16 bit indices can reach, so compactIndices() needs several windows,
+ * with its triangles shuffled so that the strips have to be found rather than read off in order. A fan of long
+ * triangles from the first vertex to some extra ones at the end can't fit in any window, which fills the 32 bit run.
+ * @param numVertices Set to the number of vertices
+ * @return The triangle list
+ */
+static std::vector<std::uint32_t> gridMesh(size_t &numVertices) {
+    const std::uint32_t size = 320, numFan = 8;
+    std::vector<Triangle> triangles;
+    for (std::uint32_t y = 0; y + 1 < size; ++y) {
+        for (std::uint32_t x = 0; x + 1 < size; ++x) {
+            const std::uint32_t v = y * size + x;
+            triangles.push_back({{v, v + 1, v + size}});
+            triangles.push_back({{v + 1, v + size + 1, v + size}});
+        }
+    }
+    const std::uint32_t fan = size * size;
+    for (std::uint32_t i = 0; i + 1 < numFan; ++i) triangles.push_back({{0, fan + i + 1, fan + i}});
+    numVertices = fan + numFan;
+
+    std::mt19937 random(7);
+    std::shuffle(triangles.begin(), triangles.end(), random);
+    std::vector<std::uint32_t> indices;
+    for (const Triangle &t : triangles) indices.insert(indices.end(), t.begin(), t.end());
+    return indices;
+}
+
+/**
+ * @brief canonical Rotate a triangle so that it starts at its smallest index, which keeps its winding
+ * @param a The first corner
+ * @param b The second corner
+ * @param c The third corner
+ * @return The rotated triangle
+ */
+static Triangle canonical(std::uint32_t a, std::uint32_t b, std::uint32_t c) {
+    if ((b < a) && (b < c)) return {{b, c, a}};
+    if ((c < a) && (c < b)) return {{c, a, b}};
+    return {{a, b, c}};
+}
+
+/**
+ * @brief appendTriangles Undo one run of compactIndices() the way GL draws it, adding back its base vertex. Strips
+ * restart after the maximum index value, and every odd triangle of a strip swaps its first two corners to keep the
+ * winding. Degenerate strip triangles are skipped, as GL doesn't draw them.
+ * @param indices The indices of the run
+ * @param range Where the run is and its base vertex
+ * @param strips Whether the indices are strips or a list
+ * @param triangles The triangles of the run are appended here
+ */
+template<typename Index>
+static void appendTriangles(const std::vector<Index> &indices, const MeshOptimiser::IndexRange &range, bool strips,
+                            std::vector<Triangle> &triangles) {
+    const Index restart = Index(~Index(0));
+    const std::uint32_t first = range.m_first, last = range.m_first + range.m_count;
+    if (!strips) {
+        for (std::uint32_t i = first; i + 2 < last; i += 3) {
+            triangles.push_back(canonical(indices[i] + range.m_baseVertex, indices[i + 1] + range.m_baseVertex,
+                                          indices[i + 2] + range.m_baseVertex));
+        }
+        return;
+    }
+    std::uint32_t start = first;
+    for (std::uint32_t i = first; i <= last; ++i) {
+        if ((i < last) && (indices[i] != restart)) continue;
+        for (std::uint32_t j = start; j + 2 < i; ++j) {
+            const bool odd = ((j - start) & 1) != 0;
+            const std::uint32_t a = indices[odd ? j + 1 : j] + range.m_baseVertex;
+            const std::uint32_t b = indices[odd ? j : j + 1] + range.m_baseVertex;
+            const std::uint32_t c = indices[j + 2] + range.m_baseVertex;
+            if ((a != b) && (b != c) && (c != a)) triangles.push_back(canonical(a, b, c));
+        }
+        start = i + 1;
+    }
+}
+
+/**
+ * @brief restoresTriangles Check that the triangles drawn from the output of compactIndices() are exactly those of
+ * the list, each with the same winding, whatever their order
+ * @param name The mesh, for the report
+ * @param indices The triangle list
+ * @param numVertices The number of vertices
+ * @param stripify Whether to build strips
+ * @return true if the triangles match and both index types were used
+ */
+static bool restoresTriangles(const char *name, const std::vector<std::uint32_t> &indices, size_t numVertices,
+                              bool stripify) {
+    const MeshOptimiser::CompactIndices compact =
+            MeshOptimiser::compactIndices(indices.data(), indices.size(), numVertices, true, stripify);
+    std::vector<Triangle> expected, drawn;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        expected.push_back(canonical(indices[i], indices[i + 1], indices[i + 2]));
+    }
+    for (const MeshOptimiser::IndexRange &range : compact.m_ranges16) {
+        appendTriangles(compact.m_indices16, range, compact.m_strips, drawn);
+    }
+    for (const MeshOptimiser::IndexRange &range : compact.m_ranges32) {
+        appendTriangles(compact.m_indices32, range, compact.m_strips, drawn);
+    }
+    std::sort(expected.begin(), expected.end());
+    std::sort(drawn.begin(), drawn.end());
+
+    const size_t numIndices = compact.m_indices16.size() + compact.m_indices32.size();
+    std::cout << "    " << name << ": " << expected.size() << " triangles in " << indices.size() << " indices, "
+              << drawn.size() << " drawn from " << numIndices << " indices in " << compact.m_ranges16.size()
+              << " 16 bit and " << compact.m_ranges32.size() << " 32 bit runs\n";
+    if (compact.m_ranges16.empty() || compact.m_ranges32.empty()) {
+        std::cout << "    the mesh should need both 16 and 32 bit runs\n";
+        return false;
+    }
+    if (drawn != expected) {
+        std::vector<Triangle> missing, extra;
+        std::set_difference(expected.begin(), expected.end(), drawn.begin(), drawn.end(), std::back_inserter(missing));
+        std::set_difference(drawn.begin(), drawn.end(), expected.begin(), expected.end(), std::back_inserter(extra));
+        std::cout << "    " << missing.size() << " triangles are missing or flipped and " << extra.size()
+                  << " are extra\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief restoresTriangles Check both the shuffled grid and the grid after optimise(), whose cache order is what the
+ * demos actually compact
+ * @param stripify Whether to build strips
+ * @return true if both match
+ */
+static bool restoresTriangles(bool stripify) {
+    size_t numVertices = 0;
+    std::vector<std::uint32_t> indices = gridMesh(numVertices);
+    const bool isShuffledPassed = restoresTriangles("shuffled", indices, numVertices, stripify);
+
+    std::vector<float> vertices(numVertices);
+    MeshOptimiser::optimiseTriangles(indices.data(), indices.size(), numVertices);
+    MeshOptimiser::optimiseVertices(indices.data(), indices.size(), vertices.data(), numVertices, 1);
+    const bool isOptimisedPassed = restoresTriangles("optimised", indices, numVertices, stripify);
+    return isShuffledPassed && isOptimisedPassed;
+}
+
+/**
+ * @brief testCompactIndicesRestoreTriangles
+ * @return true if the triangle list survives compactIndices()
+ */
+bool testCompactIndicesRestoreTriangles() {
+    return restoresTriangles(false);
+}
+
+/**
+ * @brief testStripsRestoreTriangles
+ * @return true if the triangle list survives being joined into strips
+ */
+bool testStripsRestoreTriangles() {
+    return restoresTriangles(true);
+}
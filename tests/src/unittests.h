@@ -0,0 +1,27 @@
+#ifndef UNITTESTS_H
+#define UNITTESTS_H
+
+/**
+ * The unit tests of the geometry processing in common. Each one prints what went wrong to std::cout and returns
+ * false if it fails. They are listed by name in main.cpp, so that a single test can be run on its own:
+ *
+ *     cd tests && ./tests                (runs all of them)
+ *     ./tests stripsRestoreTriangles     (runs just the named ones)
+ */
+
+/// A unit test, returning true if it passed
+typedef bool (*UnitTest)();
+
+/// compactIndices() without strips keeps every triangle of the list with its winding
+bool testCompactIndicesRestoreTriangles();
+
+/// Undoing the triangle strips of compactIndices() gives back every triangle of the list with its winding
+bool testStripsRestoreTriangles();
+
+/// CurvatureEngine::update() after a local edit gives the same records as a full compute()
+bool testUpdateMatchesCompute();
+
+/// CurvatureEngine gives the same principal curvature as igl::principal_curvature on the bundled models
+bool testMatchesIgl();
+
+#endif // UNITTESTS_H
@@ -0,0 +1,33 @@
+# The unit tests check the geometry processing in common on the CPU, so they need Eigen and libigl but no GL or NGL
+TEMPLATE = app
+TARGET = tests
+
+CONFIG += console c++11 debug thread
+CONFIG -= qt app_bundle
+
+OBJECTS_DIR = obj
+
+# The same locations as common.pri, which can be overridden with IGLDIR and EIGENDIR (see README.md)
+IGLPATH = $$(IGLDIR)
+isEmpty(IGLPATH) {
+  IGLPATH = /public/devel/libigl
+}
+EIGENPATH = $$(EIGENDIR)
+isEmpty(EIGENPATH) {
+  EIGENPATH = /public/devel/2018/include/eigen3
+}
+INCLUDEPATH += ../common/include $$IGLPATH/include $$EIGENPATH
+
+# Input
+SOURCES += src/main.cpp \
+           src/meshoptimisertests.cpp \
+           src/curvatureenginetests.cpp \
+           ../common/src/meshoptimiser.cpp \
+           ../common/src/curvatureengine.cpp \
+           ../common/src/meshtopology.cpp
+
+HEADERS += src/unittests.h \
+           ../common/include/meshoptimiser.h \
+           ../common/include/curvatureengine.h \
+           ../common/include/meshtopology.h \
+           ../common/include/parallelfor.h
@@ -1,4 +1,5 @@
 #include "woodscene.h"
+#include "tracelog.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <ngl/Obj.h>
@@ -13,6 +14,8 @@ WoodScene::WoodScene() : Scene(),
 
 
 void WoodScene::initGL() noexcept {
+    TraceScope trace("WoodScene::initGL");
+
     // Fire up the NGL machinary (not doing this will make it crash)
     ngl::NGLInit::instance();
 
@@ -27,9 +30,11 @@ void WoodScene::initGL() noexcept {
 
     // Create and compile the vertex and fragment shader
     ngl::ShaderLib *shader = ngl::ShaderLib::instance();
+    TraceLog::begin("loadShader");
     shader->loadShader("WoodProgram",
                        "shaders/wood_vert.glsl",
                        "shaders/wood_frag.glsl");
+    TraceLog::end("loadShader");
 
 
     // Our third 3D texture is for diffuse and specular variation, and is simplex noise
@@ -46,6 +51,8 @@ void WoodScene::initGL() noexcept {
 }
 
 void WoodScene::paintGL() noexcept {
+    TraceScope trace("WoodScene::paintGL");
+
     // Clear the screen (fill with our glClearColor)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 